@@ -0,0 +1,156 @@
+// Sweeps the parameters of the backtest strategy (see BacktestParams) over
+// one recorded tick file on every core and prints the best runs by net PnL.
+// The ticks are loaded once and shared read-only by all runs.
+//
+// Usage: Backtest <file> [threads] [name=value | name=from:to:step ...]
+//
+// <file> may be a binary tick journal, a tick store file or a Write2Txt text
+// file.  threads 0 (the default) uses one per hardware thread.
+//
+// Strategy parameters, each a single value or a range:
+//   entry   microprice lean from the mid to enter on, in ticks
+//   flow    order flow imbalance that must agree with the lean
+//   target  profit target in ticks        stop    stop loss in ticks
+//   hold    seconds before giving up      qty     contracts per order
+//   max     largest position
+// Fill model, single values:
+//   tick    tick size                     mult    currency per point
+//   fee     per contract                  latency order latency in microseconds
+//   slip    ticks of slippage beyond the displayed size
+// Output:
+//   top     number of runs to print (default 20)
+//
+// Example: Backtest ES.ticks 0 entry=0.1:0.9:0.1 target=1:8:1 stop=1:8:1 tick=0.25 mult=50 fee=1.2
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <stdexcept>
+#include "Backtester.h"
+
+// The values of one swept parameter.
+struct Axis
+{
+	std::string name;
+	std::vector<double> values;
+};
+
+// "from:to:step" or a single value.
+static std::vector<double> ParseRange(const std::string & name, const std::string & text)
+{
+	std::vector<double> values;
+	double from, to, step;
+	if(std::sscanf(text.c_str(), "%lf:%lf:%lf", &from, &to, &step) == 3)
+	{
+		if(step <= 0 || to < from) throw std::runtime_error("bad range for " + name + ": " + text);
+		// Allow for rounding in the last step:
+		for(int i = 0; from + i * step <= to + step * 1e-9; ++i)
+			values.push_back(from + i * step);
+	}
+	else
+	{
+		values.push_back(std::atof(text.c_str()));
+	}
+	return values;
+}
+
+static void SetParam(BacktestParams & params, const std::string & name, double value)
+{
+	if(name == "entry") params.entryTicks = value;
+	else if(name == "flow") params.minOrderFlow = value;
+	else if(name == "target") params.takeProfitTicks = value;
+	else if(name == "stop") params.stopLossTicks = value;
+	else if(name == "hold") params.maxHoldNs = static_cast<int64_t>(value * 1e9);
+	else if(name == "qty") params.orderQty = static_cast<int>(value);
+	else if(name == "max") params.maxPosition = static_cast<int>(value);
+	else throw std::runtime_error("unknown parameter " + name);
+}
+
+static bool SetFillModel(FillModel & fills, const std::string & name, double value)
+{
+	if(name == "tick") fills.tickSize = value;
+	else if(name == "mult") fills.multiplier = value;
+	else if(name == "fee") fills.feePerContract = value;
+	else if(name == "latency") fills.latencyNs = static_cast<int64_t>(value * 1e3);
+	else if(name == "slip") fills.slippageTicks = value;
+	else return false;
+	return true;
+}
+
+// Every combination of the axes, the last axis varying fastest.
+static std::vector<BacktestParams> BuildGrid(const std::vector<Axis> & axes)
+{
+	std::vector<BacktestParams> grid(1);
+	for(size_t a = 0; a < axes.size(); ++a)
+	{
+		std::vector<BacktestParams> next;
+		next.reserve(grid.size() * axes[a].values.size());
+		for(size_t i = 0; i < grid.size(); ++i)
+		{
+			for(size_t v = 0; v < axes[a].values.size(); ++v)
+			{
+				BacktestParams params = grid[i];
+				SetParam(params, axes[a].name, axes[a].values[v]);
+				next.push_back(params);
+			}
+		}
+		grid.swap(next);
+	}
+	return grid;
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc < 2)
+	{
+		std::cerr << "Usage: Backtest <file> [threads] [name=value | name=from:to:step ...]" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		int threads = 0;
+		int first = 2;
+		if(argc > 2 && std::string(argv[2]).find('=') == std::string::npos)
+		{
+			threads = std::atoi(argv[2]);
+			first = 3;
+		}
+
+		FillModel fills;
+		std::vector<Axis> axes;
+		size_t top = 20;
+		for(int i = first; i < argc; ++i)
+		{
+			std::string arg(argv[i]);
+			size_t eq = arg.find('=');
+			if(eq == std::string::npos) throw std::runtime_error("expected name=value, got " + arg);
+			std::string name = arg.substr(0, eq);
+			std::string value = arg.substr(eq + 1);
+
+			if(name == "top") top = static_cast<size_t>(std::atoi(value.c_str()));
+			else if(!SetFillModel(fills, name, std::atof(value.c_str())))
+			{
+				Axis axis = { name, ParseRange(name, value) };
+				axes.push_back(axis);
+			}
+		}
+
+		std::vector<BacktestParams> grid = BuildGrid(axes);
+
+		TickTape tape(argv[1]);
+		Backtester backtester(tape, fills);
+		std::vector<BacktestResult> results = backtester.Run(grid, threads);
+
+		Backtester::PrintTable(std::cout, grid, results, top);
+		backtester.Report(std::cout, results.size());
+	}
+	catch(std::exception & e)
+	{
+		std::cerr << "Backtest: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include "BenchHarness.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+static std::atomic<unsigned long long> allocations(0);
+
+unsigned long long AllocationCount()
+{
+	return allocations.load(std::memory_order_relaxed);
+}
+
+// Count every allocation in the process; benchmarks report the difference
+// across the timed loop.
+void* operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void* p = std::malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) throw()
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) throw()
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void* p) throw()
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) throw()
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) throw()
+{
+	std::free(p);
+}
+
+void PrintResult(const BenchResult & r)
+{
+	std::printf("%s_iterations %lld\n", r.name.c_str(), r.iterations);
+	std::printf("%s_ns_per_op %.1f\n", r.name.c_str(), r.nsPerOp);
+	std::printf("%s_allocs_per_op %.2f\n", r.name.c_str(), r.allocsPerOp);
+	std::printf("%s_ops_per_sec %.0f\n", r.name.c_str(), r.opsPerSec);
+	std::fflush(stdout);
+}
+
+std::string FinishFixMessage(const std::string & body)
+{
+	std::ostringstream msg;
+	msg << "8=FIX.4.2\0019=" << body.size() << '\001' << body;
+	std::string text = msg.str();
+
+	unsigned checksum = 0;
+	for (size_t i = 0; i < text.size(); ++i) checksum += static_cast<unsigned char>(text[i]);
+	char trailer[16];
+	std::snprintf(trailer, sizeof(trailer), "10=%03u\001", checksum % 256);
+	return text + trailer;
+}
@@ -0,0 +1,51 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <chrono>
+#include <string>
+
+/// Heap allocations made by this process so far (operator new calls; see
+/// BenchHarness.cpp, which replaces the global operator new).
+unsigned long long AllocationCount();
+
+struct BenchResult
+{
+	std::string name;
+	long long iterations;
+	double nsPerOp;
+	double allocsPerOp;
+	double opsPerSec;
+};
+
+/// Print `r` as "<name>_<metric> <value>" lines, the same key/value format
+/// as the other benchmarks, so runs can be diffed or scraped.
+void PrintResult(const BenchResult & r);
+
+/// Time `iterations` calls of `f` after a warm-up of a tenth as many.  `f`
+/// returns a value that is summed into `sink` so the work is not optimised away.
+template <class F>
+BenchResult RunBench(const std::string & name, long long iterations, F f, double & sink)
+{
+	for (long long i = 0; i < iterations / 10 + 1; ++i) sink += f();
+
+	const unsigned long long allocsBefore = AllocationCount();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (long long i = 0; i < iterations; ++i) sink += f();
+	std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+	const unsigned long long allocs = AllocationCount() - allocsBefore;
+
+	const double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+	BenchResult r;
+	r.name = name;
+	r.iterations = iterations;
+	r.nsPerOp = ns / iterations;
+	r.allocsPerOp = static_cast<double>(allocs) / iterations;
+	r.opsPerSec = ns > 0 ? iterations * 1e9 / ns : 0;
+	return r;
+}
+
+/// Prepend BeginString/BodyLength and append the CheckSum to a FIX body
+/// ("35=...^A...^A") so QuickFIX will parse it.
+std::string FinishFixMessage(const std::string & body);
+
+#endif
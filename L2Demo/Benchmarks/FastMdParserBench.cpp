@@ -0,0 +1,125 @@
+// Compares decoding a MarketDataIncrementalRefresh the way Simple::onMessage
+// does it (QuickFIX getGroup copies of every NoMDEntries group) with the raw
+// buffer fast path in FastMdParser.
+//
+// Usage: FastMdParserBench <path to QuickFIX FIX42.xml> [entries per message] [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <quickfix/Message.h>
+#include <quickfix/fix42/MarketDataIncrementalRefresh.h>
+#include "FastMdParser.h"
+
+// Build a valid X message with `entries` bid/offer/trade updates, including
+// correct BodyLength and CheckSum so QuickFIX accepts it.
+static std::string BuildIncrementalRefresh(int entries)
+{
+	std::ostringstream body;
+	body << "35=X\00134=42\00149=EXCHANGE\00152=20141103-14:30:00.123\00156=TRADER\001262=1\001268=" << entries << '\001';
+	for (int i = 0; i < entries; ++i)
+	{
+		const char type = "012"[i % 3];
+		body << "279=" << (i % 4 == 3 ? '1' : '0') << '\001'
+		     << "269=" << type << '\001'
+		     << "55=ES\001200=201412\001"
+		     << "270=" << 1975.25 + 0.25 * (i % 8) << '\001'
+		     << "271=" << 10 + i << '\001';
+	}
+
+	std::ostringstream msg;
+	msg << "8=FIX.4.2\0019=" << body.str().size() << '\001' << body.str();
+	std::string text = msg.str();
+
+	unsigned checksum = 0;
+	for (size_t i = 0; i < text.size(); ++i) checksum += static_cast<unsigned char>(text[i]);
+	char trailer[16];
+	std::snprintf(trailer, sizeof(trailer), "10=%03u\001", checksum % 256);
+	return text + trailer;
+}
+
+// What Simple::onMessage(MarketDataIncrementalRefresh) did per entry.
+static double DecodeWithGroups(const FIX42::MarketDataIncrementalRefresh& msg)
+{
+	double sum = 0;
+	FIX::NoMDEntries noMDEntries;
+	msg.get(noMDEntries);
+	for (int i = 1; i <= noMDEntries; ++i)
+	{
+		FIX42::MarketDataIncrementalRefresh::NoMDEntries group;
+		FIX::MDEntryType type;
+		FIX::MDEntryPx px;
+		FIX::MDEntrySize qty;
+		FIX::MDUpdateAction action;
+
+		msg.getGroup(i, group);
+		group.get(type);
+		group.get(px);
+		group.get(qty);
+		group.get(action);
+		sum += px.getValue() + qty.getValue() + type.getValue() + action.getValue();
+	}
+	return sum;
+}
+
+static double DecodeFast(const std::string& raw)
+{
+	FastMdMessage md;
+	if (!ParseFastMd(raw.data(), raw.size(), md)) return -1;
+
+	double sum = 0;
+	for (int i = 0; i < md.count; ++i)
+		sum += md.entries[i].md.px + md.entries[i].md.qty + md.entries[i].md.type + md.entries[i].md.action;
+	return sum;
+}
+
+template <class F>
+static double TimeNsPerOp(int iterations, F f, double& sink)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; ++i) sink += f();
+	std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(stop - start).count() / iterations;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "Usage: FastMdParserBench <FIX42.xml> [entries per message] [iterations]\n");
+		return 1;
+	}
+	const int entries = argc > 2 ? std::atoi(argv[2]) : 10;
+	const int iterations = argc > 3 ? std::atoi(argv[3]) : 200000;
+
+	FIX::DataDictionary dictionary(argv[1]);
+	const std::string raw = BuildIncrementalRefresh(entries);
+	const FIX42::MarketDataIncrementalRefresh parsed(FIX::Message(raw, dictionary));
+
+	double sink = 0;
+	if (DecodeFast(raw) != DecodeWithGroups(parsed))
+	{
+		std::fprintf(stderr, "fast path and QuickFIX disagree on the decoded entries\n");
+		return 1;
+	}
+
+	// Warm up both paths before timing them:
+	TimeNsPerOp(iterations / 10 + 1, [&]() { return DecodeWithGroups(parsed); }, sink);
+	TimeNsPerOp(iterations / 10 + 1, [&]() { return DecodeFast(raw); }, sink);
+
+	double groups = TimeNsPerOp(iterations, [&]() { return DecodeWithGroups(parsed); }, sink);
+	double fast = TimeNsPerOp(iterations, [&]() { return DecodeFast(raw); }, sink);
+	double parseAndGroups = TimeNsPerOp(iterations / 10 + 1, [&]() {
+		return DecodeWithGroups(FIX42::MarketDataIncrementalRefresh(FIX::Message(raw, dictionary)));
+	}, sink);
+
+	std::printf("entries_per_message %d\n", entries);
+	std::printf("getGroup_decode_ns_per_msg %.1f\n", groups);
+	std::printf("quickfix_parse_plus_getGroup_ns_per_msg %.1f\n", parseAndGroups);
+	std::printf("fast_path_ns_per_msg %.1f\n", fast);
+	std::printf("speedup_vs_getGroup %.2f\n", groups / fast);
+	std::printf("(checksum %g)\n", sink);
+	return 0;
+}
@@ -0,0 +1,205 @@
+// Microbenchmarks for the code every message goes through: the Simple
+// market data and ExecutionReport handlers (fed prebuilt FIX messages through
+// fromApp, as QuickFIX would), SendMarketOrder's message construction
+// (from its template and from scratch), IdHelper::GetNextOrderId against
+// IdService, and Write2Txt.  Each benchmark prints ns/op, heap
+// allocations/op and ops/s as "key value" lines.
+//
+// Usage: HotPathBench <path to QuickFIX FIX42.xml> [iterations] [name filter]
+//
+// Run it from a scratch directory: Simple and IdHelper keep their order ids
+// in the working directory, and the other benchmarks write bench_* files there.  The
+// Strategy's console output is discarded while timing, but still formatted.
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <quickfix/Message.h>
+#include <quickfix/fix42/MarketDataIncrementalRefresh.h>
+#include <quickfix/fix42/MarketDataSnapshotFullRefresh.h>
+#include <quickfix/fix42/ExecutionReport.h>
+#include <quickfix/fix42/NewOrderSingle.h>
+#include "BenchHarness.h"
+#include "Simple.h"
+#include "Strategy.h"
+#include "FillSimulator.h"
+#include "IdHelper.h"
+#include "IdService.h"
+#include "Write2Txt.h"
+
+// Simple is constructed from a Strategy below; see StrategyBinding.h.
+static_assert(std::is_same<BoundStrategy, Strategy>::value, "HotPathBench needs the default L2_STRATEGY binding");
+
+static const char* SYMBOL = "ES";
+static const char* MATURITY = "201412";
+
+// Bid and offer changes plus a trade.  `variant` moves the quantities so
+// consecutive messages really change the book and reach the Strategy.
+static std::string IncrementalRefresh(int variant)
+{
+	std::ostringstream body;
+	body << "35=X\00134=42\00149=EXCHANGE\00152=20141103-14:30:00.123\00156=TRADER\001262=1\001268=3\001"
+	     << "279=1\001269=0\00155=" << SYMBOL << "\001200=" << MATURITY << "\001270=1975.25\001271=" << 10 + variant << '\001'
+	     << "279=1\001269=1\00155=" << SYMBOL << "\001200=" << MATURITY << "\001270=1975.5\001271=" << 20 + variant << '\001'
+	     << "279=0\001269=2\00155=" << SYMBOL << "\001200=" << MATURITY << "\001270=1975.5\001271=" << 1 + variant << '\001';
+	return FinishFixMessage(body.str());
+}
+
+static std::string SnapshotFullRefresh(int variant)
+{
+	std::ostringstream body;
+	body << "35=W\00134=43\00149=EXCHANGE\00152=20141103-14:30:00.123\00156=TRADER\001262=1\00155=" << SYMBOL
+	     << "\001200=" << MATURITY << "\001268=3\001"
+	     << "269=0\001270=1975.25\001271=" << 10 + variant << '\001'
+	     << "269=1\001270=1975.5\001271=" << 20 + variant << '\001'
+	     << "269=2\001270=1975.5\001271=" << 1 + variant << '\001';
+	return FinishFixMessage(body.str());
+}
+
+static std::string ExecutionReport(char execType, char ordStatus)
+{
+	std::ostringstream body;
+	body << "35=8\00134=44\00149=EXCHANGE\00152=20141103-14:30:00.123\00156=TRADER\001"
+	     << "37=1\00111=1\00117=1\00120=0\001150=" << execType << "\00139=" << ordStatus
+	     << "\00155=" << SYMBOL << "\001200=" << MATURITY << "\00154=1\00138=1\001151=0\00114=1\0016=1975.5\00132=1\00131=1975.5\001";
+	return FinishFixMessage(body.str());
+}
+
+static bool Selected(const std::string& filter, const char* name)
+{
+	return filter.empty() || std::string(name).find(filter) != std::string::npos;
+}
+
+// What SendMarketOrder did before order templates: a new message, every field set.
+static FIX42::NewOrderSingle BuildMarketOrderFresh(const std::string& clOrdId, SimpleSide side, int qty)
+{
+	FIX42::NewOrderSingle msg;
+	msg.set(FIX::Side(BUY == side ? FIX::Side_BUY : FIX::Side_SELL));
+	msg.set(FIX::Symbol(SYMBOL));
+	msg.set(FIX::MaturityMonthYear(MATURITY));
+	msg.set(FIX::Account("BENCH"));
+	msg.set(FIX::OrderQty(qty));
+	msg.set(FIX::ClOrdID(clOrdId));
+	msg.set(FIX::OrdType(FIX::OrdType_MARKET));
+	msg.set(FIX::TimeInForce(FIX::TimeInForce_DAY));
+	msg.set(FIX::SecurityExchange("CME"));
+	msg.set(FIX::SecurityType("FUT"));
+	msg.set(FIX::CustomerOrFirm(0));
+	msg.set(FIX::Rule80A('A'));
+	return msg;
+}
+
+/// Swallows everything written to it.
+class NullBuffer : public std::streambuf
+{
+protected:
+	int overflow(int c) { return c; }
+	std::streamsize xsputn(const char*, std::streamsize n) { return n; }
+};
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "Usage: HotPathBench <FIX42.xml> [iterations] [name filter]\n");
+		return 1;
+	}
+	const long long iterations = argc > 2 ? std::atoll(argv[2]) : 100000;
+	const std::string filter = argc > 3 ? argv[3] : "";
+
+	FIX::DataDictionary dictionary(argv[1]);
+	const FIX::SessionID sessionId("FIX.4.2", "TRADER", "EXCHANGE");
+
+	const FIX::Message incremental[2] = { FIX::Message(IncrementalRefresh(0), dictionary), FIX::Message(IncrementalRefresh(1), dictionary) };
+	const FIX::Message snapshot[2] = { FIX::Message(SnapshotFullRefresh(0), dictionary), FIX::Message(SnapshotFullRefresh(1), dictionary) };
+	const FIX::Message fill(ExecutionReport(FIX::ExecType_FILL, FIX::OrdStatus_FILLED), dictionary);
+	const FIX::Message ack(ExecutionReport(FIX::ExecType_NEW, FIX::OrdStatus_NEW), dictionary);
+
+	// Simple without FIX sessions; the Strategy subscribes to SYMBOL as MDReqID 1.
+	Strategy strategy(SYMBOL, MATURITY, "BENCH", shared_ptr<Write2Txt>());
+	Simple simple(strategy);
+	FillSimulator fills;
+	simple.InitSimulation(fills);
+	FIX::Application& application = simple;
+	const InstrumentId instrument = simple.Instruments().Find(SYMBOL, MATURITY, "CME");
+
+	IdHelper ids;
+	IdService idService("bench_orderid.dat");
+	Write2Txt text("bench_ticks.txt");
+	Write2Txt journal("bench_ticks.journal", TICK_FORMAT_JOURNAL);
+	const std::time_t now = std::time(nullptr);
+
+	NullBuffer null;
+	std::streambuf* console = std::cout.rdbuf(&null);
+
+	double sink = 0;
+	long long n = 0;
+	std::vector<BenchResult> results;
+
+	if (Selected(filter, "simple_md_incremental_refresh"))
+		results.push_back(RunBench("simple_md_incremental_refresh", iterations, [&]() {
+			application.fromApp(incremental[++n & 1], sessionId);
+			return 1.0;
+		}, sink));
+
+	if (Selected(filter, "simple_md_snapshot"))
+		results.push_back(RunBench("simple_md_snapshot", iterations, [&]() {
+			application.fromApp(snapshot[++n & 1], sessionId);
+			return 1.0;
+		}, sink));
+
+	if (Selected(filter, "simple_exec_report_fill"))
+		results.push_back(RunBench("simple_exec_report_fill", iterations, [&]() {
+			application.fromApp(fill, sessionId);
+			return 1.0;
+		}, sink));
+
+	if (Selected(filter, "simple_exec_report_new"))
+		results.push_back(RunBench("simple_exec_report_new", iterations, [&]() {
+			application.fromApp(ack, sessionId);
+			return 1.0;
+		}, sink));
+
+	if (Selected(filter, "simple_build_market_order_fresh"))
+		results.push_back(RunBench("simple_build_market_order_fresh", iterations, [&]() {
+			return static_cast<double>(BuildMarketOrderFresh(ids.GetNextOrderId(), BUY, 1).totalFields());
+		}, sink));
+
+	if (Selected(filter, "simple_build_market_order"))
+		results.push_back(RunBench("simple_build_market_order", iterations, [&]() {
+			return static_cast<double>(simple.BuildMarketOrder(instrument, "BENCH", BUY, 1).totalFields());
+		}, sink));
+
+	if (Selected(filter, "idhelper_next_order_id"))
+		results.push_back(RunBench("idhelper_next_order_id", iterations, [&]() {
+			return static_cast<double>(ids.GetNextOrderId().size());
+		}, sink));
+
+	if (Selected(filter, "idservice_next_order_id"))
+		results.push_back(RunBench("idservice_next_order_id", iterations, [&]() {
+			return static_cast<double>(idService.NextOrderId().size);
+		}, sink));
+
+	if (Selected(filter, "write2txt_write_txt_file"))
+		results.push_back(RunBench("write2txt_write_txt_file", iterations, [&]() {
+			text.Write_txt_file(now, "BID", 10, 1975.25);
+			return 1.0;
+		}, sink));
+
+	if (Selected(filter, "write2txt_journal_tick"))
+		results.push_back(RunBench("write2txt_journal_tick", iterations, [&]() {
+			journal.Write_tick(now, TICK_BID, 10, 1975.25);
+			return 1.0;
+		}, sink));
+
+	std::cout.rdbuf(console);
+	for (size_t i = 0; i < results.size(); ++i)
+		PrintResult(results[i]);
+	std::printf("(checksum %g)\n", sink);
+	return 0;
+}
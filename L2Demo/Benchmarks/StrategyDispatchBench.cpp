@@ -0,0 +1,188 @@
+// Per-tick cost of calling strategies the way Simple does (a type bound at
+// compile time, StrategyList for several) against calling the same
+// strategies through a virtual interface, with one and with four strategies
+// listening to the feed.  Prints "key value" lines like the other benchmarks.
+//
+// Usage: StrategyDispatchBench [iterations]
+//
+// The strategies are deliberately cheap, so the numbers are dominated by
+// the dispatch itself: the call, and whatever the compiler could not inline
+// or hoist because of it.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "BenchHarness.h"
+#include "OrderBook.h"
+#include "StrategyList.h"
+
+// Stands in for Simple: the strategies below never call back into it.
+struct BenchSimple
+{
+};
+
+enum BenchSide { BENCH_BUY = '1', BENCH_SELL = '2' };
+
+// Keeps a running sum of the spread, like a signal fed from the top of book.
+class SpreadStrategy
+{
+public:
+	SpreadStrategy() : updates_(0), spread_(0), volume_(0) {}
+
+	void OnInit(BenchSimple &) {}
+
+	void OnBookUpdate(BenchSimple &, InstrumentId, const OrderBook & book)
+	{
+		++updates_;
+		if (book.HasBid() && book.HasOffer())
+			spread_ += book.OfferPx(0) - book.BidPx(0);
+	}
+
+	void OnLastTradeUpdate(BenchSimple &, InstrumentId, double qty, double) { volume_ += qty; }
+	void OnOrderFill(BenchSimple &, InstrumentId, BenchSide, double, double) {}
+	void OnOrderReject(BenchSimple &, InstrumentId, BenchSide, double) {}
+
+	double Result() const { return updates_ + spread_ + volume_; }
+
+private:
+	long long updates_;
+	double spread_;
+	double volume_;
+};
+
+// Tracks the size at the top of the book, like a queue-position estimate.
+class ImbalanceStrategy
+{
+public:
+	ImbalanceStrategy() : imbalance_(0) {}
+
+	void OnInit(BenchSimple &) {}
+
+	void OnBookUpdate(BenchSimple &, InstrumentId, const OrderBook & book)
+	{
+		if (book.HasBid() && book.HasOffer())
+			imbalance_ += book.BidQty(0) - book.OfferQty(0);
+	}
+
+	void OnLastTradeUpdate(BenchSimple &, InstrumentId, double, double) {}
+	void OnOrderFill(BenchSimple &, InstrumentId, BenchSide, double, double) {}
+	void OnOrderReject(BenchSimple &, InstrumentId, BenchSide, double) {}
+
+	double Result() const { return imbalance_; }
+
+private:
+	double imbalance_;
+};
+
+// What Simple would have to call with a virtual strategy interface.
+class IStrategy
+{
+public:
+	virtual ~IStrategy() {}
+	virtual void OnBookUpdate(BenchSimple & simple, InstrumentId instrument, const OrderBook & book) = 0;
+	virtual void OnLastTradeUpdate(BenchSimple & simple, InstrumentId instrument, double qty, double px) = 0;
+	virtual double Result() const = 0;
+};
+
+template <class TStrategy>
+class VirtualStrategy : public IStrategy
+{
+public:
+	void OnBookUpdate(BenchSimple & simple, InstrumentId instrument, const OrderBook & book) { strategy_.OnBookUpdate(simple, instrument, book); }
+	void OnLastTradeUpdate(BenchSimple & simple, InstrumentId instrument, double qty, double px) { strategy_.OnLastTradeUpdate(simple, instrument, qty, px); }
+	double Result() const { return strategy_.Result(); }
+
+private:
+	TStrategy strategy_;
+};
+
+// One tick: a book update and a trade, as Simple delivers them.
+template <class TStrategy>
+static void StaticTick(TStrategy & strategy, BenchSimple & simple, const OrderBook & book, long long n)
+{
+	strategy.OnBookUpdate(simple, static_cast<InstrumentId>(n & 3), book);
+	strategy.OnLastTradeUpdate(simple, static_cast<InstrumentId>(n & 3), 1, 100.25);
+}
+
+static void VirtualTick(const std::vector<IStrategy*> & strategies, BenchSimple & simple, const OrderBook & book, long long n)
+{
+	for (size_t i = 0; i < strategies.size(); ++i)
+	{
+		strategies[i]->OnBookUpdate(simple, static_cast<InstrumentId>(n & 3), book);
+		strategies[i]->OnLastTradeUpdate(simple, static_cast<InstrumentId>(n & 3), 1, 100.25);
+	}
+}
+
+// Which concrete strategy sits behind each interface pointer is decided at
+// run time, as it would be in a plugin design, so the calls stay virtual.
+static IStrategy* MakeVirtualStrategy(int kind)
+{
+	if (kind % 2) return new VirtualStrategy<ImbalanceStrategy>;
+	return new VirtualStrategy<SpreadStrategy>;
+}
+
+static MdEntry Entry(char type, int level, double px, double qty)
+{
+	MdEntry entry = { type, '0', level, px, qty };
+	return entry;
+}
+
+int main(int argc, char* argv[])
+{
+	const long long iterations = argc > 1 ? std::atoll(argv[1]) : 10000000;
+	// Even, but unknown to the compiler:
+	const int kindOffset = 2 * argc;
+
+	OrderBook book(2);
+	book.Apply(Entry('0', 1, 100.00, 12));
+	book.Apply(Entry('0', 2, 99.75, 30));
+	book.Apply(Entry('1', 1, 100.25, 9));
+	book.Apply(Entry('1', 2, 100.50, 41));
+
+	BenchSimple simple;
+	double sink = 0;
+	long long n = 0;
+	std::vector<BenchResult> results;
+
+	// One strategy
+	SpreadStrategy spread;
+	results.push_back(RunBench("dispatch_static_1", iterations, [&]() {
+		StaticTick(spread, simple, book, ++n);
+		return 0.0;
+	}, sink));
+	sink += spread.Result();
+
+	std::vector<IStrategy*> one(1, MakeVirtualStrategy(kindOffset));
+	results.push_back(RunBench("dispatch_virtual_1", iterations, [&]() {
+		VirtualTick(one, simple, book, ++n);
+		return 0.0;
+	}, sink));
+
+	// Four strategies sharing the feed
+	SpreadStrategy a, c;
+	ImbalanceStrategy b, d;
+	StrategyList<SpreadStrategy, ImbalanceStrategy, SpreadStrategy, ImbalanceStrategy> list(a, b, c, d);
+	results.push_back(RunBench("dispatch_static_4", iterations, [&]() {
+		StaticTick(list, simple, book, ++n);
+		return 0.0;
+	}, sink));
+	sink += a.Result() + b.Result() + c.Result() + d.Result();
+
+	std::vector<IStrategy*> four;
+	for (int i = 0; i < 4; ++i)
+		four.push_back(MakeVirtualStrategy(kindOffset + i));
+	results.push_back(RunBench("dispatch_virtual_4", iterations, [&]() {
+		VirtualTick(four, simple, book, ++n);
+		return 0.0;
+	}, sink));
+
+	for (size_t i = 0; i < one.size(); ++i) { sink += one[i]->Result(); delete one[i]; }
+	for (size_t i = 0; i < four.size(); ++i) { sink += four[i]->Result(); delete four[i]; }
+
+	for (size_t i = 0; i < results.size(); ++i)
+		PrintResult(results[i]);
+	std::printf("dispatch_virtual_over_static_1 %.2f\n", results[1].nsPerOp / results[0].nsPerOp);
+	std::printf("dispatch_virtual_over_static_4 %.2f\n", results[3].nsPerOp / results[2].nsPerOp);
+	std::printf("(checksum %g)\n", sink);
+	return 0;
+}
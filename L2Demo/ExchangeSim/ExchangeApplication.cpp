@@ -0,0 +1,678 @@
+#include "ExchangeApplication.h"
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <cmath>
+
+// Owner id of the simulated market makers' orders.
+static const int LIQUIDITY_OWNER = 0;
+static const int CLIENT_OWNER = 1;
+
+ExchangeApplication::ExchangeApplication(const ExchangeConfig & config)
+	: config_(config),
+	  nextId_(1),
+	  nextExecId_(1),
+	  mid_(0),
+	  lastTradePx_(0),
+	  lastTradeQty_(0),
+	  random_(42),
+	  mdMessages_(0),
+	  orders_(0),
+	  executions_(0)
+{
+	mid_ = ToTicks(config_.startPrice);
+}
+
+int64_t ExchangeApplication::ToTicks(double px) const
+{
+	return static_cast<int64_t>(std::floor(px / config_.tickSize + 0.5));
+}
+
+double ExchangeApplication::ToPrice(int64_t ticks) const
+{
+	return ticks * config_.tickSize;
+}
+
+std::string ExchangeApplication::OrderKey(const FIX::SessionID & session, const std::string & clOrdId) const
+{
+	return session.toString() + '|' + clOrdId;
+}
+
+void ExchangeApplication::SeedBook()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	for(int level = 1; level <= config_.bookDepth; ++level)
+	{
+		engine_.SubmitLimit(nextId_++, LIQUIDITY_OWNER, SIM_BUY, mid_ - level, 10 * level, eventExecutions_, eventChanges_);
+		engine_.SubmitLimit(nextId_++, LIQUIDITY_OWNER, SIM_SELL, mid_ + level, 10 * level, eventExecutions_, eventChanges_);
+	}
+	eventExecutions_.clear();
+	eventChanges_.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Simulated market activity
+
+// One random book event from the simulated market makers: add liquidity
+// near the mid, cancel some, or trade against the book.  Keeps both sides
+// at least bookDepth levels deep.
+void ExchangeApplication::SimulateEvent(Outbox & outbox)
+{
+	eventExecutions_.clear();
+	eventChanges_.clear();
+
+	const int depth = config_.bookDepth;
+	const unsigned roll = static_cast<unsigned>(random_() % 100);
+
+	if(roll < 5)
+	{
+		// Let the mid drift
+		mid_ += (random_() & 1) ? 1 : -1;
+	}
+
+	if(static_cast<int>(engine_.BidLevels()) < depth || static_cast<int>(engine_.OfferLevels()) < depth || roll < 45)
+	{
+		const bool bid = static_cast<int>(engine_.BidLevels()) < depth
+			|| (static_cast<int>(engine_.OfferLevels()) >= depth && (random_() & 1));
+		const int64_t offset = 1 + static_cast<int64_t>(random_() % depth);
+		const int64_t qty = 1 + static_cast<int64_t>(random_() % 20);
+		if(bid)
+		{
+			int64_t px = mid_ - offset;
+			if(engine_.HasOffer() && px >= engine_.BestOffer()) px = engine_.BestOffer() - 1;
+			engine_.SubmitLimit(nextId_++, LIQUIDITY_OWNER, SIM_BUY, px, qty, eventExecutions_, eventChanges_);
+		}
+		else
+		{
+			int64_t px = mid_ + offset;
+			if(engine_.HasBid() && px <= engine_.BestBid()) px = engine_.BestBid() + 1;
+			engine_.SubmitLimit(nextId_++, LIQUIDITY_OWNER, SIM_SELL, px, qty, eventExecutions_, eventChanges_);
+		}
+	}
+	else if(roll < 85)
+	{
+		uint64_t id = engine_.AnyRestingOrder(LIQUIDITY_OWNER, random_());
+		if(id) engine_.Cancel(id, eventChanges_);
+	}
+	else
+	{
+		const char side = (random_() & 1) ? SIM_BUY : SIM_SELL;
+		const int64_t qty = 1 + static_cast<int64_t>(random_() % 5);
+		engine_.SubmitMarket(nextId_++, LIQUIDITY_OWNER, side, qty, eventExecutions_, eventChanges_);
+	}
+
+	ReportExecutions(eventExecutions_, outbox);
+	PublishChanges(eventChanges_, eventExecutions_, outbox);
+}
+
+void ExchangeApplication::RunFeed(const std::atomic<bool> & stop, int reportSeconds)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Pace in 1 ms slices; each slice runs its share of the configured rate.
+	const double eventsPerSlice = config_.messageRate / 1000.0;
+	double owed = 0;
+
+	Clock::time_point next = Clock::now();
+	Clock::time_point reportStart = next;
+	unsigned long long reportMessages = mdMessages_;
+	unsigned long long events = 0;
+
+	Outbox outbox;
+	size_t subscribers = 0;
+	while(!stop)
+	{
+		owed += eventsPerSlice;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			subscribers = subscriptions_.size();
+			if(!subscriptions_.empty())
+			{
+				for(; owed >= 1; owed -= 1, ++events)
+					SimulateEvent(outbox);
+			}
+			else
+			{
+				owed = 0;
+			}
+		}
+		Send(outbox);
+
+		next += std::chrono::milliseconds(1);
+		Clock::time_point now = Clock::now();
+		if(next > now) std::this_thread::sleep_until(next);
+		else if(now - next > std::chrono::milliseconds(100)) next = now;   // we cannot keep up; do not try to catch up forever
+
+		if(reportSeconds > 0 && now - reportStart >= std::chrono::seconds(reportSeconds))
+		{
+			double seconds = std::chrono::duration<double>(now - reportStart).count();
+			unsigned long long sent = mdMessages_;
+			std::cout << "[sim] " << static_cast<unsigned long long>((sent - reportMessages) / seconds) << " md msgs/s"
+				<< " (target " << config_.messageRate << " events/s x " << subscribers << " subscribers)"
+				<< ", orders=" << orders_ << ", executions=" << executions_ << std::endl;
+			reportStart = now;
+			reportMessages = sent;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Market data
+
+void ExchangeApplication::onMessage(const FIX42::MarketDataRequest& msg, const FIX::SessionID& sessionId)
+{
+	FIX::MDReqID mdReqId;
+	FIX::SubscriptionRequestType requestType;
+	FIX::MarketDepth marketDepth;
+	msg.get(mdReqId);
+	msg.get(requestType);
+	msg.get(marketDepth);
+
+	Outbox outbox;
+
+	// Check that every requested instrument is the one we list; the config
+	// does not change, so this needs no lock:
+	FIX::NoRelatedSym noRelatedSym;
+	msg.get(noRelatedSym);
+	for(int i = 1; i <= noRelatedSym; ++i)
+	{
+		FIX42::MarketDataRequest::NoRelatedSym group;
+		FIX::Symbol symbol;
+		msg.getGroup(i, group);
+		group.get(symbol);
+		if(symbol.getValue() != config_.symbol)
+		{
+			FIX42::MarketDataRequestReject reject(mdReqId);
+			reject.set(FIX::Text("Unknown symbol " + symbol.getValue()));
+			outbox.push_back(std::make_pair(sessionId, reject));
+			Send(outbox);
+			return;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		if(FIX::SubscriptionRequestType_DISABLE_PREVIOUS_SNAPSHOT_PLUS_UPDATE_REQUEST == requestType)
+		{
+			for(size_t i = 0; i < subscriptions_.size(); ++i)
+			{
+				if(subscriptions_[i].session == sessionId && subscriptions_[i].mdReqId == mdReqId.getValue())
+				{
+					subscriptions_.erase(subscriptions_.begin() + i);
+					break;
+				}
+			}
+			return;
+		}
+
+		Subscription subscription;
+		subscription.session = sessionId;
+		subscription.mdReqId = mdReqId.getValue();
+		subscription.depth = marketDepth.getValue() > 0 ? marketDepth.getValue() : config_.bookDepth;
+		QueueSnapshot(subscription, outbox);
+
+		if(FIX::SubscriptionRequestType_SNAPSHOT_PLUS_UPDATES == requestType)
+			subscriptions_.push_back(subscription);
+	}
+	Send(outbox);
+}
+
+void ExchangeApplication::QueueSnapshot(const Subscription & subscription, Outbox & outbox)
+{
+	FIX42::MarketDataSnapshotFullRefresh snapshot;
+	snapshot.set(FIX::MDReqID(subscription.mdReqId));
+	snapshot.set(FIX::Symbol(config_.symbol));
+	snapshot.set(FIX::MaturityMonthYear(config_.maturityMonthYear));
+	snapshot.set(FIX::SecurityExchange("CME"));
+
+	FIX42::MarketDataSnapshotFullRefresh::NoMDEntries entry;
+	const char sides[] = { SIM_BUY, SIM_SELL };
+	for(int s = 0; s < 2; ++s)
+	{
+		engine_.Levels(sides[s], subscription.depth, levels_);
+		for(size_t i = 0; i < levels_.size(); ++i)
+		{
+			entry.set(FIX::MDEntryType(SIM_BUY == sides[s] ? FIX::MDEntryType_BID : FIX::MDEntryType_OFFER));
+			entry.set(FIX::MDEntryPx(ToPrice(levels_[i].first)));
+			entry.set(FIX::MDEntrySize(static_cast<double>(levels_[i].second)));
+			snapshot.addGroup(entry);
+		}
+	}
+	if(lastTradeQty_ > 0)
+	{
+		entry.set(FIX::MDEntryType(FIX::MDEntryType_TRADE));
+		entry.set(FIX::MDEntryPx(ToPrice(lastTradePx_)));
+		entry.set(FIX::MDEntrySize(static_cast<double>(lastTradeQty_)));
+		snapshot.addGroup(entry);
+	}
+
+	outbox.push_back(std::make_pair(subscription.session, snapshot));
+}
+
+// Turn one event's level changes and trades into an incremental refresh per
+// subscriber, leaving out levels deeper than the subscriber asked for.
+void ExchangeApplication::PublishChanges(const std::vector<LevelChange> & changes, const std::vector<Execution> & executions, Outbox & outbox)
+{
+	if(!executions.empty())
+	{
+		lastTradePx_ = executions.back().px;
+		lastTradeQty_ = executions.back().qty;
+	}
+
+	for(size_t s = 0; s < subscriptions_.size(); ++s)
+	{
+		const Subscription & subscription = subscriptions_[s];
+		FIX42::MarketDataIncrementalRefresh refresh;
+		refresh.set(FIX::MDReqID(subscription.mdReqId));
+		FIX42::MarketDataIncrementalRefresh::NoMDEntries entry;
+		int entries = 0;
+		bool bidDeleted = false;
+		bool offerDeleted = false;
+
+		for(size_t i = 0; i < changes.size(); ++i)
+		{
+			const LevelChange & change = changes[i];
+			if('2' != change.action && 0 == engine_.Rank(change.side, change.px, subscription.depth)) continue;
+			if('2' == change.action)
+			{
+				// Only levels the subscriber could see: the book was no deeper
+				// than its depth, or the level was better than today's bottom.
+				engine_.Levels(change.side, subscription.depth, levels_);
+				if(static_cast<int>(levels_.size()) >= subscription.depth
+					&& (SIM_BUY == change.side ? change.px < levels_.back().first : change.px > levels_.back().first))
+					continue;
+				if(SIM_BUY == change.side) bidDeleted = true;
+				else offerDeleted = true;
+			}
+
+			entry.set(FIX::MDUpdateAction(change.action));
+			entry.set(FIX::MDEntryType(SIM_BUY == change.side ? FIX::MDEntryType_BID : FIX::MDEntryType_OFFER));
+			entry.set(FIX::MDEntryPx(ToPrice(change.px)));
+			entry.set(FIX::MDEntrySize(static_cast<double>(change.qty)));
+			refresh.addGroup(entry);
+			++entries;
+		}
+
+		// A deleted level lets a deeper one into view; send the level now at
+		// the bottom of the subscriber's depth so its book stays full.
+		const char sides[] = { SIM_BUY, SIM_SELL };
+		const bool deleted[] = { bidDeleted, offerDeleted };
+		for(int side = 0; side < 2; ++side)
+		{
+			if(!deleted[side]) continue;
+			engine_.Levels(sides[side], subscription.depth, levels_);
+			if(static_cast<int>(levels_.size()) < subscription.depth) continue;
+			entry.set(FIX::MDUpdateAction(FIX::MDUpdateAction_NEW));
+			entry.set(FIX::MDEntryType(SIM_BUY == sides[side] ? FIX::MDEntryType_BID : FIX::MDEntryType_OFFER));
+			entry.set(FIX::MDEntryPx(ToPrice(levels_.back().first)));
+			entry.set(FIX::MDEntrySize(static_cast<double>(levels_.back().second)));
+			refresh.addGroup(entry);
+			++entries;
+		}
+
+		for(size_t i = 0; i < executions.size(); ++i)
+		{
+			entry.set(FIX::MDUpdateAction(FIX::MDUpdateAction_NEW));
+			entry.set(FIX::MDEntryType(FIX::MDEntryType_TRADE));
+			entry.set(FIX::MDEntryPx(ToPrice(executions[i].px)));
+			entry.set(FIX::MDEntrySize(static_cast<double>(executions[i].qty)));
+			refresh.addGroup(entry);
+			++entries;
+		}
+
+		if(entries > 0)
+			outbox.push_back(std::make_pair(subscription.session, refresh));
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Orders
+
+void ExchangeApplication::onMessage(const FIX42::NewOrderSingle& msg, const FIX::SessionID& sessionId)
+{
+	FIX::ClOrdID clOrdId;
+	FIX::Side side;
+	FIX::Symbol symbol;
+	FIX::OrderQty orderQty;
+	FIX::OrdType ordType;
+	msg.get(clOrdId);
+	msg.get(side);
+	msg.get(symbol);
+	msg.get(orderQty);
+	msg.get(ordType);
+
+	ClientOrder order;
+	order.session = sessionId;
+	order.clOrdId = clOrdId.getValue();
+	order.side = side.getValue();
+	order.ordType = ordType.getValue();
+	order.px = 0;
+	order.orderQty = static_cast<int64_t>(orderQty.getValue());
+	order.cumQty = 0;
+	order.notional = 0;
+	if(msg.isSetField(FIX::FIELD::Account))
+	{
+		FIX::Account account;
+		msg.get(account);
+		order.account = account.getValue();
+	}
+
+	++orders_;
+	Outbox outbox;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const uint64_t id = nextId_++;
+
+		if(symbol.getValue() != config_.symbol || order.orderQty <= 0
+			|| (FIX::OrdType_MARKET != order.ordType && FIX::OrdType_LIMIT != order.ordType))
+		{
+			QueueExecutionReport(id, order, FIX::ExecType_REJECTED, FIX::OrdStatus_REJECTED, 0, 0, outbox, "Unsupported order");
+		}
+		else if(FIX::OrdType_MARKET == order.ordType && !(SIM_BUY == order.side ? engine_.HasOffer() : engine_.HasBid()))
+		{
+			QueueExecutionReport(id, order, FIX::ExecType_REJECTED, FIX::OrdStatus_REJECTED, 0, 0, outbox, "No liquidity");
+		}
+		else
+		{
+			if(FIX::OrdType_LIMIT == order.ordType)
+			{
+				FIX::Price price;
+				msg.get(price);
+				order.px = ToTicks(price.getValue());
+			}
+
+			clientOrders_[id] = order;
+			byClOrdId_[OrderKey(sessionId, order.clOrdId)] = id;
+			QueueExecutionReport(id, order, FIX::ExecType_NEW, FIX::OrdStatus_NEW, 0, 0, outbox);
+
+			eventExecutions_.clear();
+			eventChanges_.clear();
+			int64_t leaves;
+			if(FIX::OrdType_MARKET == order.ordType)
+				leaves = engine_.SubmitMarket(id, CLIENT_OWNER, order.side, order.orderQty, eventExecutions_, eventChanges_);
+			else
+				leaves = engine_.SubmitLimit(id, CLIENT_OWNER, order.side, order.px, order.orderQty, eventExecutions_, eventChanges_);
+
+			ReportExecutions(eventExecutions_, outbox);
+
+			// Market orders are immediate-or-cancel:
+			if(FIX::OrdType_MARKET == order.ordType && leaves > 0)
+			{
+				ClientOrder & o = clientOrders_[id];
+				QueueExecutionReport(id, o, FIX::ExecType_CANCELED, FIX::OrdStatus_CANCELED, 0, 0, outbox, "Market order not fully filled");
+			}
+
+			if(!engine_.IsResting(id))
+			{
+				byClOrdId_.erase(OrderKey(sessionId, order.clOrdId));
+				clientOrders_.erase(id);
+			}
+
+			PublishChanges(eventChanges_, eventExecutions_, outbox);
+		}
+	}
+	Send(outbox);
+}
+
+void ExchangeApplication::onMessage(const FIX42::OrderCancelRequest& msg, const FIX::SessionID& sessionId)
+{
+	FIX::OrigClOrdID origClOrdId;
+	FIX::ClOrdID clOrdId;
+	msg.get(origClOrdId);
+	msg.get(clOrdId);
+
+	Outbox outbox;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::unordered_map<std::string, uint64_t>::iterator found = byClOrdId_.find(OrderKey(sessionId, origClOrdId.getValue()));
+		if(found == byClOrdId_.end())
+		{
+			FIX42::OrderCancelReject reject(FIX::OrderID("NONE"), clOrdId, origClOrdId, FIX::OrdStatus(FIX::OrdStatus_REJECTED), FIX::CxlRejResponseTo(FIX::CxlRejResponseTo_ORDER_CANCEL_REQUEST));
+			reject.set(FIX::Text("Unknown order"));
+			outbox.push_back(std::make_pair(sessionId, reject));
+		}
+		else
+		{
+			const uint64_t id = found->second;
+			byClOrdId_.erase(found);
+
+			eventChanges_.clear();
+			eventExecutions_.clear();
+			engine_.Cancel(id, eventChanges_);
+
+			ClientOrder order = clientOrders_[id];
+			clientOrders_.erase(id);
+			order.clOrdId = clOrdId.getValue();
+			QueueExecutionReport(id, order, FIX::ExecType_CANCELED, FIX::OrdStatus_CANCELED, 0, 0, outbox);
+			outbox.back().second.setField(FIX::OrigClOrdID(origClOrdId.getValue()));
+
+			PublishChanges(eventChanges_, eventExecutions_, outbox);
+		}
+	}
+	Send(outbox);
+}
+
+void ExchangeApplication::onMessage(const FIX42::OrderCancelReplaceRequest& msg, const FIX::SessionID& sessionId)
+{
+	FIX::OrigClOrdID origClOrdId;
+	FIX::ClOrdID clOrdId;
+	FIX::OrderQty orderQty;
+	FIX::Price price;
+	msg.get(origClOrdId);
+	msg.get(clOrdId);
+	msg.get(orderQty);
+	msg.get(price);
+
+	Outbox outbox;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::unordered_map<std::string, uint64_t>::iterator found = byClOrdId_.find(OrderKey(sessionId, origClOrdId.getValue()));
+		if(found == byClOrdId_.end())
+		{
+			FIX42::OrderCancelReject reject(FIX::OrderID("NONE"), clOrdId, origClOrdId, FIX::OrdStatus(FIX::OrdStatus_REJECTED), FIX::CxlRejResponseTo(FIX::CxlRejResponseTo_ORDER_CANCEL_REPLACE_REQUEST));
+			reject.set(FIX::Text("Unknown order"));
+			outbox.push_back(std::make_pair(sessionId, reject));
+		}
+		else if(static_cast<int64_t>(orderQty.getValue()) <= clientOrders_[found->second].cumQty)
+		{
+			// Nothing would be left to work; the original stays as it is.
+			const ClientOrder & order = clientOrders_[found->second];
+			std::ostringstream orderId;
+			orderId << found->second;
+			FIX42::OrderCancelReject reject(FIX::OrderID(orderId.str()), clOrdId, origClOrdId,
+				FIX::OrdStatus(order.cumQty > 0 ? FIX::OrdStatus_PARTIALLY_FILLED : FIX::OrdStatus_NEW),
+				FIX::CxlRejResponseTo(FIX::CxlRejResponseTo_ORDER_CANCEL_REPLACE_REQUEST));
+			reject.set(FIX::Text("OrderQty must be above the filled quantity"));
+			outbox.push_back(std::make_pair(sessionId, reject));
+		}
+		else
+		{
+			// Cancel and re-enter: the replaced order loses its time priority.
+			const uint64_t oldId = found->second;
+			byClOrdId_.erase(found);
+
+			eventChanges_.clear();
+			eventExecutions_.clear();
+			engine_.Cancel(oldId, eventChanges_);
+
+			ClientOrder order = clientOrders_[oldId];
+			clientOrders_.erase(oldId);
+			order.clOrdId = clOrdId.getValue();
+			order.px = ToTicks(price.getValue());
+			order.orderQty = static_cast<int64_t>(orderQty.getValue());
+
+			const uint64_t id = nextId_++;
+			clientOrders_[id] = order;
+			byClOrdId_[OrderKey(sessionId, order.clOrdId)] = id;
+			QueueExecutionReport(id, order, FIX::ExecType_REPLACE, FIX::OrdStatus_REPLACED, 0, 0, outbox);
+			outbox.back().second.setField(FIX::OrigClOrdID(origClOrdId.getValue()));
+
+			const int64_t remaining = order.orderQty - order.cumQty;
+			if(remaining > 0)
+				engine_.SubmitLimit(id, CLIENT_OWNER, order.side, order.px, remaining, eventExecutions_, eventChanges_);
+			ReportExecutions(eventExecutions_, outbox);
+
+			if(!engine_.IsResting(id))
+			{
+				byClOrdId_.erase(OrderKey(sessionId, order.clOrdId));
+				clientOrders_.erase(id);
+			}
+
+			PublishChanges(eventChanges_, eventExecutions_, outbox);
+		}
+	}
+	Send(outbox);
+}
+
+// A status ExecutionReport for a working order; one the book no longer
+// holds (filled, canceled or never seen) is reported as unknown.
+void ExchangeApplication::onMessage(const FIX42::OrderStatusRequest& msg, const FIX::SessionID& sessionId)
+{
+	FIX::ClOrdID clOrdId;
+	FIX::Side side;
+	msg.get(clOrdId);
+	msg.get(side);
+
+	Outbox outbox;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::unordered_map<std::string, uint64_t>::iterator found = byClOrdId_.find(OrderKey(sessionId, clOrdId.getValue()));
+		if(found == byClOrdId_.end())
+		{
+			ClientOrder unknown;
+			unknown.session = sessionId;
+			unknown.clOrdId = clOrdId.getValue();
+			unknown.side = side.getValue();
+			unknown.ordType = 0;
+			unknown.px = 0;
+			unknown.orderQty = 0;
+			unknown.cumQty = 0;
+			unknown.notional = 0;
+			QueueExecutionReport(0, unknown, FIX::OrdStatus_REJECTED, FIX::OrdStatus_REJECTED, 0, 0, outbox, "Unknown order");
+			outbox.back().second.setField(FIX::OrdRejReason(FIX::OrdRejReason_UNKNOWN_ORDER));
+		}
+		else
+		{
+			const ClientOrder & order = clientOrders_[found->second];
+			const char ordStatus = order.cumQty > 0 ? FIX::OrdStatus_PARTIALLY_FILLED : FIX::OrdStatus_NEW;
+			QueueExecutionReport(found->second, order, ordStatus, ordStatus, 0, 0, outbox);
+		}
+		outbox.back().second.setField(FIX::ExecTransType(FIX::ExecTransType_STATUS));
+	}
+	Send(outbox);
+}
+
+// Send fills for every client order involved in the executions, whether it
+// was the aggressor or the resting order.
+void ExchangeApplication::ReportExecutions(const std::vector<Execution> & executions, Outbox & outbox)
+{
+	for(size_t i = 0; i < executions.size(); ++i)
+	{
+		const Execution & execution = executions[i];
+		++executions_;
+
+		const uint64_t ids[] = { execution.aggressorId, execution.restingId };
+		const int owners[] = { execution.aggressorOwner, execution.restingOwner };
+		for(int k = 0; k < 2; ++k)
+		{
+			if(CLIENT_OWNER != owners[k]) continue;
+			std::unordered_map<uint64_t, ClientOrder>::iterator it = clientOrders_.find(ids[k]);
+			if(it == clientOrders_.end()) continue;
+
+			ClientOrder & order = it->second;
+			order.cumQty += execution.qty;
+			order.notional += execution.qty * ToPrice(execution.px);
+			const bool done = order.cumQty >= order.orderQty;
+			QueueExecutionReport(ids[k], order, done ? FIX::ExecType_FILL : FIX::ExecType_PARTIAL_FILL,
+				done ? FIX::OrdStatus_FILLED : FIX::OrdStatus_PARTIALLY_FILLED, execution.qty, execution.px, outbox);
+
+			if(done && k == 1)
+			{
+				byClOrdId_.erase(OrderKey(order.session, order.clOrdId));
+				clientOrders_.erase(it);
+			}
+		}
+	}
+}
+
+void ExchangeApplication::QueueExecutionReport(uint64_t id, const ClientOrder & order, char execType, char ordStatus,
+	int64_t lastQty, int64_t lastPx, Outbox & outbox, const std::string & text)
+{
+	std::ostringstream orderId, execId;
+	orderId << id;
+	execId << nextExecId_++;
+
+	const bool open = FIX::OrdStatus_NEW == ordStatus || FIX::OrdStatus_PARTIALLY_FILLED == ordStatus || FIX::OrdStatus_REPLACED == ordStatus;
+	const int64_t leaves = open ? order.orderQty - order.cumQty : 0;
+	const double avgPx = order.cumQty > 0 ? order.notional / order.cumQty : 0;
+
+	FIX42::ExecutionReport report(
+		FIX::OrderID(orderId.str()),
+		FIX::ExecID(execId.str()),
+		FIX::ExecTransType(FIX::ExecTransType_NEW),
+		FIX::ExecType(execType),
+		FIX::OrdStatus(ordStatus),
+		FIX::Symbol(config_.symbol),
+		FIX::Side(order.side),
+		FIX::LeavesQty(static_cast<double>(leaves)),
+		FIX::CumQty(static_cast<double>(order.cumQty)),
+		FIX::AvgPx(avgPx));
+
+	report.set(FIX::ClOrdID(order.clOrdId));
+	report.set(FIX::MaturityMonthYear(config_.maturityMonthYear));
+	report.set(FIX::SecurityExchange("CME"));
+	report.set(FIX::OrderQty(static_cast<double>(order.orderQty)));
+	if(!order.account.empty()) report.set(FIX::Account(order.account));
+	if(lastQty > 0)
+	{
+		report.set(FIX::LastShares(static_cast<double>(lastQty)));
+		report.set(FIX::LastPx(ToPrice(lastPx)));
+	}
+	if(!text.empty()) report.set(FIX::Text(text));
+
+	outbox.push_back(std::make_pair(order.session, report));
+}
+
+void ExchangeApplication::Send(Outbox & outbox)
+{
+	for(size_t i = 0; i < outbox.size(); ++i)
+	{
+		try
+		{
+			const std::string & msgType = outbox[i].second.getHeader().getField(FIX::FIELD::MsgType);
+			FIX::Session::sendToTarget(outbox[i].second, outbox[i].first);
+			if(msgType == FIX::MsgType_MarketDataIncrementalRefresh) ++mdMessages_;
+		}
+		catch(FIX::SessionNotFound &)
+		{ }
+	}
+	outbox.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Session callbacks
+
+void ExchangeApplication::onLogon(const FIX::SessionID& sessionId)
+{
+	std::cout << "[sim] logon " << sessionId << std::endl;
+}
+
+void ExchangeApplication::onLogout(const FIX::SessionID& sessionId)
+{
+	std::cout << "[sim] logout " << sessionId << std::endl;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	for(size_t i = subscriptions_.size(); i-- > 0; )
+	{
+		if(subscriptions_[i].session == sessionId)
+			subscriptions_.erase(subscriptions_.begin() + i);
+	}
+}
+
+void ExchangeApplication::fromApp(const FIX::Message& message, const FIX::SessionID& sessionID)
+	throw(FIX::FieldNotFound, FIX::IncorrectDataFormat, FIX::IncorrectTagValue, FIX::UnsupportedMessageType)
+{
+	crack(message, sessionID);
+}
@@ -0,0 +1,131 @@
+#ifndef EXCHANGE_APPLICATION_H
+#define EXCHANGE_APPLICATION_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <unordered_map>
+#include <quickfix/Application.h>
+#include <quickfix/MessageCracker.h>
+#include <quickfix/Session.h>
+#include <quickfix/fix42/MarketDataRequest.h>
+#include <quickfix/fix42/MarketDataRequestReject.h>
+#include <quickfix/fix42/MarketDataSnapshotFullRefresh.h>
+#include <quickfix/fix42/MarketDataIncrementalRefresh.h>
+#include <quickfix/fix42/NewOrderSingle.h>
+#include <quickfix/fix42/OrderCancelRequest.h>
+#include <quickfix/fix42/OrderCancelReplaceRequest.h>
+#include <quickfix/fix42/OrderCancelReject.h>
+#include <quickfix/fix42/OrderStatusRequest.h>
+#include <quickfix/fix42/ExecutionReport.h>
+#include "MatchingEngine.h"
+
+/// What the simulated venue lists and how busy its market is.
+struct ExchangeConfig
+{
+	std::string symbol;
+	std::string maturityMonthYear;
+	double tickSize;
+	double startPrice;
+	int bookDepth;          // levels of simulated liquidity per side
+	double messageRate;     // book events per second, each sent to every subscriber
+};
+
+/// Acceptor side of the FIX connection: answers MarketDataRequests with a
+/// snapshot followed by incremental refreshes, and matches NewOrderSingle,
+/// OrderCancelRequest and OrderCancelReplaceRequest against a
+/// MatchingEngine that simulated market makers keep busy.
+class ExchangeApplication : public FIX::Application,
+                            public FIX::MessageCracker
+{
+public:
+	explicit ExchangeApplication(const ExchangeConfig & config);
+
+	/// Seed the book with `bookDepth` levels per side.
+	void SeedBook();
+
+	/// Generate simulated book activity at the configured rate until `stop`
+	/// becomes true, printing throughput every `reportSeconds`.
+	void RunFeed(const std::atomic<bool> & stop, int reportSeconds);
+
+	unsigned long long MarketDataMessages() const { return mdMessages_; }
+	unsigned long long Orders() const { return orders_; }
+	unsigned long long Executions() const { return executions_; }
+
+private:
+	struct Subscription
+	{
+		FIX::SessionID session;
+		std::string mdReqId;
+		int depth;
+	};
+
+	struct ClientOrder
+	{
+		FIX::SessionID session;
+		std::string clOrdId;
+		std::string account;
+		char side;
+		char ordType;
+		int64_t px;
+		int64_t orderQty;
+		int64_t cumQty;
+		double notional;
+	};
+
+	typedef std::vector<std::pair<FIX::SessionID, FIX::Message> > Outbox;
+
+	// QF callbacks
+	void onMessage(const FIX42::MarketDataRequest&, const FIX::SessionID&);
+	void onMessage(const FIX42::NewOrderSingle&, const FIX::SessionID&);
+	void onMessage(const FIX42::OrderCancelRequest&, const FIX::SessionID&);
+	void onMessage(const FIX42::OrderCancelReplaceRequest&, const FIX::SessionID&);
+	void onMessage(const FIX42::OrderStatusRequest&, const FIX::SessionID&);
+
+	void onCreate(const FIX::SessionID&) {}
+	void onLogon(const FIX::SessionID&);
+	void onLogout(const FIX::SessionID&);
+	void toAdmin(FIX::Message&, const FIX::SessionID&) {}
+	void toApp(FIX::Message&, const FIX::SessionID&) throw(FIX::DoNotSend) {}
+	void fromAdmin(const FIX::Message&, const FIX::SessionID&) throw(FIX::FieldNotFound, FIX::IncorrectDataFormat, FIX::IncorrectTagValue, FIX::RejectLogon) {}
+	void fromApp(const FIX::Message& message, const FIX::SessionID& sessionID) throw(FIX::FieldNotFound, FIX::IncorrectDataFormat, FIX::IncorrectTagValue, FIX::UnsupportedMessageType);
+
+	// Called with mutex_ held; messages are queued in the outbox and sent after it is released.
+	void SimulateEvent(Outbox & outbox);
+	void ReportExecutions(const std::vector<Execution> & executions, Outbox & outbox);
+	void PublishChanges(const std::vector<LevelChange> & changes, const std::vector<Execution> & executions, Outbox & outbox);
+	void QueueExecutionReport(uint64_t id, const ClientOrder & order, char execType, char ordStatus, int64_t lastQty, int64_t lastPx, Outbox & outbox, const std::string & text = "");
+	void QueueSnapshot(const Subscription & subscription, Outbox & outbox);
+	void Send(Outbox & outbox);
+
+	std::string OrderKey(const FIX::SessionID & session, const std::string & clOrdId) const;
+	int64_t ToTicks(double px) const;
+	double ToPrice(int64_t ticks) const;
+
+	const ExchangeConfig config_;
+
+	std::mutex mutex_;
+	MatchingEngine engine_;
+	std::vector<Subscription> subscriptions_;
+	std::unordered_map<uint64_t, ClientOrder> clientOrders_;
+	std::unordered_map<std::string, uint64_t> byClOrdId_;
+	uint64_t nextId_;
+	uint64_t nextExecId_;
+	int64_t mid_;
+	int64_t lastTradePx_;
+	int64_t lastTradeQty_;
+	std::mt19937_64 random_;
+
+	// Scratch space reused for every event
+	std::vector<Execution> eventExecutions_;
+	std::vector<LevelChange> eventChanges_;
+	std::vector<std::pair<int64_t, int64_t> > levels_;
+
+	std::atomic<unsigned long long> mdMessages_;
+	std::atomic<unsigned long long> orders_;
+	std::atomic<unsigned long long> executions_;
+};
+
+#endif
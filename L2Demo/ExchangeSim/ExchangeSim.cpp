@@ -0,0 +1,85 @@
+// Local FIX 4.2 exchange for end-to-end tests of the trading app without a
+// venue connection.  Point the app's market data and order sessions at the
+// acceptor sessions in exchangesim.cfg; the simulator answers
+// MarketDataRequests with a snapshot and a stream of incremental refreshes
+// at SimMessageRate events per second, and matches the app's orders against
+// the simulated book.
+//
+// Usage: ExchangeSim <config file>
+//
+// [DEFAULT] settings read besides the QuickFIX ones:
+//   SimSymbol, SimMaturityMonthYear   the one instrument listed
+//   SimTickSize (0.25), SimStartPrice (2000), SimBookDepth (10)
+//   SimMessageRate (10000)            book events per second
+//   SimReportSeconds (1)              throughput print interval, 0 for none
+//   SimDurationSeconds (0)            stop after this long, 0 for never
+
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <quickfix/FileStore.h>
+#include <quickfix/FileLog.h>
+#include <quickfix/SocketAcceptor.h>
+#include <quickfix/SessionSettings.h>
+#include "ExchangeApplication.h"
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: ExchangeSim <config file>" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		FIX::SessionSettings settings(argv[1]);
+		const FIX::Dictionary& defaults = settings.get();
+
+		ExchangeConfig config;
+		config.symbol = defaults.has("SimSymbol") ? defaults.getString("SimSymbol") : "ES";
+		config.maturityMonthYear = defaults.has("SimMaturityMonthYear") ? defaults.getString("SimMaturityMonthYear") : "201512";
+		config.tickSize = defaults.has("SimTickSize") ? defaults.getDouble("SimTickSize") : 0.25;
+		config.startPrice = defaults.has("SimStartPrice") ? defaults.getDouble("SimStartPrice") : 2000;
+		config.bookDepth = defaults.has("SimBookDepth") ? defaults.getInt("SimBookDepth") : 10;
+		config.messageRate = defaults.has("SimMessageRate") ? defaults.getDouble("SimMessageRate") : 10000;
+		const int reportSeconds = defaults.has("SimReportSeconds") ? defaults.getInt("SimReportSeconds") : 1;
+		const int durationSeconds = defaults.has("SimDurationSeconds") ? defaults.getInt("SimDurationSeconds") : 0;
+
+		ExchangeApplication application(config);
+		application.SeedBook();
+
+		FIX::FileStoreFactory storeFactory(settings);
+		FIX::FileLogFactory logFactory(settings);
+		FIX::SocketAcceptor acceptor(application, storeFactory, settings, logFactory);
+		acceptor.start();
+
+		std::atomic<bool> stop(false);
+		std::thread feed([&]() { application.RunFeed(stop, reportSeconds); });
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (durationSeconds > 0)
+			std::this_thread::sleep_for(std::chrono::seconds(durationSeconds));
+		else
+		{
+			std::cout << "[sim] running, press enter to stop" << std::endl;
+			std::cin.get();
+		}
+
+		stop = true;
+		feed.join();
+		acceptor.stop();
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "[sim] " << application.MarketDataMessages() << " md msgs in " << seconds << " s ("
+			<< static_cast<unsigned long long>(application.MarketDataMessages() / seconds) << " msgs/s), orders="
+			<< application.Orders() << ", executions=" << application.Executions() << std::endl;
+	}
+	catch (std::exception & e)
+	{
+		std::cerr << "ExchangeSim: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
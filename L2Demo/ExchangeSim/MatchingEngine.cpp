@@ -0,0 +1,161 @@
+#include "MatchingEngine.h"
+#include <algorithm>
+
+MatchingEngine::MatchingEngine()
+{ }
+
+int64_t MatchingEngine::SubmitLimit(uint64_t id, int owner, char side, int64_t px, int64_t qty,
+	std::vector<Execution> & executions, std::vector<LevelChange> & changes)
+{
+	int64_t leaves = Match(id, owner, side, true, px, qty, executions, changes);
+	if(leaves <= 0) return 0;
+
+	Side & book = SIM_BUY == side ? bids_ : offers_;
+	Side::iterator it = book.find(px);
+	const bool added = it == book.end();
+	if(added)
+	{
+		it = book.insert(std::make_pair(px, Level())).first;
+		it->second.total = 0;
+	}
+
+	Resting resting = { id, owner, leaves };
+	it->second.queue.push_back(resting);
+	it->second.total += leaves;
+
+	Location location = { side, px, owner };
+	index_[id] = location;
+
+	LevelChange change = { side, added ? '0' : '1', px, it->second.total };
+	changes.push_back(change);
+	return leaves;
+}
+
+int64_t MatchingEngine::SubmitMarket(uint64_t id, int owner, char side, int64_t qty,
+	std::vector<Execution> & executions, std::vector<LevelChange> & changes)
+{
+	return Match(id, owner, side, false, 0, qty, executions, changes);
+}
+
+// Walk the opposite side best price first and, within a level, oldest order
+// first, until the incoming order is filled or no longer crosses.
+int64_t MatchingEngine::Match(uint64_t id, int owner, char side, bool limit, int64_t px, int64_t qty,
+	std::vector<Execution> & executions, std::vector<LevelChange> & changes)
+{
+	const bool buy = SIM_BUY == side;
+	Side & book = buy ? offers_ : bids_;
+	const char restingSide = buy ? SIM_SELL : SIM_BUY;
+
+	while(qty > 0 && !book.empty())
+	{
+		Side::iterator it = buy ? book.begin() : --book.end();
+		const int64_t levelPx = it->first;
+		if(limit && (buy ? levelPx > px : levelPx < px)) break;
+
+		Level & level = it->second;
+		while(qty > 0 && !level.queue.empty())
+		{
+			Resting & resting = level.queue.front();
+			int64_t take = std::min(qty, resting.qty);
+			qty -= take;
+			resting.qty -= take;
+			level.total -= take;
+
+			Execution execution = { id, resting.id, owner, resting.owner, side, levelPx, take, qty, resting.qty };
+			executions.push_back(execution);
+
+			if(resting.qty == 0)
+			{
+				index_.erase(resting.id);
+				level.queue.pop_front();
+			}
+		}
+
+		LevelChange change = { restingSide, level.total > 0 ? '1' : '2', levelPx, level.total };
+		changes.push_back(change);
+		if(level.queue.empty()) book.erase(it);
+	}
+	return qty;
+}
+
+int64_t MatchingEngine::Cancel(uint64_t id, std::vector<LevelChange> & changes)
+{
+	std::unordered_map<uint64_t, Location>::iterator found = index_.find(id);
+	if(found == index_.end()) return 0;
+
+	const Location location = found->second;
+	index_.erase(found);
+
+	Side & book = SIM_BUY == location.side ? bids_ : offers_;
+	Side::iterator it = book.find(location.px);
+	if(it == book.end()) return 0;
+
+	Level & level = it->second;
+	int64_t leaves = 0;
+	for(std::deque<Resting>::iterator r = level.queue.begin(); r != level.queue.end(); ++r)
+	{
+		if(r->id == id)
+		{
+			leaves = r->qty;
+			level.total -= leaves;
+			level.queue.erase(r);
+			break;
+		}
+	}
+
+	LevelChange change = { location.side, level.queue.empty() ? '2' : '1', location.px, level.total };
+	changes.push_back(change);
+	if(level.queue.empty()) book.erase(it);
+	return leaves;
+}
+
+void MatchingEngine::Levels(char side, int depth, std::vector<std::pair<int64_t, int64_t> > & out) const
+{
+	out.clear();
+	if(SIM_BUY == side)
+	{
+		for(Side::const_reverse_iterator it = bids_.rbegin(); it != bids_.rend() && static_cast<int>(out.size()) < depth; ++it)
+			out.push_back(std::make_pair(it->first, it->second.total));
+	}
+	else
+	{
+		for(Side::const_iterator it = offers_.begin(); it != offers_.end() && static_cast<int>(out.size()) < depth; ++it)
+			out.push_back(std::make_pair(it->first, it->second.total));
+	}
+}
+
+int MatchingEngine::Rank(char side, int64_t px, int depth) const
+{
+	int rank = 1;
+	if(SIM_BUY == side)
+	{
+		for(Side::const_reverse_iterator it = bids_.rbegin(); it != bids_.rend() && rank <= depth; ++it, ++rank)
+		{
+			if(it->first <= px) return it->first == px ? rank : 0;
+		}
+	}
+	else
+	{
+		for(Side::const_iterator it = offers_.begin(); it != offers_.end() && rank <= depth; ++it, ++rank)
+		{
+			if(it->first >= px) return it->first == px ? rank : 0;
+		}
+	}
+	return 0;
+}
+
+uint64_t MatchingEngine::AnyRestingOrder(int owner, uint64_t hint) const
+{
+	if(index_.empty()) return 0;
+
+	// Start from an arbitrary bucket so cancels spread over the book:
+	size_t bucket = static_cast<size_t>(hint % index_.bucket_count());
+	for(size_t tried = 0; tried < index_.bucket_count(); ++tried, bucket = (bucket + 1) % index_.bucket_count())
+	{
+		for(std::unordered_map<uint64_t, Location>::const_local_iterator it = index_.begin(bucket); it != index_.end(bucket); ++it)
+		{
+			if(it->second.owner == owner) return it->first;
+		}
+	}
+	return 0;
+}
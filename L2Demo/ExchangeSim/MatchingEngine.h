@@ -0,0 +1,108 @@
+#ifndef MATCHING_ENGINE_H
+#define MATCHING_ENGINE_H
+
+#include <map>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+/// Side of an order, using the FIX Side values.
+const char SIM_BUY = '1';
+const char SIM_SELL = '2';
+
+/// A trade between an incoming order and a resting one.
+struct Execution
+{
+	uint64_t aggressorId;
+	uint64_t restingId;
+	int aggressorOwner;
+	int restingOwner;
+	char aggressorSide;
+	int64_t px;          // in ticks
+	int64_t qty;
+	int64_t aggressorLeaves;
+	int64_t restingLeaves;
+};
+
+/// A change to the aggregated quantity at one price level, for market data.
+struct LevelChange
+{
+	char side;           // SIM_BUY for bids, SIM_SELL for offers
+	char action;         // FIX MDUpdateAction: '0' new, '1' change, '2' delete
+	int64_t px;          // in ticks
+	int64_t qty;         // aggregated quantity left at the level
+};
+
+/// Price-time priority limit order book for one instrument.  Prices are in
+/// integer ticks.  Each order has an owner so executions can be routed back
+/// to whoever sent it; owner 0 is the simulator's own liquidity.
+class MatchingEngine
+{
+public:
+	MatchingEngine();
+
+	/// Match a limit order and rest whatever is left.  Returns the resting quantity.
+	int64_t SubmitLimit(uint64_t id, int owner, char side, int64_t px, int64_t qty,
+		std::vector<Execution> & executions, std::vector<LevelChange> & changes);
+
+	/// Match a market order; it never rests.  Returns the unfilled quantity.
+	int64_t SubmitMarket(uint64_t id, int owner, char side, int64_t qty,
+		std::vector<Execution> & executions, std::vector<LevelChange> & changes);
+
+	/// Remove a resting order.  Returns its remaining quantity, or 0 if it is not resting.
+	int64_t Cancel(uint64_t id, std::vector<LevelChange> & changes);
+
+	bool IsResting(uint64_t id) const { return index_.count(id) != 0; }
+
+	bool HasBid() const { return !bids_.empty(); }
+	bool HasOffer() const { return !offers_.empty(); }
+	int64_t BestBid() const { return bids_.rbegin()->first; }
+	int64_t BestOffer() const { return offers_.begin()->first; }
+	size_t BidLevels() const { return bids_.size(); }
+	size_t OfferLevels() const { return offers_.size(); }
+
+	/// The best `depth` levels of a side as (price, aggregated quantity), best first.
+	void Levels(char side, int depth, std::vector<std::pair<int64_t, int64_t> > & out) const;
+
+	/// 1-based rank of a price among the levels of its side, or 0 if it is not
+	/// within the best `depth` levels.
+	int Rank(char side, int64_t px, int depth) const;
+
+	/// Id of a random-ish resting order owned by `owner`, or 0; used by the
+	/// liquidity simulator to pick something to cancel.
+	uint64_t AnyRestingOrder(int owner, uint64_t hint) const;
+
+private:
+	struct Resting
+	{
+		uint64_t id;
+		int owner;
+		int64_t qty;
+	};
+
+	struct Level
+	{
+		int64_t total;
+		std::deque<Resting> queue;
+	};
+
+	typedef std::map<int64_t, Level> Side;
+
+	struct Location
+	{
+		char side;
+		int64_t px;
+		int owner;
+	};
+
+	int64_t Match(uint64_t id, int owner, char side, bool limit, int64_t px, int64_t qty,
+		std::vector<Execution> & executions, std::vector<LevelChange> & changes);
+
+	Side bids_;      // iterated from rbegin() for best first
+	Side offers_;    // iterated from begin() for best first
+	std::unordered_map<uint64_t, Location> index_;
+};
+
+#endif
@@ -0,0 +1,55 @@
+// Replays recorded market data through Simple and Strategy without any FIX
+// connection and reports how many events per second the strategy layer
+// sustains.  Orders are filled by FillSimulator against the replayed book.
+//
+// Usage: Replay <file> <symbol> <maturityMonthYear> [speed]
+//
+// <file> may be a Write2Txt text file, a binary tick journal or a QuickFIX
+// FileLog message log.  speed 0 (the default) replays as fast as possible;
+// otherwise events are paced to their timestamps, speed times real time.
+
+#include <iostream>
+#include <cstdlib>
+#include <memory>
+#include <type_traits>
+#include "Simple.h"
+#include "Strategy.h"
+#include "FillSimulator.h"
+#include "ReplayEngine.h"
+
+// Simple is constructed from a Strategy below; see StrategyBinding.h.
+static_assert(std::is_same<BoundStrategy, Strategy>::value, "Replay needs the default L2_STRATEGY binding");
+
+int main(int argc, char* argv[])
+{
+	if (argc < 4)
+	{
+		std::cerr << "Usage: Replay <file> <symbol> <maturityMonthYear> [speed]" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		const double speed = argc > 4 ? std::atof(argv[4]) : 0;
+
+		// No Write2Txt: we are reading recorded data, not recording it.
+		Strategy strategy(argv[2], argv[3], "REPLAY", shared_ptr<Write2Txt>());
+		Simple simple(strategy);
+		FillSimulator fills;
+		simple.InitSimulation(fills);
+
+		InstrumentId instrument = simple.Instruments().Find(argv[2], argv[3], "CME");
+
+		ReplayEngine replay(simple, speed);
+		replay.ReplayFile(argv[1], instrument);
+
+		replay.Report(std::cout);
+		std::cout << "[replay] orders=" << fills.Orders() << " fills=" << fills.Fills() << " rejects=" << fills.Rejects() << std::endl;
+	}
+	catch (std::exception & e)
+	{
+		std::cerr << "Replay: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
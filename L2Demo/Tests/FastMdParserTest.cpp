@@ -0,0 +1,149 @@
+// ParseFastMd: the market data messages it reads, and everything it must
+// refuse so that Simple falls back to QuickFIX's parsed message.
+
+#include "FastMdParser.h"
+#include "TestHarness.h"
+#include <string>
+
+using std::string;
+
+// The tests write fields separated by '|'; this puts in the SOHs.
+static string Fix(const string & fields)
+{
+	string message = fields;
+	for(size_t i = 0; i < message.size(); ++i)
+	{
+		if(message[i] == '|') message[i] = '\001';
+	}
+	return message;
+}
+
+static bool Parse(const string & fields, FastMdMessage & out)
+{
+	const string message = Fix(fields);
+	return ParseFastMd(message.data(), message.size(), out);
+}
+
+static bool Parse(const string & fields)
+{
+	FastMdMessage out;
+	return Parse(fields, out);
+}
+
+static bool Is(const FieldView & view, const string & expected)
+{
+	return string(view.data, view.size) == expected;
+}
+
+static const string HEADER_X = "8=FIX.4.4|9=200|35=X|34=12|52=20261016-14:30:00.123|262=REQ1|";
+static const string HEADER_W = "8=FIX.4.4|9=200|35=W|34=13|52=20261016-14:30:00.456|262=REQ1|55=ES|200=202612|207=CME|";
+static const string TRAILER = "10=000|";
+
+// `count` incremental entries, each a new bid one level deeper.
+static string Entries(int count)
+{
+	string entries;
+	for(int i = 0; i < count; ++i)
+		entries += "279=0|269=0|270=100|271=1|1023=" + std::to_string(i + 1) + "|";
+	return entries;
+}
+
+TEST(ParsesAnIncrementalRefresh)
+{
+	FastMdMessage out;
+	CHECK(Parse(HEADER_X + "268=2|"
+		"279=0|269=0|55=ES|200=202612|207=CME|270=4500.25|271=5|1023=1|273=14:30:00.100|"
+		"279=2|269=1|270=4500.5|271=0|1023=2|" + TRAILER, out));
+	CHECK(out.msgType == 'X');
+	CHECK(Is(out.msgSeqNum, "12"));
+	CHECK(Is(out.mdReqId, "REQ1"));
+	CHECK(Is(out.entryTime, "14:30:00.100"));
+	CHECK(out.count == 2);
+	if(out.count != 2) return;
+	CHECK(out.entries[0].md.action == '0' && out.entries[0].md.type == '0');
+	CHECK(out.entries[0].md.level == 1);
+	CHECK_NEAR(out.entries[0].md.px, 4500.25);
+	CHECK_NEAR(out.entries[0].md.qty, 5.0);
+	CHECK(Is(out.entries[0].symbol, "ES") && Is(out.entries[0].exchange, "CME"));
+	CHECK(out.entries[1].md.action == '2' && out.entries[1].md.type == '1');
+	CHECK(out.entries[1].md.level == 2);
+	CHECK(out.entries[1].symbol.empty());
+}
+
+TEST(ParsesASnapshot)
+{
+	FastMdMessage out;
+	CHECK(Parse(HEADER_W + "268=2|269=0|270=-1.5|271=3|1023=1|269=1|270=0.75|271=4|1023=1|" + TRAILER, out));
+	CHECK(out.msgType == 'W');
+	CHECK(Is(out.symbol, "ES") && Is(out.maturityMonthYear, "202612") && Is(out.exchange, "CME"));
+	CHECK(out.count == 2);
+	if(out.count != 2) return;
+	// Snapshot entries are all new levels:
+	CHECK(out.entries[0].md.action == '0' && out.entries[1].md.action == '0');
+	CHECK_NEAR(out.entries[0].md.px, -1.5);
+	CHECK_NEAR(out.entries[1].md.px, 0.75);
+}
+
+TEST(RefusesOtherMessageTypes)
+{
+	CHECK(!Parse("8=FIX.4.4|9=100|35=D|34=5|268=0|" + TRAILER));
+	CHECK(!Parse("8=FIX.4.4|9=100|35=XX|34=5|268=0|" + TRAILER));
+	// NoMDEntries before the MsgType is not one we understand either:
+	CHECK(!Parse("8=FIX.4.4|9=100|268=0|35=X|" + TRAILER));
+}
+
+TEST(RefusesAnEntryCountMismatch)
+{
+	CHECK(Parse(HEADER_X + "268=2|" + Entries(2) + TRAILER));
+	CHECK(!Parse(HEADER_X + "268=3|" + Entries(2) + TRAILER));
+	CHECK(!Parse(HEADER_X + "268=1|" + Entries(2) + TRAILER));
+	CHECK(!Parse(HEADER_X + Entries(2) + TRAILER));
+	CHECK(!Parse(HEADER_X + "268=x|" + Entries(2) + TRAILER));
+}
+
+TEST(RefusesMoreEntriesThanFit)
+{
+	FastMdMessage out;
+	CHECK(Parse(HEADER_X + "268=" + std::to_string(MAX_FAST_MD_ENTRIES) + "|" + Entries(MAX_FAST_MD_ENTRIES) + TRAILER, out));
+	CHECK(out.count == MAX_FAST_MD_ENTRIES);
+	CHECK(!Parse(HEADER_X + "268=" + std::to_string(MAX_FAST_MD_ENTRIES + 1) + "|" + Entries(MAX_FAST_MD_ENTRIES + 1) + TRAILER));
+}
+
+TEST(RefusesMalformedPrices)
+{
+	CHECK(!Parse(HEADER_X + "268=1|279=0|269=0|270=1.2.3|271=1|" + TRAILER));
+	CHECK(!Parse(HEADER_X + "268=1|279=0|269=0|270=abc|271=1|" + TRAILER));
+	CHECK(!Parse(HEADER_X + "268=1|279=0|269=0|270=|271=1|" + TRAILER));
+	CHECK(!Parse(HEADER_X + "268=1|279=0|269=0|270=-|271=1|" + TRAILER));
+	CHECK(!Parse(HEADER_X + "268=1|279=0|269=0|270=1e5|271=1|" + TRAILER));
+	// More digits than a double holds exactly:
+	CHECK(!Parse(HEADER_X + "268=1|279=0|269=0|270=1234567890.123456789|271=1|" + TRAILER));
+	// A price outside any entry:
+	CHECK(!Parse(HEADER_X + "270=100|268=1|279=0|269=0|271=1|" + TRAILER));
+}
+
+// Incremental entries start at MDUpdateAction (279), snapshot entries at
+// MDEntryType (269).
+TEST(GroupDelimiterFollowsTheMessageType)
+{
+	CHECK(!Parse(HEADER_X + "268=1|269=0|279=0|270=100|271=1|" + TRAILER));
+	CHECK(!Parse(HEADER_W + "268=1|279=0|269=0|270=100|271=1|" + TRAILER));
+	// A second entry that starts with 269 in an incremental is missing its type:
+	CHECK(!Parse(HEADER_X + "268=2|279=0|269=0|270=100|271=1|269=1|279=0|270=101|271=1|" + TRAILER));
+
+	FastMdMessage out;
+	CHECK(Parse(HEADER_W + "268=2|269=0|279=1|270=100|271=1|269=1|270=101|271=1|" + TRAILER, out));
+	CHECK(out.count == 2 && out.entries[0].md.action == '1' && out.entries[1].md.action == '0');
+}
+
+TEST(ReadsPriceLevels)
+{
+	FastMdMessage out;
+	CHECK(Parse(HEADER_X + "268=2|279=1|269=0|270=100|271=1|1023=10|279=1|269=0|270=99|271=1|" + TRAILER, out));
+	CHECK(out.count == 2 && out.entries[0].md.level == 10 && out.entries[1].md.level == 0);
+
+	CHECK(!Parse(HEADER_X + "268=1|279=1|269=0|270=100|271=1|1023=-1|" + TRAILER));
+	CHECK(!Parse(HEADER_X + "268=1|279=1|269=0|270=100|271=1|1023=1x|" + TRAILER));
+	CHECK(!Parse(HEADER_X + "268=1|279=1|269=0|270=100|271=1|1023=|" + TRAILER));
+	CHECK(!Parse(HEADER_X + "1023=1|268=1|279=1|269=0|270=100|271=1|" + TRAILER));
+}
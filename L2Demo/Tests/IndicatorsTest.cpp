@@ -0,0 +1,160 @@
+// The microstructure indicators: VWAP, EWMA volatility, order flow
+// imbalance, trade sign imbalance and microprice, and the window sums
+// under the windowed ones.
+
+#include "Indicators.h"
+#include "TestHarness.h"
+#include <cmath>
+
+static const int64_t SECOND = 1000000000LL;
+
+TEST(WindowSumExpiresByTime)
+{
+	WindowSum sum(10 * SECOND, 8);
+	sum.Add(0, 1, 10);
+	sum.Add(5 * SECOND, 2, 20);
+	CHECK(sum.Count() == 2);
+	CHECK_NEAR(sum.SumA(), 3.0);
+	CHECK_NEAR(sum.SumB(), 30.0);
+
+	// An entry exactly one window old is out:
+	sum.Expire(10 * SECOND);
+	CHECK(sum.Count() == 1);
+	CHECK_NEAR(sum.SumA(), 2.0);
+	sum.Expire(20 * SECOND);
+	CHECK(sum.Count() == 0);
+	CHECK_NEAR(sum.SumB(), 0.0);
+}
+
+TEST(WindowSumDropsTheOldestWhenFull)
+{
+	WindowSum sum(100 * SECOND, 4);
+	for(int i = 1; i <= 6; ++i)
+		sum.Add(i * SECOND, i);
+	CHECK(sum.Count() == 4);
+	CHECK(sum.Overflows() == 2);
+	CHECK_NEAR(sum.SumA(), 3.0 + 4 + 5 + 6);
+}
+
+TEST(RollingVwapWeighsBySize)
+{
+	RollingVwap vwap(60 * SECOND, 16);
+	CHECK_NEAR(vwap.Value(), 0.0);
+
+	vwap.OnTrade(0, 1, 100);
+	vwap.OnTrade(SECOND, 3, 102);
+	vwap.OnTrade(2 * SECOND, 0, 200);       // no size, no weight
+	CHECK_NEAR(vwap.Value(), 101.5);
+	CHECK_NEAR(vwap.Volume(), 4.0);
+
+	vwap.Expire(60 * SECOND);
+	CHECK_NEAR(vwap.Value(), 102.0);
+	vwap.Expire(61 * SECOND);
+	CHECK_NEAR(vwap.Value(), 0.0);
+}
+
+TEST(EwmaVolatilityUpdatesPerPriceChange)
+{
+	EwmaVolatility volatility(0.5);
+	volatility.OnPrice(100);
+	volatility.OnPrice(100);
+	CHECK(volatility.Count() == 0);
+	CHECK_NEAR(volatility.Value(), 0.0);
+
+	// The first return seeds the variance:
+	const double r1 = std::log(110.0 / 100.0);
+	volatility.OnPrice(110);
+	CHECK(volatility.Count() == 1);
+	CHECK_NEAR(volatility.Value(), r1);
+
+	// Repeats and non-positive prices are not returns:
+	volatility.OnPrice(110);
+	volatility.OnPrice(0);
+	volatility.OnPrice(-5);
+	CHECK(volatility.Count() == 1);
+	CHECK_NEAR(volatility.Value(), r1);
+
+	const double r2 = std::log(100.0 / 110.0);
+	volatility.OnPrice(100);
+	CHECK(volatility.Count() == 2);
+	CHECK_NEAR(volatility.Value(), std::sqrt(0.5 * r1 * r1 + 0.5 * r2 * r2));
+}
+
+TEST(OrderFlowImbalanceFromQuoteChanges)
+{
+	OrderFlowImbalance flow(10 * SECOND, 16);
+
+	// The first quote only sets the reference:
+	flow.OnQuote(0, 100, 5, 101, 5);
+	CHECK_NEAR(flow.Value(), 0.0);
+
+	// Same prices: bid size up 3.
+	flow.OnQuote(SECOND, 100, 8, 101, 5);
+	CHECK_NEAR(flow.Value(), 3.0);
+
+	// Bid up a level with 2 new; offer unchanged in price, down 1.
+	flow.OnQuote(2 * SECOND, 100.5, 2, 101, 4);
+	CHECK_NEAR(flow.Value(), 6.0);
+
+	// Offer down a level with 6: all of it counts against the bid.
+	flow.OnQuote(3 * SECOND, 100.5, 2, 100.75, 6);
+	CHECK_NEAR(flow.Value(), 0.0);
+
+	// A one-sided quote drops the reference, so the next quote adds nothing:
+	flow.OnQuote(4 * SECOND, 0, 0, 100.75, 6);
+	flow.OnQuote(5 * SECOND, 100.5, 9, 100.75, 6);
+	CHECK_NEAR(flow.Value(), 0.0);
+
+	flow.Expire(11 * SECOND);
+	CHECK_NEAR(flow.Value(), -3.0);
+	flow.Expire(13 * SECOND);
+	CHECK_NEAR(flow.Value(), 0.0);
+}
+
+TEST(TradeSignImbalanceUsesTheMidThenTheTickRule)
+{
+	TradeSignImbalance sign(10 * SECOND, 16);
+	CHECK(sign.LastSign() == 0);
+
+	sign.OnTrade(0, 2, 100.5, 100);         // above the mid: buy
+	CHECK(sign.LastSign() == 1);
+	sign.OnTrade(SECOND, 1, 99.5, 100);     // below: sell
+	CHECK(sign.LastSign() == -1);
+	CHECK_NEAR(sign.Value(), 1.0 / 3);
+
+	sign.OnTrade(2 * SECOND, 3, 100, 100);  // at the mid, up tick: buy
+	CHECK(sign.LastSign() == 1);
+	sign.OnTrade(3 * SECOND, 2, 100, 0);    // no quote, same price: as before
+	CHECK(sign.LastSign() == 1);
+	CHECK_NEAR(sign.Value(), 6.0 / 8);
+
+	sign.Expire(12 * SECOND);
+	CHECK_NEAR(sign.Value(), 1.0);
+	sign.Expire(20 * SECOND);
+	CHECK_NEAR(sign.Value(), 0.0);
+}
+
+TEST(MicropriceLeansTowardsTheThinSide)
+{
+	CHECK_NEAR(Microprice(100, 1, 101, 3), 100.25);
+	CHECK_NEAR(Microprice(100, 3, 101, 1), 100.75);
+	CHECK_NEAR(Microprice(100, 2, 101, 2), 100.5);
+	CHECK_NEAR(Microprice(0, 1, 101, 3), 0.0);
+	CHECK_NEAR(Microprice(100, 1, 0, 3), 0.0);
+	CHECK_NEAR(Microprice(100, 0, 101, 0), 0.0);
+}
+
+TEST(SignalsKeepTheLastMidOnAOneSidedBook)
+{
+	MicrostructureSignals signals;
+	signals.OnQuote(0, 100, 1, 101, 3);
+	CHECK_NEAR(signals.Mid(), 100.5);
+	CHECK_NEAR(signals.Microprice(), 100.25);
+
+	signals.OnQuote(SECOND, 0, 0, 101, 3);
+	CHECK_NEAR(signals.Mid(), 100.5);
+
+	signals.OnTrade(2 * SECOND, 4, 101);
+	CHECK_NEAR(signals.Vwap(), 101.0);
+	CHECK_NEAR(signals.TradeSign(), 1.0);
+}
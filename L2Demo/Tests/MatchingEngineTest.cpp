@@ -0,0 +1,123 @@
+// MatchingEngine: price-time priority fills, resting and canceling orders,
+// and the level changes it reports for market data.
+
+#include "MatchingEngine.h"
+#include "TestHarness.h"
+
+static const int SIM = 0;
+static const int CLIENT = 1;
+
+TEST(LimitOrdersRestWithoutACross)
+{
+	MatchingEngine engine;
+	std::vector<Execution> executions;
+	std::vector<LevelChange> changes;
+
+	CHECK(engine.SubmitLimit(1, SIM, SIM_BUY, 100, 5, executions, changes) == 5);
+	CHECK(engine.SubmitLimit(2, SIM, SIM_BUY, 100, 3, executions, changes) == 3);
+	CHECK(engine.SubmitLimit(3, SIM, SIM_SELL, 102, 4, executions, changes) == 4);
+	CHECK(executions.empty());
+
+	CHECK(engine.HasBid() && engine.BestBid() == 100);
+	CHECK(engine.HasOffer() && engine.BestOffer() == 102);
+	CHECK(engine.IsResting(1) && engine.IsResting(2) && engine.IsResting(3));
+
+	CHECK(changes.size() == 3);
+	CHECK(changes[0].side == SIM_BUY && changes[0].action == '0' && changes[0].px == 100 && changes[0].qty == 5);
+	CHECK(changes[1].action == '1' && changes[1].qty == 8);
+	CHECK(changes[2].side == SIM_SELL && changes[2].action == '0' && changes[2].qty == 4);
+}
+
+TEST(FillsInPriceThenTimeOrder)
+{
+	MatchingEngine engine;
+	std::vector<Execution> executions;
+	std::vector<LevelChange> changes;
+
+	engine.SubmitLimit(1, SIM, SIM_SELL, 101, 2, executions, changes);
+	engine.SubmitLimit(2, SIM, SIM_SELL, 100, 3, executions, changes);
+	engine.SubmitLimit(3, SIM, SIM_SELL, 100, 4, executions, changes);
+	changes.clear();
+
+	// Takes 100 (order 2, then 3) before 101, and rests nothing.
+	CHECK(engine.SubmitLimit(10, CLIENT, SIM_BUY, 101, 8, executions, changes) == 0);
+	CHECK(executions.size() == 3);
+	if(executions.size() != 3) return;
+	CHECK(executions[0].restingId == 2 && executions[0].px == 100 && executions[0].qty == 3);
+	CHECK(executions[0].aggressorId == 10 && executions[0].aggressorOwner == CLIENT && executions[0].restingOwner == SIM);
+	CHECK(executions[0].aggressorLeaves == 5 && executions[0].restingLeaves == 0);
+	CHECK(executions[1].restingId == 3 && executions[1].qty == 4 && executions[1].restingLeaves == 0);
+	CHECK(executions[2].restingId == 1 && executions[2].px == 101 && executions[2].qty == 1);
+	CHECK(executions[2].aggressorLeaves == 0 && executions[2].restingLeaves == 1);
+
+	CHECK(!engine.IsResting(2) && !engine.IsResting(3) && engine.IsResting(1));
+	CHECK(!engine.IsResting(10));
+	CHECK(engine.BestOffer() == 101);
+	CHECK(!engine.HasBid());
+
+	CHECK(changes.size() == 2);
+	CHECK(changes[0].side == SIM_SELL && changes[0].action == '2' && changes[0].px == 100);
+	CHECK(changes[1].action == '1' && changes[1].px == 101 && changes[1].qty == 1);
+}
+
+TEST(LimitOrderRestsWhatDoesNotFill)
+{
+	MatchingEngine engine;
+	std::vector<Execution> executions;
+	std::vector<LevelChange> changes;
+
+	engine.SubmitLimit(1, SIM, SIM_BUY, 100, 2, executions, changes);
+	engine.SubmitLimit(2, SIM, SIM_BUY, 99, 5, executions, changes);
+
+	// Sells down to 100 only; the rest becomes the best offer at 100.
+	CHECK(engine.SubmitLimit(3, CLIENT, SIM_SELL, 100, 6, executions, changes) == 4);
+	CHECK(executions.size() == 1 && executions[0].restingId == 1 && executions[0].qty == 2);
+	CHECK(engine.IsResting(3));
+	CHECK(engine.BestOffer() == 100 && engine.BestBid() == 99);
+
+	std::vector<std::pair<int64_t, int64_t> > levels;
+	engine.Levels(SIM_SELL, 5, levels);
+	CHECK(levels.size() == 1 && levels[0].first == 100 && levels[0].second == 4);
+	CHECK(engine.Rank(SIM_BUY, 99, 5) == 1);
+	CHECK(engine.Rank(SIM_BUY, 98, 5) == 0);
+}
+
+TEST(MarketOrderNeverRests)
+{
+	MatchingEngine engine;
+	std::vector<Execution> executions;
+	std::vector<LevelChange> changes;
+
+	engine.SubmitLimit(1, SIM, SIM_BUY, 100, 2, executions, changes);
+	engine.SubmitLimit(2, SIM, SIM_BUY, 98, 3, executions, changes);
+
+	CHECK(engine.SubmitMarket(3, CLIENT, SIM_SELL, 7, executions, changes) == 2);
+	CHECK(executions.size() == 2 && executions[1].px == 98 && executions[1].qty == 3);
+	CHECK(!engine.IsResting(3));
+	CHECK(!engine.HasBid() && !engine.HasOffer());
+}
+
+TEST(CancelRemovesTheRestingOrder)
+{
+	MatchingEngine engine;
+	std::vector<Execution> executions;
+	std::vector<LevelChange> changes;
+
+	engine.SubmitLimit(1, CLIENT, SIM_SELL, 105, 4, executions, changes);
+	engine.SubmitLimit(2, SIM, SIM_SELL, 105, 6, executions, changes);
+	engine.SubmitMarket(3, SIM, SIM_BUY, 1, executions, changes);
+	changes.clear();
+
+	CHECK(engine.AnyRestingOrder(CLIENT, 0) == 1);
+	CHECK(engine.Cancel(1, changes) == 3);
+	CHECK(!engine.IsResting(1));
+	CHECK(changes.size() == 1 && changes[0].action == '1' && changes[0].qty == 6);
+
+	CHECK(engine.Cancel(1, changes) == 0);
+	CHECK(engine.AnyRestingOrder(CLIENT, 0) == 0);
+
+	changes.clear();
+	CHECK(engine.Cancel(2, changes) == 6);
+	CHECK(changes.size() == 1 && changes[0].action == '2');
+	CHECK(!engine.HasOffer());
+}
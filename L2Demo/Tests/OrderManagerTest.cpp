@@ -0,0 +1,193 @@
+// Order state transitions, working quantity, replace accounting and
+// positions as OrderManager keeps them.
+
+#include "OrderManager.h"
+#include "TestHarness.h"
+#include <stdexcept>
+
+// FIX values
+static const char BUY = '1';
+static const char SELL = '2';
+static const char LIMIT = '2';
+static const char EXEC_NEW = '0';
+static const char EXEC_PARTIAL_FILL = '1';
+static const char EXEC_FILL = '2';
+static const char EXEC_CANCELED = '4';
+static const char EXEC_REPLACE = '5';
+static const char EXEC_REJECTED = '8';
+
+static const InstrumentId ES = 0;
+
+TEST(NewOrderIsAckedThenFilled)
+{
+	OrderManager orders(16);
+	orders.AddInstrument(ES);
+
+	const Order & order = orders.OnNewOrder("1", ES, BUY, LIMIT, 10, 100.0);
+	CHECK(order.state == ORDER_PENDING_NEW);
+	CHECK(orders.LiveOrders() == 1);
+	CHECK_NEAR(orders.GetPosition(ES).workingBuyQty, 10.0);
+
+	orders.OnExecutionReport("1", "", ES, BUY, EXEC_NEW, 0, 0);
+	CHECK(order.state == ORDER_ACKED);
+
+	orders.OnExecutionReport("1", "", ES, BUY, EXEC_PARTIAL_FILL, 4, 100.0);
+	CHECK(order.state == ORDER_PARTIALLY_FILLED);
+	CHECK_NEAR(order.cumQty, 4.0);
+	CHECK_NEAR(order.LeavesQty(), 6.0);
+	CHECK_NEAR(orders.GetPosition(ES).workingBuyQty, 6.0);
+	CHECK_NEAR(orders.GetPosition(ES).netQty, 4.0);
+
+	orders.OnExecutionReport("1", "", ES, BUY, EXEC_FILL, 6, 99.5);
+	CHECK(order.state == ORDER_FILLED);
+	CHECK_NEAR(order.cumQty, 10.0);
+	CHECK_NEAR(order.avgPx, (4 * 100.0 + 6 * 99.5) / 10);
+	CHECK_NEAR(order.LeavesQty(), 0.0);
+	CHECK(orders.LiveOrders() == 0);
+	CHECK_NEAR(orders.GetPosition(ES).workingBuyQty, 0.0);
+	CHECK_NEAR(orders.GetPosition(ES).netQty, 10.0);
+
+	// A late fill of a finished order changes nothing:
+	orders.OnExecutionReport("1", "", ES, BUY, EXEC_FILL, 1, 99.0);
+	CHECK_NEAR(order.cumQty, 10.0);
+	CHECK_NEAR(orders.GetPosition(ES).netQty, 10.0);
+}
+
+TEST(RejectAndCancelEndTheOrder)
+{
+	OrderManager orders(16);
+	orders.AddInstrument(ES);
+
+	const Order & rejected = orders.OnNewOrder("1", ES, SELL, LIMIT, 5, 101.0);
+	orders.OnExecutionReport("1", "", ES, SELL, EXEC_REJECTED, 0, 0);
+	CHECK(rejected.state == ORDER_REJECTED);
+	CHECK(rejected.IsTerminal());
+	CHECK_NEAR(orders.GetPosition(ES).workingSellQty, 0.0);
+
+	const Order & canceled = orders.OnNewOrder("2", ES, SELL, LIMIT, 5, 101.0);
+	orders.OnExecutionReport("2", "", ES, SELL, EXEC_NEW, 0, 0);
+	orders.OnCancelRequested("2");
+	CHECK(canceled.cancelPending);
+
+	// The exchange refuses the first cancel, then takes the second; the
+	// cancel's own ClOrdID is the one on the report.
+	orders.OnCancelReject("3", "2");
+	CHECK(!canceled.cancelPending);
+	CHECK(canceled.state == ORDER_ACKED);
+	orders.OnCancelRequested("2");
+	orders.OnExecutionReport("4", "2", ES, SELL, EXEC_CANCELED, 0, 0);
+	CHECK(canceled.state == ORDER_CANCELED);
+	CHECK(!canceled.cancelPending);
+	CHECK(orders.LiveOrders() == 0);
+	CHECK_NEAR(orders.GetPosition(ES).workingSellQty, 0.0);
+}
+
+TEST(ReplaceTakesOverFillsAndWorkingQuantity)
+{
+	OrderManager orders(16);
+	orders.AddInstrument(ES);
+
+	const Order & original = orders.OnNewOrder("1", ES, BUY, LIMIT, 10, 100.0);
+	orders.OnExecutionReport("1", "", ES, BUY, EXEC_NEW, 0, 0);
+	orders.OnExecutionReport("1", "", ES, BUY, EXEC_PARTIAL_FILL, 4, 100.0);
+
+	orders.OnReplaceRequested("2", "1", 8, 100.25);
+	const Order* replacement = orders.Find("2");
+	CHECK(replacement != nullptr);
+	if(!replacement) return;
+	CHECK(replacement->state == ORDER_PENDING_REPLACE);
+	CHECK(replacement->ordType == LIMIT);
+	CHECK(replacement->side == BUY);
+	// Nothing more is working until the exchange confirms:
+	CHECK_NEAR(orders.GetPosition(ES).workingBuyQty, 6.0);
+
+	orders.OnExecutionReport("2", "1", ES, BUY, EXEC_REPLACE, 0, 0);
+	CHECK(original.state == ORDER_REPLACED);
+	CHECK(replacement->state == ORDER_PARTIALLY_FILLED);
+	CHECK_NEAR(replacement->cumQty, 4.0);
+	CHECK_NEAR(replacement->LeavesQty(), 4.0);
+	CHECK_NEAR(orders.GetPosition(ES).workingBuyQty, 4.0);
+	CHECK(orders.LiveOrders() == 1);
+
+	orders.OnExecutionReport("2", "", ES, BUY, EXEC_FILL, 4, 100.25);
+	CHECK(replacement->state == ORDER_FILLED);
+	CHECK_NEAR(orders.GetPosition(ES).netQty, 8.0);
+	CHECK_NEAR(orders.GetPosition(ES).workingBuyQty, 0.0);
+}
+
+TEST(RefusedReplaceLeavesTheOriginalWorking)
+{
+	OrderManager orders(16);
+	orders.AddInstrument(ES);
+
+	const Order & original = orders.OnNewOrder("1", ES, SELL, LIMIT, 5, 101.0);
+	orders.OnExecutionReport("1", "", ES, SELL, EXEC_NEW, 0, 0);
+	orders.OnReplaceRequested("2", "1", 7, 100.75);
+
+	orders.OnCancelReject("2", "1");
+	const Order* replacement = orders.Find("2");
+	CHECK(replacement && replacement->state == ORDER_REJECTED);
+	CHECK(original.state == ORDER_ACKED);
+	CHECK_NEAR(orders.GetPosition(ES).workingSellQty, 5.0);
+	CHECK(orders.LiveOrders() == 1);
+}
+
+TEST(PositionKeepsAverageCostAndPnl)
+{
+	OrderManager orders(16);
+	orders.AddInstrument(ES);
+
+	orders.OnNewOrder("1", ES, BUY, LIMIT, 5, 100.0);
+	orders.OnExecutionReport("1", "", ES, BUY, EXEC_FILL, 5, 100.0);
+	orders.OnNewOrder("2", ES, BUY, LIMIT, 5, 102.0);
+	orders.OnExecutionReport("2", "", ES, BUY, EXEC_FILL, 5, 102.0);
+	CHECK_NEAR(orders.GetPosition(ES).netQty, 10.0);
+	CHECK_NEAR(orders.GetPosition(ES).avgCost, 101.0);
+
+	// Sell through zero: 10 close at a profit of 4 each, 3 open short at 105.
+	orders.OnNewOrder("3", ES, SELL, LIMIT, 13, 105.0);
+	orders.OnExecutionReport("3", "", ES, SELL, EXEC_FILL, 13, 105.0);
+	const Position & position = orders.GetPosition(ES);
+	CHECK_NEAR(position.netQty, -3.0);
+	CHECK_NEAR(position.avgCost, 105.0);
+	CHECK_NEAR(position.realizedPnl, 40.0);
+	CHECK_NEAR(position.boughtQty, 10.0);
+	CHECK_NEAR(position.soldQty, 13.0);
+
+	orders.Mark(ES, 104.0);
+	CHECK_NEAR(position.UnrealizedPnl(), 3.0);
+	CHECK_NEAR(position.TotalPnl(), 43.0);
+
+	// Fills of orders we do not know still move the position:
+	orders.OnExecutionReport("unknown", "", ES, BUY, EXEC_FILL, 3, 104.0);
+	CHECK_NEAR(position.netQty, 0.0);
+	CHECK_NEAR(position.avgCost, 0.0);
+	CHECK_NEAR(position.realizedPnl, 43.0);
+}
+
+TEST(FinishedOrderSlotsAreReclaimed)
+{
+	OrderManager orders(2);
+	orders.AddInstrument(ES);
+
+	orders.OnNewOrder("1", ES, BUY, LIMIT, 1, 100.0);
+	orders.OnNewOrder("2", ES, BUY, LIMIT, 1, 100.0);
+	orders.OnExecutionReport("1", "", ES, BUY, EXEC_FILL, 1, 100.0);
+
+	// The slab is full; the filled order's slot is reused.
+	orders.OnNewOrder("3", ES, BUY, LIMIT, 1, 100.0);
+	CHECK(orders.Find("1") == nullptr);
+	CHECK(orders.Find("2") != nullptr);
+	CHECK(orders.Find("3") != nullptr);
+
+	bool threw = false;
+	try
+	{
+		orders.OnNewOrder("4", ES, BUY, LIMIT, 1, 100.0);
+	}
+	catch(std::runtime_error &)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+}
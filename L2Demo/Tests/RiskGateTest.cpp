@@ -0,0 +1,132 @@
+// RiskGate limits, the kill switch and how fills, releases and replaces
+// move the exposure it checks against.
+
+#include "RiskGate.h"
+#include "TestHarness.h"
+
+// FIX Side values
+static const char BUY = '1';
+static const char SELL = '2';
+
+static const InstrumentId ES = 0;
+static const InstrumentId NQ = 1;
+
+static RiskLimits Limits(int maxOrderQty, int maxPosition, int ordersPerSecond, int burst)
+{
+	RiskLimits limits = { maxOrderQty, maxPosition, ordersPerSecond, burst };
+	return limits;
+}
+
+TEST(OrderQtyLimit)
+{
+	RiskGate risk;
+	risk.SetLimits(Limits(10, 0, 0, 0));
+	const int account = risk.Account(ES, "A");
+
+	CHECK(risk.Check(ES, account, BUY, 10) == RISK_OK);
+	CHECK(risk.Check(ES, account, BUY, 11) == RISK_ORDER_QTY);
+	CHECK(risk.Passed() == 1);
+	CHECK(risk.Rejects(RISK_ORDER_QTY) == 1);
+	// The refused order is not counted as working:
+	CHECK(risk.GetExposure(ES, account).workingBuy == 10);
+}
+
+TEST(PositionLimitCountsWorkingOrders)
+{
+	RiskGate risk;
+	risk.SetLimits(Limits(0, 10, 0, 0));
+	const int account = risk.Account(ES, "A");
+
+	CHECK(risk.Check(ES, account, BUY, 6) == RISK_OK);
+	CHECK(risk.Check(ES, account, BUY, 5) == RISK_POSITION);
+	CHECK(risk.Check(ES, account, BUY, 4) == RISK_OK);
+	CHECK_NEAR(risk.Headroom(ES, account, BUY), 0.0);
+
+	// A fill moves quantity from working to the position; a cancel frees it.
+	risk.OnFill(ES, account, BUY, 6);
+	RiskExposure exposure = risk.GetExposure(ES, account);
+	CHECK(exposure.position == 6);
+	CHECK(exposure.workingBuy == 4);
+	CHECK(risk.Check(ES, account, BUY, 1) == RISK_POSITION);
+
+	risk.Release(ES, account, BUY, 4);
+	CHECK_NEAR(risk.Headroom(ES, account, BUY), 4.0);
+	CHECK(risk.Check(ES, account, BUY, 4) == RISK_OK);
+
+	// Selling out of a long position has room for the long plus the limit:
+	CHECK_NEAR(risk.Headroom(ES, account, SELL), 16.0);
+	CHECK(risk.Check(ES, account, SELL, 16) == RISK_OK);
+	CHECK(risk.Check(ES, account, SELL, 1) == RISK_POSITION);
+}
+
+TEST(LimitsArePerInstrumentAndAccount)
+{
+	RiskGate risk;
+	risk.SetLimits(Limits(0, 5, 0, 0));
+	const int a = risk.Account(ES, "A");
+	const int b = risk.Account(ES, "B");
+	const int nq = risk.Account(NQ, "A");
+
+	CHECK(a != b);
+	CHECK(risk.Account(ES, "A") == a);
+	CHECK(risk.Accounts(ES) == 2);
+	CHECK(risk.Check(ES, a, BUY, 5) == RISK_OK);
+	CHECK(risk.Check(ES, b, BUY, 5) == RISK_OK);
+	CHECK(risk.Check(NQ, nq, BUY, 5) == RISK_OK);
+	CHECK(risk.Check(ES, a, BUY, 1) == RISK_POSITION);
+}
+
+// Simple counts a replace's new quantity in full when it is sent and
+// releases the original's leaves once the exchange confirms it.
+TEST(ReplaceAccounting)
+{
+	RiskGate risk;
+	risk.SetLimits(Limits(0, 10, 0, 0));
+	const int account = risk.Account(ES, "A");
+
+	CHECK(risk.Check(ES, account, SELL, 6) == RISK_OK);
+	risk.OnFill(ES, account, SELL, 2);
+
+	// Short 2 with 4 working leaves room for 4 more.  Both the original's 4
+	// and the replacement count until the replace is confirmed:
+	CHECK(risk.Check(ES, account, SELL, 6) == RISK_POSITION);
+	CHECK(risk.Check(ES, account, SELL, 4) == RISK_OK);
+	CHECK(risk.GetExposure(ES, account).workingSell == 8);
+	CHECK_NEAR(risk.Headroom(ES, account, SELL), 0.0);
+
+	risk.Release(ES, account, SELL, 4);
+	RiskExposure exposure = risk.GetExposure(ES, account);
+	CHECK(exposure.position == -2);
+	CHECK(exposure.workingSell == 4);
+	CHECK_NEAR(risk.Headroom(ES, account, SELL), 4.0);
+}
+
+TEST(KillSwitchBlocksUntilResumed)
+{
+	RiskGate risk;
+	const int account = risk.Account(ES, "A");
+
+	risk.Kill();
+	CHECK(risk.Killed());
+	CHECK(risk.Check(ES, account, BUY, 1) == RISK_KILLED);
+	CHECK(risk.GetExposure(ES, account).workingBuy == 0);
+
+	risk.Resume();
+	CHECK(risk.Check(ES, account, BUY, 1) == RISK_OK);
+	CHECK(risk.Rejects(RISK_KILLED) == 1);
+}
+
+TEST(RateLimitAllowsTheBurst)
+{
+	RiskGate risk;
+	// One order a second, three back to back; the test runs well within a second.
+	risk.SetLimits(Limits(0, 0, 1, 3));
+	const int account = risk.Account(ES, "A");
+
+	CHECK(risk.Tokens() == 3);
+	CHECK(risk.Check(ES, account, BUY, 1) == RISK_OK);
+	CHECK(risk.Check(ES, account, BUY, 1) == RISK_OK);
+	CHECK(risk.Check(ES, account, BUY, 1) == RISK_OK);
+	CHECK(risk.Check(ES, account, BUY, 1) == RISK_RATE);
+	CHECK(risk.GetExposure(ES, account).workingBuy == 3);
+}
@@ -0,0 +1,185 @@
+// StateCheckpoint: state saved by one process is restored by the next, and
+// a commit interrupted half way is finished from the redo area on open.
+
+#include "StateCheckpoint.h"
+#include "TestHarness.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+// FIX values
+static const char BUY = '1';
+static const char SELL = '2';
+static const char LIMIT = '2';
+static const char EXEC_NEW = '0';
+static const char EXEC_PARTIAL_FILL = '1';
+static const char EXEC_FILL = '2';
+
+static const size_t ORDER_CAPACITY = 16;
+static const size_t MAX_INSTRUMENTS = 4;
+static const InstrumentId ES = 0;
+
+// CheckpointRedo::kind of an order record; part of the file format.
+static const uint32_t REDO_ORDER = 1;
+
+static Instrument MakeInstrument(const string & symbol)
+{
+	Instrument details;
+	details.symbol = symbol;
+	details.maturityMonthYear = "202612";
+	details.exchange = "CME";
+	return details;
+}
+
+// A fresh checkpoint at `path` holding a partly filled buy and a working
+// sell on ES, each commit tagged with its ExecutionReport's MsgSeqNum.
+static void WriteCheckpoint(const char* path)
+{
+	std::remove(path);
+	StateCheckpoint checkpoint(path, ORDER_CAPACITY, MAX_INSTRUMENTS);
+	CHECK(!checkpoint.Recovered());
+
+	OrderManager orders(ORDER_CAPACITY);
+	RiskGate risk;
+	orders.AddInstrument(ES);
+	orders.TrackChanges(true);
+	checkpoint.AddInstrument(ES, MakeInstrument("ES"));
+	const int account = risk.Account(ES, "ACCT");
+
+	risk.Check(ES, account, BUY, 10);
+	orders.OnNewOrder("1", ES, BUY, LIMIT, 10, 100.0, account);
+	checkpoint.Commit(orders, risk);
+	orders.OnExecutionReport("1", "", ES, BUY, EXEC_NEW, 0, 0);
+	checkpoint.Commit(orders, risk, 7);
+	orders.OnExecutionReport("1", "", ES, BUY, EXEC_PARTIAL_FILL, 4, 100.0);
+	risk.OnFill(ES, account, BUY, 4);
+	checkpoint.Commit(orders, risk, 8);
+
+	risk.Check(ES, account, SELL, 3);
+	orders.OnNewOrder("2", ES, SELL, LIMIT, 3, 101.0, account);
+	checkpoint.Commit(orders, risk);
+
+	CHECK(checkpoint.Header().lastExecSeqNum == 8);
+	CHECK(checkpoint.Header().redoCount == 0);
+}
+
+TEST(RestoresOrdersPositionsAndRisk)
+{
+	const char* path = "StateCheckpointTest_restore.chk";
+	WriteCheckpoint(path);
+
+	StateCheckpoint checkpoint(path, ORDER_CAPACITY, MAX_INSTRUMENTS);
+	CHECK(checkpoint.Recovered());
+	CHECK(checkpoint.Instruments() == 1);
+	CHECK(checkpoint.GetInstrument(ES).symbol == "ES");
+	CHECK(checkpoint.GetInstrument(ES).maturityMonthYear == "202612");
+	CHECK(checkpoint.Header().lastExecSeqNum == 8);
+
+	OrderManager orders(ORDER_CAPACITY);
+	RiskGate risk;
+	checkpoint.Restore(orders, risk);
+
+	CHECK(orders.LiveOrders() == 2);
+	const Order* buy = orders.Find("1");
+	CHECK(buy && buy->state == ORDER_PARTIALLY_FILLED);
+	CHECK(buy && buy->cumQty == 4);
+	const Order* sell = orders.Find("2");
+	CHECK(sell && sell->state == ORDER_PENDING_NEW);
+
+	const Position & position = orders.GetPosition(ES);
+	CHECK_NEAR(position.netQty, 4.0);
+	CHECK_NEAR(position.workingBuyQty, 6.0);
+	CHECK_NEAR(position.workingSellQty, 3.0);
+
+	CHECK(risk.Accounts(ES) == 1);
+	const int account = risk.Account(ES, "ACCT");
+	const RiskExposure exposure = risk.GetExposure(ES, account);
+	CHECK(exposure.position == 4);
+	CHECK(exposure.workingBuy == 6);
+	CHECK(exposure.workingSell == 3);
+
+	// The restored orders carry on as if nothing happened:
+	orders.OnExecutionReport("1", "", ES, BUY, EXEC_FILL, 6, 100.0);
+	CHECK(buy && buy->state == ORDER_FILLED);
+	CHECK_NEAR(orders.GetPosition(ES).netQty, 10.0);
+	CHECK(orders.LiveOrders() == 1);
+
+	std::remove(path);
+}
+
+// Stage a fill of order "1" and its MsgSeqNum the way Commit() does, but
+// stop before the records are copied into place, as a crash would.
+TEST(FinishesAnInterruptedCommit)
+{
+	const char* path = "StateCheckpointTest_redo.chk";
+	WriteCheckpoint(path);
+
+	uint32_t slot = 0;
+	{
+		StateCheckpoint checkpoint(path, ORDER_CAPACITY, MAX_INSTRUMENTS);
+		OrderManager orders(ORDER_CAPACITY);
+		RiskGate risk;
+		checkpoint.Restore(orders, risk);
+		const Order* buy = orders.Find("1");
+		CHECK(buy != nullptr);
+		if(!buy) return;
+		slot = static_cast<uint32_t>(buy - &orders.Slot(0));
+	}
+
+	{
+		// The header, then the redo area on the next cache line:
+		const size_t redoOffset = (sizeof(CheckpointHeader) + CACHE_LINE_SIZE - 1) & ~static_cast<size_t>(CACHE_LINE_SIZE - 1);
+		MappedFile file;
+		file.Open(path, redoOffset + sizeof(CheckpointRedo));
+		CheckpointHeader* header = reinterpret_cast<CheckpointHeader*>(file.Data());
+		CheckpointRedo* redo = reinterpret_cast<CheckpointRedo*>(file.Data() + redoOffset);
+
+		OrderManager scratch(ORDER_CAPACITY);
+		scratch.AddInstrument(ES);
+		Order filled = scratch.OnNewOrder("1", ES, BUY, LIMIT, 10, 100.0);
+		filled.state = ORDER_FILLED;
+		filled.cumQty = 10;
+		filled.avgPx = 100.0;
+
+		std::memset(redo, 0, sizeof(CheckpointRedo));
+		redo->kind = REDO_ORDER;
+		redo->index = slot;
+		redo->order = filled;
+		header->redoExecSeqNum = 9;
+		header->redoCount = 1;
+		file.Flush();
+	}
+
+	StateCheckpoint checkpoint(path, ORDER_CAPACITY, MAX_INSTRUMENTS);
+	CHECK(checkpoint.Header().redoCount == 0);
+	CHECK(checkpoint.Header().lastExecSeqNum == 9);
+
+	OrderManager orders(ORDER_CAPACITY);
+	RiskGate risk;
+	checkpoint.Restore(orders, risk);
+	const Order* buy = orders.Find("1");
+	CHECK(buy && buy->state == ORDER_FILLED);
+	CHECK(buy && buy->cumQty == 10);
+	CHECK(orders.LiveOrders() == 1);
+
+	std::remove(path);
+}
+
+TEST(RefusesAFileOfAnotherSize)
+{
+	const char* path = "StateCheckpointTest_size.chk";
+	WriteCheckpoint(path);
+
+	bool threw = false;
+	try
+	{
+		StateCheckpoint checkpoint(path, 2 * ORDER_CAPACITY, MAX_INSTRUMENTS);
+	}
+	catch(std::runtime_error &)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+
+	std::remove(path);
+}
@@ -0,0 +1,55 @@
+#include "TestHarness.h"
+#include <exception>
+#include <iostream>
+#include <vector>
+
+struct RegisteredTest
+{
+	const char* name;
+	TestFunction function;
+};
+
+// A function-local static, so registration order across files does not matter.
+static std::vector<RegisteredTest>& Tests()
+{
+	static std::vector<RegisteredTest> tests;
+	return tests;
+}
+
+static int failures = 0;
+
+TestRegistration::TestRegistration(const char* name, TestFunction function)
+{
+	RegisteredTest test = { name, function };
+	Tests().push_back(test);
+}
+
+void ReportFailure(const char* file, int line, const char* expression)
+{
+	std::cerr << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+	++failures;
+}
+
+int main()
+{
+	int failed = 0;
+	for(size_t i = 0; i < Tests().size(); ++i)
+	{
+		const RegisteredTest & test = Tests()[i];
+		const int before = failures;
+		try
+		{
+			test.function();
+		}
+		catch(std::exception & e)
+		{
+			std::cerr << test.name << " threw: " << e.what() << std::endl;
+			++failures;
+		}
+		const bool ok = failures == before;
+		if(!ok) ++failed;
+		std::cout << "[test] " << test.name << (ok ? " ok" : " FAILED") << std::endl;
+	}
+	std::cout << "[test] " << Tests().size() - failed << "/" << Tests().size() << " passed" << std::endl;
+	return failed == 0 ? 0 : 1;
+}
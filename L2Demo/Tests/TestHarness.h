@@ -0,0 +1,31 @@
+#ifndef TEST_HARNESS_H
+#define TEST_HARNESS_H
+
+// A small runner for the behavior tests.  TEST(Name) defines a test;
+// CHECK(condition) and CHECK_NEAR(a, b) record a failure and carry on.
+// TestHarness.cpp supplies main(), which runs every test and exits non-zero
+// if any check failed or a test threw.
+
+#include <cmath>
+
+typedef void (*TestFunction)();
+
+struct TestRegistration
+{
+	TestRegistration(const char* name, TestFunction function);
+};
+
+void ReportFailure(const char* file, int line, const char* expression);
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistration name##Registration(#name, &name); \
+	static void name()
+
+#define CHECK(condition) \
+	((condition) ? (void)0 : ReportFailure(__FILE__, __LINE__, #condition))
+
+#define CHECK_NEAR(actual, expected) \
+	((std::fabs((actual) - (expected)) < 1e-9) ? (void)0 : ReportFailure(__FILE__, __LINE__, #actual " == " #expected))
+
+#endif
@@ -0,0 +1,194 @@
+// TickStore and TickStoreReader: ticks written through the store come back
+// from the file unchanged, across blocks, for a time range, and in the units
+// the file was started with.
+
+#include "TickStore.h"
+#include "TestHarness.h"
+#include <cstdio>
+
+static const InstrumentId ES = 0;
+static const double TICK_SIZE = 0.25;
+
+// 2023-11-14 22:13:20 UTC; the ticks below stay well inside the day.
+static const int64_t BASE_TIME = 1700000000LL * 1000000000LL;
+static const int DAY = 20231114;
+
+// Enough ticks for one full block and part of a second.
+static const int TICK_COUNT = TICK_BLOCK_SIZE + 100;
+
+static Instrument MakeInstrument(const string & symbol)
+{
+	Instrument details;
+	details.symbol = symbol;
+	details.maturityMonthYear = "202612";
+	details.exchange = "CME";
+	return details;
+}
+
+static string PathFor(const string & symbol)
+{
+	return TickStore::FileName(".", symbol, "202612", DAY);
+}
+
+// Every seventh tick is stamped before the one ahead of it, and the price
+// wanders up and down, so both columns have negative deltas.
+static int64_t TimeOf(int i)
+{
+	return BASE_TIME + i * 1000LL - (i % 7 == 3 ? 1500 : 0);
+}
+
+static double PxOf(int i)
+{
+	return 4500.0 + ((i * 37) % 41 - 20) * TICK_SIZE;
+}
+
+static double QtyOf(int i)
+{
+	return i % 50 + 1;
+}
+
+static TickType TypeOf(int i)
+{
+	return static_cast<TickType>(i % 3);
+}
+
+TEST(CivilDates)
+{
+	CHECK(TickStore::DayOf(BASE_TIME) == DAY);
+	CHECK(TickStore::DayOf(0) == 19700101);
+	CHECK(TickStore::DayOf(-1) == 19691231);
+
+	CHECK(TickStore::DaysFromCivil(1970, 1, 1) == 0);
+	CHECK(TickStore::DaysFromCivil(1969, 12, 31) == -1);
+	CHECK(TickStore::DaysFromCivil(2023, 11, 14) * 86400 * 1000000000LL == BASE_TIME - 80000 * 1000000000LL);
+	CHECK(TickStore::DayOf(TickStore::DaysFromCivil(2024, 2, 29) * 86400 * 1000000000LL) == 20240229);
+}
+
+TEST(RoundTripAcrossBlocks)
+{
+	const string path = PathFor("RTRIP");
+	std::remove(path.c_str());
+	{
+		TickStore store(".", TICK_SIZE);
+		store.AddInstrument(ES, MakeInstrument("RTRIP"));
+		for(int i = 0; i < TICK_COUNT; ++i)
+			store.Append(ES, TimeOf(i), TypeOf(i), QtyOf(i), PxOf(i));
+	}
+
+	TickStoreReader reader(path);
+	CHECK(reader.Count() == static_cast<uint64_t>(TICK_COUNT));
+	CHECK(reader.BlockCount() == 2);
+	CHECK(reader.Header().day == DAY);
+	CHECK_NEAR(reader.Header().tickSize, TICK_SIZE);
+
+	TickStoreReader::Cursor cursor = reader.All();
+	TickBatch batch;
+	int i = 0;
+	bool same = true;
+	while(cursor.Next(batch))
+	{
+		for(size_t k = 0; k < batch.count; ++k, ++i)
+		{
+			same = same && batch.time[k] == TimeOf(i) && batch.type[k] == TypeOf(i)
+				&& batch.px[k] == PxOf(i) && batch.qty[k] == QtyOf(i);
+		}
+	}
+	CHECK(i == TICK_COUNT);
+	CHECK(same);
+	std::remove(path.c_str());
+}
+
+TEST(OffGridPricesRoundToTheTickSize)
+{
+	const string path = PathFor("ROUND");
+	std::remove(path.c_str());
+	{
+		TickStore store(".", TICK_SIZE);
+		store.AddInstrument(ES, MakeInstrument("ROUND"));
+		store.Append(ES, BASE_TIME, TICK_BID, 1, 100.1);
+		store.Append(ES, BASE_TIME + 1, TICK_BID, 1, 100.2);
+		store.Append(ES, BASE_TIME + 2, TICK_OFFER, 1, 99.874);
+		store.Append(ES, BASE_TIME + 3, TICK_TRADE, 2.6, -1.3);
+	}
+
+	TickStoreReader reader(path);
+	TickStoreReader::Cursor cursor = reader.All();
+	TickBatch batch;
+	CHECK(cursor.Next(batch));
+	CHECK(batch.count == 4);
+	if(batch.count != 4) return;
+	CHECK_NEAR(batch.px[0], 100.0);
+	CHECK_NEAR(batch.px[1], 100.25);
+	CHECK_NEAR(batch.px[2], 99.75);
+	CHECK_NEAR(batch.px[3], -1.25);
+	CHECK_NEAR(batch.qty[3], 3.0);
+	CHECK(!cursor.Next(batch));
+	std::remove(path.c_str());
+}
+
+// Counts the ticks a query returns and checks they are in [from, to).
+static int CountInRange(const TickStoreReader & reader, int64_t from, int64_t to)
+{
+	TickStoreReader::Cursor cursor = reader.Query(from, to);
+	TickBatch batch;
+	int count = 0;
+	while(cursor.Next(batch))
+	{
+		for(size_t k = 0; k < batch.count; ++k, ++count)
+			CHECK(batch.time[k] >= from && batch.time[k] < to);
+	}
+	return count;
+}
+
+TEST(QueryReturnsTheHalfOpenRange)
+{
+	const string path = PathFor("QUERY");
+	std::remove(path.c_str());
+	{
+		TickStore store(".", TICK_SIZE);
+		store.AddInstrument(ES, MakeInstrument("QUERY"));
+		for(int i = 0; i < TICK_COUNT; ++i)
+			store.Append(ES, BASE_TIME + i * 1000LL, TypeOf(i), QtyOf(i), PxOf(i));
+	}
+
+	TickStoreReader reader(path);
+	CHECK(CountInRange(reader, BASE_TIME + 10 * 1000, BASE_TIME + 20 * 1000) == 10);
+	CHECK(CountInRange(reader, BASE_TIME + 10 * 1000, BASE_TIME + 10 * 1000 + 1) == 1);
+	CHECK(CountInRange(reader, BASE_TIME + 10 * 1000, BASE_TIME + 10 * 1000) == 0);
+	// Across the block boundary:
+	CHECK(CountInRange(reader, BASE_TIME + (TICK_BLOCK_SIZE - 5) * 1000LL, BASE_TIME + (TICK_BLOCK_SIZE + 5) * 1000LL) == 10);
+	// Entirely before and after the file:
+	CHECK(CountInRange(reader, 0, BASE_TIME) == 0);
+	CHECK(CountInRange(reader, BASE_TIME + TICK_COUNT * 1000LL, BASE_TIME + TICK_COUNT * 2000LL) == 0);
+	CHECK(CountInRange(reader, BASE_TIME, BASE_TIME + TICK_COUNT * 1000LL) == TICK_COUNT);
+	std::remove(path.c_str());
+}
+
+TEST(ReopenedFileKeepsItsTickSize)
+{
+	const string path = PathFor("REOPEN");
+	std::remove(path.c_str());
+	{
+		TickStore store(".", TICK_SIZE);
+		store.AddInstrument(ES, MakeInstrument("REOPEN"));
+		store.Append(ES, BASE_TIME, TICK_BID, 1, 100.0);
+		store.Append(ES, BASE_TIME + 1, TICK_OFFER, 1, 100.25);
+	}
+	{
+		// A finer tick size only applies to files the store starts:
+		TickStore store(".", TICK_SIZE);
+		store.SetTickSize("REOPEN", 0.1);
+		store.AddInstrument(ES, MakeInstrument("REOPEN"));
+		store.Append(ES, BASE_TIME + 2, TICK_TRADE, 1, 100.3);
+	}
+
+	TickStoreReader reader(path);
+	CHECK(reader.Count() == 3);
+	CHECK(reader.BlockCount() == 2);
+	CHECK_NEAR(reader.Header().tickSize, TICK_SIZE);
+
+	TickStoreReader::Cursor cursor = reader.Query(BASE_TIME + 2, BASE_TIME + 3);
+	TickBatch batch;
+	CHECK(cursor.Next(batch) && batch.count == 1 && batch.px[0] == 100.25);
+	std::remove(path.c_str());
+}
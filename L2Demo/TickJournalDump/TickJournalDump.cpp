@@ -0,0 +1,45 @@
+// Converts a binary tick journal written by Write2Txt in journal mode back to
+// the "time type qty px" text format of Write2Txt::Write_txt_file.
+//
+// Usage: TickJournalDump <journal file> [text file]
+// The text goes to stdout when no output file is given.
+
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include "TickJournal.h"
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: TickJournalDump <journal file> [text file]" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		TickJournalReader reader(argv[1]);
+
+		std::ofstream file;
+		if (argc > 2)
+		{
+			file.open(argv[2], std::ios_base::app);
+			if (!file) throw std::runtime_error(std::string("cannot open ") + argv[2]);
+		}
+		std::ostream & out = argc > 2 ? file : std::cout;
+
+		for (uint64_t i = 0; i < reader.Count(); ++i)
+		{
+			const TickRecord & r = reader[i];
+			out << r.time << ' ' << TickTypeLabel(static_cast<TickType>(r.type)) << ' ' << r.qty << ' ' << r.px << '\n';
+		}
+		out.flush();
+	}
+	catch (std::exception & e)
+	{
+		std::cerr << "TickJournalDump: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,52 @@
+// Converts a tick store file written by Write2Txt in TICK_FORMAT_STORE mode
+// to the "time type qty px" text format of Write2Txt::Write_txt_file.
+//
+// Usage: TickStoreExport <tick store file> [from] [to] [text file]
+// `from` and `to` are seconds since the epoch (to is exclusive; 0 means no
+// limit).  The text goes to stdout when no output file is given.
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include "TickStore.h"
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: TickStoreExport <tick store file> [from] [to] [text file]" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		TickStoreReader reader(argv[1]);
+
+		const int64_t nsPerSecond = 1000000000LL;
+		int64_t from = std::numeric_limits<int64_t>::min();
+		int64_t to = std::numeric_limits<int64_t>::max();
+		if (argc > 2 && std::atoll(argv[2]) != 0) from = std::atoll(argv[2]) * nsPerSecond;
+		if (argc > 3 && std::atoll(argv[3]) != 0) to = std::atoll(argv[3]) * nsPerSecond;
+
+		std::ofstream file;
+		if (argc > 4)
+		{
+			file.open(argv[4], std::ios_base::app);
+			if (!file) throw std::runtime_error(std::string("cannot open ") + argv[4]);
+		}
+		std::ostream & out = argc > 4 ? file : std::cout;
+
+		uint64_t written = reader.ExportText(out, from, to);
+		out.flush();
+		std::cerr << "TickStoreExport: " << written << " of " << reader.Count() << " ticks in "
+			<< reader.BlockCount() << " blocks (" << reader.Header().instrument << ", " << reader.Header().day << ")" << std::endl;
+	}
+	catch (std::exception & e)
+	{
+		std::cerr << "TickStoreExport: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,185 @@
+#include "AsyncLog.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include "SpscRing.h"
+#include "Platform.h"
+
+// Records written out per thread per pass of the writer.
+static const size_t WRITE_BATCH = 256;
+
+struct LogBuffer
+{
+	explicit LogBuffer(size_t records) : ring(records) { }
+	SpscRing<LogRecord> ring;
+};
+
+// This thread's ring.  Buffers are never freed, since a thread may still hold
+// its pointer after a Stop(); a restarted writer simply picks them up again.
+static THREAD_LOCAL LogBuffer* threadBuffer = nullptr;
+
+static std::mutex buffersMutex;
+static std::vector<LogBuffer*> buffers;
+static size_t recordsPerThread = 1024;
+
+static std::atomic<bool> running(false);
+static std::atomic<uint64_t> dropped(0);
+static std::ostream* output = nullptr;
+static std::thread writer;
+
+// Wall clock at Start(), to turn record timestamps into times of day.
+static uint64_t startTsc = 0;
+static int64_t startMicros = 0;
+static double ticksPerNs = 1.0;
+
+const char* PrintLogFormat(std::ostream & out, const char* format)
+{
+	const char* placeholder = std::strstr(format, "{}");
+	if(!placeholder)
+	{
+		out << format;
+		return nullptr;
+	}
+	out.write(format, placeholder - format);
+	return placeholder + 2;
+}
+
+const char* AsyncLog::LevelName(LogLevel level)
+{
+	switch(level)
+	{
+	case LOG_LEVEL_DEBUG:
+		return "DEBUG";
+	case LOG_LEVEL_INFO:
+		return "INFO ";
+	case LOG_LEVEL_WARN:
+		return "WARN ";
+	case LOG_LEVEL_ERROR:
+		return "ERROR";
+	default:
+		return "?    ";
+	}
+}
+
+LogRecord* AsyncLog::Claim(LogRecord & local)
+{
+	if(!running.load(std::memory_order_acquire)) return &local;
+
+	if(!threadBuffer)
+	{
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		threadBuffer = new LogBuffer(recordsPerThread);
+		buffers.push_back(threadBuffer);
+	}
+
+	LogRecord* record = threadBuffer->ring.TryClaim();
+	if(!record)
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	record->tsc = ReadTsc();
+	return record;
+}
+
+void AsyncLog::Commit(LogRecord* record, LogRecord & local)
+{
+	if(record == &local)
+	{
+		// No writer: format right here, as std::cout would have.
+		record->print(std::cout, *record);
+		std::cout << '\n';
+		return;
+	}
+	threadBuffer->ring.Publish();
+}
+
+// "HH:MM:SS.uuuuuu LEVEL text", with the time of day in UTC.
+static void WriteRecord(std::ostream & out, const LogRecord & record)
+{
+	int64_t micros = startMicros + static_cast<int64_t>((static_cast<int64_t>(record.tsc - startTsc)) / ticksPerNs / 1000);
+	int64_t secondsOfDay = (micros / 1000000) % 86400;
+	out << std::setfill('0')
+		<< std::setw(2) << secondsOfDay / 3600 << ':'
+		<< std::setw(2) << secondsOfDay / 60 % 60 << ':'
+		<< std::setw(2) << secondsOfDay % 60 << '.'
+		<< std::setw(6) << micros % 1000000
+		<< std::setfill(' ') << ' '
+		<< AsyncLog::LevelName(static_cast<LogLevel>(record.level)) << ' ';
+	record.print(out, record);
+	out << '\n';
+}
+
+// Write out what every thread has queued.  Returns the number of records written.
+static size_t Drain()
+{
+	std::lock_guard<std::mutex> lock(buffersMutex);
+
+	size_t total = 0;
+	for(size_t i = 0; i < buffers.size(); ++i)
+	{
+		SpscRing<LogRecord> & ring = buffers[i]->ring;
+		for(;;)
+		{
+			size_t count = 0;
+			const LogRecord* records = ring.Peek(WRITE_BATCH, count);
+			if(0 == count) break;
+			for(size_t j = 0; j < count; ++j)
+				WriteRecord(*output, records[j]);
+			ring.Release(count);
+			total += count;
+		}
+	}
+	return total;
+}
+
+void AsyncLog::Start(std::ostream & out, size_t records)
+{
+	if(writer.joinable()) return;
+
+	ticksPerNs = MeasureTscTicksPerNs();
+	startTsc = ReadTsc();
+	startMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	output = &out;
+	{
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		recordsPerThread = records;
+	}
+
+	running.store(true, std::memory_order_release);
+	writer = std::thread([]()
+	{
+		while(running.load(std::memory_order_acquire))
+		{
+			// Only flush once we have caught up, not per line:
+			if(0 == Drain())
+			{
+				output->flush();
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+		Drain();
+		output->flush();
+	});
+}
+
+void AsyncLog::Stop()
+{
+	if(!writer.joinable()) return;
+
+	running.store(false, std::memory_order_release);
+	writer.join();
+
+	uint64_t lost = dropped.load(std::memory_order_relaxed);
+	if(lost)
+		std::cout << "[log] " << lost << " lines dropped, logging threads outran the writer" << std::endl;
+}
+
+uint64_t AsyncLog::Dropped()
+{
+	return dropped.load(std::memory_order_relaxed);
+}
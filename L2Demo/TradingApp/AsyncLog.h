@@ -0,0 +1,271 @@
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+// Asynchronous, leveled logging for the hot path.
+//
+// LOG_DEBUG/LOG_INFO/LOG_WARN/LOG_ERROR take a format string with "{}"
+// placeholders and the values to put in them:
+//
+//     LOG_INFO("MarketDataUpdate: BID {} / {}", px, qty);
+//
+// The calling thread only copies the values, in binary, into a slot of its
+// own lock-free ring; a background thread formats and writes them.  Levels
+// below L2_LOG_LEVEL (0 debug, 1 info, 2 warn, 3 error, 4 none; default 1)
+// are compiled out, arguments and all.
+//
+// Values are printed with operator<<.  Anything that is not a string must be
+// trivially copyable: pass FIX fields with getValue() and FIX messages with
+// toString().  A record holds LOG_RECORD_DATA bytes of values; longer strings
+// are cut short and values that no longer fit print as "...".
+
+#include <ostream>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include "IdService.h"
+
+#ifndef L2_LOG_LEVEL
+#define L2_LOG_LEVEL 1
+#endif
+
+enum LogLevel
+{
+	LOG_LEVEL_DEBUG = 0,
+	LOG_LEVEL_INFO,
+	LOG_LEVEL_WARN,
+	LOG_LEVEL_ERROR,
+	LOG_LEVEL_NONE
+};
+
+enum { LOG_RECORD_DATA = 480 };
+
+struct LogRecord;
+typedef void (*LogPrinter)(std::ostream & out, const LogRecord & record);
+
+/// One log line: the format string, a function that knows the types of the
+/// values, and the values themselves.
+struct LogRecord
+{
+	uint64_t tsc;
+	LogPrinter print;
+	const char* format;     // must outlive the record: a string literal
+	int level;              // LogLevel
+	uint32_t size;          // bytes used in `data`
+	char data[LOG_RECORD_DATA];
+};
+
+/// Appends values to a record.  Once something does not fit nothing more is written.
+class LogEncoder
+{
+public:
+	explicit LogEncoder(LogRecord & record) : record_(record), full_(false) { record_.size = 0; }
+
+	void Put(const void* value, size_t size)
+	{
+		if(full_ || record_.size + size > LOG_RECORD_DATA) { full_ = true; return; }
+		std::memcpy(record_.data + record_.size, value, size);
+		record_.size += static_cast<uint32_t>(size);
+	}
+
+	void PutString(const char* s, size_t size)
+	{
+		if(full_ || record_.size + sizeof(uint32_t) > LOG_RECORD_DATA) { full_ = true; return; }
+		const size_t room = LOG_RECORD_DATA - record_.size - sizeof(uint32_t);
+		const bool truncated = size > room;
+		uint32_t length = static_cast<uint32_t>(truncated ? room : size);
+		Put(&length, sizeof(length));
+		Put(s, length);
+		if(truncated) full_ = true;
+	}
+
+private:
+	LogRecord & record_;
+	bool full_;
+};
+
+/// Reads values back in the order they were put.  False once the record runs out.
+class LogDecoder
+{
+public:
+	explicit LogDecoder(const LogRecord & record) : record_(record), position_(0) { }
+
+	bool Get(void* value, size_t size)
+	{
+		if(position_ + size > record_.size) return false;
+		std::memcpy(value, record_.data + position_, size);
+		position_ += static_cast<uint32_t>(size);
+		return true;
+	}
+
+	bool GetString(const char*& s, uint32_t & size)
+	{
+		if(!Get(&size, sizeof(size)) || position_ + size > record_.size) return false;
+		s = record_.data + position_;
+		position_ += size;
+		return true;
+	}
+
+private:
+	const LogRecord & record_;
+	uint32_t position_;
+};
+
+/// How a value of type T is copied into a record and printed from it.
+template <class T>
+struct LogArg
+{
+	static void Encode(LogEncoder & encoder, const T & value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value,
+			"LOG_* values are copied as raw bytes: pass FIX fields with getValue() and messages with toString()");
+		encoder.Put(&value, sizeof(T));
+	}
+
+	static bool Print(LogDecoder & decoder, std::ostream & out)
+	{
+		T value;
+		if(!decoder.Get(&value, sizeof(T))) return false;
+		out << value;
+		return true;
+	}
+};
+
+/// Strings are copied by content.
+struct LogStringArg
+{
+	static bool Print(LogDecoder & decoder, std::ostream & out)
+	{
+		const char* s;
+		uint32_t size;
+		if(!decoder.GetString(s, size)) return false;
+		out.write(s, size);
+		return true;
+	}
+};
+
+template <>
+struct LogArg<const char*> : LogStringArg
+{
+	static void Encode(LogEncoder & encoder, const char* value) { encoder.PutString(value, value ? std::strlen(value) : 0); }
+};
+
+template <>
+struct LogArg<char*> : LogArg<const char*> { };
+
+template <>
+struct LogArg<std::string> : LogStringArg
+{
+	static void Encode(LogEncoder & encoder, const std::string & value) { encoder.PutString(value.data(), value.size()); }
+};
+
+template <>
+struct LogArg<IdString> : LogStringArg
+{
+	static void Encode(LogEncoder & encoder, const IdString & value) { encoder.PutString(value.data, value.size); }
+};
+
+/// Print `format` up to its next "{}".  Returns what follows the
+/// placeholder, or nullptr if the format ended first.
+const char* PrintLogFormat(std::ostream & out, const char* format);
+
+template <class... Args>
+struct LogFormatter;
+
+template <>
+struct LogFormatter<>
+{
+	static void Print(std::ostream & out, LogDecoder &, const char* format)
+	{
+		// Placeholders without a value are printed as they are:
+		if(format) out << format;
+	}
+};
+
+template <class T, class... Rest>
+struct LogFormatter<T, Rest...>
+{
+	static void Print(std::ostream & out, LogDecoder & decoder, const char* format)
+	{
+		format = PrintLogFormat(out, format);
+		if(!format) return;
+		if(!LogArg<T>::Print(decoder, out)) out << "...";
+		LogFormatter<Rest...>::Print(out, decoder, format);
+	}
+};
+
+template <class... Args>
+void PrintLogRecord(std::ostream & out, const LogRecord & record)
+{
+	LogDecoder decoder(record);
+	LogFormatter<Args...>::Print(out, decoder, record.format);
+}
+
+/// The logger behind the LOG_* macros.  Until Start() is called, and after
+/// Stop(), lines are formatted and written to std::cout on the calling thread.
+class AsyncLog
+{
+public:
+	/// Start the background writer.  Every thread that logs gets a ring of
+	/// `recordsPerThread` records (a power of two) the first time it does;
+	/// lines logged while its ring is full are dropped and counted.
+	static void Start(std::ostream & out, size_t recordsPerThread = 1024);
+
+	/// Write out everything logged so far and stop the background writer.
+	/// Call once the other threads have stopped logging.
+	static void Stop();
+
+	/// Lines dropped because a thread's ring was full.
+	static uint64_t Dropped();
+
+	template <class... Args>
+	static void Write(LogLevel level, const char* format, const Args&... args)
+	{
+		LogRecord local;
+		LogRecord* record = Claim(local);
+		if(!record) return;
+
+		record->level = level;
+		record->format = format;
+		record->print = &PrintLogRecord<typename std::decay<Args>::type...>;
+		LogEncoder encoder(*record);
+		int expand[] = { 0, (LogArg<typename std::decay<Args>::type>::Encode(encoder, args), 0)... };
+		(void)expand;
+
+		Commit(record, local);
+	}
+
+	static const char* LevelName(LogLevel level);
+
+private:
+	/// A slot in this thread's ring, `local` if the writer is not running,
+	/// or nullptr if the ring is full.
+	static LogRecord* Claim(LogRecord & local);
+	static void Commit(LogRecord* record, LogRecord & local);
+};
+
+#if L2_LOG_LEVEL <= 0
+#define LOG_DEBUG(...)  AsyncLog::Write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...)  ((void)0)
+#endif
+
+#if L2_LOG_LEVEL <= 1
+#define LOG_INFO(...)   AsyncLog::Write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...)   ((void)0)
+#endif
+
+#if L2_LOG_LEVEL <= 2
+#define LOG_WARN(...)   AsyncLog::Write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...)   ((void)0)
+#endif
+
+#if L2_LOG_LEVEL <= 3
+#define LOG_ERROR(...)  AsyncLog::Write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...)  ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,344 @@
+#include "Backtester.h"
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "TickStore.h"
+#include "WorkStealingPool.h"
+
+static const int64_t NS_PER_SECOND = 1000000000LL;
+
+static const int64_t DEFAULT_MAX_HOLD_NS = 60 * NS_PER_SECOND;
+
+BacktestParams::BacktestParams()
+	: entryTicks(0.3),
+	  minOrderFlow(0),
+	  takeProfitTicks(2),
+	  stopLossTicks(2),
+	  maxHoldNs(DEFAULT_MAX_HOLD_NS),
+	  orderQty(1),
+	  maxPosition(1)
+{ }
+
+FillModel::FillModel()
+	: tickSize(0.25),
+	  multiplier(1),
+	  feePerContract(0),
+	  latencyNs(0),
+	  slippageTicks(1)
+{ }
+
+TickTape::TickTape(const string & path)
+	: records_(nullptr),
+	  count_(0),
+	  timeScale_(1)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if(!file) throw std::runtime_error("[TickTape] cannot open " + path);
+
+	char magic[8] = { 0 };
+	file.read(magic, sizeof(magic));
+	file.close();
+
+	if(std::memcmp(magic, "L2TICKJ", 8) == 0)
+	{
+		// Already a flat array of TickRecords; use it where it is.
+		journal_.reset(new TickJournalReader(path));
+		records_ = journal_->Count() > 0 ? &(*journal_)[0] : nullptr;
+		count_ = journal_->Count();
+		timeScale_ = NS_PER_SECOND;
+		return;
+	}
+
+	if(std::memcmp(magic, "L2TSTOR", 8) == 0)
+		LoadTickStore(path);
+	else
+		LoadText(path);
+
+	records_ = decoded_.empty() ? nullptr : &decoded_[0];
+	count_ = decoded_.size();
+}
+
+// Decoded with nanosecond times, so timeScale_ stays 1.
+void TickTape::LoadTickStore(const string & path)
+{
+	TickStoreReader reader(path);
+	decoded_.reserve(static_cast<size_t>(reader.Count()));
+
+	TickStoreReader::Cursor cursor = reader.All();
+	TickBatch batch;
+	while(cursor.Next(batch))
+	{
+		for(size_t i = 0; i < batch.count; ++i)
+		{
+			TickRecord r;
+			r.time = batch.time[i];
+			r.qty = batch.qty[i];
+			r.px = batch.px[i];
+			r.type = batch.type[i];
+			std::memset(r.reserved, 0, sizeof(r.reserved));
+			decoded_.push_back(r);
+		}
+	}
+}
+
+// "<time> <label> <qty> <px>" lines as written by Write2Txt, times in seconds.
+void TickTape::LoadText(const string & path)
+{
+	std::ifstream file(path.c_str());
+	if(!file) throw std::runtime_error("[TickTape] cannot open " + path);
+
+	std::string line;
+	TickRecord r;
+	while(std::getline(file, line))
+	{
+		if(ParseTextTick(line, r)) decoded_.push_back(r);
+	}
+	timeScale_ = NS_PER_SECOND;
+}
+
+// The state of one run.  Each run owns one of these, allocated on the thread
+// that runs it, and touches nothing else but the shared, read-only tape.
+class BacktestRun
+{
+public:
+	BacktestRun(const BacktestParams & params, const FillModel & fills, const IndicatorSettings & indicators)
+		: params_(params),
+		  fills_(fills),
+		  signals_(indicators),
+		  bidPx_(0), bidQty_(0), offerPx_(0), offerQty_(0),
+		  position_(0),
+		  cash_(0),
+		  entryPx_(0),
+		  entryTimeNs_(0),
+		  pendingQty_(0),
+		  pendingDueNs_(0),
+		  peakEquity_(0)
+	{
+		std::memset(&result_, 0, sizeof(result_));
+	}
+
+	void OnTick(int64_t timeNs, const TickRecord & tick)
+	{
+		if(TICK_TRADE == tick.type)
+		{
+			signals_.OnTrade(timeNs, tick.qty, tick.px);
+			return;
+		}
+
+		// A zero price and size is an empty side, as Strategy records it.
+		if(TICK_BID == tick.type) { bidPx_ = tick.px; bidQty_ = tick.qty; }
+		else { offerPx_ = tick.px; offerQty_ = tick.qty; }
+		if(pendingQty_ != 0 && timeNs >= pendingDueNs_)
+			Fill();
+		if(bidPx_ <= 0 || offerPx_ <= 0) return;
+
+		signals_.OnQuote(timeNs, bidPx_, bidQty_, offerPx_, offerQty_);
+		MarkToMarket();
+		if(pendingQty_ == 0)
+			Decide(timeNs);
+	}
+
+	const BacktestResult & Finish(size_t run)
+	{
+		result_.run = run;
+		result_.netPnl = Equity();
+		result_.finalPosition = position_;
+		return result_;
+	}
+
+private:
+	double Equity() const
+	{
+		return cash_ + position_ * signals_.Mid() * fills_.multiplier;
+	}
+
+	void MarkToMarket()
+	{
+		double equity = Equity();
+		if(equity > peakEquity_) peakEquity_ = equity;
+		if(peakEquity_ - equity > result_.maxDrawdown) result_.maxDrawdown = peakEquity_ - equity;
+	}
+
+	void Decide(int64_t timeNs)
+	{
+		const double tick = fills_.tickSize;
+		if(position_ != 0)
+		{
+			const double moveTicks = (signals_.Mid() - entryPx_) / tick * (position_ > 0 ? 1 : -1);
+			const bool timedOut = params_.maxHoldNs > 0 && timeNs - entryTimeNs_ >= params_.maxHoldNs;
+			if(moveTicks >= params_.takeProfitTicks || moveTicks <= -params_.stopLossTicks || timedOut)
+			{
+				Send(-position_, timeNs);
+				return;
+			}
+		}
+
+		const double leanTicks = (signals_.Microprice() - signals_.Mid()) / tick;
+		int side = 0;
+		if(leanTicks >= params_.entryTicks && signals_.OrderFlow() >= params_.minOrderFlow) side = 1;
+		else if(leanTicks <= -params_.entryTicks && signals_.OrderFlow() <= -params_.minOrderFlow) side = -1;
+		if(side == 0 || position_ * side < 0) return;
+
+		const int qty = side * params_.orderQty;
+		if(std::abs(position_ + qty) <= params_.maxPosition)
+			Send(qty, timeNs);
+	}
+
+	void Send(int qty, int64_t timeNs)
+	{
+		++result_.orders;
+		pendingQty_ = qty;
+		pendingDueNs_ = timeNs + fills_.latencyNs;
+		if(fills_.latencyNs <= 0)
+			Fill();
+	}
+
+	void Fill()
+	{
+		const int qty = pendingQty_;
+		pendingQty_ = 0;
+
+		const bool buy = qty > 0;
+		const double touchPx = buy ? offerPx_ : bidPx_;
+		const double touchQty = buy ? offerQty_ : bidQty_;
+		if(touchPx <= 0)
+		{
+			++result_.rejects;
+			return;
+		}
+
+		const double size = std::abs(qty);
+		const double atTouch = std::min(size, touchQty);
+		const double worsePx = touchPx + (buy ? 1 : -1) * fills_.slippageTicks * fills_.tickSize;
+		const double notional = (atTouch * touchPx + (size - atTouch) * worsePx) * fills_.multiplier;
+		const double fee = size * fills_.feePerContract;
+
+		cash_ -= (buy ? notional : -notional) + fee;
+		result_.fees += fee;
+		result_.turnover += notional;
+		result_.contracts += static_cast<uint64_t>(size);
+
+		const int before = position_;
+		position_ += qty;
+		if(before == 0 || (before > 0) != (position_ > 0))
+		{
+			entryPx_ = notional / (size * fills_.multiplier);
+			entryTimeNs_ = pendingDueNs_;
+		}
+		else if(std::abs(position_) > std::abs(before))
+		{
+			entryPx_ = (entryPx_ * std::abs(before) + notional / fills_.multiplier) / std::abs(position_);
+		}
+	}
+
+	const BacktestParams params_;
+	const FillModel & fills_;
+	MicrostructureSignals signals_;
+
+	double bidPx_, bidQty_;
+	double offerPx_, offerQty_;
+
+	int position_;
+	double cash_;
+	double entryPx_;        // average price of the open position
+	int64_t entryTimeNs_;
+
+	int pendingQty_;        // signed; 0 when no order is on its way to the market
+	int64_t pendingDueNs_;
+
+	double peakEquity_;
+	BacktestResult result_;
+};
+
+Backtester::Backtester(const TickTape & tape, const FillModel & fills, const IndicatorSettings & indicators)
+	: tape_(tape),
+	  fills_(fills),
+	  indicators_(indicators),
+	  elapsedSeconds_(0),
+	  threads_(0),
+	  steals_(0)
+{ }
+
+BacktestResult Backtester::RunOne(const BacktestParams & params, size_t run) const
+{
+	BacktestRun state(params, fills_, indicators_);
+	const uint64_t count = tape_.Count();
+	for(uint64_t i = 0; i < count; ++i)
+		state.OnTick(tape_.TimeNs(i), tape_[i]);
+	return state.Finish(run);
+}
+
+std::vector<BacktestResult> Backtester::Run(const std::vector<BacktestParams> & grid, int threads)
+{
+	std::vector<BacktestResult> results(grid.size());
+	WorkStealingPool pool(threads);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pool.Run(grid.size(), [&](size_t run, int)
+	{
+		// Each result is written once, at the end of its run.
+		results[run] = RunOne(grid[run], run);
+	});
+	elapsedSeconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	threads_ = pool.Threads();
+	steals_ = pool.Steals();
+	return results;
+}
+
+void Backtester::Report(std::ostream & out, size_t runs) const
+{
+	const double ticks = static_cast<double>(tape_.Count()) * runs;
+	out << "[backtest] " << runs << " runs x " << tape_.Count() << " ticks on " << threads_ << " threads in "
+		<< elapsedSeconds_ << " s (" << steals_ << " steals)";
+	if(elapsedSeconds_ > 0)
+	{
+		out << ", " << static_cast<uint64_t>(runs / elapsedSeconds_) << " runs/s, "
+			<< static_cast<uint64_t>(ticks / elapsedSeconds_) << " ticks/s";
+	}
+	out << std::endl;
+}
+
+static bool ByNetPnl(const BacktestResult & a, const BacktestResult & b)
+{
+	return a.netPnl > b.netPnl;
+}
+
+void Backtester::PrintTable(std::ostream & out, const std::vector<BacktestParams> & grid, const std::vector<BacktestResult> & results, size_t top)
+{
+	std::vector<BacktestResult> sorted(results);
+	std::sort(sorted.begin(), sorted.end(), ByNetPnl);
+	if(sorted.size() > top) sorted.resize(top);
+
+	out << "[backtest]   run  entry   flow  target   stop  hold(s)  qty  max"
+		<< "       netPnl        fees          turnover    drawdown    orders  rejects  contracts  position" << std::endl;
+	for(size_t i = 0; i < sorted.size(); ++i)
+	{
+		const BacktestResult & r = sorted[i];
+		const BacktestParams & p = grid[r.run];
+		out << "[backtest] " << std::setw(5) << r.run
+			<< std::fixed << std::setprecision(2)
+			<< std::setw(7) << p.entryTicks
+			<< std::setw(7) << p.minOrderFlow
+			<< std::setw(8) << p.takeProfitTicks
+			<< std::setw(7) << p.stopLossTicks
+			<< std::setw(9) << p.maxHoldNs / static_cast<double>(NS_PER_SECOND)
+			<< std::setw(5) << p.orderQty
+			<< std::setw(5) << p.maxPosition
+			<< std::setw(13) << r.netPnl
+			<< std::setw(12) << r.fees
+			<< std::setw(18) << r.turnover
+			<< std::setw(12) << r.maxDrawdown
+			<< std::setw(10) << r.orders
+			<< std::setw(9) << r.rejects
+			<< std::setw(11) << r.contracts
+			<< std::setw(10) << r.finalPosition
+			<< std::endl;
+	}
+	out.unsetf(std::ios::floatfield);
+}
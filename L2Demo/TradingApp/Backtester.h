@@ -0,0 +1,123 @@
+#ifndef BACKTESTER_H
+#define BACKTESTER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <memory>
+#include <cstdint>
+#include "TickJournal.h"
+#include "Indicators.h"
+
+using std::string;
+
+/// Recorded top-of-book and trade ticks for one instrument, loaded once and
+/// then shared read-only by every backtest run.  A tick journal is used in
+/// place through its file mapping; a tick store file or a Write2Txt text file
+/// is decoded once into memory in the same record layout.
+class TickTape
+{
+public:
+	/// Pick the format from the file's contents.  Throws std::runtime_error.
+	explicit TickTape(const string & path);
+
+	uint64_t Count() const { return count_; }
+	const TickRecord & operator[](uint64_t i) const { return records_[i]; }
+
+	/// A record's time in nanoseconds since the epoch; journals and text
+	/// files only have whole seconds.
+	int64_t TimeNs(uint64_t i) const { return records_[i].time * timeScale_; }
+
+private:
+	TickTape(const TickTape&) = delete;
+	TickTape& operator=(const TickTape&) = delete;
+
+	void LoadTickStore(const string & path);
+	void LoadText(const string & path);
+
+	std::unique_ptr<TickJournalReader> journal_;
+	std::vector<TickRecord> decoded_;
+	const TickRecord* records_;
+	uint64_t count_;
+	int64_t timeScale_;
+};
+
+/// The strategy being tuned: trades toward the microprice when it leans far
+/// enough from the mid, and flattens on a profit target, a stop or a timeout.
+/// Prices are in ticks of FillModel::tickSize.
+struct BacktestParams
+{
+	double entryTicks;      // enter when |microprice - mid| reaches this
+	double minOrderFlow;    // and order flow imbalance agrees by at least this much
+	double takeProfitTicks;
+	double stopLossTicks;
+	int64_t maxHoldNs;      // 0 holds until the target or the stop
+	int orderQty;
+	int maxPosition;
+
+	BacktestParams();
+};
+
+/// How simulated market orders are filled and charged.  An order reaches the
+/// market `latencyNs` after it is sent and fills at the opposite touch; any
+/// quantity beyond the displayed size fills `slippageTicks` worse.  An order
+/// that arrives to an empty opposite side is rejected.
+struct FillModel
+{
+	double tickSize;
+	double multiplier;      // currency per point
+	double feePerContract;
+	int64_t latencyNs;
+	double slippageTicks;
+
+	FillModel();
+};
+
+/// Outcome of one run.  PnL marks any open position to the last mid.
+struct BacktestResult
+{
+	size_t run;             // index into the parameter grid
+	double netPnl;
+	double fees;
+	double turnover;        // notional traded
+	double maxDrawdown;     // largest fall of marked-to-market equity from its peak
+	uint64_t orders;
+	uint64_t rejects;
+	uint64_t contracts;
+	int finalPosition;
+};
+
+/// Runs a grid of BacktestParams over one TickTape on all cores.
+class Backtester
+{
+public:
+	Backtester(const TickTape & tape, const FillModel & fills, const IndicatorSettings & indicators = IndicatorSettings());
+
+	/// One run on the calling thread.
+	BacktestResult RunOne(const BacktestParams & params, size_t run = 0) const;
+
+	/// Every run in `grid`, spread over `threads` threads (0 for one per
+	/// hardware thread) by a WorkStealingPool.  Results are in grid order.
+	std::vector<BacktestResult> Run(const std::vector<BacktestParams> & grid, int threads = 0);
+
+	double ElapsedSeconds() const { return elapsedSeconds_; }
+	int Threads() const { return threads_; }
+	uint64_t Steals() const { return steals_; }
+
+	/// Runs, ticks replayed and throughput of the last Run().
+	void Report(std::ostream & out, size_t runs) const;
+
+	/// The `top` best runs by net PnL, one line each with their parameters.
+	static void PrintTable(std::ostream & out, const std::vector<BacktestParams> & grid, const std::vector<BacktestResult> & results, size_t top);
+
+private:
+	const TickTape & tape_;
+	const FillModel fills_;
+	const IndicatorSettings indicators_;
+
+	double elapsedSeconds_;
+	int threads_;
+	uint64_t steals_;
+};
+
+#endif
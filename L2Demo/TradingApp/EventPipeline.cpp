@@ -0,0 +1,271 @@
+#include "EventPipeline.h"
+#include "Simple.h"
+#include "MarketDataShard.h"
+#include "LatencyProbes.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Records taken off a ring per pass of the consumer loops.
+static const size_t BATCH_SIZE = 256;
+
+EventPipeline::EventPipeline(Simple & simple, size_t ringSize, int strategyCpu, int senderCpu)
+	: simple_(simple),
+	  inbound_(ringSize),
+	  outbound_(ringSize),
+	  strategyCpu_(strategyCpu),
+	  senderCpu_(senderCpu),
+	  ticksPerNs_(MeasureTscTicksPerNs()),
+	  strategyRunning_(false),
+	  senderRunning_(false),
+	  inboundMaxDepth_(0),
+	  outboundMaxDepth_(0),
+	  inboundFullWaits_(0),
+	  outboundFullWaits_(0)
+{ }
+
+EventPipeline::~EventPipeline()
+{
+	Stop();
+}
+
+void EventPipeline::Start()
+{
+	if(strategyThread_.joinable()) return;
+
+	strategyRunning_.store(true, std::memory_order_release);
+	senderRunning_.store(true, std::memory_order_release);
+	senderThread_ = std::thread(&EventPipeline::SenderLoop, this);
+	strategyThread_ = std::thread(&EventPipeline::StrategyLoop, this);
+}
+
+// The strategy thread goes first: draining the inbound ring may still send orders.
+void EventPipeline::Stop()
+{
+	if(!strategyThread_.joinable()) return;
+
+	strategyRunning_.store(false, std::memory_order_release);
+	strategyThread_.join();
+	senderRunning_.store(false, std::memory_order_release);
+	senderThread_.join();
+
+	Report(std::cout);
+}
+
+InboundEvent & EventPipeline::ClaimInbound()
+{
+	InboundEvent* slot = inbound_.TryClaim();
+	if(!slot)
+	{
+		inboundFullWaits_.fetch_add(1, std::memory_order_relaxed);
+		while(!(slot = inbound_.TryClaim()))
+			CpuRelax();
+	}
+	return *slot;
+}
+
+void EventPipeline::PublishInbound(InboundEvent & event)
+{
+	event.fromAppTsc = PROBE_FROMAPP_STAMP();
+	event.tsc = ReadTsc();
+	inbound_.Publish();
+}
+
+void EventPipeline::PublishOrder(const OrderCommand & command)
+{
+	OrderCommand* slot = outbound_.TryClaim();
+	if(!slot)
+	{
+		outboundFullWaits_.fetch_add(1, std::memory_order_relaxed);
+		while(!(slot = outbound_.TryClaim()))
+			CpuRelax();
+	}
+	*slot = command;
+	slot->tsc = ReadTsc();
+	outbound_.Publish();
+}
+
+// Track the deepest backlog the consumer has seen.  Only the consumer writes it.
+static void UpdateMax(std::atomic<uint64_t> & max, uint64_t value)
+{
+	if(value > max.load(std::memory_order_relaxed))
+		max.store(value, std::memory_order_relaxed);
+}
+
+void EventPipeline::StrategyLoop()
+{
+	Pin(strategyCpu_);
+
+	for(;;)
+	{
+		// Read the flag before looking at the ring, so nothing published
+		// before Stop() is left behind:
+		const bool running = strategyRunning_.load(std::memory_order_acquire);
+
+		const size_t merged = shards_.empty() ? 0 : MergeShards(BATCH_SIZE);
+
+		size_t count = 0;
+		const InboundEvent* events = inbound_.Peek(BATCH_SIZE, count);
+		if(0 == count)
+		{
+			if(0 == merged)
+			{
+				if(!running) break;
+				CpuRelax();
+			}
+			continue;
+		}
+
+		UpdateMax(inboundMaxDepth_, inbound_.Size());
+		const uint64_t now = ReadTsc();
+		for(size_t i = 0; i < count; ++i)
+		{
+			inboundLatency_.Record(now - events[i].tsc);
+			// Only look at the ring again for the last event of the batch:
+			simple_.HandleEvent(events[i], i + 1 < count || inbound_.Size() > count || ShardBacklog());
+		}
+		inbound_.Release(count);
+	}
+}
+
+// Hand the Strategy up to `max` whole messages from the shards, the earliest
+// published first.  Returns how many.
+size_t EventPipeline::MergeShards(size_t max)
+{
+	size_t messages = 0;
+	while(messages < max)
+	{
+		MarketDataShard* next = nullptr;
+		uint64_t earliest = 0;
+		for(size_t i = 0; i < shards_.size(); ++i)
+		{
+			const ShardUpdate* head = shards_[i]->Head();
+			if(head && (!next || head->tsc < earliest))
+			{
+				next = shards_[i];
+				earliest = head->tsc;
+			}
+		}
+		if(!next) break;
+
+		// Stay with this shard to the end of the message, which is already
+		// being published:
+		for(;;)
+		{
+			const ShardUpdate* update = next->Head();
+			if(!update)
+			{
+				CpuRelax();
+				continue;
+			}
+
+			const bool end = SHARD_END == update->type;
+			next->RecordQueued(ReadTsc() - update->tsc, next->Depth());
+			simple_.HandleShardUpdate(*update, end && (inbound_.Size() > 0 || ShardBacklog()));
+			next->Pop();
+			if(end) break;
+		}
+		++messages;
+	}
+	return messages;
+}
+
+// More market data queued behind what is being handled.
+bool EventPipeline::ShardBacklog() const
+{
+	for(size_t i = 0; i < shards_.size(); ++i)
+	{
+		if(shards_[i]->Depth() > 0) return true;
+	}
+	return false;
+}
+
+void EventPipeline::SenderLoop()
+{
+	Pin(senderCpu_);
+
+	for(;;)
+	{
+		const bool running = senderRunning_.load(std::memory_order_acquire);
+
+		size_t count = 0;
+		const OrderCommand* commands = outbound_.Peek(BATCH_SIZE, count);
+		if(0 == count)
+		{
+			if(!running) break;
+			CpuRelax();
+			continue;
+		}
+
+		UpdateMax(outboundMaxDepth_, outbound_.Size());
+		const uint64_t now = ReadTsc();
+		for(size_t i = 0; i < count; ++i)
+		{
+			outboundLatency_.Record(now - commands[i].tsc);
+			simple_.ExecuteOrderCommand(commands[i]);
+		}
+		outbound_.Release(count);
+	}
+}
+
+// Pin the calling thread to one core.  Best effort: the pipeline works
+// unpinned, just with more jitter.
+void EventPipeline::Pin(int cpu)
+{
+	if(cpu < 0) return;
+
+#ifdef _WIN32
+	bool pinned = 0 != SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu);
+#else
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+	bool pinned = 0 == pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+	if(!pinned)
+		std::cout << "[EventPipeline] Warning: could not pin thread to CPU " << cpu << std::endl;
+}
+
+static void ReportQueue(std::ostream & out, const char* name, const LatencyHistogram & latency,
+	uint64_t maxDepth, uint64_t fullWaits, double ticksPerNs)
+{
+	out << "[pipeline] " << std::left << std::setw(9) << name << std::right
+		<< std::setw(12) << latency.Count()
+		<< std::setw(10) << maxDepth
+		<< std::setw(10) << fullWaits
+		<< std::fixed << std::setprecision(0)
+		<< std::setw(12) << latency.Percentile(50) / ticksPerNs
+		<< std::setw(12) << latency.Percentile(99) / ticksPerNs
+		<< std::setw(12) << latency.Max() / ticksPerNs
+		<< std::endl;
+}
+
+void EventPipeline::Report(std::ostream & out) const
+{
+	out << "[pipeline] queue           count max depth full waits     p50(ns)     p99(ns)     max(ns)" << std::endl;
+	ReportQueue(out, "inbound", inboundLatency_, inboundMaxDepth_.load(std::memory_order_relaxed),
+		inboundFullWaits_.load(std::memory_order_relaxed), ticksPerNs_);
+	ReportQueue(out, "outbound", outboundLatency_, outboundMaxDepth_.load(std::memory_order_relaxed),
+		outboundFullWaits_.load(std::memory_order_relaxed), ticksPerNs_);
+	for(size_t i = 0; i < shards_.size(); ++i)
+	{
+		std::ostringstream name;
+		name << "shard " << shards_[i]->Index();
+		ReportQueue(out, name.str().c_str(), shards_[i]->Latency(), shards_[i]->MaxDepth(), shards_[i]->FullWaits(), ticksPerNs_);
+	}
+	for(size_t i = 0; i < shards_.size(); ++i)
+	{
+		out << "[pipeline] shard " << shards_[i]->Index() << ": " << shards_[i]->Messages() << " messages";
+		if(shards_[i]->Misrouted() > 0)
+			out << ", " << shards_[i]->Misrouted() << " entries for instruments of other shards dropped";
+		out << std::endl;
+	}
+}
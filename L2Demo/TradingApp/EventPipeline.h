@@ -0,0 +1,160 @@
+#ifndef EVENT_PIPELINE_H
+#define EVENT_PIPELINE_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include "SpscRing.h"
+#include "OrderBook.h"
+#include "IdService.h"
+#include "InstrumentRegistry.h"
+#include "LatencyHistogram.h"
+
+class Simple;
+class MarketDataShard;
+struct OrderTemplate;
+
+/// An ExecutionReport or OrderCancelReject reduced to what Simple acts on.
+struct ExecutionEvent
+{
+	IdString clOrdId;
+	IdString origClOrdId;
+	InstrumentId instrument;
+	char side;          // FIX Side
+	char execType;      // FIX ExecType; CxlRejResponseTo for cancel rejects
+	double orderQty;
+	double lastQty;
+	double lastPx;
+	double cumQty;      // status reports only
+	double avgPx;
+	int msgSeqNum;      // of the ExecutionReport; 0 if it did not come from a session
+	bool status;        // answers an OrderStatusRequest; execType is then the OrdStatus
+};
+
+enum InboundEventType
+{
+	EVENT_MD_ENTRY,         // apply `md` to the book of `instrument`
+	EVENT_BOOK_CLEAR,       // a snapshot is about to rebuild `instrument`'s book
+	EVENT_MD_END,           // end of a market data message: notify changed books
+	EVENT_EXECUTION,
+	EVENT_CANCEL_REJECT
+};
+
+/// What the QuickFIX thread hands to the strategy thread.
+struct InboundEvent
+{
+	uint64_t tsc;           // when it was published
+	uint64_t fromAppTsc;    // latency probe stamp, see LatencyProbes.h
+	int type;               // InboundEventType
+	InstrumentId instrument;
+	int64_t timeNs;         // market data: when the message arrived, see Simple::EventTimeNs()
+	union
+	{
+		MdEntry md;
+		ExecutionEvent execution;
+	};
+};
+
+enum OrderCommandType
+{
+	COMMAND_NEW_ORDER,
+	COMMAND_CANCEL,
+	COMMAND_CANCEL_REPLACE
+};
+
+/// An order message to send, handed from the strategy thread to the sender.
+struct OrderCommand
+{
+	uint64_t tsc;
+	uint64_t sendTsc;       // latency probe stamps, see LatencyProbes.h
+	uint64_t tickTsc;
+	int type;               // OrderCommandType
+	OrderTemplate* messages;
+	IdString clOrdId;
+	IdString origClOrdId;
+	char side;
+	char ordType;
+	int qty;
+	double px;
+};
+
+/// Runs the Strategy on its own thread.
+///
+/// The QuickFIX thread decodes inbound messages into InboundEvents and
+/// publishes them into a preallocated ring, filling each slot in place.  A
+/// strategy thread (optionally pinned to a core) busy-polls the ring, applies
+/// the events to the books and order state and calls the Strategy.  Orders
+/// the Strategy sends go back through a second ring to a sender thread that
+/// hands them to QuickFIX, so neither the socket thread nor the Strategy
+/// ever waits on the other.
+///
+/// Both rings are single-producer/single-consumer: a SocketInitiator reads
+/// all its sessions on one thread, and only the strategy thread sends.
+///
+/// With several market data sessions, each is a MarketDataShard with a ring
+/// of its own, and the inbound ring only carries the order session's
+/// events.  The strategy thread merges the shards' messages by the time
+/// they were published.
+class EventPipeline
+{
+public:
+	/// `ringSize` must be a power of two.  A cpu of -1 leaves that thread unpinned.
+	EventPipeline(Simple & simple, size_t ringSize, int strategyCpu, int senderCpu);
+	~EventPipeline();
+
+	/// Before Start(): also take market data from `shard`.
+	void AddShard(MarketDataShard & shard) { shards_.push_back(&shard); }
+
+	void Start();
+
+	/// Process everything already queued, then stop both threads.
+	void Stop();
+
+	/// Producer (QuickFIX thread): the next slot to fill, waiting while the ring is full.
+	InboundEvent & ClaimInbound();
+	void PublishInbound(InboundEvent & event);
+
+	/// Producer (strategy thread).
+	void PublishOrder(const OrderCommand & command);
+
+	size_t InboundDepth() const { return inbound_.Size(); }
+	size_t OutboundDepth() const { return outbound_.Size(); }
+
+	/// Events/commands passed, deepest queue seen and time spent queued.
+	void Report(std::ostream & out) const;
+
+private:
+	EventPipeline(const EventPipeline&) = delete;
+	EventPipeline& operator=(const EventPipeline&) = delete;
+
+	void StrategyLoop();
+	size_t MergeShards(size_t max);
+	bool ShardBacklog() const;
+	void SenderLoop();
+	static void Pin(int cpu);
+
+	Simple & simple_;
+	SpscRing<InboundEvent> inbound_;
+	SpscRing<OrderCommand> outbound_;
+	const int strategyCpu_;
+	const int senderCpu_;
+	const double ticksPerNs_;
+
+	std::atomic<bool> strategyRunning_;
+	std::atomic<bool> senderRunning_;
+	std::thread strategyThread_;
+	std::thread senderThread_;
+	std::vector<MarketDataShard*> shards_;
+
+	// Statistics, written by the consuming thread
+	LatencyHistogram inboundLatency_;
+	LatencyHistogram outboundLatency_;
+	std::atomic<uint64_t> inboundMaxDepth_;
+	std::atomic<uint64_t> outboundMaxDepth_;
+	std::atomic<uint64_t> inboundFullWaits_;
+	std::atomic<uint64_t> outboundFullWaits_;
+};
+
+#endif
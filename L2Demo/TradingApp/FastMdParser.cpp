@@ -0,0 +1,186 @@
+#include "FastMdParser.h"
+
+static const char SOH = '\001';
+
+static const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+// Decimal to double without strtod.  Exact for the integer mantissas of up
+// to 15 digits that prices and sizes use, since both operands of the final
+// division are exactly representable.
+static bool ParseDouble(const char* p, const char* end, double & value)
+{
+	bool negative = false;
+	if(p < end && *p == '-')
+	{
+		negative = true;
+		++p;
+	}
+	if(p == end) return false;
+
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int decimals = -1;
+	for(; p < end; ++p)
+	{
+		char c = *p;
+		if(c >= '0' && c <= '9')
+		{
+			if(++digits > 18) return false;
+			mantissa = mantissa * 10 + (c - '0');
+			if(decimals >= 0) ++decimals;
+		}
+		else if(c == '.' && decimals < 0)
+		{
+			decimals = 0;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	if(digits == 0) return false;
+
+	value = static_cast<double>(mantissa);
+	if(decimals > 0) value /= POW10[decimals];
+	if(negative) value = -value;
+	return true;
+}
+
+static bool ParseInt(const char* p, const char* end, int & value)
+{
+	if(p == end || end - p > 9) return false;
+	value = 0;
+	for(; p < end; ++p)
+	{
+		if(*p < '0' || *p > '9') return false;
+		value = value * 10 + (*p - '0');
+	}
+	return true;
+}
+
+static void Clear(FieldView & view)
+{
+	view.data = nullptr;
+	view.size = 0;
+}
+
+static void StartEntry(FastMdEntry & entry, char defaultAction)
+{
+	entry.md.type = 0;
+	entry.md.action = defaultAction;
+	entry.md.level = 0;
+	entry.md.px = 0;
+	entry.md.qty = 0;
+	Clear(entry.symbol);
+	Clear(entry.maturityMonthYear);
+	Clear(entry.exchange);
+}
+
+bool ParseFastMd(const char* data, size_t size, FastMdMessage & out)
+{
+	const char* p = data;
+	const char* const end = data + size;
+
+	out.msgType = 0;
+	out.count = 0;
+	Clear(out.msgSeqNum);
+	Clear(out.sendingTime);
+	Clear(out.entryTime);
+	Clear(out.mdReqId);
+	Clear(out.symbol);
+	Clear(out.maturityMonthYear);
+	Clear(out.exchange);
+
+	int declared = -1;
+	// The first field of each group instance marks the start of a new entry:
+	// MDUpdateAction for incremental refreshes, MDEntryType for snapshots.
+	int delimiter = 0;
+	FastMdEntry* entry = nullptr;
+
+	while(p < end)
+	{
+		int tag = 0;
+		while(p < end && *p >= '0' && *p <= '9')
+			tag = tag * 10 + (*p++ - '0');
+		if(p == end || *p != '=' || tag == 0) return false;
+
+		const char* value = ++p;
+		while(p < end && *p != SOH) ++p;
+		const char* valueEnd = p;
+		if(p < end) ++p;
+
+		FieldView view = { value, static_cast<int>(valueEnd - value) };
+
+		if(tag == 10) break;     // CheckSum: end of message
+
+		if(declared >= 0 && tag == delimiter)
+		{
+			if(out.count == declared || out.count == MAX_FAST_MD_ENTRIES) return false;
+			entry = &out.entries[out.count++];
+			StartEntry(*entry, 'X' == out.msgType ? 0 : '0');
+		}
+
+		switch(tag)
+		{
+		case 35:
+			if(view.size != 1 || (value[0] != 'X' && value[0] != 'W')) return false;
+			out.msgType = value[0];
+			delimiter = 'X' == out.msgType ? 279 : 269;
+			break;
+		case 34:
+			out.msgSeqNum = view;
+			break;
+		case 52:
+			out.sendingTime = view;
+			break;
+		case 273:
+			if(entry && out.entryTime.empty()) out.entryTime = view;
+			break;
+		case 262:
+			out.mdReqId = view;
+			break;
+		case 268:
+			if(!ParseInt(value, valueEnd, declared) || out.msgType == 0) return false;
+			break;
+		case 269:
+			if(!entry || view.size != 1) return false;
+			entry->md.type = value[0];
+			break;
+		case 279:
+			if(!entry || view.size != 1) return false;
+			entry->md.action = value[0];
+			break;
+		case 270:
+			if(!entry || !ParseDouble(value, valueEnd, entry->md.px)) return false;
+			break;
+		case 271:
+			if(!entry || !ParseDouble(value, valueEnd, entry->md.qty)) return false;
+			break;
+		case 1023:
+			if(!entry || !ParseInt(value, valueEnd, entry->md.level)) return false;
+			break;
+		case 55:
+			if(entry) entry->symbol = view;
+			else out.symbol = view;
+			break;
+		case 200:
+			if(entry) entry->maturityMonthYear = view;
+			else out.maturityMonthYear = view;
+			break;
+		case 207:
+			if(entry) entry->exchange = view;
+			else out.exchange = view;
+			break;
+		default:
+			// Header, trailer and group fields we do not use
+			break;
+		}
+	}
+
+	if(out.msgType == 0 || declared < 0 || out.count != declared) return false;
+	for(int i = 0; i < out.count; ++i)
+	{
+		if(out.entries[i].md.type == 0 || out.entries[i].md.action == 0) return false;
+	}
+	return true;
+}
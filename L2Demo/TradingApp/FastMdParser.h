@@ -0,0 +1,50 @@
+#ifndef FAST_MD_PARSER_H
+#define FAST_MD_PARSER_H
+
+#include <cstddef>
+#include "OrderBook.h"
+
+/// Most entries a message may carry before we give up and let QuickFIX handle it.
+const int MAX_FAST_MD_ENTRIES = 64;
+
+/// A value inside the raw message buffer; not NUL-terminated.
+struct FieldView
+{
+	const char* data;
+	int size;
+
+	bool empty() const { return size == 0; }
+};
+
+/// One NoMDEntries group, plus the instrument fields an incremental entry may carry.
+struct FastMdEntry
+{
+	MdEntry md;
+	FieldView symbol;
+	FieldView maturityMonthYear;
+	FieldView exchange;
+};
+
+/// The parts of a MarketDataIncrementalRefresh (X) or
+/// MarketDataSnapshotFullRefresh (W) that Simple uses.
+struct FastMdMessage
+{
+	char msgType;                // 'X' or 'W'
+	FieldView msgSeqNum;
+	FieldView sendingTime;
+	FieldView entryTime;         // MDEntryTime of the first entry that has one
+	FieldView mdReqId;
+	FieldView symbol;            // message level, snapshots only
+	FieldView maturityMonthYear;
+	FieldView exchange;
+	int count;
+	FastMdEntry entries[MAX_FAST_MD_ENTRIES];
+};
+
+/// Walk a raw tag=value FIX message once and fill `out` without allocating.
+/// Returns false for anything we do not fully understand (other message
+/// types, malformed numbers, entry count mismatch, too many entries), in
+/// which case the caller should fall back to QuickFIX's parsed message.
+bool ParseFastMd(const char* data, size_t size, FastMdMessage & out);
+
+#endif
@@ -0,0 +1,262 @@
+#include "FeedMonitor.h"
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include "AsyncLog.h"
+#include "TickStore.h"
+
+static const int64_t NS_PER_SECOND = 1000000000LL;
+static const int64_t NS_PER_DAY = 86400LL * NS_PER_SECOND;
+
+static int64_t SystemClockNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+TscClock::TscClock()
+{
+	nsPerTick_ = 1.0 / MeasureTscTicksPerNs();
+	baseTsc_ = ReadTsc();
+	baseNs_ = SystemClockNs();
+}
+
+// `count` decimal digits at `p`.
+static bool ParseDigits(const char* p, int count, int & value)
+{
+	value = 0;
+	for(int i = 0; i < count; ++i)
+	{
+		if(p[i] < '0' || p[i] > '9') return false;
+		value = value * 10 + (p[i] - '0');
+	}
+	return true;
+}
+
+// FIX UTCTimeOnly, HH:MM:SS[.sss[sss[sss]]], as ns since midnight.
+static bool ParseTimeOnly(const char* p, int size, int64_t & ns)
+{
+	int hour, minute, second;
+	if(size < 8 || p[2] != ':' || p[5] != ':'
+		|| !ParseDigits(p, 2, hour) || !ParseDigits(p + 3, 2, minute) || !ParseDigits(p + 6, 2, second))
+		return false;
+
+	int64_t fraction = 0;
+	int digits = 0;
+	if(size > 8)
+	{
+		if(p[8] != '.') return false;
+		for(int i = 9; i < size && digits < 9; ++i, ++digits)
+		{
+			if(p[i] < '0' || p[i] > '9') return false;
+			fraction = fraction * 10 + (p[i] - '0');
+		}
+	}
+	for(; digits < 9; ++digits) fraction *= 10;
+
+	ns = ((hour * 60 + minute) * 60 + second) * NS_PER_SECOND + fraction;
+	return true;
+}
+
+// FIX UTCTimestamp, YYYYMMDD-HH:MM:SS[.sss...], as ns since the epoch.
+static bool ParseTimestamp(const FieldView & view, int64_t & ns)
+{
+	int year, month, day;
+	int64_t timeOfDay;
+	if(view.size < 17 || view.data[8] != '-'
+		|| !ParseDigits(view.data, 4, year) || !ParseDigits(view.data + 4, 2, month) || !ParseDigits(view.data + 6, 2, day)
+		|| !ParseTimeOnly(view.data + 9, view.size - 9, timeOfDay))
+		return false;
+
+	ns = TickStore::DaysFromCivil(year, month, day) * NS_PER_DAY + timeOfDay;
+	return true;
+}
+
+FeedMonitor::FeedMonitor(const FeedSettings & settings)
+	: settings_(settings),
+	  feeds_(settings.maxInstruments > 0 ? settings.maxInstruments : 1),
+	  instrumentCount_(0),
+	  clockSkewed_(0),
+	  messages_(0),
+	  gaps_(0),
+	  missedMessages_(0),
+	  lastMsgSeqNum_(0),
+	  lastReportNs_(0),
+	  stopping_(false)
+{
+	lastReportNs_ = clock_.NowNs();
+	monitor_ = std::thread(&FeedMonitor::MonitorLoop, this);
+}
+
+FeedMonitor::~FeedMonitor()
+{
+	{
+		std::lock_guard<std::mutex> lock(monitorMutex_);
+		stopping_ = true;
+	}
+	monitorWakeup_.notify_all();
+	monitor_.join();
+	LogReport();
+}
+
+// Instruments are registered one at a time, in id order.
+void FeedMonitor::AddInstrument(InstrumentId instrument, const Instrument & details)
+{
+	const int count = instrumentCount_.load(std::memory_order_relaxed);
+	if(instrument != count || count >= static_cast<int>(feeds_.size())) return;
+
+	const int64_t now = clock_.NowNs();
+	InstrumentFeed& feed = feeds_[instrument];
+	// A subscription that never delivers anything goes stale too:
+	feed.lastUpdateNs.store(now, std::memory_order_relaxed);
+	feed.messages.store(0, std::memory_order_relaxed);
+	feed.bursts.store(0, std::memory_order_relaxed);
+	feed.peakPerSecond.store(0, std::memory_order_relaxed);
+	feed.secondStartNs = now;
+	feed.secondCount = 0;
+	feed.burstStartNs = now;
+	feed.burstCount = 0;
+	feed.stale = false;
+	feed.reportedMessages = 0;
+	const string name = details.symbol + " " + details.maturityMonthYear + " " + details.exchange;
+	const size_t size = name.size() < sizeof(feed.name) ? name.size() : sizeof(feed.name) - 1;
+	std::memcpy(feed.name, name.data(), size);
+	feed.name[size] = '\0';
+	instrumentCount_.store(count + 1, std::memory_order_release);
+}
+
+void FeedMonitor::OnMessage(int64_t receiptNs, const FieldView & msgSeqNum, const FieldView & sendingTime, const FieldView & entryTime)
+{
+	Increment(messages_);
+
+	int seq;
+	if(!msgSeqNum.empty() && msgSeqNum.size <= 9 && ParseDigits(msgSeqNum.data, msgSeqNum.size, seq))
+	{
+		// Lower numbers are resends or a reset, not gaps:
+		if(lastMsgSeqNum_ > 0 && seq > lastMsgSeqNum_ + 1)
+		{
+			Increment(gaps_);
+			missedMessages_.store(missedMessages_.load(std::memory_order_relaxed) + (seq - lastMsgSeqNum_ - 1), std::memory_order_relaxed);
+		}
+		lastMsgSeqNum_ = seq;
+	}
+
+	int64_t sentNs;
+	if(!ParseTimestamp(sendingTime, sentNs)) return;
+	RecordLatency(sendingLatency_, receiptNs - sentNs);
+
+	// MDEntryTime has no date; it is the SendingTime's, or the day before
+	// if the entry is from just before midnight:
+	int64_t entryTimeOfDay;
+	if(!entryTime.empty() && ParseTimeOnly(entryTime.data, entryTime.size, entryTimeOfDay))
+	{
+		const int64_t sentDay = sentNs - sentNs % NS_PER_DAY;
+		int64_t entryNs = sentDay + entryTimeOfDay;
+		if(entryNs > sentNs + NS_PER_DAY / 2) entryNs -= NS_PER_DAY;
+		RecordLatency(entryLatency_, receiptNs - entryNs);
+	}
+}
+
+// Exchange clocks ahead of ours count as zero latency, and are counted.
+void FeedMonitor::RecordLatency(LatencyHistogram & histogram, int64_t latencyNs)
+{
+	if(latencyNs < 0)
+	{
+		Increment(clockSkewed_);
+		latencyNs = 0;
+	}
+	histogram.Record(static_cast<uint64_t>(latencyNs));
+}
+
+void FeedMonitor::MonitorLoop()
+{
+	// Check often enough to notice a stale instrument within half the limit:
+	int64_t checkNs = settings_.staleNs / 2;
+	if(checkNs > NS_PER_SECOND) checkNs = NS_PER_SECOND;
+	if(checkNs < 1000000) checkNs = 1000000;
+
+	std::unique_lock<std::mutex> lock(monitorMutex_);
+	while(!monitorWakeup_.wait_for(lock, std::chrono::nanoseconds(checkNs), [this]() { return stopping_; }))
+	{
+		const int64_t now = clock_.NowNs();
+		CheckStale(now);
+		if(settings_.reportSeconds > 0 && now - lastReportNs_ >= settings_.reportSeconds * NS_PER_SECOND)
+			LogReport();
+	}
+}
+
+void FeedMonitor::CheckStale(int64_t now)
+{
+	const int count = instrumentCount_.load(std::memory_order_acquire);
+	for(int i = 0; i < count; ++i)
+	{
+		InstrumentFeed& feed = feeds_[i];
+		const int64_t age = now - feed.lastUpdateNs.load(std::memory_order_relaxed);
+		if(!feed.stale && age > settings_.staleNs)
+		{
+			feed.stale = true;
+			LOG_WARN("[feed] Stale quotes: no market data for {} in {} ms", feed.name, age / 1000000);
+		}
+		else if(feed.stale && age <= settings_.staleNs)
+		{
+			feed.stale = false;
+			LOG_INFO("[feed] Market data for {} resumed", feed.name);
+		}
+	}
+}
+
+// The report goes through the log a line at a time: the log's writer thread
+// prints to the same stream, and lines written around it would interleave.
+void FeedMonitor::LogReport()
+{
+	std::ostringstream report;
+	Report(report);
+	std::istringstream lines(report.str());
+	string line;
+	while(std::getline(lines, line))
+		LOG_INFO("{}", line);
+}
+
+void FeedMonitor::Report(std::ostream & out)
+{
+	const int64_t now = clock_.NowNs();
+	const double seconds = (now - lastReportNs_) / 1e9;
+	lastReportNs_ = now;
+
+	out << "[feed] messages=" << messages_.load(std::memory_order_relaxed)
+		<< ", gaps=" << gaps_.load(std::memory_order_relaxed)
+		<< " (" << missedMessages_.load(std::memory_order_relaxed) << " messages)"
+		<< ", exchange clock ahead=" << clockSkewed_.load(std::memory_order_relaxed) << std::endl;
+
+	out << "[feed] latency(us)      count         p50         p99       p99.9         max" << std::endl;
+	const LatencyHistogram* histograms[] = { &sendingLatency_, &entryLatency_ };
+	const char* names[] = { "SendingTime", "MDEntryTime" };
+	for(int i = 0; i < 2; ++i)
+	{
+		const LatencyHistogram& h = *histograms[i];
+		out << "[feed] " << std::left << std::setw(12) << names[i] << std::right
+			<< std::setw(12) << h.Count()
+			<< std::fixed << std::setprecision(1)
+			<< std::setw(12) << h.Percentile(50) / 1e3
+			<< std::setw(12) << h.Percentile(99) / 1e3
+			<< std::setw(12) << h.Percentile(99.9) / 1e3
+			<< std::setw(12) << h.Max() / 1e3
+			<< std::endl;
+	}
+
+	out << "[feed] instrument            msgs/s    peak/s    bursts    age(ms)" << std::endl;
+	const int count = instrumentCount_.load(std::memory_order_acquire);
+	for(int i = 0; i < count; ++i)
+	{
+		InstrumentFeed& feed = feeds_[i];
+		const uint64_t messages = feed.messages.load(std::memory_order_relaxed);
+		out << "[feed] " << std::left << std::setw(20) << feed.name << std::right
+			<< std::fixed << std::setprecision(0)
+			<< std::setw(10) << (seconds > 0 ? (messages - feed.reportedMessages) / seconds : 0)
+			<< std::setw(10) << feed.peakPerSecond.load(std::memory_order_relaxed)
+			<< std::setw(10) << feed.bursts.load(std::memory_order_relaxed)
+			<< std::setw(11) << (now - feed.lastUpdateNs.load(std::memory_order_relaxed)) / 1000000
+			<< (feed.stale ? " STALE" : "") << std::endl;
+		feed.reportedMessages = messages;
+	}
+}
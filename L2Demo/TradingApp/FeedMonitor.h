@@ -0,0 +1,159 @@
+#ifndef FEED_MONITOR_H
+#define FEED_MONITOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include "FastMdParser.h"
+#include "InstrumentRegistry.h"
+#include "LatencyHistogram.h"
+#include "Platform.h"
+
+/// UTC wall-clock time read from the TSC: calibrated against the system
+/// clock once, then one rdtsc and a multiply per reading.
+class TscClock
+{
+public:
+	TscClock();
+
+	int64_t NowNs() const { return baseNs_ + static_cast<int64_t>((ReadTsc() - baseTsc_) * nsPerTick_); }
+
+private:
+	int64_t baseNs_;
+	unsigned long long baseTsc_;
+	double nsPerTick_;
+};
+
+struct FeedSettings
+{
+	int64_t staleNs;         // no update for this long makes an instrument stale
+	int64_t burstWindowNs;   // more than burstMessages in this window is a burst
+	int burstMessages;
+	int reportSeconds;       // 0: report only at shutdown
+	int maxInstruments;      // instruments past this many are not monitored
+};
+
+/// Watches the market data feed as it arrives, beside the handlers:
+///
+///   - exchange-to-receipt latency, from SendingTime and from the first
+///     entry's MDEntryTime, as histograms;
+///   - MsgSeqNum gaps the application sees, i.e. market data the venue
+///     skipped with a gap fill rather than resent;
+///   - per instrument: messages per second, the busiest second, bursts
+///     and the time since the last update.
+///
+/// A background thread raises a stale-quote alert through the log when an
+/// instrument has not updated for FeedSettings::staleNs, another when it
+/// recovers, and logs a report every FeedSettings::reportSeconds and once
+/// more when it is destroyed.
+///
+/// OnMessage/OnUpdate must come from a single thread, QuickFIX's.  Counters
+/// are fixed-size and written with plain relaxed stores, so a message costs
+/// a TSC read and a few stores per instrument.
+class FeedMonitor
+{
+public:
+	explicit FeedMonitor(const FeedSettings & settings);
+	~FeedMonitor();
+
+	/// Start watching an instrument; call once, when it is registered.  Its
+	/// name is copied, so the monitor thread never reads the registry.
+	void AddInstrument(InstrumentId instrument, const Instrument & details);
+
+	/// Receipt time to pass to the calls below.
+	int64_t NowNs() const { return clock_.NowNs(); }
+
+	/// A market data message arrived at `receiptNs`.  Any of the fields may be empty.
+	void OnMessage(int64_t receiptNs, const FieldView & msgSeqNum, const FieldView & sendingTime, const FieldView & entryTime);
+
+	/// The message received at `receiptNs` updated `instrument`.  Call once
+	/// per instrument per message.
+	void OnUpdate(InstrumentId instrument, int64_t receiptNs)
+	{
+		if(instrument < 0 || instrument >= instrumentCount_.load(std::memory_order_acquire)) return;
+		InstrumentFeed& feed = feeds_[instrument];
+		Increment(feed.messages);
+		feed.lastUpdateNs.store(receiptNs, std::memory_order_relaxed);
+
+		if(receiptNs - feed.secondStartNs >= 1000000000LL)
+		{
+			feed.secondStartNs = receiptNs;
+			feed.secondCount = 0;
+		}
+		if(++feed.secondCount > feed.peakPerSecond.load(std::memory_order_relaxed))
+			feed.peakPerSecond.store(feed.secondCount, std::memory_order_relaxed);
+
+		if(receiptNs - feed.burstStartNs >= settings_.burstWindowNs)
+		{
+			feed.burstStartNs = receiptNs;
+			feed.burstCount = 0;
+		}
+		if(++feed.burstCount == settings_.burstMessages + 1)
+			Increment(feed.bursts);
+	}
+
+private:
+	FeedMonitor(const FeedMonitor&) = delete;
+	FeedMonitor& operator=(const FeedMonitor&) = delete;
+
+	/// One writer, any number of readers: no read-modify-write needed.
+	static void Increment(std::atomic<uint64_t> & counter)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	struct InstrumentFeed
+	{
+		// Written on the market data thread, read by the monitor thread
+		std::atomic<int64_t> lastUpdateNs;
+		std::atomic<uint64_t> messages;
+		std::atomic<uint64_t> bursts;
+		std::atomic<uint32_t> peakPerSecond;
+
+		// Market data thread only
+		int64_t secondStartNs;
+		uint32_t secondCount;
+		int64_t burstStartNs;
+		int burstCount;
+
+		// Set before the instrument is published, then read-only
+		char name[48];          // "symbol maturityMonthYear exchange"
+
+		// Monitor thread only
+		bool stale;
+		uint64_t reportedMessages;
+		char pad[CACHE_LINE_SIZE];
+	};
+
+	void MonitorLoop();
+	void Report(std::ostream & out);
+	void LogReport();
+	void CheckStale(int64_t now);
+	void RecordLatency(LatencyHistogram & histogram, int64_t latencyNs);
+
+	const FeedSettings settings_;
+	TscClock clock_;
+
+	std::vector<InstrumentFeed> feeds_;          // maxInstruments, never resized
+	std::atomic<int> instrumentCount_;
+
+	LatencyHistogram sendingLatency_;            // ns, SendingTime to receipt
+	LatencyHistogram entryLatency_;              // ns, MDEntryTime to receipt
+	std::atomic<uint64_t> clockSkewed_;          // exchange time after receipt
+	std::atomic<uint64_t> messages_;
+	std::atomic<uint64_t> gaps_;
+	std::atomic<uint64_t> missedMessages_;
+	int lastMsgSeqNum_;
+
+	int64_t lastReportNs_;                       // monitor thread only
+	std::thread monitor_;
+	std::mutex monitorMutex_;
+	std::condition_variable monitorWakeup_;
+	bool stopping_;
+};
+
+#endif
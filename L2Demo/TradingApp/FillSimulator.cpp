@@ -0,0 +1,76 @@
+#include "FillSimulator.h"
+
+FillSimulator::FillSimulator()
+	: orders_(0),
+	  rejects_(0),
+	  fills_(0)
+{ }
+
+void FillSimulator::SubmitMarketOrder(const IdString & clOrdId, InstrumentId instrument, const OrderBook & book, SimpleSide side, int qty)
+{
+	++orders_;
+
+	// A buy lifts the offers, a sell hits the bids:
+	const bool buy = BUY == side;
+	const int levels = buy ? book.OfferLevels() : book.BidLevels();
+	if(levels == 0 || qty <= 0)
+	{
+		++rejects_;
+		Report(clOrdId, instrument, side, FIX::ExecType_REJECTED, qty, 0);
+		return;
+	}
+
+	double remaining = qty;
+	double px = 0;
+	for(int level = 0; level < levels && remaining > 0; ++level)
+	{
+		px = buy ? book.OfferPx(level) : book.BidPx(level);
+		double available = buy ? book.OfferQty(level) : book.BidQty(level);
+		double take = available < remaining ? available : remaining;
+		if(take > 0)
+		{
+			Report(clOrdId, instrument, side, FIX::ExecType_FILL, take, px);
+			remaining -= take;
+		}
+	}
+	if(remaining > 0)
+		Report(clOrdId, instrument, side, FIX::ExecType_FILL, remaining, px);
+}
+
+void FillSimulator::SubmitLimitOrder(const IdString & clOrdId, InstrumentId instrument, const OrderBook & book, SimpleSide side, int qty, double px)
+{
+	++orders_;
+
+	const bool buy = BUY == side;
+	const int levels = buy ? book.OfferLevels() : book.BidLevels();
+	double remaining = qty;
+	for(int level = 0; level < levels && remaining > 0; ++level)
+	{
+		double levelPx = buy ? book.OfferPx(level) : book.BidPx(level);
+		if(buy ? levelPx > px : levelPx < px) break;
+		double available = buy ? book.OfferQty(level) : book.BidQty(level);
+		double take = available < remaining ? available : remaining;
+		if(take > 0)
+		{
+			Report(clOrdId, instrument, side, FIX::ExecType_FILL, take, levelPx);
+			remaining -= take;
+		}
+	}
+	if(remaining > 0)
+		Report(clOrdId, instrument, side, FIX::ExecType_CANCELED, remaining, 0);
+}
+
+bool FillSimulator::PopFill(SimulatedFill & fill)
+{
+	if(pending_.empty()) return false;
+	fill = pending_.front();
+	pending_.pop_front();
+	return true;
+}
+
+void FillSimulator::Report(const IdString & clOrdId, InstrumentId instrument, SimpleSide side, char execType, double qty, double px)
+{
+	if(FIX::ExecType_FILL == execType) ++fills_;
+	SimulatedFill fill = { clOrdId, instrument, side, execType, qty, px };
+	pending_.push_back(fill);
+}
@@ -0,0 +1,50 @@
+#ifndef FILL_SIMULATOR_H
+#define FILL_SIMULATOR_H
+
+#include <deque>
+#include "Simple.h"
+
+/// A fill (or reject) produced by the FillSimulator.
+struct SimulatedFill
+{
+	IdString clOrdId;
+	InstrumentId instrument;
+	SimpleSide side;
+	char execType;      // FIX ExecType: FILL, REJECTED, or CANCELED for what a limit order did not fill
+	double qty;
+	double px;
+};
+
+/// Stands in for the exchange when Simple runs without FIX sessions.  Market
+/// orders sweep the opposite side of the book as it is when they are sent;
+/// any quantity beyond the visible depth fills at the worst visible price.
+/// An order with nothing on the opposite side is rejected.
+class FillSimulator
+{
+public:
+	FillSimulator();
+
+	void SubmitMarketOrder(const IdString & clOrdId, InstrumentId instrument, const OrderBook & book, SimpleSide side, int qty);
+
+	/// Fills whatever crosses the book at `px` or better; the rest of the
+	/// order is canceled (there is no queue to rest in).
+	void SubmitLimitOrder(const IdString & clOrdId, InstrumentId instrument, const OrderBook & book, SimpleSide side, int qty, double px);
+
+	/// Fills are queued and handed to the Strategy after the callback that
+	/// sent the order returns, as they would be by a real venue.
+	bool PopFill(SimulatedFill & fill);
+
+	unsigned long long Orders() const { return orders_; }
+	unsigned long long Rejects() const { return rejects_; }
+	unsigned long long Fills() const { return fills_; }
+
+private:
+	void Report(const IdString & clOrdId, InstrumentId instrument, SimpleSide side, char execType, double qty, double px);
+
+	std::deque<SimulatedFill> pending_;
+	unsigned long long orders_;
+	unsigned long long rejects_;
+	unsigned long long fills_;
+};
+
+#endif
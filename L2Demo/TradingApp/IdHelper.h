@@ -20,7 +20,7 @@ public:
 	
 	void WriteOrderIdToFile();
 	
-	int ReadOrderIdFromFile();
+	static int ReadOrderIdFromFile();
 
 private:
 	IdHelper(const IdHelper&) = delete;
@@ -0,0 +1,93 @@
+#include "IdService.h"
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+static const char ID_SERVICE_MAGIC[8] = { 'L', '2', 'I', 'D', 'S', 'V', 'C', '\0' };
+static const uint32_t ID_SERVICE_VERSION = 1;
+
+IdService::IdService(const string & path, uint32_t blockSize, uint64_t lastUsedOrderId)
+	: blockSize_(blockSize ? blockSize : 1),
+	  nextOrder_(0),
+	  reservedEnd_(0),
+	  nextMDRequest_(0)
+{
+	file_.Open(path, sizeof(IdServiceHeader));
+
+	IdServiceHeader* header = Header();
+	if(header->version == 0)
+	{
+		std::memcpy(header->magic, ID_SERVICE_MAGIC, sizeof(header->magic));
+		header->version = ID_SERVICE_VERSION;
+		header->highWater = lastUsedOrderId + 1;
+		header->updated = static_cast<int64_t>(time(nullptr));
+	}
+	else if(std::memcmp(header->magic, ID_SERVICE_MAGIC, sizeof(header->magic)) != 0)
+	{
+		throw std::runtime_error("[IdService] " + path + " is not an id file");
+	}
+	header->blockSize = blockSize_;
+
+	// Nothing at or above the high-water mark has been handed out; the first
+	// id will reserve a fresh block starting there.
+	nextOrder_.store(header->highWater);
+	reservedEnd_.store(header->highWater);
+}
+
+IdService::~IdService()
+{
+	file_.Flush();
+}
+
+uint64_t IdService::NextOrderNumber()
+{
+	const uint64_t id = nextOrder_.fetch_add(1, std::memory_order_relaxed);
+	if(id >= reservedEnd_.load(std::memory_order_acquire))
+		Reserve(id);
+	return id;
+}
+
+// Slow path, once per block: raise the high-water mark past `id` and make
+// it durable before `id` may be used.
+void IdService::Reserve(uint64_t id)
+{
+	std::lock_guard<std::mutex> lock(reserveMutex_);
+	if(id < reservedEnd_.load(std::memory_order_relaxed))
+		return;     // another thread reserved a block covering us meanwhile
+
+	const uint64_t end = id + blockSize_;
+	IdServiceHeader* header = Header();
+	header->highWater = end;
+	header->updated = static_cast<int64_t>(time(nullptr));
+	file_.Flush();
+
+	reservedEnd_.store(end, std::memory_order_release);
+}
+
+uint64_t IdService::NextMDRequestNumber()
+{
+	return nextMDRequest_.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+uint64_t IdService::HighWater() const
+{
+	return Header()->highWater;
+}
+
+IdString IdService::Format(uint64_t value)
+{
+	IdString id;
+	char digits[20];
+	int n = 0;
+	do
+	{
+		digits[n++] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while(value != 0);
+
+	for(int i = 0; i < n; ++i)
+		id.data[i] = digits[n - 1 - i];
+	id.data[n] = '\0';
+	id.size = n;
+	return id;
+}
@@ -0,0 +1,99 @@
+#ifndef ID_SERVICE_H
+#define ID_SERVICE_H
+
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include "MappedFile.h"
+#include "Platform.h"
+
+using std::string;
+
+/// An id formatted as decimal text in a fixed buffer, so handing one out
+/// never touches the heap.
+struct IdString
+{
+	char data[24];
+	int size;
+
+	const char* c_str() const { return data; }
+	string str() const { return string(data, size); }
+};
+
+/// Copy an id received on the wire, e.g. an exchange's ClOrdID echo; ids
+/// longer than the buffer are truncated.
+inline IdString ToIdString(const char* data, size_t size)
+{
+	IdString id;
+	if(size > sizeof(id.data) - 1) size = sizeof(id.data) - 1;
+	for(size_t i = 0; i < size; ++i) id.data[i] = data[i];
+	id.data[size] = '\0';
+	id.size = static_cast<int>(size);
+	return id;
+}
+
+inline IdString ToIdString(const string & s) { return ToIdString(s.data(), s.size()); }
+
+/// On-disk state of an IdService.
+struct IdServiceHeader
+{
+	char magic[8];          // "L2IDSVC"
+	uint32_t version;
+	uint32_t blockSize;
+	uint64_t highWater;     // every order id below this may have been used
+	int64_t updated;
+	uint8_t reserved[32];
+};
+
+static_assert(sizeof(IdServiceHeader) == 64, "IdServiceHeader layout is part of the file format");
+
+/// Hands out ClOrdIDs and MDReqIDs from any number of threads.
+///
+/// Order ids are reserved from a memory-mapped file in blocks: the file's
+/// high-water mark is raised (and flushed) before any id of a new block is
+/// handed out, so ids sent before a crash are never reused.  A restart skips
+/// whatever was left of the last block.  MDReqIDs are only meaningful to the
+/// current sessions and start from 1 on every run.
+class IdService
+{
+public:
+	static const uint32_t DEFAULT_BLOCK_SIZE = 10000;
+
+	/// Open (or create) the id file at `path`.  A new file continues after
+	/// `lastUsedOrderId`, e.g. the last id an older id file recorded.
+	IdService(const string & path, uint32_t blockSize = DEFAULT_BLOCK_SIZE, uint64_t lastUsedOrderId = 0);
+	~IdService();
+
+	uint64_t NextOrderNumber();
+	uint64_t NextMDRequestNumber();
+
+	IdString NextOrderId() { return Format(NextOrderNumber()); }
+	IdString NextMDRequestId() { return Format(NextMDRequestNumber()); }
+
+	/// The id file's current high-water mark.
+	uint64_t HighWater() const;
+
+	static IdString Format(uint64_t value);
+
+private:
+	IdService(const IdService&) = delete;
+	IdService& operator=(const IdService&) = delete;
+
+	IdServiceHeader* Header() const { return reinterpret_cast<IdServiceHeader*>(file_.Data()); }
+	void Reserve(uint64_t id);
+
+private:
+	MappedFile file_;
+	const uint32_t blockSize_;
+	std::mutex reserveMutex_;
+
+	// Written by every sending thread; kept apart from what they only read.
+	std::atomic<uint64_t> nextOrder_;
+	char pad0_[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+	std::atomic<uint64_t> reservedEnd_;
+	char pad1_[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+	std::atomic<uint64_t> nextMDRequest_;
+};
+
+#endif
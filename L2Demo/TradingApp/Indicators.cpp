@@ -0,0 +1,235 @@
+#include "Indicators.h"
+#include <cmath>
+#include <stdexcept>
+
+// Defaults for IndicatorSettings.
+static const int64_t NS_PER_SECOND = 1000000000LL;
+static const int64_t DEFAULT_VWAP_WINDOW_NS = 60 * NS_PER_SECOND;
+static const int64_t DEFAULT_FLOW_WINDOW_NS = 10 * NS_PER_SECOND;
+static const double DEFAULT_VOLATILITY_LAMBDA = 0.94;
+static const size_t DEFAULT_WINDOW_CAPACITY = 4096;
+
+WindowSum::WindowSum(int64_t windowNs, size_t capacity)
+	: windowNs_(windowNs),
+	  mask_(capacity - 1),
+	  time_(capacity),
+	  a_(capacity),
+	  b_(capacity),
+	  head_(0),
+	  tail_(0),
+	  sumA_(0),
+	  sumB_(0),
+	  removedSinceResum_(0),
+	  overflows_(0)
+{
+	if(capacity == 0 || (capacity & (capacity - 1)) != 0)
+		throw std::invalid_argument("WindowSum capacity must be a power of two");
+}
+
+void WindowSum::Add(int64_t timeNs, double a, double b)
+{
+	Expire(timeNs);
+	if(Count() > mask_)
+	{
+		Remove();
+		++overflows_;
+	}
+
+	const size_t i = head_ & mask_;
+	time_[i] = timeNs;
+	a_[i] = a;
+	b_[i] = b;
+	++head_;
+	sumA_ += a;
+	sumB_ += b;
+}
+
+void WindowSum::Expire(int64_t timeNs)
+{
+	const int64_t cutoff = timeNs - windowNs_;
+	while(head_ != tail_ && time_[tail_ & mask_] <= cutoff)
+		Remove();
+}
+
+void WindowSum::Remove()
+{
+	const size_t i = tail_ & mask_;
+	sumA_ -= a_[i];
+	sumB_ -= b_[i];
+	++tail_;
+
+	if(head_ == tail_)
+	{
+		sumA_ = 0;
+		sumB_ = 0;
+		removedSinceResum_ = 0;
+	}
+	else if(++removedSinceResum_ > mask_)
+	{
+		Resum();
+	}
+}
+
+// Add up the live entries again: at most two contiguous runs of each column.
+void WindowSum::Resum()
+{
+	double sumA = 0;
+	double sumB = 0;
+	size_t begin = tail_ & mask_;
+	size_t remaining = Count();
+	while(remaining)
+	{
+		const size_t run = remaining < time_.size() - begin ? remaining : time_.size() - begin;
+		const double* a = &a_[begin];
+		const double* b = &b_[begin];
+		for(size_t i = 0; i < run; ++i)
+		{
+			sumA += a[i];
+			sumB += b[i];
+		}
+		remaining -= run;
+		begin = 0;
+	}
+	sumA_ = sumA;
+	sumB_ = sumB;
+	removedSinceResum_ = 0;
+}
+
+void RollingVwap::OnTrade(int64_t timeNs, double qty, double px)
+{
+	if(qty > 0) trades_.Add(timeNs, px * qty, qty);
+}
+
+EwmaVolatility::EwmaVolatility(double lambda)
+	: lambda_(lambda),
+	  lastPx_(0),
+	  variance_(0),
+	  count_(0)
+{ }
+
+void EwmaVolatility::OnPrice(double px)
+{
+	if(px <= 0) return;
+	if(lastPx_ > 0 && px != lastPx_)
+	{
+		const double r = std::log(px / lastPx_);
+		variance_ = count_ ? lambda_ * variance_ + (1 - lambda_) * r * r : r * r;
+		++count_;
+	}
+	lastPx_ = px;
+}
+
+double EwmaVolatility::Value() const
+{
+	return std::sqrt(variance_);
+}
+
+OrderFlowImbalance::OrderFlowImbalance(int64_t windowNs, size_t capacity)
+	: flow_(windowNs, capacity),
+	  haveQuote_(false),
+	  bidPx_(0), bidQty_(0),
+	  offerPx_(0), offerQty_(0)
+{ }
+
+void OrderFlowImbalance::OnQuote(int64_t timeNs, double bidPx, double bidQty, double offerPx, double offerQty)
+{
+	// Only two-sided quotes say anything about the flow:
+	if(bidPx <= 0 || offerPx <= 0)
+	{
+		haveQuote_ = false;
+		return;
+	}
+
+	if(haveQuote_)
+	{
+		// A higher bid is all new size, a lower one took all the old size
+		// away; at the same price only the difference counts.  Mirrored for the offer.
+		double e = 0;
+		if(bidPx >= bidPx_) e += bidQty;
+		if(bidPx <= bidPx_) e -= bidQty_;
+		if(offerPx <= offerPx_) e -= offerQty;
+		if(offerPx >= offerPx_) e += offerQty_;
+		flow_.Add(timeNs, e);
+	}
+
+	haveQuote_ = true;
+	bidPx_ = bidPx;
+	bidQty_ = bidQty;
+	offerPx_ = offerPx;
+	offerQty_ = offerQty;
+}
+
+TradeSignImbalance::TradeSignImbalance(int64_t windowNs, size_t capacity)
+	: trades_(windowNs, capacity),
+	  lastPx_(0),
+	  lastSign_(0)
+{ }
+
+void TradeSignImbalance::OnTrade(int64_t timeNs, double qty, double px, double mid)
+{
+	int sign;
+	if(mid > 0 && px > mid)
+		sign = 1;
+	else if(mid > 0 && px < mid)
+		sign = -1;
+	else if(px > lastPx_ && lastPx_ > 0)
+		sign = 1;
+	else if(px < lastPx_)
+		sign = -1;
+	else
+		sign = lastSign_;
+
+	lastPx_ = px;
+	lastSign_ = sign;
+	if(qty > 0) trades_.Add(timeNs, sign * qty, qty);
+}
+
+double Microprice(double bidPx, double bidQty, double offerPx, double offerQty)
+{
+	if(bidPx <= 0 || offerPx <= 0 || bidQty + offerQty <= 0) return 0;
+	return (bidPx * offerQty + offerPx * bidQty) / (bidQty + offerQty);
+}
+
+IndicatorSettings::IndicatorSettings()
+	: vwapWindowNs(DEFAULT_VWAP_WINDOW_NS),
+	  orderFlowWindowNs(DEFAULT_FLOW_WINDOW_NS),
+	  tradeSignWindowNs(DEFAULT_FLOW_WINDOW_NS),
+	  volatilityLambda(DEFAULT_VOLATILITY_LAMBDA),
+	  windowCapacity(DEFAULT_WINDOW_CAPACITY)
+{ }
+
+MicrostructureSignals::MicrostructureSignals(const IndicatorSettings & settings)
+	: mid_(0),
+	  microprice_(0),
+	  vwap_(settings.vwapWindowNs, settings.windowCapacity),
+	  volatility_(settings.volatilityLambda),
+	  orderFlow_(settings.orderFlowWindowNs, settings.windowCapacity),
+	  tradeSign_(settings.tradeSignWindowNs, settings.windowCapacity)
+{ }
+
+void MicrostructureSignals::OnQuote(int64_t timeNs, double bidPx, double bidQty, double offerPx, double offerQty)
+{
+	// One-sided books have no mid; keep the last one.
+	if(bidPx > 0 && offerPx > 0)
+	{
+		mid_ = (bidPx + offerPx) / 2;
+		microprice_ = ::Microprice(bidPx, bidQty, offerPx, offerQty);
+		volatility_.OnPrice(mid_);
+	}
+	orderFlow_.OnQuote(timeNs, bidPx, bidQty, offerPx, offerQty);
+	Expire(timeNs);
+}
+
+void MicrostructureSignals::OnTrade(int64_t timeNs, double qty, double px)
+{
+	vwap_.OnTrade(timeNs, qty, px);
+	tradeSign_.OnTrade(timeNs, qty, px, mid_);
+	Expire(timeNs);
+}
+
+void MicrostructureSignals::Expire(int64_t timeNs)
+{
+	vwap_.Expire(timeNs);
+	orderFlow_.Expire(timeNs);
+	tradeSign_.Expire(timeNs);
+}
@@ -0,0 +1,177 @@
+#ifndef INDICATORS_H
+#define INDICATORS_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/// Running sums of one or two values over a sliding time window.
+///
+/// Entries live in a fixed-capacity ring stored as separate time and value
+/// columns, allocated once in the constructor.  Adding and expiring are O(1);
+/// the sums are recomputed from the columns once per `capacity` removals so
+/// that floating point error cannot build up.  If more than `capacity`
+/// entries fall inside the window the oldest are dropped early.
+class WindowSum
+{
+public:
+	/// `capacity` must be a power of two.
+	WindowSum(int64_t windowNs, size_t capacity);
+
+	void Add(int64_t timeNs, double a, double b = 0);
+
+	/// Drop entries older than `timeNs` minus the window.
+	void Expire(int64_t timeNs);
+
+	double SumA() const { return sumA_; }
+	double SumB() const { return sumB_; }
+	size_t Count() const { return head_ - tail_; }
+	int64_t Window() const { return windowNs_; }
+
+	/// Entries dropped before they left the window because the ring was full.
+	uint64_t Overflows() const { return overflows_; }
+
+private:
+	void Remove();
+	void Resum();
+
+	int64_t windowNs_;
+	size_t mask_;
+	std::vector<int64_t> time_;
+	std::vector<double> a_;
+	std::vector<double> b_;
+	size_t head_;           // next entry to write
+	size_t tail_;           // oldest entry
+	double sumA_;
+	double sumB_;
+	size_t removedSinceResum_;
+	uint64_t overflows_;
+};
+
+/// Volume-weighted average trade price over a time window.
+class RollingVwap
+{
+public:
+	RollingVwap(int64_t windowNs, size_t capacity) : trades_(windowNs, capacity) { }
+
+	void OnTrade(int64_t timeNs, double qty, double px);
+	void Expire(int64_t timeNs) { trades_.Expire(timeNs); }
+
+	/// 0 if nothing traded in the window.
+	double Value() const { return trades_.SumB() > 0 ? trades_.SumA() / trades_.SumB() : 0; }
+	double Volume() const { return trades_.SumB(); }
+
+private:
+	WindowSum trades_;      // a = px * qty, b = qty
+};
+
+/// Exponentially weighted volatility of log returns, per price change:
+/// var = lambda * var + (1 - lambda) * r^2.  A price equal to the last one
+/// is not a return, so quotes that only change size leave it alone.
+class EwmaVolatility
+{
+public:
+	explicit EwmaVolatility(double lambda);
+
+	void OnPrice(double px);
+
+	/// Standard deviation of the log return per price change; 0 until the price has changed once.
+	double Value() const;
+	uint64_t Count() const { return count_; }
+
+private:
+	double lambda_;
+	double lastPx_;
+	double variance_;
+	uint64_t count_;        // price changes seen
+};
+
+/// Order flow imbalance (Cont, Kukanov & Stoikov) summed over a time window:
+/// the net size added at the bid minus the net size added at the offer,
+/// inferred from successive top-of-book quotes.
+class OrderFlowImbalance
+{
+public:
+	OrderFlowImbalance(int64_t windowNs, size_t capacity);
+
+	void OnQuote(int64_t timeNs, double bidPx, double bidQty, double offerPx, double offerQty);
+	void Expire(int64_t timeNs) { flow_.Expire(timeNs); }
+
+	double Value() const { return flow_.SumA(); }
+
+private:
+	WindowSum flow_;
+	bool haveQuote_;
+	double bidPx_, bidQty_;
+	double offerPx_, offerQty_;
+};
+
+/// Signed trade volume over total trade volume in a time window, in [-1, 1].
+/// Trades above the mid count as buys and below as sells; trades at the mid
+/// (or with no quote) follow the tick rule.
+class TradeSignImbalance
+{
+public:
+	TradeSignImbalance(int64_t windowNs, size_t capacity);
+
+	void OnTrade(int64_t timeNs, double qty, double px, double mid);
+	void Expire(int64_t timeNs) { trades_.Expire(timeNs); }
+
+	double Value() const { return trades_.SumB() > 0 ? trades_.SumA() / trades_.SumB() : 0; }
+
+	/// +1 buy, -1 sell, 0 before the first trade that moved the price.
+	int LastSign() const { return lastSign_; }
+
+private:
+	WindowSum trades_;      // a = sign * qty, b = qty
+	double lastPx_;
+	int lastSign_;
+};
+
+/// Size-weighted mid: leans towards the side with less size.  0 without a two-sided quote.
+double Microprice(double bidPx, double bidQty, double offerPx, double offerQty);
+
+/// Windows and decay used by MicrostructureSignals.
+struct IndicatorSettings
+{
+	int64_t vwapWindowNs;
+	int64_t orderFlowWindowNs;
+	int64_t tradeSignWindowNs;
+	double volatilityLambda;
+	size_t windowCapacity;  // entries per window, a power of two
+
+	IndicatorSettings();
+};
+
+/// The indicators for one instrument, fed from the Strategy's top-of-book and
+/// trade callbacks.  Every update is O(1) and allocates nothing; every value
+/// can be read at any time and is as of the last update or Expire().
+class MicrostructureSignals
+{
+public:
+	explicit MicrostructureSignals(const IndicatorSettings & settings = IndicatorSettings());
+
+	void OnQuote(int64_t timeNs, double bidPx, double bidQty, double offerPx, double offerQty);
+	void OnTrade(int64_t timeNs, double qty, double px);
+
+	/// Age the windows without a new update, e.g. before reading them after a quiet spell.
+	void Expire(int64_t timeNs);
+
+	double Mid() const { return mid_; }
+	double Microprice() const { return microprice_; }
+	double Vwap() const { return vwap_.Value(); }
+	double VwapVolume() const { return vwap_.Volume(); }
+	double Volatility() const { return volatility_.Value(); }
+	double OrderFlow() const { return orderFlow_.Value(); }
+	double TradeSign() const { return tradeSign_.Value(); }
+
+private:
+	double mid_;
+	double microprice_;
+	RollingVwap vwap_;
+	EwmaVolatility volatility_;     // of the mid
+	OrderFlowImbalance orderFlow_;
+	TradeSignImbalance tradeSign_;
+};
+
+#endif
@@ -0,0 +1,171 @@
+#include "InstrumentRegistry.h"
+#include <cstdlib>
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t HashAppend(uint64_t h, const char* s, size_t size)
+{
+	for(size_t i = 0; i < size; ++i)
+	{
+		h ^= static_cast<unsigned char>(s[i]);
+		h *= FNV_PRIME;
+	}
+	// Separator so that ("AB", "C") and ("A", "BC") hash differently:
+	h ^= 0xff;
+	h *= FNV_PRIME;
+	return h;
+}
+
+// Our MDReqIDs come from IdService::NextMDRequestId(): decimal numbers that
+// start from 1 on every run, so they can index a flat array directly.
+// Anything else is rejected.
+static int ParseRequestId(const char* mdReqId, size_t size)
+{
+	if(size == 0 || size > 9) return -1;
+	int value = 0;
+	for(size_t i = 0; i < size; ++i)
+	{
+		char c = mdReqId[i];
+		if(c < '0' || c > '9') return -1;
+		value = value * 10 + (c - '0');
+	}
+	return value;
+}
+
+// Starting sizes; every table doubles as it fills.
+static const size_t INITIAL_INSTRUMENTS = 64;
+static const size_t INITIAL_REQUESTS = 256;
+
+InstrumentRegistry::InstrumentRegistry()
+	: entries_(new Table<const Entry*>(INITIAL_INSTRUMENTS, nullptr, nullptr)),
+	  slots_(new Table<InstrumentId>(2 * INITIAL_INSTRUMENTS, INVALID_INSTRUMENT, nullptr)),
+	  byRequest_(new Table<InstrumentId>(INITIAL_REQUESTS, INVALID_INSTRUMENT, nullptr)),
+	  size_(0)
+{ }
+
+InstrumentRegistry::~InstrumentRegistry()
+{
+	delete entries_.load(std::memory_order_relaxed);
+	delete slots_.load(std::memory_order_relaxed);
+	delete byRequest_.load(std::memory_order_relaxed);
+}
+
+uint64_t InstrumentRegistry::Hash(const string & symbol, const string & maturityMonthYear, const string & exchange)
+{
+	return HashAppend(HashAppend(HashAppend(FNV_OFFSET, symbol.data(), symbol.size()), maturityMonthYear.data(), maturityMonthYear.size()), exchange.data(), exchange.size());
+}
+
+// The instrument is written before its id is published, so a reader that
+// finds the id finds the instrument.
+InstrumentId InstrumentRegistry::Register(const string & symbol, const string & maturityMonthYear, const string & exchange)
+{
+	std::lock_guard<std::mutex> lock(writeMutex_);
+	InstrumentId id = Find(symbol, maturityMonthYear, exchange);
+	if(id != INVALID_INSTRUMENT) return id;
+
+	id = size_.load(std::memory_order_relaxed);
+	Entry entry = { { symbol, maturityMonthYear, exchange }, Hash(symbol, maturityMonthYear, exchange) };
+	storage_.push_back(entry);
+
+	Table<const Entry*>* entries = entries_.load(std::memory_order_relaxed);
+	if(static_cast<size_t>(id) >= entries->size)
+	{
+		Table<const Entry*>* bigger = new Table<const Entry*>(2 * entries->size, nullptr, entries);
+		for(size_t i = 0; i < entries->size; ++i)
+			bigger->items[i].store(entries->items[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		entries_.store(bigger, std::memory_order_release);
+		entries = bigger;
+	}
+	entries->items[id].store(&storage_.back(), std::memory_order_release);
+
+	// Keep the table at most half full so probe sequences stay short:
+	Table<InstrumentId>* slots = slots_.load(std::memory_order_relaxed);
+	if(2 * static_cast<size_t>(id + 1) > slots->size)
+	{
+		Table<InstrumentId>* bigger = new Table<InstrumentId>(2 * slots->size, INVALID_INSTRUMENT, slots);
+		for(InstrumentId i = 0; i <= id; ++i)
+			Insert(*bigger, storage_[i].hash, i);
+		slots_.store(bigger, std::memory_order_release);
+	}
+	else
+	{
+		Insert(*slots, storage_.back().hash, id);
+	}
+
+	size_.store(id + 1, std::memory_order_release);
+	return id;
+}
+
+InstrumentId InstrumentRegistry::Find(const string & symbol, const string & maturityMonthYear, const string & exchange) const
+{
+	return Find(symbol.data(), symbol.size(), maturityMonthYear.data(), maturityMonthYear.size(), exchange.data(), exchange.size());
+}
+
+InstrumentId InstrumentRegistry::Find(const char* symbol, size_t symbolSize, const char* maturityMonthYear, size_t maturityMonthYearSize, const char* exchange, size_t exchangeSize) const
+{
+	const uint64_t hash = HashAppend(HashAppend(HashAppend(FNV_OFFSET, symbol, symbolSize), maturityMonthYear, maturityMonthYearSize), exchange, exchangeSize);
+	const Table<InstrumentId>* slots = slots_.load(std::memory_order_acquire);
+	const Table<const Entry*>* entries = nullptr;
+	const size_t mask = slots->size - 1;
+	for(size_t i = static_cast<size_t>(hash) & mask; ; i = (i + 1) & mask)
+	{
+		const InstrumentId id = slots->items[i].load(std::memory_order_acquire);
+		if(id == INVALID_INSTRUMENT) return INVALID_INSTRUMENT;
+
+		// Loaded after the id, so the table is new enough to hold it:
+		if(!entries) entries = entries_.load(std::memory_order_acquire);
+		const Entry* entry = entries->items[id].load(std::memory_order_acquire);
+		if(entry->hash == hash)
+		{
+			const Instrument & instrument = entry->instrument;
+			if(instrument.symbol.compare(0, string::npos, symbol, symbolSize) == 0
+				&& instrument.maturityMonthYear.compare(0, string::npos, maturityMonthYear, maturityMonthYearSize) == 0
+				&& instrument.exchange.compare(0, string::npos, exchange, exchangeSize) == 0)
+				return id;
+		}
+	}
+}
+
+void InstrumentRegistry::MapRequest(const string & mdReqId, InstrumentId id)
+{
+	int index = ParseRequestId(mdReqId.data(), mdReqId.size());
+	if(index < 0) return;
+
+	std::lock_guard<std::mutex> lock(writeMutex_);
+	Table<InstrumentId>* byRequest = byRequest_.load(std::memory_order_relaxed);
+	if(static_cast<size_t>(index) >= byRequest->size)
+	{
+		size_t size = byRequest->size;
+		while(static_cast<size_t>(index) >= size) size *= 2;
+		Table<InstrumentId>* bigger = new Table<InstrumentId>(size, INVALID_INSTRUMENT, byRequest);
+		for(size_t i = 0; i < byRequest->size; ++i)
+			bigger->items[i].store(byRequest->items[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		byRequest_.store(bigger, std::memory_order_release);
+		byRequest = bigger;
+	}
+	byRequest->items[index].store(id, std::memory_order_release);
+}
+
+InstrumentId InstrumentRegistry::FindByRequest(const string & mdReqId) const
+{
+	return FindByRequest(mdReqId.data(), mdReqId.size());
+}
+
+InstrumentId InstrumentRegistry::FindByRequest(const char* mdReqId, size_t size) const
+{
+	int index = ParseRequestId(mdReqId, size);
+	if(index < 0) return INVALID_INSTRUMENT;
+	const Table<InstrumentId>* byRequest = byRequest_.load(std::memory_order_acquire);
+	if(static_cast<size_t>(index) >= byRequest->size) return INVALID_INSTRUMENT;
+	return byRequest->items[index].load(std::memory_order_acquire);
+}
+
+// Only on a table no reader has seen yet, or for an id not yet published.
+void InstrumentRegistry::Insert(Table<InstrumentId> & slots, uint64_t hash, InstrumentId id)
+{
+	const size_t mask = slots.size - 1;
+	size_t i = static_cast<size_t>(hash) & mask;
+	while(slots.items[i].load(std::memory_order_relaxed) != INVALID_INSTRUMENT) i = (i + 1) & mask;
+	slots.items[i].store(id, std::memory_order_release);
+}
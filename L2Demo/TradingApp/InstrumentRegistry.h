@@ -0,0 +1,100 @@
+#ifndef INSTRUMENT_REGISTRY_H
+#define INSTRUMENT_REGISTRY_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <cstdint>
+
+using std::string;
+
+/// Dense index of an instrument, assigned at subscription time.  Used to
+/// index every per-instrument array in Simple and Strategy.
+typedef int InstrumentId;
+
+const InstrumentId INVALID_INSTRUMENT = -1;
+
+/// The fields that identify an instrument on the wire.
+struct Instrument
+{
+	string symbol;
+	string maturityMonthYear;
+	string exchange;
+};
+
+/// Maps (symbol, maturity, exchange) and MDReqIDs to dense InstrumentIds.
+/// Registration happens on the subscription path; lookups on the market data
+/// path hash the wire strings once and never allocate.
+///
+/// Lookups take no lock, so any number of threads may read while one
+/// registers or maps a request; writers are serialized by a mutex.  Tables
+/// are never resized in place: a writer publishes a bigger copy, and keeps
+/// the old one until the registry goes, since a reader may still be in it.
+/// Tables double, so the copies kept add up to less than the latest.
+class InstrumentRegistry
+{
+public:
+	InstrumentRegistry();
+	~InstrumentRegistry();
+
+	/// Return the id of the instrument, registering it if it is new.
+	InstrumentId Register(const string & symbol, const string & maturityMonthYear, const string & exchange);
+
+	/// Returns INVALID_INSTRUMENT if the instrument was never registered.
+	InstrumentId Find(const string & symbol, const string & maturityMonthYear, const string & exchange) const;
+
+	/// Same lookup on values pointing straight into a raw FIX buffer.
+	InstrumentId Find(const char* symbol, size_t symbolSize, const char* maturityMonthYear, size_t maturityMonthYearSize, const char* exchange, size_t exchangeSize) const;
+
+	/// Remember that market data for MDReqID `mdReqId` belongs to `id`.
+	void MapRequest(const string & mdReqId, InstrumentId id);
+
+	/// Returns INVALID_INSTRUMENT for an unknown MDReqID.
+	InstrumentId FindByRequest(const string & mdReqId) const;
+	InstrumentId FindByRequest(const char* mdReqId, size_t size) const;
+
+	/// `id` must have been returned by Register() or a lookup.
+	const Instrument & Get(InstrumentId id) const { return entries_.load(std::memory_order_acquire)->items[id].load(std::memory_order_acquire)->instrument; }
+	int Size() const { return size_.load(std::memory_order_acquire); }
+
+	static uint64_t Hash(const string & symbol, const string & maturityMonthYear, const string & exchange);
+
+private:
+	InstrumentRegistry(const InstrumentRegistry&) = delete;
+	InstrumentRegistry& operator=(const InstrumentRegistry&) = delete;
+
+	struct Entry
+	{
+		Instrument instrument;
+		uint64_t hash;
+	};
+
+	/// Fixed-size array of atomics; `previous` is the table it replaced.
+	template<class T>
+	struct Table
+	{
+		Table(size_t size, T empty, Table* previous)
+			: size(size), items(new std::atomic<T>[size]), previous(previous)
+		{
+			for(size_t i = 0; i < size; ++i)
+				items[i].store(empty, std::memory_order_relaxed);
+		}
+
+		const size_t size;
+		std::unique_ptr<std::atomic<T>[]> items;
+		std::unique_ptr<Table> previous;
+	};
+
+	void Insert(Table<InstrumentId> & slots, uint64_t hash, InstrumentId id);
+
+	std::mutex writeMutex_;
+	std::deque<Entry> storage_;                             // never moves; written under writeMutex_
+	std::atomic<Table<const Entry*>*> entries_;             // indexed by InstrumentId
+	std::atomic<Table<InstrumentId>*> slots_;               // open addressing, power-of-two size
+	std::atomic<Table<InstrumentId>*> byRequest_;           // indexed by numeric MDReqID
+	std::atomic<int> size_;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "LatencyHistogram.h"
+#include "Platform.h"
+
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+int LatencyHistogram::BucketIndex(uint64_t value)
+{
+	if(value < LINEAR_LIMIT) return static_cast<int>(value);
+
+	int msb = MostSignificantBit(value);
+	if(msb >= MAX_BITS) return BUCKETS - 1;
+
+	// value >> shift falls in [SUB_BUCKETS, 2 * SUB_BUCKETS)
+	int shift = msb - SUB_BUCKET_BITS;
+	return LINEAR_LIMIT + (shift - 1) * SUB_BUCKETS + static_cast<int>((value >> shift) - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int index)
+{
+	if(index < LINEAR_LIMIT) return static_cast<uint64_t>(index);
+
+	int shift = (index - LINEAR_LIMIT) / SUB_BUCKETS + 1;
+	uint64_t sub = (index - LINEAR_LIMIT) % SUB_BUCKETS + SUB_BUCKETS;
+	return ((sub + 1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::Count() const
+{
+	uint64_t total = 0;
+	for(int i = 0; i < BUCKETS; ++i)
+		total += counts_[i].load(std::memory_order_relaxed);
+	return total;
+}
+
+uint64_t LatencyHistogram::Percentile(double percentile) const
+{
+	uint64_t total = Count();
+	if(total == 0) return 0;
+
+	uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * total + 0.5);
+	if(rank < 1) rank = 1;
+	if(rank > total) rank = total;
+
+	uint64_t seen = 0;
+	for(int i = 0; i < BUCKETS; ++i)
+	{
+		seen += counts_[i].load(std::memory_order_relaxed);
+		if(seen >= rank)
+		{
+			uint64_t bound = BucketUpperBound(i);
+			uint64_t max = Max();
+			return bound < max ? bound : max;
+		}
+	}
+	return Max();
+}
+
+void LatencyHistogram::Reset()
+{
+	for(int i = 0; i < BUCKETS; ++i)
+		counts_[i].store(0, std::memory_order_relaxed);
+	max_.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,50 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+
+/// HDR-style histogram with log-linear buckets: exact below 64, then 32
+/// sub-buckets per power of two (about 3% relative precision) up to 2^48.
+/// Recording is a single relaxed atomic increment, so several threads may
+/// record into the same histogram without locks.
+class LatencyHistogram
+{
+public:
+	static const int SUB_BUCKET_BITS = 5;
+	static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static const int LINEAR_LIMIT = 2 * SUB_BUCKETS;
+	static const int MAX_BITS = 48;
+	static const int BUCKETS = LINEAR_LIMIT + (MAX_BITS - SUB_BUCKET_BITS - 1) * SUB_BUCKETS;
+
+	LatencyHistogram();
+
+	void Record(uint64_t value)
+	{
+		counts_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		uint64_t max = max_.load(std::memory_order_relaxed);
+		while(value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed))
+		{ }
+	}
+
+	uint64_t Count() const;
+	uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+
+	/// Upper bound of the bucket holding the given percentile (0-100).
+	uint64_t Percentile(double percentile) const;
+
+	void Reset();
+
+	static int BucketIndex(uint64_t value);
+	static uint64_t BucketUpperBound(int index);
+
+private:
+	LatencyHistogram(const LatencyHistogram&) = delete;
+	LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+private:
+	std::atomic<uint64_t> counts_[BUCKETS];
+	std::atomic<uint64_t> max_;
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include "LatencyProbes.h"
+
+#ifdef L2_LATENCY_PROBES
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include <iomanip>
+#include "Platform.h"
+
+// Start timestamps of the spans in progress on this thread; 0 means the
+// span is not open, so e.g. an order sent from OnInit records no tick-to-trade.
+struct ProbeStamps
+{
+	unsigned long long fromApp;
+	unsigned long long strategy;
+	unsigned long long send;
+	unsigned long long tick;    // fromApp stamp carried to the order
+};
+
+static THREAD_LOCAL ProbeStamps stamps = { 0, 0, 0, 0 };
+
+static LatencyHistogram histograms[SPAN_COUNT];
+static double ticksPerNs = 0;
+
+static std::thread reporter;
+static std::mutex reporterMutex;
+static std::condition_variable reporterWakeup;
+static bool reporterStop = false;
+
+LatencyHistogram & LatencyMonitor::Histogram(LatencySpan span)
+{
+	return histograms[span];
+}
+
+void LatencyMonitor::FromAppBegin()
+{
+	stamps.fromApp = ReadTsc();
+}
+
+void LatencyMonitor::FromAppEnd()
+{
+	stamps.fromApp = 0;
+}
+
+void LatencyMonitor::StrategyEnter()
+{
+	unsigned long long now = ReadTsc();
+	stamps.strategy = now;
+	if(stamps.fromApp) Histogram(SPAN_FROMAPP_TO_STRATEGY).Record(now - stamps.fromApp);
+}
+
+void LatencyMonitor::StrategyExit()
+{
+	unsigned long long now = ReadTsc();
+	if(stamps.strategy) Histogram(SPAN_STRATEGY).Record(now - stamps.strategy);
+	stamps.strategy = 0;
+}
+
+void LatencyMonitor::SendOrder()
+{
+	unsigned long long now = ReadTsc();
+	stamps.send = now;
+	stamps.tick = stamps.fromApp;
+	if(stamps.strategy) Histogram(SPAN_STRATEGY_TO_SEND).Record(now - stamps.strategy);
+}
+
+void LatencyMonitor::ToAppOrder()
+{
+	unsigned long long now = ReadTsc();
+	if(stamps.send) Histogram(SPAN_SEND_TO_TOAPP).Record(now - stamps.send);
+	if(stamps.tick) Histogram(SPAN_TICK_TO_TRADE).Record(now - stamps.tick);
+	stamps.send = 0;
+	stamps.tick = 0;
+}
+
+uint64_t LatencyMonitor::FromAppStamp()
+{
+	return stamps.fromApp;
+}
+
+void LatencyMonitor::ResumeFromApp(uint64_t fromApp)
+{
+	stamps.fromApp = fromApp;
+}
+
+void LatencyMonitor::HandOffOrder(uint64_t & send, uint64_t & tick)
+{
+	send = stamps.send;
+	tick = stamps.tick;
+	stamps.send = 0;
+	stamps.tick = 0;
+}
+
+void LatencyMonitor::ResumeOrder(uint64_t send, uint64_t tick)
+{
+	stamps.send = send;
+	stamps.tick = tick;
+}
+
+double LatencyMonitor::TicksPerNs()
+{
+	if(ticksPerNs == 0)
+		ticksPerNs = MeasureTscTicksPerNs();
+	return ticksPerNs;
+}
+
+const char* LatencyMonitor::SpanName(LatencySpan span)
+{
+	switch(span)
+	{
+	case SPAN_FROMAPP_TO_STRATEGY:
+		return "fromApp->strategy";
+	case SPAN_STRATEGY:
+		return "strategy callback";
+	case SPAN_STRATEGY_TO_SEND:
+		return "strategy->SendMarketOrder";
+	case SPAN_SEND_TO_TOAPP:
+		return "SendMarketOrder->toApp";
+	case SPAN_TICK_TO_TRADE:
+		return "tick-to-trade";
+	default:
+		return "unknown";
+	}
+}
+
+void LatencyMonitor::Report(std::ostream & out)
+{
+	const double ticksPerNs = TicksPerNs();
+
+	out << "[latency] span                        count       p50(ns)     p99(ns)   p99.9(ns)     max(ns)" << std::endl;
+	for(int i = 0; i < SPAN_COUNT; ++i)
+	{
+		const LatencyHistogram & h = Histogram(static_cast<LatencySpan>(i));
+		out << "[latency] " << std::left << std::setw(26) << SpanName(static_cast<LatencySpan>(i)) << std::right
+			<< std::setw(12) << h.Count()
+			<< std::fixed << std::setprecision(0)
+			<< std::setw(12) << h.Percentile(50) / ticksPerNs
+			<< std::setw(12) << h.Percentile(99) / ticksPerNs
+			<< std::setw(12) << h.Percentile(99.9) / ticksPerNs
+			<< std::setw(12) << h.Max() / ticksPerNs
+			<< std::endl;
+	}
+}
+
+void LatencyMonitor::StartReporter(int seconds)
+{
+	// Calibrate up front rather than on the first report:
+	TicksPerNs();
+	if(seconds <= 0 || reporter.joinable()) return;
+
+	reporterStop = false;
+	reporter = std::thread([seconds]()
+	{
+		std::unique_lock<std::mutex> lock(reporterMutex);
+		while(!reporterWakeup.wait_for(lock, std::chrono::seconds(seconds), []() { return reporterStop; }))
+			Report(std::cout);
+	});
+}
+
+void LatencyMonitor::StopReporter()
+{
+	if(reporter.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(reporterMutex);
+			reporterStop = true;
+		}
+		reporterWakeup.notify_all();
+		reporter.join();
+	}
+	Report(std::cout);
+}
+
+#endif
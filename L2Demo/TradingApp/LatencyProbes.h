@@ -0,0 +1,101 @@
+#ifndef LATENCY_PROBES_H
+#define LATENCY_PROBES_H
+
+// Tick-to-trade latency probes.  Build with L2_LATENCY_PROBES defined to
+// enable them; otherwise every PROBE_* macro expands to nothing and none of
+// the code below is referenced.
+
+#ifdef L2_LATENCY_PROBES
+
+#include <ostream>
+#include <cstdint>
+#include "LatencyHistogram.h"
+
+/// The spans we measure.  Each thread keeps the start stamps of the spans
+/// it has open.  With MyStrategyThread=Y a span crosses threads: fromApp
+/// runs on the QuickFIX thread, the Strategy on the strategy thread and
+/// toApp on the sender thread.  The start stamps then travel with the work,
+/// in InboundEvent, ShardUpdate and OrderCommand, and the receiving thread
+/// picks them up with PROBE_RESUME_FROMAPP/PROBE_RESUME_ORDER.
+enum LatencySpan
+{
+	SPAN_FROMAPP_TO_STRATEGY = 0,   // decode, queueing and book building
+	SPAN_STRATEGY,                  // inside a Strategy callback
+	SPAN_STRATEGY_TO_SEND,          // callback entry to SendMarketOrder
+	SPAN_SEND_TO_TOAPP,             // building the order until QuickFIX hands it to toApp
+	SPAN_TICK_TO_TRADE,             // fromApp entry to the order reaching toApp
+	SPAN_COUNT
+};
+
+/// Timestamps the probe points with the TSC and records the spans between
+/// them into one LatencyHistogram per span.
+class LatencyMonitor
+{
+public:
+	static void FromAppBegin();
+	static void FromAppEnd();
+	static void StrategyEnter();
+	static void StrategyExit();
+	static void SendOrder();
+	static void ToAppOrder();
+
+	/// The fromApp stamp open on this thread, to hand to another; 0 if none.
+	static uint64_t FromAppStamp();
+
+	/// Continue the fromApp span started on another thread, or close it with 0.
+	static void ResumeFromApp(uint64_t fromApp);
+
+	/// Take the stamps of the order being built off this thread, to hand
+	/// them to the thread that sends it.
+	static void HandOffOrder(uint64_t & send, uint64_t & tick);
+
+	/// Continue an order's spans on the thread that sends it.
+	static void ResumeOrder(uint64_t send, uint64_t tick);
+
+	/// Print count, p50/p99/p99.9/max in nanoseconds for every span.
+	static void Report(std::ostream & out);
+
+	/// Report to stdout every `seconds` from a background thread.
+	static void StartReporter(int seconds);
+
+	/// Stop the background thread and print a final report.
+	static void StopReporter();
+
+	/// TSC ticks per nanosecond, measured against the steady clock once.
+	static double TicksPerNs();
+
+	static const char* SpanName(LatencySpan span);
+	static LatencyHistogram & Histogram(LatencySpan span);
+};
+
+#define PROBE_FROMAPP_BEGIN()   LatencyMonitor::FromAppBegin()
+#define PROBE_FROMAPP_END()     LatencyMonitor::FromAppEnd()
+#define PROBE_STRATEGY_ENTER()  LatencyMonitor::StrategyEnter()
+#define PROBE_STRATEGY_EXIT()   LatencyMonitor::StrategyExit()
+#define PROBE_SEND_ORDER()      LatencyMonitor::SendOrder()
+#define PROBE_TOAPP_ORDER()     LatencyMonitor::ToAppOrder()
+#define PROBE_FROMAPP_STAMP()   LatencyMonitor::FromAppStamp()
+#define PROBE_RESUME_FROMAPP(stamp)     LatencyMonitor::ResumeFromApp(stamp)
+#define PROBE_HANDOFF_ORDER(send, tick) LatencyMonitor::HandOffOrder(send, tick)
+#define PROBE_RESUME_ORDER(send, tick)  LatencyMonitor::ResumeOrder(send, tick)
+#define PROBE_START_REPORTER(seconds) LatencyMonitor::StartReporter(seconds)
+#define PROBE_STOP_REPORTER()   LatencyMonitor::StopReporter()
+
+#else
+
+#define PROBE_FROMAPP_BEGIN()   ((void)0)
+#define PROBE_FROMAPP_END()     ((void)0)
+#define PROBE_STRATEGY_ENTER()  ((void)0)
+#define PROBE_STRATEGY_EXIT()   ((void)0)
+#define PROBE_SEND_ORDER()      ((void)0)
+#define PROBE_TOAPP_ORDER()     ((void)0)
+#define PROBE_FROMAPP_STAMP()   0ULL
+#define PROBE_RESUME_FROMAPP(stamp)     ((void)0)
+#define PROBE_HANDOFF_ORDER(send, tick) ((void)((send) = (tick) = 0))
+#define PROBE_RESUME_ORDER(send, tick)  ((void)0)
+#define PROBE_START_REPORTER(seconds) ((void)0)
+#define PROBE_STOP_REPORTER()   ((void)0)
+
+#endif
+
+#endif
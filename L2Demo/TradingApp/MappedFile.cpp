@@ -0,0 +1,209 @@
+#include "MappedFile.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+	: data_(nullptr),
+	  size_(0),
+	  readOnly_(false)
+#ifdef _WIN32
+	, file_(INVALID_HANDLE_VALUE),
+	  mapping_(nullptr)
+#else
+	, fd_(-1)
+#endif
+{ }
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+void MappedFile::Open(const string & path, size_t size)
+{
+	Close();
+	path_ = path;
+	readOnly_ = false;
+
+	file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file_ == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("[MappedFile] cannot open " + path);
+
+	LARGE_INTEGER current;
+	if(!GetFileSizeEx(file_, &current))
+	{
+		Close();
+		throw std::runtime_error("[MappedFile] cannot read the size of " + path);
+	}
+	if(static_cast<size_t>(current.QuadPart) > size) size = static_cast<size_t>(current.QuadPart);
+
+	ULARGE_INTEGER length;
+	length.QuadPart = size;
+	mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, length.HighPart, length.LowPart, nullptr);
+	if(!mapping_)
+	{
+		Close();
+		throw std::runtime_error("[MappedFile] cannot map " + path);
+	}
+
+	data_ = static_cast<char*>(MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size));
+	if(!data_)
+	{
+		Close();
+		throw std::runtime_error("[MappedFile] cannot map view of " + path);
+	}
+	size_ = size;
+}
+
+void MappedFile::OpenReadOnly(const string & path)
+{
+	Close();
+	path_ = path;
+	readOnly_ = true;
+
+	file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file_ == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("[MappedFile] cannot open " + path);
+
+	LARGE_INTEGER length;
+	if(!GetFileSizeEx(file_, &length))
+	{
+		Close();
+		throw std::runtime_error("[MappedFile] cannot read the size of " + path);
+	}
+	if(length.QuadPart == 0)
+	{
+		Close();
+		throw std::runtime_error("[MappedFile] empty file " + path);
+	}
+
+	mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mapping_)
+		data_ = static_cast<char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+	if(!data_)
+	{
+		Close();
+		throw std::runtime_error("[MappedFile] cannot map " + path);
+	}
+	size_ = static_cast<size_t>(length.QuadPart);
+}
+
+void MappedFile::Flush()
+{
+	if(data_ && !readOnly_)
+	{
+		FlushViewOfFile(data_, size_);
+		FlushFileBuffers(file_);
+	}
+}
+
+void MappedFile::Close()
+{
+	if(data_) UnmapViewOfFile(data_);
+	if(mapping_) CloseHandle(mapping_);
+	if(file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+	data_ = nullptr;
+	mapping_ = nullptr;
+	file_ = INVALID_HANDLE_VALUE;
+	size_ = 0;
+}
+
+#else
+
+void MappedFile::Open(const string & path, size_t size)
+{
+	Close();
+	path_ = path;
+	readOnly_ = false;
+
+	fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if(fd_ < 0)
+		throw std::runtime_error("[MappedFile] cannot open " + path);
+
+	struct stat st;
+	if(fstat(fd_, &st) != 0)
+	{
+		Close();
+		throw std::runtime_error("[MappedFile] cannot read the size of " + path);
+	}
+	if(static_cast<size_t>(st.st_size) > size) size = static_cast<size_t>(st.st_size);
+	if(static_cast<size_t>(st.st_size) < size && ftruncate(fd_, size) != 0)
+	{
+		Close();
+		throw std::runtime_error("[MappedFile] cannot grow " + path);
+	}
+
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+	if(p == MAP_FAILED)
+	{
+		Close();
+		throw std::runtime_error("[MappedFile] cannot map " + path);
+	}
+	data_ = static_cast<char*>(p);
+	size_ = size;
+}
+
+void MappedFile::OpenReadOnly(const string & path)
+{
+	Close();
+	path_ = path;
+	readOnly_ = true;
+
+	fd_ = ::open(path.c_str(), O_RDONLY);
+	if(fd_ < 0)
+		throw std::runtime_error("[MappedFile] cannot open " + path);
+
+	struct stat st;
+	if(fstat(fd_, &st) != 0)
+	{
+		Close();
+		throw std::runtime_error("[MappedFile] cannot read the size of " + path);
+	}
+	if(st.st_size == 0)
+	{
+		Close();
+		throw std::runtime_error("[MappedFile] empty file " + path);
+	}
+
+	void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd_, 0);
+	if(p == MAP_FAILED)
+	{
+		Close();
+		throw std::runtime_error("[MappedFile] cannot map " + path);
+	}
+	data_ = static_cast<char*>(p);
+	size_ = static_cast<size_t>(st.st_size);
+}
+
+void MappedFile::Flush()
+{
+	if(data_ && !readOnly_) msync(data_, size_, MS_SYNC);
+}
+
+void MappedFile::Close()
+{
+	if(data_) munmap(data_, size_);
+	if(fd_ >= 0) ::close(fd_);
+	data_ = nullptr;
+	fd_ = -1;
+	size_ = 0;
+}
+
+#endif
+
+void MappedFile::Resize(size_t size)
+{
+	string path = path_;
+	Flush();
+	Open(path, size);
+}
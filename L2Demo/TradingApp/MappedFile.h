@@ -0,0 +1,54 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+using std::string;
+
+/// A file mapped into memory.  Used by the journals and stores that want to
+/// append without a write() call per record.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	/// Map the first `size` bytes of `path` read/write, creating the file and
+	/// growing it to `size` bytes if needed.  Throws std::runtime_error on failure.
+	void Open(const string & path, size_t size);
+
+	/// Map an existing file read-only in its entirety.  Throws std::runtime_error on failure.
+	void OpenReadOnly(const string & path);
+
+	/// Unmap the current mapping and map it again with `size` bytes.
+	void Resize(size_t size);
+
+	/// Ask the OS to write dirty pages back to disk.
+	void Flush();
+
+	void Close();
+
+	char* Data() const { return data_; }
+	size_t Size() const { return size_; }
+	bool IsOpen() const { return data_ != nullptr; }
+	const string & Path() const { return path_; }
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+	string path_;
+	char* data_;
+	size_t size_;
+	bool readOnly_;
+#ifdef _WIN32
+	void* file_;
+	void* mapping_;
+#else
+	int fd_;
+#endif
+};
+
+#endif
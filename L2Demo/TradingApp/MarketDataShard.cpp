@@ -0,0 +1,131 @@
+#include "MarketDataShard.h"
+#include <stdexcept>
+#include "LatencyProbes.h"
+
+// Non-book entries (trades) one message can carry before the buffer grows.
+static const size_t EXPECTED_ENTRIES = 256;
+
+MarketDataShard::MarketDataShard(int index, int count, const FIX::SessionID & session, InstrumentRegistry & instruments, IdService & ids,
+	size_t maxInstruments, size_t ringSize)
+	: index_(index),
+	  count_(count > 0 ? count : 1),
+	  session_(session),
+	  subscriptions_(instruments, ids),
+	  books_(maxInstruments),
+	  changed_(maxInstruments, 0),
+	  ring_(ringSize),
+	  messages_(0),
+	  misrouted_(0),
+	  fullWaits_(0),
+	  maxDepth_(0)
+{
+	changedBooks_.reserve(maxInstruments);
+	entries_.reserve(EXPECTED_ENTRIES);
+}
+
+// The subscription is sent after this on the same thread, and its market
+// data is read after it arrives, so the session thread sees the new depth.
+void MarketDataShard::SetDepth(InstrumentId instrument, int depth)
+{
+	if(instrument < 0 || static_cast<size_t>(instrument) >= books_.size())
+		throw std::runtime_error("[MarketDataShard] too many instruments for the preallocated books");
+	books_[instrument].SetDepth(depth);
+}
+
+void MarketDataShard::ClearBook(InstrumentId instrument)
+{
+	if(!Owns(instrument) || static_cast<size_t>(instrument) >= books_.size())
+	{
+		misrouted_.store(misrouted_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return;
+	}
+	books_[instrument].Clear();
+	MarkChanged(instrument);
+}
+
+void MarketDataShard::Apply(InstrumentId instrument, const MdEntry & entry)
+{
+	if(!Owns(instrument) || static_cast<size_t>(instrument) >= books_.size())
+	{
+		misrouted_.store(misrouted_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return;
+	}
+
+	if(FIX::MDEntryType_BID == entry.type || FIX::MDEntryType_OFFER == entry.type)
+	{
+		if(books_[instrument].Apply(entry))
+			MarkChanged(instrument);
+	}
+	else
+	{
+		PendingEntry pending = { instrument, entry };
+		entries_.push_back(pending);
+	}
+}
+
+void MarketDataShard::MarkChanged(InstrumentId instrument)
+{
+	if(changed_[instrument]) return;
+	changed_[instrument] = 1;
+	changedBooks_.push_back(instrument);
+}
+
+// The whole message goes out at once, so the strategy thread only ever
+// waits a few stores for the rest of a message it has started on.
+void MarketDataShard::EndOfMessage(int64_t timeNs)
+{
+	if(changedBooks_.empty() && entries_.empty()) return;
+
+	const uint64_t tsc = ReadTsc();
+	const uint64_t fromAppTsc = PROBE_FROMAPP_STAMP();
+	for(size_t i = 0; i < entries_.size(); ++i)
+	{
+		ShardUpdate & update = Claim();
+		update.tsc = tsc;
+		update.fromAppTsc = fromAppTsc;
+		update.type = SHARD_ENTRY;
+		update.instrument = entries_[i].instrument;
+		update.timeNs = timeNs;
+		update.entry = entries_[i].entry;
+		ring_.Publish();
+	}
+	entries_.clear();
+
+	for(size_t i = 0; i < changedBooks_.size(); ++i)
+	{
+		const InstrumentId instrument = changedBooks_[i];
+		changed_[instrument] = 0;
+		ShardUpdate & update = Claim();
+		update.tsc = tsc;
+		update.fromAppTsc = fromAppTsc;
+		update.type = SHARD_BOOK;
+		update.instrument = instrument;
+		update.timeNs = timeNs;
+		update.book = books_[instrument];
+		ring_.Publish();
+	}
+	changedBooks_.clear();
+
+	ShardUpdate & end = Claim();
+	end.tsc = tsc;
+	end.fromAppTsc = fromAppTsc;
+	end.type = SHARD_END;
+	end.instrument = INVALID_INSTRUMENT;
+	end.timeNs = timeNs;
+	ring_.Publish();
+
+	messages_.store(messages_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// The next slot to fill, waiting while the ring is full.
+ShardUpdate & MarketDataShard::Claim()
+{
+	ShardUpdate* slot = ring_.TryClaim();
+	if(!slot)
+	{
+		fullWaits_.fetch_add(1, std::memory_order_relaxed);
+		while(!(slot = ring_.TryClaim()))
+			CpuRelax();
+	}
+	return *slot;
+}
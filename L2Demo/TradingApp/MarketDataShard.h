@@ -0,0 +1,132 @@
+#ifndef MARKET_DATA_SHARD_H
+#define MARKET_DATA_SHARD_H
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <quickfix/SessionID.h>
+#include "SpscRing.h"
+#include "OrderBook.h"
+#include "InstrumentRegistry.h"
+#include "SubscriptionManager.h"
+#include "LatencyHistogram.h"
+#include "Platform.h"
+
+enum ShardUpdateType
+{
+	SHARD_ENTRY,            // `entry` is a trade or other non-book entry, in feed order
+	SHARD_BOOK,             // `book` is the instrument's book after the message
+	SHARD_END               // end of one market data message
+};
+
+/// What a MarketDataShard hands to the strategy thread.
+struct ShardUpdate
+{
+	uint64_t tsc;           // when the message was published
+	uint64_t fromAppTsc;    // latency probe stamp, see LatencyProbes.h
+	int type;               // ShardUpdateType
+	InstrumentId instrument;
+	int64_t timeNs;         // when the message arrived, see Simple::EventTimeNs()
+	MdEntry entry;
+	OrderBook book;
+};
+
+/// One of several market data sessions, and the instruments it carries:
+/// those whose id modulo the number of shards is its index.
+///
+/// The session's own QuickFIX thread (a ThreadedSocketInitiator reads each
+/// session on one) parses its messages and applies them to the shard's
+/// books, which no other thread touches.  At the end of each message the
+/// books it changed are copied whole, after the trades it carried, into a
+/// single-producer/single-consumer ring, and an end marker closes the
+/// message.  The strategy thread (see EventPipeline) takes whole messages
+/// from every shard in the order they were published, so what the Strategy
+/// sees of each shard is always as of a message boundary, and no book is
+/// shared between threads.
+///
+/// Each shard has its own subscriptions, sent on its session.
+class MarketDataShard
+{
+public:
+	/// Shard `index` of `count`, for `session`.  Books are preallocated for
+	/// `maxInstruments` ids; `ringSize` must be a power of two.
+	MarketDataShard(int index, int count, const FIX::SessionID & session, InstrumentRegistry & instruments, IdService & ids,
+		size_t maxInstruments, size_t ringSize);
+
+	int Index() const { return index_; }
+	const FIX::SessionID & Session() const { return session_; }
+	bool Owns(InstrumentId instrument) const { return instrument >= 0 && instrument % count_ == index_; }
+	SubscriptionManager & Subscriptions() { return subscriptions_; }
+
+	/// Before the instrument's subscription is sent, from any thread.
+	/// Throws std::runtime_error past `maxInstruments`.
+	void SetDepth(InstrumentId instrument, int depth);
+
+	/// Session thread: build one message's books, then publish them.
+	/// Instruments the shard does not own are counted and dropped.
+	void ClearBook(InstrumentId instrument);
+	void Apply(InstrumentId instrument, const MdEntry & entry);
+	void EndOfMessage(int64_t timeNs);
+
+	/// Strategy thread: the oldest unread record, or nullptr; then Pop() it.
+	const ShardUpdate* Head()
+	{
+		size_t count = 0;
+		const ShardUpdate* update = ring_.Peek(1, count);
+		return count ? update : nullptr;
+	}
+	void Pop() { ring_.Release(1); }
+	size_t Depth() const { return ring_.Size(); }
+
+	// Statistics
+	uint64_t Messages() const { return messages_.load(std::memory_order_relaxed); }
+	uint64_t Misrouted() const { return misrouted_.load(std::memory_order_relaxed); }
+	uint64_t FullWaits() const { return fullWaits_.load(std::memory_order_relaxed); }
+	const LatencyHistogram & Latency() const { return latency_; }
+	uint64_t MaxDepth() const { return maxDepth_.load(std::memory_order_relaxed); }
+
+	/// Strategy thread: time a record spent queued, and the backlog behind it.
+	void RecordQueued(uint64_t ticks, uint64_t depth)
+	{
+		latency_.Record(ticks);
+		if(depth > maxDepth_.load(std::memory_order_relaxed))
+			maxDepth_.store(depth, std::memory_order_relaxed);
+	}
+
+private:
+	MarketDataShard(const MarketDataShard&) = delete;
+	MarketDataShard& operator=(const MarketDataShard&) = delete;
+
+	/// A non-book entry waiting for the end of its message.
+	struct PendingEntry
+	{
+		InstrumentId instrument;
+		MdEntry entry;
+	};
+
+	ShardUpdate & Claim();
+	void MarkChanged(InstrumentId instrument);
+
+	const int index_;
+	const int count_;
+	const FIX::SessionID session_;
+	SubscriptionManager subscriptions_;
+
+	// Session thread only
+	std::vector<OrderBook, CacheLineAllocator<OrderBook> > books_;     // indexed by InstrumentId, never resized
+	std::vector<char> changed_;
+	std::vector<InstrumentId> changedBooks_;
+	std::vector<PendingEntry> entries_;
+
+	SpscRing<ShardUpdate> ring_;
+
+	std::atomic<uint64_t> messages_;
+	std::atomic<uint64_t> misrouted_;
+	std::atomic<uint64_t> fullWaits_;
+
+	// Written by the strategy thread
+	LatencyHistogram latency_;
+	std::atomic<uint64_t> maxDepth_;
+};
+
+#endif
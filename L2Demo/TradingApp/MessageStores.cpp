@@ -0,0 +1,181 @@
+#include "MessageStores.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+static const char STORE_MAGIC[8] = "L2MSTOR";
+static const uint32_t STORE_VERSION = 1;
+
+// Slot defaults for MappedStore: 16384 messages of up to 1 KB each.
+static const int DEFAULT_SLOT_COUNT = 16384;
+static const int DEFAULT_SLOT_SIZE = 1024;
+
+// Each slot starts with the sequence number it holds and the message length.
+struct SlotHeader
+{
+	int32_t msgSeqNum;
+	uint32_t length;
+};
+
+MappedStore::MappedStore(const std::string & path, uint64_t slotCount, uint32_t slotSize)
+{
+	if(slotCount == 0 || slotSize <= sizeof(SlotHeader))
+		throw std::invalid_argument("[MappedStore] slots must be able to hold a message");
+
+	file_.Open(path, sizeof(MappedStoreHeader) + slotCount * slotSize);
+
+	MappedStoreHeader* header = Header();
+	if(header->version == 0)
+	{
+		std::memcpy(header->magic, STORE_MAGIC, sizeof(header->magic));
+		header->version = STORE_VERSION;
+		header->slotSize = slotSize;
+		header->slotCount = slotCount;
+		reset();
+	}
+	else if(std::memcmp(header->magic, STORE_MAGIC, sizeof(header->magic)) != 0)
+	{
+		throw std::runtime_error("[MappedStore] " + path + " is not a message store");
+	}
+	else if(header->slotSize != slotSize || header->slotCount != slotCount)
+	{
+		// Keep the layout the file was created with; only the sequence numbers matter across restarts.
+		if(file_.Size() < sizeof(MappedStoreHeader) + header->slotCount * header->slotSize)
+			throw std::runtime_error("[MappedStore] " + path + " is truncated");
+		std::cout << "[MappedStore] " << path << " keeps its existing " << header->slotCount << " slots of "
+			<< header->slotSize << " bytes" << std::endl;
+	}
+}
+
+char* MappedStore::Slot(int msgSeqNum) const
+{
+	const MappedStoreHeader* header = Header();
+	return file_.Data() + sizeof(MappedStoreHeader) + (static_cast<uint64_t>(msgSeqNum) % header->slotCount) * header->slotSize;
+}
+
+bool MappedStore::set(int msgSeqNum, const std::string & message) throw(FIX::IOException)
+{
+	char* slot = Slot(msgSeqNum);
+	SlotHeader* slotHeader = reinterpret_cast<SlotHeader*>(slot);
+
+	// Too long for a slot: remember only that the slot no longer holds its old message.
+	if(message.size() > Header()->slotSize - sizeof(SlotHeader))
+	{
+		slotHeader->msgSeqNum = 0;
+		return true;
+	}
+
+	std::memcpy(slot + sizeof(SlotHeader), message.data(), message.size());
+	slotHeader->length = static_cast<uint32_t>(message.size());
+	slotHeader->msgSeqNum = msgSeqNum;
+	return true;
+}
+
+void MappedStore::get(int begin, int end, std::vector<std::string> & messages) const throw(FIX::IOException)
+{
+	messages.clear();
+
+	// Only the last slotCount messages sent can still be here:
+	const MappedStoreHeader* header = Header();
+	const int64_t oldest = static_cast<int64_t>(header->nextSenderMsgSeqNum) - static_cast<int64_t>(header->slotCount);
+	if(begin < oldest) begin = static_cast<int>(oldest);
+	if(end >= header->nextSenderMsgSeqNum) end = header->nextSenderMsgSeqNum - 1;
+	if(begin < 1) begin = 1;
+
+	for(int msgSeqNum = begin; msgSeqNum <= end; ++msgSeqNum)
+	{
+		const char* slot = Slot(msgSeqNum);
+		const SlotHeader* slotHeader = reinterpret_cast<const SlotHeader*>(slot);
+		if(slotHeader->msgSeqNum == msgSeqNum)
+			messages.push_back(std::string(slot + sizeof(SlotHeader), slotHeader->length));
+	}
+}
+
+int MappedStore::getNextSenderMsgSeqNum() const throw(FIX::IOException)
+{
+	return Header()->nextSenderMsgSeqNum;
+}
+
+int MappedStore::getNextTargetMsgSeqNum() const throw(FIX::IOException)
+{
+	return Header()->nextTargetMsgSeqNum;
+}
+
+void MappedStore::setNextSenderMsgSeqNum(int value) throw(FIX::IOException)
+{
+	Header()->nextSenderMsgSeqNum = value;
+}
+
+void MappedStore::setNextTargetMsgSeqNum(int value) throw(FIX::IOException)
+{
+	Header()->nextTargetMsgSeqNum = value;
+}
+
+void MappedStore::incrNextSenderMsgSeqNum() throw(FIX::IOException)
+{
+	++Header()->nextSenderMsgSeqNum;
+}
+
+void MappedStore::incrNextTargetMsgSeqNum() throw(FIX::IOException)
+{
+	++Header()->nextTargetMsgSeqNum;
+}
+
+FIX::UtcTimeStamp MappedStore::getCreationTime() const throw(FIX::IOException)
+{
+	return FIX::UtcTimeStamp(static_cast<time_t>(Header()->creationTime), Header()->creationMillisecond);
+}
+
+void MappedStore::reset() throw(FIX::IOException)
+{
+	MappedStoreHeader* header = Header();
+	header->nextSenderMsgSeqNum = 1;
+	header->nextTargetMsgSeqNum = 1;
+
+	FIX::UtcTimeStamp now;
+	header->creationTime = static_cast<int64_t>(now.getTimeT());
+	header->creationMillisecond = now.getMillisecond();
+
+	for(uint64_t i = 0; i < header->slotCount; ++i)
+		reinterpret_cast<SlotHeader*>(file_.Data() + sizeof(MappedStoreHeader) + i * header->slotSize)->msgSeqNum = 0;
+	file_.Flush();
+}
+
+// The mapping is the store; there is nothing to reload.
+void MappedStore::refresh() throw(FIX::IOException)
+{ }
+
+SessionStoreFactory::SessionStoreFactory(const FIX::SessionSettings & settings)
+	: settings_(settings),
+	  fileStores_(settings)
+{ }
+
+FIX::MessageStore* SessionStoreFactory::create(const FIX::SessionID & sessionId)
+{
+	const FIX::Dictionary & dictionary = settings_.get(sessionId);
+	const std::string type = dictionary.has("MyMessageStore") ? dictionary.getString("MyMessageStore") : "file";
+
+	if(type == "null")
+		return new NullStore;
+
+	if(type == "mapped")
+	{
+		std::string path = dictionary.has("FileStorePath") ? dictionary.getString("FileStorePath") : ".";
+		path += "/" + sessionId.getBeginString() + "-" + sessionId.getSenderCompID() + "-" + sessionId.getTargetCompID() + ".mstore";
+		int slots = dictionary.has("MyMessageStoreSlots") ? dictionary.getInt("MyMessageStoreSlots") : DEFAULT_SLOT_COUNT;
+		int slotSize = dictionary.has("MyMessageStoreSlotSize") ? dictionary.getInt("MyMessageStoreSlotSize") : DEFAULT_SLOT_SIZE;
+		return new MappedStore(path, slots, slotSize);
+	}
+
+	if(type != "file")
+		std::cout << "[SessionStoreFactory] Unknown MyMessageStore=" << type << " for " << sessionId << ", using file" << std::endl;
+	return fileStores_.create(sessionId);
+}
+
+void SessionStoreFactory::destroy(FIX::MessageStore* store)
+{
+	if(dynamic_cast<NullStore*>(store) || dynamic_cast<MappedStore*>(store))
+		delete store;
+	else
+		fileStores_.destroy(store);
+}
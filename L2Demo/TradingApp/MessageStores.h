@@ -0,0 +1,90 @@
+#ifndef MESSAGE_STORES_H
+#define MESSAGE_STORES_H
+
+#include <string>
+#include <vector>
+#include <quickfix/MessageStore.h>
+#include <quickfix/FileStore.h>
+#include <quickfix/SessionSettings.h>
+#include "MappedFile.h"
+
+/// Keeps sequence numbers in memory and throws every message away.  For
+/// sessions we never need to resend on, such as market data subscriptions.
+/// Sequence numbers start over with the process, so the session should log
+/// on with ResetOnLogon=Y.
+class NullStore : public FIX::MemoryStore
+{
+public:
+	bool set(int, const std::string &) throw(FIX::IOException) { return true; }
+	void get(int, int, std::vector<std::string> &) const throw(FIX::IOException) { }
+};
+
+/// File header of a MappedStore.
+struct MappedStoreHeader
+{
+	char magic[8];          // "L2MSTOR"
+	uint32_t version;
+	uint32_t slotSize;
+	uint64_t slotCount;
+	int32_t nextSenderMsgSeqNum;
+	int32_t nextTargetMsgSeqNum;
+	int64_t creationTime;   // time_t
+	int32_t creationMillisecond;
+	uint8_t reserved[20];
+};
+
+static_assert(sizeof(MappedStoreHeader) == 64, "MappedStoreHeader layout is part of the file format");
+
+/// A MessageStore in a preallocated memory-mapped file: the sequence numbers
+/// plus the last `slotCount` outgoing messages in fixed-size slots, so
+/// storing a message is a copy into memory rather than a file write.
+///
+/// Resend requests are answered from the slots.  Messages that have been
+/// overwritten, or were longer than a slot, are missing from get(), and
+/// QuickFIX gap-fills over them as it does for admin messages.
+class MappedStore : public FIX::MessageStore
+{
+public:
+	MappedStore(const std::string & path, uint64_t slotCount, uint32_t slotSize);
+
+	bool set(int msgSeqNum, const std::string & message) throw(FIX::IOException);
+	void get(int begin, int end, std::vector<std::string> & messages) const throw(FIX::IOException);
+
+	int getNextSenderMsgSeqNum() const throw(FIX::IOException);
+	int getNextTargetMsgSeqNum() const throw(FIX::IOException);
+	void setNextSenderMsgSeqNum(int value) throw(FIX::IOException);
+	void setNextTargetMsgSeqNum(int value) throw(FIX::IOException);
+	void incrNextSenderMsgSeqNum() throw(FIX::IOException);
+	void incrNextTargetMsgSeqNum() throw(FIX::IOException);
+
+	FIX::UtcTimeStamp getCreationTime() const throw(FIX::IOException);
+
+	void reset() throw(FIX::IOException);
+	void refresh() throw(FIX::IOException);
+
+private:
+	MappedStoreHeader* Header() const { return reinterpret_cast<MappedStoreHeader*>(file_.Data()); }
+	char* Slot(int msgSeqNum) const;
+
+	MappedFile file_;
+};
+
+/// Picks each session's MessageStore from its MyMessageStore setting:
+///   file    QuickFIX's FileStore (the default)
+///   null    NullStore
+///   mapped  MappedStore in FileStorePath, sized by MyMessageStoreSlots
+///           and MyMessageStoreSlotSize
+class SessionStoreFactory : public FIX::MessageStoreFactory
+{
+public:
+	explicit SessionStoreFactory(const FIX::SessionSettings & settings);
+
+	FIX::MessageStore* create(const FIX::SessionID & sessionId);
+	void destroy(FIX::MessageStore* store);
+
+private:
+	const FIX::SessionSettings & settings_;
+	FIX::FileStoreFactory fileStores_;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "OrderBook.h"
+
+static const char ENTRY_BID = '0';
+static const char ENTRY_OFFER = '1';
+static const char ACTION_NEW = '0';
+static const char ACTION_CHANGE = '1';
+static const char ACTION_DELETE = '2';
+
+OrderBook::OrderBook(int depth)
+	: depth_(1)
+{
+	Clear();
+	SetDepth(depth);
+}
+
+void OrderBook::SetDepth(int depth)
+{
+	if(depth < 1) depth = 1;
+	if(depth > MAX_BOOK_DEPTH) depth = MAX_BOOK_DEPTH;
+	depth_ = depth;
+	if(bids_.count > depth_) bids_.count = depth_;
+	if(offers_.count > depth_) offers_.count = depth_;
+}
+
+void OrderBook::Clear()
+{
+	for(int i = 0; i < MAX_BOOK_DEPTH; ++i)
+	{
+		bids_.px[i] = bids_.qty[i] = 0;
+		offers_.px[i] = offers_.qty[i] = 0;
+	}
+	bids_.count = 0;
+	offers_.count = 0;
+}
+
+bool OrderBook::Apply(const MdEntry & entry)
+{
+	const bool isBid = ENTRY_BID == entry.type;
+	if(!isBid && ENTRY_OFFER != entry.type) return false;
+
+	BookSide & side = isBid ? bids_ : offers_;
+	if(entry.level > 0) return ApplyByLevel(side, entry);
+	return ApplyByPrice(side, isBid, entry);
+}
+
+// Shift levels [index, count) down by one and write the new level at index.
+// The deepest level falls off if the side is already full.
+bool OrderBook::Insert(BookSide & side, int index, double px, double qty)
+{
+	if(index >= depth_) return false;
+	if(index > side.count) index = side.count;
+
+	int last = side.count < depth_ ? side.count : depth_ - 1;
+	for(int i = last; i > index; --i)
+	{
+		side.px[i] = side.px[i - 1];
+		side.qty[i] = side.qty[i - 1];
+	}
+	side.px[index] = px;
+	side.qty[index] = qty;
+	if(side.count < depth_) ++side.count;
+	return true;
+}
+
+// Shift levels (index, count) up by one over the removed level.
+bool OrderBook::Remove(BookSide & side, int index)
+{
+	if(index >= side.count) return false;
+
+	for(int i = index; i < side.count - 1; ++i)
+	{
+		side.px[i] = side.px[i + 1];
+		side.qty[i] = side.qty[i + 1];
+	}
+	--side.count;
+	side.px[side.count] = side.qty[side.count] = 0;
+	return true;
+}
+
+// The venue tells us which level the entry refers to.
+bool OrderBook::ApplyByLevel(BookSide & side, const MdEntry & entry)
+{
+	const int index = entry.level - 1;
+	if(index >= depth_) return false;
+
+	switch(entry.action)
+	{
+	case ACTION_NEW:
+		return Insert(side, index, entry.px, entry.qty);
+	case ACTION_CHANGE:
+		if(index >= side.count) return Insert(side, index, entry.px, entry.qty);
+		side.px[index] = entry.px;
+		side.qty[index] = entry.qty;
+		return true;
+	case ACTION_DELETE:
+		return Remove(side, index);
+	default:
+		return false;
+	}
+}
+
+// No MDPriceLevel: find the level by price, keeping bids descending and
+// offers ascending.
+bool OrderBook::ApplyByPrice(BookSide & side, bool isBid, const MdEntry & entry)
+{
+	int index = 0;
+	while(index < side.count && (isBid ? side.px[index] > entry.px : side.px[index] < entry.px))
+		++index;
+	const bool found = index < side.count && side.px[index] == entry.px;
+
+	if(ACTION_DELETE == entry.action)
+		return found && Remove(side, index);
+
+	if(ACTION_NEW != entry.action && ACTION_CHANGE != entry.action)
+		return false;
+
+	if(found)
+	{
+		side.qty[index] = entry.qty;
+		return true;
+	}
+	return Insert(side, index, entry.px, entry.qty);
+}
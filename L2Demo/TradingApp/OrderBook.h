@@ -0,0 +1,68 @@
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include "Platform.h"
+
+/// Deepest book we keep per side.  The depth actually used is chosen per
+/// book (see OrderBook::SetDepth) and is usually much smaller.
+const int MAX_BOOK_DEPTH = 16;
+
+/// One entry of a market data refresh, decoded from the FIX repeating group.
+struct MdEntry
+{
+	char type;      // FIX::MDEntryType_BID / _OFFER / _TRADE
+	char action;    // FIX::MDUpdateAction_NEW / _CHANGE / _DELETE
+	int level;      // 1-based MDPriceLevel, 0 when the venue did not send one
+	double px;
+	double qty;
+};
+
+/// One side of the book: prices and sizes in flat arrays, best level first.
+struct alignas(CACHE_LINE_SIZE) BookSide
+{
+	double px[MAX_BOOK_DEPTH];
+	double qty[MAX_BOOK_DEPTH];
+	int count;
+};
+
+/// Aggregated price-level book for one instrument.  Updates are applied in
+/// place by shifting levels within the arrays; nothing is allocated.
+class alignas(CACHE_LINE_SIZE) OrderBook
+{
+public:
+	explicit OrderBook(int depth = 1);
+
+	/// Change the number of levels kept per side (clamped to MAX_BOOK_DEPTH).
+	void SetDepth(int depth);
+	int Depth() const { return depth_; }
+
+	/// Drop all levels, e.g. before rebuilding from a snapshot.
+	void Clear();
+
+	/// Apply one NEW/CHANGE/DELETE bid or offer entry.  Returns true if the
+	/// visible book changed.
+	bool Apply(const MdEntry & entry);
+
+	int BidLevels() const { return bids_.count; }
+	int OfferLevels() const { return offers_.count; }
+	double BidPx(int level) const { return bids_.px[level]; }
+	double BidQty(int level) const { return bids_.qty[level]; }
+	double OfferPx(int level) const { return offers_.px[level]; }
+	double OfferQty(int level) const { return offers_.qty[level]; }
+
+	bool HasBid() const { return bids_.count > 0; }
+	bool HasOffer() const { return offers_.count > 0; }
+
+private:
+	bool Insert(BookSide & side, int index, double px, double qty);
+	bool Remove(BookSide & side, int index);
+	bool ApplyByLevel(BookSide & side, const MdEntry & entry);
+	bool ApplyByPrice(BookSide & side, bool isBid, const MdEntry & entry);
+
+private:
+	BookSide bids_;
+	BookSide offers_;
+	int depth_;
+};
+
+#endif
@@ -0,0 +1,345 @@
+#include "OrderManager.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+// Empty hash bucket / order not found
+static const uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+static uint64_t HashClOrdId(const char* s, size_t size)
+{
+	uint64_t h = FNV_OFFSET;
+	for(size_t i = 0; i < size; ++i)
+	{
+		h ^= static_cast<unsigned char>(s[i]);
+		h *= FNV_PRIME;
+	}
+	return h;
+}
+
+const char* OrderStateName(OrderState state)
+{
+	switch(state)
+	{
+	case ORDER_PENDING_NEW: return "PENDING_NEW";
+	case ORDER_ACKED: return "ACKED";
+	case ORDER_PARTIALLY_FILLED: return "PARTIALLY_FILLED";
+	case ORDER_FILLED: return "FILLED";
+	case ORDER_REJECTED: return "REJECTED";
+	case ORDER_CANCELED: return "CANCELED";
+	case ORDER_PENDING_REPLACE: return "PENDING_REPLACE";
+	case ORDER_REPLACED: return "REPLACED";
+	default: return "UNKNOWN";
+	}
+}
+
+OrderManager::OrderManager(size_t capacity)
+	: slab_(capacity ? capacity : 1),
+	  mask_(0),
+	  live_(0),
+	  trackChanges_(false)
+{
+	// At most half full, so probe sequences stay short:
+	size_t buckets = 2;
+	while(buckets < 2 * slab_.size()) buckets <<= 1;
+	table_.assign(buckets, NO_SLOT);
+	mask_ = buckets - 1;
+
+	free_.reserve(slab_.size());
+	for(size_t i = slab_.size(); i-- > 0; )
+		free_.push_back(static_cast<uint32_t>(i));
+
+	// A call changes a handful of records at most:
+	changedOrders_.reserve(64);
+	changedPositions_.reserve(64);
+}
+
+void OrderManager::AddInstrument(InstrumentId instrument)
+{
+	if(static_cast<size_t>(instrument) >= positions_.size())
+	{
+		Position flat = { 0, 0, 0, 0, 0, 0, 0, 0 };
+		positions_.resize(instrument + 1, flat);
+	}
+}
+
+uint32_t OrderManager::Allocate()
+{
+	if(free_.empty()) Reclaim();
+	if(free_.empty()) throw std::runtime_error("[OrderManager] every order slot holds a live order");
+
+	uint32_t slot = free_.back();
+	free_.pop_back();
+	return slot;
+}
+
+// Free the slots of finished orders and rebuild the hash from the live ones.
+// Only runs once the free list is empty, so every slot holds a real order.
+void OrderManager::Reclaim()
+{
+	table_.assign(table_.size(), NO_SLOT);
+	for(uint32_t slot = 0; slot < slab_.size(); ++slot)
+	{
+		if(slab_[slot].IsTerminal()) free_.push_back(slot);
+		else Insert(slot);
+	}
+}
+
+void OrderManager::RestoreOrder(uint32_t slot, const Order& order)
+{
+	if(slot >= slab_.size()) throw std::runtime_error("[OrderManager] restored order slot out of range");
+	slab_[slot] = order;
+}
+
+void OrderManager::RestorePosition(InstrumentId instrument, const Position& position)
+{
+	AddInstrument(instrument);
+	positions_[instrument] = position;
+}
+
+// Finished orders stay findable, as they would have before the restart.
+void OrderManager::Rebuild()
+{
+	free_.clear();
+	table_.assign(table_.size(), NO_SLOT);
+	live_ = 0;
+	for(size_t i = slab_.size(); i-- > 0; )
+	{
+		const uint32_t slot = static_cast<uint32_t>(i);
+		if(slab_[slot].clOrdIdSize == 0)
+		{
+			free_.push_back(slot);
+			continue;
+		}
+		Insert(slot);
+		if(!slab_[slot].IsTerminal()) ++live_;
+	}
+}
+
+void OrderManager::Insert(uint32_t slot)
+{
+	const Order& order = slab_[slot];
+	uint64_t bucket = HashClOrdId(order.clOrdId, order.clOrdIdSize) & mask_;
+	while(table_[bucket] != NO_SLOT)
+		bucket = (bucket + 1) & mask_;
+	table_[bucket] = slot;
+}
+
+uint32_t OrderManager::Lookup(const char* clOrdId, size_t size) const
+{
+	for(uint64_t bucket = HashClOrdId(clOrdId, size) & mask_; table_[bucket] != NO_SLOT; bucket = (bucket + 1) & mask_)
+	{
+		const Order& order = slab_[table_[bucket]];
+		if(order.clOrdIdSize == size && std::memcmp(order.clOrdId, clOrdId, size) == 0)
+			return table_[bucket];
+	}
+	return NO_SLOT;
+}
+
+const Order* OrderManager::Find(const char* clOrdId, size_t size) const
+{
+	uint32_t slot = Lookup(clOrdId, size);
+	return slot == NO_SLOT ? nullptr : &slab_[slot];
+}
+
+Order* OrderManager::FindMutable(const string & clOrdId)
+{
+	uint32_t slot = clOrdId.empty() ? NO_SLOT : Lookup(clOrdId.data(), clOrdId.size());
+	return slot == NO_SLOT ? nullptr : &slab_[slot];
+}
+
+const Order& OrderManager::OnNewOrder(const char* clOrdId, InstrumentId instrument, char side, char ordType, double qty, double px, int account)
+{
+	Order& order = Create(clOrdId, instrument, side, ordType, qty, px, ORDER_PENDING_NEW, account);
+	AddWorking(order, qty);
+	return order;
+}
+
+void OrderManager::OnReplaceRequested(const char* clOrdId, const string & origClOrdId, double qty, double px)
+{
+	const Order* orig = FindMutable(origClOrdId);
+	if(!orig) return;
+
+	// Not working until the exchange confirms the replace.  Copy what we need
+	// first: Create() may reclaim finished orders' slots.
+	const InstrumentId instrument = orig->instrument;
+	const char side = orig->side;
+	const int account = orig->account;
+	Create(clOrdId, instrument, side, '2', qty, px, ORDER_PENDING_REPLACE, account);
+}
+
+Order& OrderManager::Create(const char* clOrdId, InstrumentId instrument, char side, char ordType, double qty, double px, OrderState state, int account)
+{
+	const size_t size = std::strlen(clOrdId);
+	if(size >= sizeof(Order().clOrdId)) throw std::runtime_error(string("[OrderManager] ClOrdID too long: ") + clOrdId);
+
+	uint32_t slot = Allocate();
+	Order& order = slab_[slot];
+	std::memcpy(order.clOrdId, clOrdId, size + 1);
+	order.clOrdIdSize = static_cast<uint8_t>(size);
+	order.side = side;
+	order.ordType = ordType;
+	order.cancelPending = false;
+	order.account = static_cast<uint16_t>(account);
+	order.state = state;
+	order.instrument = instrument;
+	order.orderQty = qty;
+	order.px = px;
+	order.cumQty = 0;
+	order.avgPx = 0;
+	Insert(slot);
+	++live_;
+	Changed(order);
+	return order;
+}
+
+void OrderManager::OnCancelRequested(const string & origClOrdId)
+{
+	Order* order = FindMutable(origClOrdId);
+	if(order && !order->IsTerminal())
+	{
+		order->cancelPending = true;
+		Changed(*order);
+	}
+}
+
+const Order* OrderManager::OnExecutionReport(const string & clOrdId, const string & origClOrdId, InstrumentId instrument,
+	char side, char execType, double lastQty, double lastPx)
+{
+	// FIX ExecType values
+	const char NEW = '0', PARTIAL_FILL = '1', FILL = '2', CANCELED = '4', REPLACE = '5', REJECTED = '8';
+
+	if(CANCELED == execType)
+	{
+		// ClOrdID is the cancel request's; the order is OrigClOrdID.
+		Order* order = FindMutable(origClOrdId);
+		if(!order) order = FindMutable(clOrdId);
+		if(order && !order->IsTerminal()) Finish(*order, ORDER_CANCELED);
+		return order;
+	}
+
+	Order* order = FindMutable(clOrdId);
+
+	if(REPLACE == execType)
+	{
+		Order* orig = FindMutable(origClOrdId);
+		if(order && orig)
+		{
+			// The replacement takes over what the original had done so far.
+			order->cumQty = orig->cumQty;
+			order->avgPx = orig->avgPx;
+			order->state = order->cumQty > 0 ? ORDER_PARTIALLY_FILLED : ORDER_ACKED;
+			if(!orig->IsTerminal()) Finish(*orig, ORDER_REPLACED);
+			AddWorking(*order, order->LeavesQty());
+			Changed(*order);
+		}
+		return order;
+	}
+
+	if(PARTIAL_FILL == execType || FILL == execType)
+	{
+		if(order) Fill(*order, lastQty, lastPx);
+		else if(instrument != INVALID_INSTRUMENT) ApplyFill(instrument, side, lastQty, lastPx);
+		return order;
+	}
+
+	if(!order) return nullptr;
+
+	if(NEW == execType)
+	{
+		if(ORDER_PENDING_NEW == order->state)
+		{
+			order->state = ORDER_ACKED;
+			Changed(*order);
+		}
+	}
+	else if(REJECTED == execType)
+	{
+		if(!order->IsTerminal()) Finish(*order, ORDER_REJECTED);
+	}
+	return order;
+}
+
+void OrderManager::OnCancelReject(const string & clOrdId, const string & origClOrdId)
+{
+	Order* orig = FindMutable(origClOrdId);
+	if(orig)
+	{
+		orig->cancelPending = false;
+		Changed(*orig);
+	}
+
+	// A refused cancel/replace leaves the original working as it was:
+	Order* replacement = FindMutable(clOrdId);
+	if(replacement && ORDER_PENDING_REPLACE == replacement->state)
+		Finish(*replacement, ORDER_REJECTED);
+}
+
+void OrderManager::Fill(Order& order, double qty, double px)
+{
+	if(order.IsTerminal() || qty <= 0) return;
+
+	const double cum = order.cumQty + qty;
+	order.avgPx = (order.avgPx * order.cumQty + px * qty) / cum;
+	order.cumQty = cum;
+	AddWorking(order, -qty);
+	ApplyFill(order.instrument, order.side, qty, px);
+
+	if(order.cumQty >= order.orderQty)
+	{
+		order.state = ORDER_FILLED;
+		--live_;
+	}
+	else
+	{
+		order.state = ORDER_PARTIALLY_FILLED;
+	}
+	Changed(order);
+}
+
+void OrderManager::Finish(Order& order, OrderState state)
+{
+	if(ORDER_PENDING_REPLACE != order.state)
+		AddWorking(order, -order.LeavesQty());
+	order.state = state;
+	order.cancelPending = false;
+	--live_;
+	Changed(order);
+}
+
+void OrderManager::AddWorking(const Order& order, double qty)
+{
+	Position& position = positions_[order.instrument];
+	if('1' == order.side) position.workingBuyQty += qty;
+	else position.workingSellQty += qty;
+	Changed(order.instrument);
+}
+
+// Average-cost position keeping: fills that add to the position move the
+// average cost, fills against it realize PnL, and a fill through zero
+// opens the remainder at the fill price.
+void OrderManager::ApplyFill(InstrumentId instrument, char side, double qty, double px)
+{
+	Position& position = positions_[instrument];
+	Changed(instrument);
+	const double signedQty = '1' == side ? qty : -qty;
+	if('1' == side) position.boughtQty += qty;
+	else position.soldQty += qty;
+
+	const double net = position.netQty;
+	if(net == 0 || (net > 0) == (signedQty > 0))
+	{
+		position.avgCost = (position.avgCost * net + px * signedQty) / (net + signedQty);
+		position.netQty = net + signedQty;
+		return;
+	}
+
+	const double closing = std::min(qty, net > 0 ? net : -net);
+	position.realizedPnl += closing * (px - position.avgCost) * (net > 0 ? 1 : -1);
+	position.netQty = net + signedQty;
+	if(position.netQty == 0) position.avgCost = 0;
+	else if((position.netQty > 0) != (net > 0)) position.avgCost = px;
+}
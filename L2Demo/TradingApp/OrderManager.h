@@ -0,0 +1,157 @@
+#ifndef ORDER_MANAGER_H
+#define ORDER_MANAGER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "InstrumentRegistry.h"
+
+using std::string;
+
+/// Where an order is in its life.  PENDING_REPLACE is the new ClOrdID of a
+/// cancel/replace the exchange has not confirmed yet; once it does, the
+/// original order becomes REPLACED and the new one carries on.
+enum OrderState
+{
+	ORDER_PENDING_NEW,
+	ORDER_ACKED,
+	ORDER_PARTIALLY_FILLED,
+	ORDER_FILLED,
+	ORDER_REJECTED,
+	ORDER_CANCELED,
+	ORDER_PENDING_REPLACE,
+	ORDER_REPLACED
+};
+
+const char* OrderStateName(OrderState state);
+
+/// One order as the OrderManager tracks it.  `side` is the FIX Side value.
+struct Order
+{
+	char clOrdId[24];
+	uint8_t clOrdIdSize;
+	char side;
+	char ordType;
+	bool cancelPending;
+	uint16_t account;       // the caller's index for the account, e.g. RiskGate::Account()
+	OrderState state;
+	InstrumentId instrument;
+	double orderQty;
+	double px;
+	double cumQty;
+	double avgPx;
+
+	double LeavesQty() const { return IsTerminal() ? 0 : orderQty - cumQty; }
+	bool IsTerminal() const { return state == ORDER_FILLED || state == ORDER_REJECTED || state == ORDER_CANCELED || state == ORDER_REPLACED; }
+};
+
+/// Net position and PnL for one instrument, kept up to date on every fill.
+/// PnL is in price points times quantity; multiply by the contract's point
+/// value for money.
+struct Position
+{
+	double netQty;          // long > 0, short < 0
+	double avgCost;         // average price of the open position
+	double realizedPnl;
+	double markPx;          // last trade price
+	double boughtQty;
+	double soldQty;
+	double workingBuyQty;   // leaves quantity of live buy orders
+	double workingSellQty;
+
+	double UnrealizedPnl() const { return netQty * (markPx - avgCost); }
+	double TotalPnl() const { return realizedPnl + UnrealizedPnl(); }
+};
+
+/// Tracks every order we send and the positions they build.
+///
+/// Orders live in a slab allocated up front and are found by ClOrdID through
+/// an open-addressing hash, so nothing on the execution path allocates or
+/// walks a container.  Finished orders stay queryable until the slab fills
+/// up; their slots are then reclaimed in one pass, so hold on to an Order
+/// pointer only while the order is live.
+class OrderManager
+{
+public:
+	explicit OrderManager(size_t capacity = 1 << 16);
+
+	/// Make room for `instrument` so the execution path only indexes arrays.
+	void AddInstrument(InstrumentId instrument);
+
+	/// Record an order we are about to send.  `side` and `ordType` are FIX values.
+	const Order& OnNewOrder(const char* clOrdId, InstrumentId instrument, char side, char ordType, double qty, double px, int account = 0);
+
+	/// Record a cancel/replace we are about to send: `clOrdId` replaces `origClOrdId`.
+	void OnReplaceRequested(const char* clOrdId, const string & origClOrdId, double qty, double px);
+	void OnCancelRequested(const string & origClOrdId);
+
+	/// Apply an ExecutionReport.  Fills of orders we do not know still move
+	/// the position of `instrument`.  Returns the order, or nullptr.
+	const Order* OnExecutionReport(const string & clOrdId, const string & origClOrdId, InstrumentId instrument,
+		char side, char execType, double lastQty, double lastPx);
+
+	/// The exchange refused a cancel or cancel/replace.
+	void OnCancelReject(const string & clOrdId, const string & origClOrdId);
+
+	/// Latest traded price, for unrealized PnL.
+	void Mark(InstrumentId instrument, double px) { positions_[instrument].markPx = px; }
+
+	const Order* Find(const char* clOrdId, size_t size) const;
+	const Order* Find(const string & clOrdId) const { return Find(clOrdId.data(), clOrdId.size()); }
+
+	const Position& GetPosition(InstrumentId instrument) const { return positions_[instrument]; }
+
+	size_t LiveOrders() const { return live_; }
+
+	/// Slots in the slab; an Order's slot does not change while it is tracked.
+	size_t Capacity() const { return slab_.size(); }
+	const Order& Slot(uint32_t slot) const { return slab_[slot]; }
+
+	/// With TrackChanges(true), the slots and positions each call changes
+	/// are recorded until ClearChanges(), for StateCheckpoint.  A slot or
+	/// position may be listed more than once.
+	void TrackChanges(bool track) { trackChanges_ = track; }
+	const std::vector<uint32_t>& ChangedOrders() const { return changedOrders_; }
+	const std::vector<InstrumentId>& ChangedPositions() const { return changedPositions_; }
+	void ClearChanges() { changedOrders_.clear(); changedPositions_.clear(); }
+
+	/// Put back an order or a position saved earlier, e.g. by a checkpoint,
+	/// into the same slot.  An order with an empty ClOrdID leaves its slot
+	/// free.  Call Rebuild() once everything is back.
+	void RestoreOrder(uint32_t slot, const Order& order);
+	void RestorePosition(InstrumentId instrument, const Position& position);
+
+	/// Recount the live orders and rebuild the free list and the ClOrdID hash
+	/// from the slab.
+	void Rebuild();
+
+private:
+	OrderManager(const OrderManager&) = delete;
+	OrderManager& operator=(const OrderManager&) = delete;
+
+	Order& Create(const char* clOrdId, InstrumentId instrument, char side, char ordType, double qty, double px, OrderState state, int account);
+	uint32_t Allocate();
+	void Reclaim();
+	void Insert(uint32_t slot);
+	uint32_t Lookup(const char* clOrdId, size_t size) const;
+	Order* FindMutable(const string & clOrdId);
+	void Fill(Order& order, double qty, double px);
+	void Finish(Order& order, OrderState state);
+	void ApplyFill(InstrumentId instrument, char side, double qty, double px);
+	void AddWorking(const Order& order, double qty);
+	void Changed(const Order& order) { if(trackChanges_) changedOrders_.push_back(static_cast<uint32_t>(&order - &slab_[0])); }
+	void Changed(InstrumentId instrument) { if(trackChanges_) changedPositions_.push_back(instrument); }
+
+	std::vector<Order> slab_;
+	std::vector<uint32_t> free_;        // unused slots
+	std::vector<uint32_t> table_;       // slot per hash bucket, NO_SLOT if none
+	uint64_t mask_;
+	size_t live_;
+	std::vector<Position> positions_;   // indexed by InstrumentId
+
+	bool trackChanges_;
+	std::vector<uint32_t> changedOrders_;
+	std::vector<InstrumentId> changedPositions_;
+};
+
+#endif
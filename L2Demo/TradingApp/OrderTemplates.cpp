@@ -0,0 +1,87 @@
+#include "OrderTemplates.h"
+
+OrderTemplate& OrderTemplates::Get(InstrumentId instrument, const Instrument & details, const string & account)
+{
+	if(static_cast<size_t>(instrument) >= byInstrument_.size())
+		byInstrument_.resize(instrument + 1);
+
+	std::vector<Entry>& entries = byInstrument_[instrument];
+	for(size_t i = 0; i < entries.size(); ++i)
+	{
+		if(entries[i].account == account)
+			return *entries[i].messages;
+	}
+
+	Entry entry;
+	entry.account = account;
+	entry.messages.reset(new OrderTemplate);
+	Prepare(*entry.messages, details, account);
+	entries.push_back(std::move(entry));
+	return *entries.back().messages;
+}
+
+// Everything that is the same for every order on this instrument and account.
+void OrderTemplates::Prepare(OrderTemplate & messages, const Instrument & details, const string & account)
+{
+	FIX42::NewOrderSingle& order = messages.newOrder;
+	order.set(FIX::Symbol(details.symbol));
+	order.set(FIX::MaturityMonthYear(details.maturityMonthYear));
+	order.set(FIX::Account(account));
+	order.set(FIX::TimeInForce(FIX::TimeInForce_DAY));
+	order.set(FIX::SecurityExchange(details.exchange));
+	order.set(FIX::SecurityType("FUT"));
+	order.set(FIX::CustomerOrFirm(0));
+	order.set(FIX::Rule80A('A'));
+
+	FIX42::OrderCancelRequest& cancel = messages.cancel;
+	cancel.set(FIX::Symbol(details.symbol));
+	cancel.set(FIX::MaturityMonthYear(details.maturityMonthYear));
+	cancel.set(FIX::Account(account));
+	cancel.set(FIX::SecurityExchange(details.exchange));
+	cancel.set(FIX::SecurityType("FUT"));
+
+	FIX42::OrderCancelReplaceRequest& replace = messages.replace;
+	replace.set(FIX::Symbol(details.symbol));
+	replace.set(FIX::MaturityMonthYear(details.maturityMonthYear));
+	replace.set(FIX::Account(account));
+	replace.set(FIX::HandlInst(FIX::HandlInst_AUTOMATED_EXECUTION_ORDER_PRIVATE));
+	replace.set(FIX::OrdType(FIX::OrdType_LIMIT));
+	replace.set(FIX::TimeInForce(FIX::TimeInForce_DAY));
+	replace.set(FIX::SecurityExchange(details.exchange));
+	replace.set(FIX::SecurityType("FUT"));
+	replace.set(FIX::CustomerOrFirm(0));
+}
+
+FIX42::NewOrderSingle& OrderTemplate::NewOrder(const char* clOrdId, char side, int qty, char ordType, double px)
+{
+	newOrder.set(FIX::ClOrdID(clOrdId));
+	newOrder.set(FIX::Side(side));
+	newOrder.set(FIX::OrderQty(qty));
+	newOrder.set(FIX::OrdType(ordType));
+	if(FIX::OrdType_LIMIT == ordType)
+		newOrder.set(FIX::Price(px));
+	else
+		newOrder.removeField(FIX::FIELD::Price);
+	return newOrder;
+}
+
+FIX42::OrderCancelRequest& OrderTemplate::Cancel(const char* clOrdId, const string & origClOrdId, char side, int qty)
+{
+	cancel.set(FIX::ClOrdID(clOrdId));
+	cancel.set(FIX::OrigClOrdID(origClOrdId));
+	cancel.set(FIX::Side(side));
+	cancel.set(FIX::OrderQty(qty));
+	cancel.set(FIX::TransactTime());
+	return cancel;
+}
+
+FIX42::OrderCancelReplaceRequest& OrderTemplate::Replace(const char* clOrdId, const string & origClOrdId, char side, int qty, double px)
+{
+	replace.set(FIX::ClOrdID(clOrdId));
+	replace.set(FIX::OrigClOrdID(origClOrdId));
+	replace.set(FIX::Side(side));
+	replace.set(FIX::OrderQty(qty));
+	replace.set(FIX::Price(px));
+	replace.set(FIX::TransactTime());
+	return replace;
+}
@@ -0,0 +1,53 @@
+#ifndef ORDER_TEMPLATES_H
+#define ORDER_TEMPLATES_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <quickfix/fix42/NewOrderSingle.h>
+#include <quickfix/fix42/OrderCancelRequest.h>
+#include <quickfix/fix42/OrderCancelReplaceRequest.h>
+#include "InstrumentRegistry.h"
+
+using std::string;
+
+/// The order-entry messages for one (instrument, account), with every field
+/// that never changes already set.  Sending patches the few fields that do
+/// in place and hands the same message to QuickFIX again, instead of
+/// building a new message field by field.
+///
+/// `side` and `ordType` are FIX Side and OrdType values.
+struct OrderTemplate
+{
+	FIX42::NewOrderSingle newOrder;
+	FIX42::OrderCancelRequest cancel;
+	FIX42::OrderCancelReplaceRequest replace;
+
+	/// A limit order if `ordType` is OrdType_LIMIT, a market order (no Price) otherwise.
+	FIX42::NewOrderSingle& NewOrder(const char* clOrdId, char side, int qty, char ordType, double px);
+	FIX42::OrderCancelRequest& Cancel(const char* clOrdId, const string & origClOrdId, char side, int qty);
+	/// Re-price and/or re-size a resting limit order.
+	FIX42::OrderCancelReplaceRequest& Replace(const char* clOrdId, const string & origClOrdId, char side, int qty, double px);
+};
+
+/// OrderTemplates prepared on first use, looked up by InstrumentId and account.
+class OrderTemplates
+{
+public:
+	/// The templates for `account` trading `instrument` (described by `details`).
+	OrderTemplate& Get(InstrumentId instrument, const Instrument & details, const string & account);
+
+private:
+	struct Entry
+	{
+		string account;
+		std::unique_ptr<OrderTemplate> messages;   // stays put as the vectors grow
+	};
+
+	static void Prepare(OrderTemplate & messages, const Instrument & details, const string & account);
+
+	// Indexed by InstrumentId; strategies use one or two accounts, so a scan is fine.
+	std::vector<std::vector<Entry> > byInstrument_;
+};
+
+#endif
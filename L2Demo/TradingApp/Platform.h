@@ -0,0 +1,139 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <chrono>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <malloc.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+/// Size of a cache line on the x86 machines we run on.  Used to keep
+/// producer and consumer state of the lock-free queues apart.
+#define CACHE_LINE_SIZE 64
+
+/// Thread-local storage for POD values.  VS2013 has no thread_local.
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL thread_local
+#endif
+
+/// Hint to the CPU that we are in a spin-wait loop.
+inline void CpuRelax()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#endif
+}
+
+/// Read the CPU timestamp counter.  Cheap enough to call on every message;
+/// convert ticks to time with a calibrated rate (see LatencyMonitor).
+inline unsigned long long ReadTsc()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/// TSC ticks per nanosecond, measured against the steady clock over
+/// `milliseconds`.  Slow; call once and keep the result.
+inline double MeasureTscTicksPerNs(int milliseconds = 50)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	unsigned long long tscStart = ReadTsc();
+	std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+	unsigned long long tscStop = ReadTsc();
+	std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+
+	double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+	return ns > 0 && tscStop > tscStart ? (tscStop - tscStart) / ns : 1.0;
+}
+
+/// Index of the highest set bit of a non-zero value.
+inline int MostSignificantBit(unsigned long long value)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return static_cast<int>(index);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if(_BitScanReverse(&index, static_cast<unsigned long>(value >> 32))) return static_cast<int>(index) + 32;
+	_BitScanReverse(&index, static_cast<unsigned long>(value));
+	return static_cast<int>(index);
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+/// Allocate `size` bytes aligned to `alignment` (a power of two).
+inline void* AlignedAlloc(size_t size, size_t alignment)
+{
+#if defined(_MSC_VER)
+	void* p = _aligned_malloc(size, alignment);
+#else
+	void* p = nullptr;
+	if(posix_memalign(&p, alignment, size) != 0) p = nullptr;
+#endif
+	if(!p) throw std::bad_alloc();
+	return p;
+}
+
+inline void AlignedFree(void* p)
+{
+#if defined(_MSC_VER)
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+/// Fault in and pin every page the process has mapped, and every page it
+/// maps from now on, so the hot path never takes a page fault.  Needs
+/// CAP_IPC_LOCK or a large enough RLIMIT_MEMLOCK; Windows has no process-wide
+/// equivalent.  Returns false if the memory is not locked.
+inline bool LockProcessMemory()
+{
+#if defined(_WIN32)
+	return false;
+#else
+	return mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+#endif
+}
+
+/// Allocator for containers of cache-line-aligned types such as OrderBook,
+/// which plain operator new does not align before C++17.
+template <class T>
+struct CacheLineAllocator
+{
+	typedef T value_type;
+
+	CacheLineAllocator() {}
+	template <class U> CacheLineAllocator(const CacheLineAllocator<U>&) {}
+
+	T* allocate(size_t n) { return static_cast<T*>(AlignedAlloc(n * sizeof(T), CACHE_LINE_SIZE)); }
+	void deallocate(T* p, size_t) { AlignedFree(p); }
+
+	template <class U> struct rebind { typedef CacheLineAllocator<U> other; };
+};
+
+template <class T, class U>
+bool operator==(const CacheLineAllocator<T>&, const CacheLineAllocator<U>&) { return true; }
+
+template <class T, class U>
+bool operator!=(const CacheLineAllocator<T>&, const CacheLineAllocator<U>&) { return false; }
+
+#endif
@@ -0,0 +1,60 @@
+#include "RawMessageLog.h"
+
+static THREAD_LOCAL RawMessage currentRawMessage = { nullptr, 0 };
+
+RawMessage & CurrentRawMessage()
+{
+	return currentRawMessage;
+}
+
+RawMessageLog::RawMessageLog(FIX::Log* inner)
+	: inner_(inner)
+{ }
+
+void RawMessageLog::clear()
+{
+	if(inner_) inner_->clear();
+}
+
+void RawMessageLog::backup()
+{
+	if(inner_) inner_->backup();
+}
+
+void RawMessageLog::onIncoming(const std::string& value)
+{
+	currentRawMessage.data = value.data();
+	currentRawMessage.size = value.size();
+	if(inner_) inner_->onIncoming(value);
+}
+
+void RawMessageLog::onOutgoing(const std::string& value)
+{
+	if(inner_) inner_->onOutgoing(value);
+}
+
+void RawMessageLog::onEvent(const std::string& value)
+{
+	if(inner_) inner_->onEvent(value);
+}
+
+RawMessageLogFactory::RawMessageLogFactory(FIX::LogFactory& inner)
+	: inner_(inner)
+{ }
+
+FIX::Log* RawMessageLogFactory::create()
+{
+	return new RawMessageLog(inner_.create());
+}
+
+FIX::Log* RawMessageLogFactory::create(const FIX::SessionID& sessionId)
+{
+	return new RawMessageLog(inner_.create(sessionId));
+}
+
+void RawMessageLogFactory::destroy(FIX::Log* log)
+{
+	RawMessageLog* raw = static_cast<RawMessageLog*>(log);
+	if(raw->Inner()) inner_.destroy(raw->Inner());
+	delete raw;
+}
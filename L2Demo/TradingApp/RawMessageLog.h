@@ -0,0 +1,54 @@
+#ifndef RAW_MESSAGE_LOG_H
+#define RAW_MESSAGE_LOG_H
+
+#include <string>
+#include <quickfix/Log.h>
+#include "Platform.h"
+
+/// The raw text of the message QuickFIX is currently processing on this
+/// thread, or null.  QuickFIX logs every inbound message through
+/// Log::onIncoming right before parsing it and calling Application::fromApp
+/// on the same thread, so fromApp can look at the original buffer here.
+struct RawMessage
+{
+	const char* data;
+	size_t size;
+};
+
+/// Per-thread slot filled by RawMessageLog.
+RawMessage & CurrentRawMessage();
+
+/// Log decorator that records the raw inbound message before forwarding
+/// every call to the wrapped log.
+class RawMessageLog : public FIX::Log
+{
+public:
+	explicit RawMessageLog(FIX::Log* inner);
+
+	void clear();
+	void backup();
+	void onIncoming(const std::string& value);
+	void onOutgoing(const std::string& value);
+	void onEvent(const std::string& value);
+
+	FIX::Log* Inner() const { return inner_; }
+
+private:
+	FIX::Log* inner_;
+};
+
+/// Wraps the logs created by another factory in RawMessageLogs.
+class RawMessageLogFactory : public FIX::LogFactory
+{
+public:
+	explicit RawMessageLogFactory(FIX::LogFactory& inner);
+
+	FIX::Log* create();
+	FIX::Log* create(const FIX::SessionID&);
+	void destroy(FIX::Log*);
+
+private:
+	FIX::LogFactory& inner_;
+};
+
+#endif
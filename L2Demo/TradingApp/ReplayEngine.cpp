@@ -0,0 +1,191 @@
+#include "ReplayEngine.h"
+#include <fstream>
+#include <thread>
+#include <cstring>
+#include <stdexcept>
+#include "TickJournal.h"
+#include "FastMdParser.h"
+#include "TickStore.h"
+
+static const int64_t NS_PER_SECOND = 1000000000LL;
+
+// MDEntryType of each TickType.
+static const char MD_ENTRY_TYPES[] = { '0', '1', '2' };
+
+static int Digits(const char* p, int n)
+{
+	int value = 0;
+	for(int i = 0; i < n; ++i) value = value * 10 + (p[i] - '0');
+	return value;
+}
+
+// "YYYYMMDD-HH:MM:SS[.sss]" as written by FIX::FileLog, or -1.
+static int64_t ParseLogTimestamp(const std::string & line)
+{
+	if(line.size() < 17 || line[8] != '-' || line[11] != ':' || line[14] != ':') return -1;
+	const char* p = line.c_str();
+	int64_t days = TickStore::DaysFromCivil(Digits(p, 4), Digits(p + 4, 2), Digits(p + 6, 2));
+	int64_t seconds = days * 86400 + Digits(p + 9, 2) * 3600 + Digits(p + 12, 2) * 60 + Digits(p + 15, 2);
+	int64_t ns = seconds * NS_PER_SECOND;
+	if(line.size() >= 21 && line[17] == '.') ns += Digits(p + 18, 3) * 1000000LL;
+	return ns;
+}
+
+ReplayEngine::ReplayEngine(Simple & simple, double speed)
+	: simple_(simple),
+	  speed_(speed),
+	  events_(0),
+	  elapsedSeconds_(0),
+	  firstTimeNs_(-1)
+{ }
+
+void ReplayEngine::Start()
+{
+	firstTimeNs_ = -1;
+	runStart_ = std::chrono::steady_clock::now();
+}
+
+void ReplayEngine::Stop()
+{
+	elapsedSeconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart_).count();
+}
+
+void ReplayEngine::Pace(int64_t timeNs)
+{
+	if(speed_ <= 0) return;
+
+	if(firstTimeNs_ < 0)
+	{
+		firstTimeNs_ = timeNs;
+		wallStart_ = std::chrono::steady_clock::now();
+		return;
+	}
+
+	std::chrono::nanoseconds offset(static_cast<long long>((timeNs - firstTimeNs_) / speed_));
+	std::this_thread::sleep_until(wallStart_ + offset);
+}
+
+// Text files and journals only hold the top of the book, so each record
+// replaces level 1 of its side.  Strategy writes a zero price and size for an
+// empty side, which we turn back into a delete.
+void ReplayEngine::ApplyTick(InstrumentId instrument, int64_t timeNs, char type, double qty, double px)
+{
+	Pace(timeNs);
+
+	MdEntry entry;
+	entry.type = type;
+	entry.px = px;
+	entry.qty = qty;
+	if('2' == type)
+	{
+		entry.action = '0';
+		entry.level = 0;
+	}
+	else
+	{
+		entry.action = 0 == px && 0 == qty ? '2' : '1';
+		entry.level = 1;
+	}
+
+	simple_.SetReplayTime(timeNs);
+	simple_.ApplyMarketData(instrument, &entry, 1);
+	++events_;
+}
+
+uint64_t ReplayEngine::ReplayTextFile(const string & path, InstrumentId instrument)
+{
+	std::ifstream file(path.c_str());
+	if(!file) throw std::runtime_error("[replay] cannot open " + path);
+
+	const uint64_t before = events_;
+	Start();
+
+	std::string line;
+	TickRecord r;
+	while(std::getline(file, line))
+	{
+		if(ParseTextTick(line, r))
+			ApplyTick(instrument, r.time * NS_PER_SECOND, MD_ENTRY_TYPES[r.type], r.qty, r.px);
+	}
+
+	Stop();
+	return events_ - before;
+}
+
+uint64_t ReplayEngine::ReplayTickJournal(const string & path, InstrumentId instrument)
+{
+	TickJournalReader reader(path);
+
+	const uint64_t before = events_;
+	Start();
+
+	for(uint64_t i = 0; i < reader.Count(); ++i)
+	{
+		const TickRecord & r = reader[i];
+		if(r.type > TICK_TRADE) continue;
+		ApplyTick(instrument, r.time * NS_PER_SECOND, MD_ENTRY_TYPES[r.type], r.qty, r.px);
+	}
+
+	Stop();
+	return events_ - before;
+}
+
+uint64_t ReplayEngine::ReplayFixLog(const string & path)
+{
+	std::ifstream file(path.c_str());
+	if(!file) throw std::runtime_error("[replay] cannot open " + path);
+
+	const uint64_t before = events_;
+	Start();
+
+	FastMdMessage md;
+	std::string line;
+	while(std::getline(file, line))
+	{
+		size_t start = line.find("8=FIX");
+		if(start == std::string::npos) continue;
+
+		if(!ParseFastMd(line.data() + start, line.size() - start, md)) continue;
+
+		int64_t timeNs = ParseLogTimestamp(line);
+		if(timeNs >= 0)
+		{
+			Pace(timeNs);
+			simple_.SetReplayTime(timeNs);
+		}
+
+		simple_.ApplyMarketData(md);
+		++events_;
+	}
+
+	Stop();
+	return events_ - before;
+}
+
+uint64_t ReplayEngine::ReplayFile(const string & path, InstrumentId instrument)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if(!file) throw std::runtime_error("[replay] cannot open " + path);
+
+	char magic[8] = { 0 };
+	file.read(magic, sizeof(magic));
+	if(file.gcount() == sizeof(magic) && std::memcmp(magic, "L2TICKJ", 8) == 0)
+		return ReplayTickJournal(path, instrument);
+
+	file.clear();
+	file.seekg(0);
+	std::string line;
+	std::getline(file, line);
+	if(line.find("8=FIX") != std::string::npos)
+		return ReplayFixLog(path);
+
+	return ReplayTextFile(path, instrument);
+}
+
+void ReplayEngine::Report(std::ostream & out) const
+{
+	out << "[replay] " << events_ << " events in " << elapsedSeconds_ << " s";
+	if(elapsedSeconds_ > 0)
+		out << " (" << static_cast<uint64_t>(events_ / elapsedSeconds_) << " events/s)";
+	out << std::endl;
+}
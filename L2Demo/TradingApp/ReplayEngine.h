@@ -0,0 +1,58 @@
+#ifndef REPLAY_ENGINE_H
+#define REPLAY_ENGINE_H
+
+#include <string>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+#include "Simple.h"
+
+using std::string;
+
+/// Drives a Simple set up with InitSimulation() from recorded market data,
+/// so the Strategy sees the same callbacks it would see live, with
+/// Simple::EventTimeNs() at the recorded time of each event.
+class ReplayEngine
+{
+public:
+	/// `speed` 0 replays as fast as possible; otherwise events are paced to
+	/// their recorded timestamps, `speed` times faster than real time.
+	ReplayEngine(Simple & simple, double speed = 0);
+
+	/// Replay a Write2Txt text file ("time type qty px" lines) as top-of-book
+	/// updates for `instrument`.
+	uint64_t ReplayTextFile(const string & path, InstrumentId instrument);
+
+	/// Replay a binary TickJournal as top-of-book updates for `instrument`.
+	uint64_t ReplayTickJournal(const string & path, InstrumentId instrument);
+
+	/// Replay the MarketDataIncrementalRefresh and MarketDataSnapshotFullRefresh
+	/// messages of a QuickFIX FileLog message log; everything else is skipped.
+	uint64_t ReplayFixLog(const string & path);
+
+	/// Pick one of the above from the file's contents.
+	uint64_t ReplayFile(const string & path, InstrumentId instrument);
+
+	uint64_t Events() const { return events_; }
+	double ElapsedSeconds() const { return elapsedSeconds_; }
+
+	/// Print events, wall time and events per second.
+	void Report(std::ostream & out) const;
+
+private:
+	void ApplyTick(InstrumentId instrument, int64_t timeNs, char type, double qty, double px);
+	void Pace(int64_t timeNs);
+	void Start();
+	void Stop();
+
+	Simple & simple_;
+	const double speed_;
+	uint64_t events_;
+	double elapsedSeconds_;
+
+	std::chrono::steady_clock::time_point wallStart_;
+	std::chrono::steady_clock::time_point runStart_;
+	int64_t firstTimeNs_;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "RiskGate.h"
+#include <chrono>
+#include <cmath>
+
+// FIX Side values
+static const char BUY_SIDE = '1';
+
+static int64_t NowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* RiskResultName(RiskResult result)
+{
+	switch(result)
+	{
+	case RISK_OK:
+		return "ok";
+	case RISK_KILLED:
+		return "kill switch";
+	case RISK_ORDER_QTY:
+		return "order qty";
+	case RISK_POSITION:
+		return "position";
+	case RISK_RATE:
+		return "order rate";
+	default:
+		return "unknown";
+	}
+}
+
+RiskGate::RiskGate()
+	: intervalNs_(0),
+	  burstNs_(0),
+	  theoreticalArrival_(0),
+	  killed_(false),
+	  passed_(0)
+{
+	RiskLimits none = { 0, 0, 0, 0 };
+	limits_ = none;
+	for(int i = 0; i < RISK_RESULT_COUNT; ++i)
+		rejects_[i].store(0);
+}
+
+void RiskGate::SetLimits(const RiskLimits & limits)
+{
+	limits_ = limits;
+	if(limits_.burst < 1) limits_.burst = 1;
+	intervalNs_ = limits_.ordersPerSecond > 0 ? 1000000000LL / limits_.ordersPerSecond : 0;
+	burstNs_ = intervalNs_ * (limits_.burst - 1);
+	theoreticalArrival_.store(0);
+}
+
+int RiskGate::Account(InstrumentId instrument, const string & account)
+{
+	if(static_cast<size_t>(instrument) >= byInstrument_.size())
+		byInstrument_.resize(instrument + 1);
+
+	std::vector<Entry>& entries = byInstrument_[instrument];
+	for(size_t i = 0; i < entries.size(); ++i)
+	{
+		if(entries[i].account == account)
+			return static_cast<int>(i);
+	}
+
+	Entry entry;
+	entry.account = account;
+	entry.exposure.reset(new Exposure);
+	entry.exposure->position.store(0);
+	entry.exposure->workingBuy.store(0);
+	entry.exposure->workingSell.store(0);
+	entries.push_back(std::move(entry));
+	return static_cast<int>(entries.size() - 1);
+}
+
+RiskResult RiskGate::Check(InstrumentId instrument, int account, char side, int qty)
+{
+	RiskResult result = RISK_OK;
+	if(killed_.load(std::memory_order_acquire))
+	{
+		result = RISK_KILLED;
+	}
+	else if(limits_.maxOrderQty > 0 && qty > limits_.maxOrderQty)
+	{
+		result = RISK_ORDER_QTY;
+	}
+	else
+	{
+		// Reserve the quantity first and take it back if it does not fit, so
+		// two orders racing each other cannot both squeeze in:
+		Exposure& exposure = At(instrument, account);
+		std::atomic<int64_t>& working = BUY_SIDE == side ? exposure.workingBuy : exposure.workingSell;
+		const int64_t worstCase = working.fetch_add(qty, std::memory_order_acq_rel) + qty;
+		const int64_t position = exposure.position.load(std::memory_order_acquire);
+		if(limits_.maxPosition > 0 && (BUY_SIDE == side ? position + worstCase : worstCase - position) > limits_.maxPosition)
+			result = RISK_POSITION;
+		else if(!TakeToken())
+			result = RISK_RATE;
+
+		if(RISK_OK != result)
+			working.fetch_sub(qty, std::memory_order_acq_rel);
+	}
+
+	if(RISK_OK == result)
+		passed_.fetch_add(1, std::memory_order_relaxed);
+	else
+		rejects_[result].fetch_add(1, std::memory_order_relaxed);
+	return result;
+}
+
+// Generic cell rate algorithm: an order may go out if the bucket's
+// theoretical arrival time is no more than burstNs_ ahead of now.
+bool RiskGate::TakeToken()
+{
+	if(0 == intervalNs_) return true;
+
+	const int64_t now = NowNs();
+	int64_t arrival = theoreticalArrival_.load(std::memory_order_relaxed);
+	for(;;)
+	{
+		const int64_t start = arrival > now ? arrival : now;
+		if(start - now > burstNs_) return false;
+		if(theoreticalArrival_.compare_exchange_weak(arrival, start + intervalNs_, std::memory_order_relaxed))
+			return true;
+	}
+}
+
+void RiskGate::OnFill(InstrumentId instrument, int account, char side, double qty)
+{
+	Exposure& exposure = At(instrument, account);
+	const int64_t filled = static_cast<int64_t>(std::llround(qty));
+	// Position first: until working drops, the fill counts twice, never zero times.
+	exposure.position.fetch_add(BUY_SIDE == side ? filled : -filled, std::memory_order_acq_rel);
+	(BUY_SIDE == side ? exposure.workingBuy : exposure.workingSell).fetch_sub(filled, std::memory_order_acq_rel);
+}
+
+void RiskGate::Release(InstrumentId instrument, int account, char side, double qty)
+{
+	Exposure& exposure = At(instrument, account);
+	(BUY_SIDE == side ? exposure.workingBuy : exposure.workingSell).fetch_sub(static_cast<int64_t>(std::llround(qty)), std::memory_order_acq_rel);
+}
+
+int RiskGate::Accounts(InstrumentId instrument) const
+{
+	return static_cast<size_t>(instrument) < byInstrument_.size() ? static_cast<int>(byInstrument_[instrument].size()) : 0;
+}
+
+RiskExposure RiskGate::GetExposure(InstrumentId instrument, int account) const
+{
+	const Exposure& exposure = At(instrument, account);
+	RiskExposure result;
+	result.position = exposure.position.load(std::memory_order_acquire);
+	result.workingBuy = exposure.workingBuy.load(std::memory_order_acquire);
+	result.workingSell = exposure.workingSell.load(std::memory_order_acquire);
+	return result;
+}
+
+int RiskGate::Restore(InstrumentId instrument, const string & account, const RiskExposure & restored)
+{
+	const int index = Account(instrument, account);
+	Exposure& exposure = At(instrument, index);
+	exposure.position.store(restored.position);
+	exposure.workingBuy.store(restored.workingBuy);
+	exposure.workingSell.store(restored.workingSell);
+	return index;
+}
+
+void RiskGate::Kill()
+{
+	killed_.store(true, std::memory_order_release);
+}
+
+void RiskGate::Resume()
+{
+	killed_.store(false, std::memory_order_release);
+}
+
+int RiskGate::Tokens() const
+{
+	if(0 == intervalNs_) return limits_.burst;
+
+	const int64_t ahead = theoreticalArrival_.load(std::memory_order_relaxed) - NowNs();
+	if(ahead <= 0) return limits_.burst;
+	const int64_t tokens = (burstNs_ - ahead) / intervalNs_ + 1;
+	return tokens > 0 ? static_cast<int>(tokens) : 0;
+}
+
+double RiskGate::Headroom(InstrumentId instrument, int account, char side) const
+{
+	if(limits_.maxPosition <= 0) return HUGE_VAL;
+
+	const Exposure& exposure = At(instrument, account);
+	const int64_t position = exposure.position.load(std::memory_order_acquire);
+	const int64_t used = BUY_SIDE == side ? position + exposure.workingBuy.load(std::memory_order_acquire)
+		: exposure.workingSell.load(std::memory_order_acquire) - position;
+	return static_cast<double>(limits_.maxPosition - used);
+}
+
+void RiskGate::Report(std::ostream & out) const
+{
+	out << "[risk] passed=" << Passed();
+	for(int i = RISK_OK + 1; i < RISK_RESULT_COUNT; ++i)
+		out << ", " << RiskResultName(static_cast<RiskResult>(i)) << "=" << Rejects(static_cast<RiskResult>(i));
+	out << (Killed() ? " (killed)" : "") << std::endl;
+}
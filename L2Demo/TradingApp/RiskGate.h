@@ -0,0 +1,137 @@
+#ifndef RISK_GATE_H
+#define RISK_GATE_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include "InstrumentRegistry.h"
+
+using std::string;
+
+/// Why the RiskGate refused an order.
+enum RiskResult
+{
+	RISK_OK,
+	RISK_KILLED,            // the kill switch is on
+	RISK_ORDER_QTY,         // more than maxOrderQty
+	RISK_POSITION,          // could take the position past maxPosition
+	RISK_RATE,              // more than ordersPerSecond, beyond the burst
+	RISK_RESULT_COUNT
+};
+
+const char* RiskResultName(RiskResult result);
+
+/// Limits checked before every new order and cancel/replace.  0 means no limit.
+struct RiskLimits
+{
+	int maxOrderQty;
+	int maxPosition;        // absolute net position per instrument and account
+	int ordersPerSecond;
+	int burst;              // orders that may go out back to back
+};
+
+/// Filled position and working quantity of one account on one instrument.
+struct RiskExposure
+{
+	int64_t position;
+	int64_t workingBuy;
+	int64_t workingSell;
+};
+
+/// Pre-trade checks in front of every outbound order, using atomics only.
+///
+/// The position check is worst case: the filled position plus every live
+/// order on the same side, so orders in flight can never add up to more than
+/// maxPosition.  An order's quantity counts from the moment it passes the
+/// gate until it fills, is canceled or is rejected (see OnFill/Release).
+/// The rate limit is a token bucket kept as a single theoretical arrival
+/// time (GCRA), so taking a token is one compare-and-swap.
+///
+/// Cancels are never checked: they only ever reduce risk.  Kill() blocks
+/// every later order at once, from any thread.
+///
+/// Accounts are registered on an instrument's first order for them, like
+/// OrderTemplates, so Account() and the checks run on the thread that sends
+/// orders.  Kill(), the counters and Tokens() are safe from any thread.
+class RiskGate
+{
+public:
+	RiskGate();
+
+	void SetLimits(const RiskLimits & limits);
+	const RiskLimits & Limits() const { return limits_; }
+
+	/// Index of `account` on `instrument`, for the calls below.
+	int Account(InstrumentId instrument, const string & account);
+
+	/// Check an order of `qty` on `side` (FIX Side) and, if it passes,
+	/// count it as working.
+	RiskResult Check(InstrumentId instrument, int account, char side, int qty);
+
+	/// `qty` of a working order filled.
+	void OnFill(InstrumentId instrument, int account, char side, double qty);
+
+	/// `qty` of a working order will not fill: canceled, rejected or replaced.
+	void Release(InstrumentId instrument, int account, char side, double qty);
+
+	/// Accounts registered on `instrument` so far, and what they hold; for StateCheckpoint.
+	int Accounts(InstrumentId instrument) const;
+	const string & AccountName(InstrumentId instrument, int account) const { return byInstrument_[instrument][account].account; }
+	RiskExposure GetExposure(InstrumentId instrument, int account) const;
+
+	/// Register `account` on `instrument` with what it held before a restart.
+	/// Returns its index.
+	int Restore(InstrumentId instrument, const string & account, const RiskExposure & exposure);
+
+	void Kill();
+	void Resume();
+	bool Killed() const { return killed_.load(std::memory_order_acquire); }
+
+	uint64_t Rejects(RiskResult result) const { return rejects_[result].load(std::memory_order_relaxed); }
+	uint64_t Passed() const { return passed_.load(std::memory_order_relaxed); }
+
+	/// Orders that may go out right now before the rate limit kicks in.
+	int Tokens() const;
+
+	/// How much more may be bought (BUY) or sold (SELL) before maxPosition.
+	double Headroom(InstrumentId instrument, int account, char side) const;
+
+	void Report(std::ostream & out) const;
+
+private:
+	RiskGate(const RiskGate&) = delete;
+	RiskGate& operator=(const RiskGate&) = delete;
+
+	/// Net filled position and working quantity, per instrument and account.
+	struct Exposure
+	{
+		std::atomic<int64_t> position;
+		std::atomic<int64_t> workingBuy;
+		std::atomic<int64_t> workingSell;
+	};
+
+	struct Entry
+	{
+		string account;
+		std::unique_ptr<Exposure> exposure;   // stays put as the vectors grow
+	};
+
+	Exposure & At(InstrumentId instrument, int account) const { return *byInstrument_[instrument][account].exposure; }
+	bool TakeToken();
+
+	RiskLimits limits_;
+	int64_t intervalNs_;       // between orders at ordersPerSecond
+	int64_t burstNs_;          // how far ahead of the clock the bucket may run
+	std::atomic<int64_t> theoreticalArrival_;
+	std::atomic<bool> killed_;
+	std::atomic<uint64_t> passed_;
+	std::atomic<uint64_t> rejects_[RISK_RESULT_COUNT];
+
+	// Indexed by InstrumentId; strategies use one or two accounts, so a scan is fine.
+	std::vector<std::vector<Entry> > byInstrument_;
+};
+
+#endif
@@ -1,16 +1,110 @@
 #include "Simple.h"
-#include "Strategy.h"
+#include L2_STRATEGY_HEADER
+#include "LatencyProbes.h"
+#include "FillSimulator.h"
+#include "AsyncLog.h"
+#include <cstring>
+#include <algorithm>
 
-Simple::Simple(Strategy & strategy)
-	: strategy_(strategy)
+// Exchange assumed for instruments and messages that do not name one.
+static const std::string DEFAULT_EXCHANGE("CME");
+
+// Where ClOrdIDs are reserved; a new file carries on from IdHelper's orderid.txt.
+static const char* ORDER_ID_FILE = "orderid.dat";
+
+// Slots in each EventPipeline ring unless MyPipelineRingSize says otherwise.
+static const int DEFAULT_PIPELINE_RING_SIZE = 65536;
+
+// Market data subscription batching unless MyMdSymbolsPerRequest/MyMdMaxRetries say otherwise.
+static const int DEFAULT_MD_SYMBOLS_PER_REQUEST = 100;
+static const int DEFAULT_MD_MAX_RETRIES = 3;
+
+// Startup unless MyLogonTimeoutSeconds/MyExpectedInstruments/MyWarmUpMessages say otherwise.
+static const int DEFAULT_LOGON_TIMEOUT_SECONDS = 10;
+static const int DEFAULT_EXPECTED_INSTRUMENTS = 64;
+static const int DEFAULT_WARM_UP_MESSAGES = 10000;
+
+// FeedMonitor unless MyStaleQuoteMs/MyBurstWindowUs/MyBurstMessages/MyFeedReportSeconds say otherwise.
+static const int DEFAULT_STALE_QUOTE_MS = 5000;
+static const int DEFAULT_BURST_WINDOW_US = 1000;
+static const int DEFAULT_BURST_MESSAGES = 50;
+static const int DEFAULT_FEED_REPORT_SECONDS = 10;
+static const int MAX_MONITORED_INSTRUMENTS = 4096;
+
+// Instruments a StateCheckpoint (MyCheckpointFile) has room for.
+static const int MAX_CHECKPOINT_INSTRUMENTS = 1024;
+
+// Books each MarketDataShard preallocates, and its ring unless MyShardRingSize says otherwise.
+static const int MAX_SHARD_INSTRUMENTS = 4096;
+static const int DEFAULT_SHARD_RING_SIZE = 4096;
+
+// The shard whose session the calling QuickFIX thread is reading, if any.
+// A ThreadedSocketInitiator reads each session on a thread of its own.
+static THREAD_LOCAL MarketDataShard* currentShard = nullptr;
+static THREAD_LOCAL const FIX::SessionID* currentSession = nullptr;
+
+// When the market data message the calling thread is handling arrived (or
+// was recorded, in a replay); the Dispatch* methods pass it on with its entries.
+static THREAD_LOCAL int64_t currentMdTimeNs = 0;
+
+// States of bookDirty_.  A change to a DEFERRED book means the Strategy
+// will never see the version of it that was deferred.
+enum BookState
+{
+	BOOK_CLEAN,
+	BOOK_CHANGED,               // changed by the current message
+	BOOK_DEFERRED,              // changed by an earlier message, not yet published
+	BOOK_DEFERRED_CHANGED       // both
+};
+
+Simple::Simple(BoundStrategy & strategy)
+	: strategy_(strategy),
+	  ids_(ORDER_ID_FILE, IdService::DEFAULT_BLOCK_SIZE, IdHelper::ReadOrderIdFromFile()),
+	  subscriptions_(instruments_, ids_),
+	  batchSubscriptions_(false),
+	  registrationClosed_(false),
+	  fastMarketData_(false),
+	  conflateBooks_(false),
+	  conflateTrades_(false),
+	  conflatedBookUpdates_(0),
+	  conflatedTrades_(0),
+	  eventTimeNs_(0),
+	  replayTimeNs_(0),
+	  replaying_(false),
+	  mdLoggedOn_(false),
+	  orderLoggedOn_(false),
+	  messageStoreFactory_(nullptr),
+	  logFactory_(nullptr),
+	  rawLogFactory_(nullptr),
+	  fillSimulator_(nullptr),
+	  sessionSettings_(nullptr),
+	  initiator_(nullptr),
+	  pipeline_(nullptr),
+	  feedMonitor_(nullptr),
+	  checkpoint_(nullptr),
+	  recoveredExecSeqNum_(0)
 { }
 
 Simple::~Simple()
 {
 	std::cout << "Shutting down..." << std::endl;
 	
+	// Stop QuickFIX first so nothing more is published into the pipeline,
+	// then let the strategy thread finish what is already queued:
 	if(initiator_) initiator_->stop();
+	if(pipeline_) pipeline_->Stop();
+	delete checkpoint_;
+	delete feedMonitor_;
+	AsyncLog::Stop();
+	if(conflateBooks_ || conflateTrades_)
+		std::cout << "[conflation] book updates=" << conflatedBookUpdates_ << ", trades=" << conflatedTrades_ << std::endl;
+	risk_.Report(std::cout);
+	PROBE_STOP_REPORTER();
+	delete pipeline_;
+	for(size_t i = 0; i < shards_.size(); ++i)
+		delete shards_[i];
 	delete initiator_;
+	delete rawLogFactory_;
 	delete logFactory_;
 	delete messageStoreFactory_;
 	delete sessionSettings_;
@@ -21,223 +115,1294 @@ void Simple::Init(const std::string & configFile)
 {
 	// Boilerplate quickfix setup:
 	sessionSettings_ = new FIX::SessionSettings(configFile);
-	messageStoreFactory_ = new FIX::FileStoreFactory(*sessionSettings_);
+	// FileStore unless a session picks another with MyMessageStore:
+	messageStoreFactory_ = new SessionStoreFactory(*sessionSettings_);
 	logFactory_ = new FIX::FileLogFactory(*sessionSettings_);
-	initiator_ = new FIX::SocketInitiator(*this, *messageStoreFactory_, *sessionSettings_, *logFactory_);
+
+	// Optional raw-buffer fast path for market data, see OnRawMarketData():
+	const FIX::Dictionary& defaults = sessionSettings_->get();
+	fastMarketData_ = defaults.has("MyFastMarketData") && defaults.getBool("MyFastMarketData");
+	if(fastMarketData_)
+		rawLogFactory_ = new RawMessageLogFactory(*logFactory_);
+	FIX::LogFactory& logs = rawLogFactory_ ? static_cast<FIX::LogFactory&>(*rawLogFactory_) : *logFactory_;
+
+	// Several market data sessions are each read on a thread of their own:
+	std::vector<FIX::SessionID> mdSessions;
+	const std::set<FIX::SessionID> sessions = sessionSettings_->getSessions();
+	for(std::set<FIX::SessionID>::const_iterator it = sessions.begin(); it != sessions.end(); ++it)
+	{
+		const FIX::Dictionary& settings = sessionSettings_->get(*it);
+		if(settings.has("MyMarketDataSession") && settings.getBool("MyMarketDataSession"))
+			mdSessions.push_back(*it);
+	}
+	if(mdSessions.size() > 1)
+		initiator_ = new FIX::ThreadedSocketInitiator(*this, *messageStoreFactory_, *sessionSettings_, logs);
+	else
+		initiator_ = new FIX::SocketInitiator(*this, *messageStoreFactory_, *sessionSettings_, logs);
+
+	// Optional strategy thread, see EventPipeline.  It exists before the
+	// sessions start so that nothing reaches the Strategy on QuickFIX's thread:
+	if(defaults.has("MyStrategyThread") && defaults.getBool("MyStrategyThread"))
+	{
+		pipeline_ = new EventPipeline(*this,
+			defaults.has("MyPipelineRingSize") ? defaults.getInt("MyPipelineRingSize") : DEFAULT_PIPELINE_RING_SIZE,
+			defaults.has("MyStrategyCpu") ? defaults.getInt("MyStrategyCpu") : -1,
+			defaults.has("MySenderCpu") ? defaults.getInt("MySenderCpu") : -1);
+
+		// Latest-wins book notifications while the strategy thread is behind:
+		conflateBooks_ = defaults.has("MyConflateBooks") && defaults.getBool("MyConflateBooks");
+	}
+	conflateTrades_ = defaults.has("MyConflateTrades") && defaults.getBool("MyConflateTrades");
+
+	// Instruments per MarketDataRequest; 1 for venues that identify market data by MDReqID alone:
+	const int symbolsPerRequest = defaults.has("MyMdSymbolsPerRequest") ? defaults.getInt("MyMdSymbolsPerRequest") : DEFAULT_MD_SYMBOLS_PER_REQUEST;
+	const int maxRetries = defaults.has("MyMdMaxRetries") ? defaults.getInt("MyMdMaxRetries") : DEFAULT_MD_MAX_RETRIES;
+	subscriptions_.SetLimits(symbolsPerRequest, maxRetries);
+
+	// One shard per market data session, merged on the strategy thread:
+	if(mdSessions.size() > 1)
+	{
+		if(!pipeline_)
+			throw std::runtime_error("[init] Several market data sessions need MyStrategyThread=Y");
+
+		const int ringSize = defaults.has("MyShardRingSize") ? defaults.getInt("MyShardRingSize") : DEFAULT_SHARD_RING_SIZE;
+		const int count = static_cast<int>(mdSessions.size());
+		for(int i = 0; i < count; ++i)
+		{
+			MarketDataShard* shard = new MarketDataShard(i, count, mdSessions[i], instruments_, ids_, MAX_SHARD_INSTRUMENTS, ringSize);
+			shards_.push_back(shard);
+			shard->Subscriptions().SetLimits(symbolsPerRequest, maxRetries);
+			pipeline_->AddShard(*shard);
+		}
+		shardLoggedOn_.assign(count, 0);
+		std::cout << "[init] Market data sharded over " << count << " sessions" << std::endl;
+	}
+
+	// Pre-trade limits; 0 or missing means no limit:
+	RiskLimits limits;
+	limits.maxOrderQty = defaults.has("MyMaxOrderQty") ? defaults.getInt("MyMaxOrderQty") : 0;
+	limits.maxPosition = defaults.has("MyMaxPosition") ? defaults.getInt("MyMaxPosition") : 0;
+	limits.ordersPerSecond = defaults.has("MyMaxOrdersPerSecond") ? defaults.getInt("MyMaxOrdersPerSecond") : 0;
+	limits.burst = defaults.has("MyOrderBurst") ? defaults.getInt("MyOrderBurst") : 1;
+	risk_.SetLimits(limits);
+
+	// Optional market data feed health monitoring, of a single session only:
+	if(defaults.has("MyFeedMonitor") && defaults.getBool("MyFeedMonitor") && !shards_.empty())
+	{
+		std::cout << "[init] MyFeedMonitor is ignored with several market data sessions" << std::endl;
+	}
+	else if(defaults.has("MyFeedMonitor") && defaults.getBool("MyFeedMonitor"))
+	{
+		FeedSettings feed;
+		feed.staleNs = 1000000LL * (defaults.has("MyStaleQuoteMs") ? defaults.getInt("MyStaleQuoteMs") : DEFAULT_STALE_QUOTE_MS);
+		feed.burstWindowNs = 1000LL * (defaults.has("MyBurstWindowUs") ? defaults.getInt("MyBurstWindowUs") : DEFAULT_BURST_WINDOW_US);
+		feed.burstMessages = defaults.has("MyBurstMessages") ? defaults.getInt("MyBurstMessages") : DEFAULT_BURST_MESSAGES;
+		feed.reportSeconds = defaults.has("MyFeedReportSeconds") ? defaults.getInt("MyFeedReportSeconds") : DEFAULT_FEED_REPORT_SECONDS;
+		feed.maxInstruments = MAX_MONITORED_INSTRUMENTS;
+		feedMonitor_ = new FeedMonitor(feed);
+	}
+
+	// Carry on from the last run's orders and positions:
+	if(defaults.has("MyCheckpointFile"))
+		OpenCheckpoint(defaults.getString("MyCheckpointFile"));
+
+	// Hot-path logging goes through a background writer from here on:
+	AsyncLog::Start(std::cout);
 	initiator_->start();
+
+	// Periodic latency report when built with L2_LATENCY_PROBES:
+	PROBE_START_REPORTER(defaults.has("MyLatencyReportSeconds") ? defaults.getInt("MyLatencyReportSeconds") : 10);
 	
 	// Make sure all Sessions are logged on before we tell our Strategy it is OK to start:
-	for(int i = 0; i < 10; ++i)
+	const int logonTimeout = defaults.has("MyLogonTimeoutSeconds") ? defaults.getInt("MyLogonTimeoutSeconds") : DEFAULT_LOGON_TIMEOUT_SECONDS;
+	{
+		std::unique_lock<std::mutex> lock(logonMutex_);
+		if(!logonChanged_.wait_for(lock, std::chrono::seconds(logonTimeout), [this]() { return mdLoggedOn_ && orderLoggedOn_; }))
+			throw std::runtime_error("[init] Fatal error: timed out waiting for all FIX Sessions to logon!");
+	}
+
+	// Get the first live message to steady-state latency:
+	if(defaults.has("MyLockMemory") && defaults.getBool("MyLockMemory") && !LockProcessMemory())
+		std::cout << "[init] Could not lock memory; page faults remain possible" << std::endl;
+	Reserve(defaults.has("MyExpectedInstruments") ? defaults.getInt("MyExpectedInstruments") : DEFAULT_EXPECTED_INSTRUMENTS);
+	WarmUp(defaults.has("MyWarmUpMessages") ? defaults.getInt("MyWarmUpMessages") : DEFAULT_WARM_UP_MESSAGES);
+
+	// Only the orders that were working need checking with the venue:
+	if(checkpoint_ && checkpoint_->Recovered())
+		RequestOrderStatus();
+
+	batchSubscriptions_ = true;
+	strategy_.OnInit(*this);
+	batchSubscriptions_ = false;
+	subscriptions_.Flush(&mdSessionId_);
+	for(size_t i = 0; i < shards_.size(); ++i)
+		shards_[i]->Subscriptions().Flush(&shards_[i]->Session());
+
+	// Anything that arrived or was sent during OnInit waits in the rings.
+	// From here on the per-instrument state must not move under the threads:
+	if(pipeline_)
 	{
-		FIX::Session* marketDataSession = FIX::Session::lookupSession(mdSessionId_);
-		FIX::Session* orderSession = FIX::Session::lookupSession(orderSessionId_);
-		if(marketDataSession && orderSession)
+		registrationClosed_ = true;
+		pipeline_->Start();
+	}
+}
+
+// Load what the last run left in the checkpoint, before any session can
+// deliver a report for it, and save every change from here on.
+void Simple::OpenCheckpoint(const std::string & path)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	checkpoint_ = new StateCheckpoint(path, orders_.Capacity(), MAX_CHECKPOINT_INSTRUMENTS);
+	if(checkpoint_->Recovered())
+	{
+		// Same ids as before, so the saved orders and books line up:
+		for(InstrumentId instrument = 0; instrument < checkpoint_->Instruments(); ++instrument)
 		{
-			if(marketDataSession->isLoggedOn() && orderSession->isLoggedOn())
-			{
-				strategy_.OnInit(*this);
-				return;
-			}
+			const Instrument details = checkpoint_->GetInstrument(instrument);
+			if(RegisterInstrument(details.symbol, details.maturityMonthYear) != instrument)
+				throw std::runtime_error("[init] " + path + " does not match the instruments already registered");
+			books_[instrument] = checkpoint_->Book(instrument);
 		}
-		std::cout << "[init] Waiting for all FIX Sessions to logon..." << std::endl;
-		FIX::process_sleep(1);
-	}
-
-	throw std::runtime_error("[init] Fatal error: timed out waiting for all FIX Sessions to logon!");
-}
-
-void Simple::SendMarketDataSubscription(const std::string & symbol, const std::string & maturityMonthYear)
-{
-	// We want the latest snapshot, plus updates, for top of the book:
-	FIX42::MarketDataRequest msg;
-	msg.set(FIX::MDReqID(idHelper_.GetNextMDRequestId()));
-	msg.set(FIX::SubscriptionRequestType(FIX::SubscriptionRequestType_SNAPSHOT_PLUS_UPDATES));
-	msg.set(FIX::MarketDepth(1));
-	msg.set(FIX::MDUpdateType(FIX::MDUpdateType_INCREMENTAL_REFRESH));
-	msg.set(FIX::AggregatedBook(FIX::AggregatedBook_YES));
-
-	// We want best bid, best offer, and last trade notifications
-	FIX42::MarketDataRequest::NoMDEntryTypes marketDataEntryGroup;
-	marketDataEntryGroup.set(FIX::MDEntryType(FIX::MDEntryType_BID));
-	msg.addGroup(marketDataEntryGroup);
-	marketDataEntryGroup.set(FIX::MDEntryType(FIX::MDEntryType_OFFER));
-	msg.addGroup(marketDataEntryGroup);
-	marketDataEntryGroup.set(FIX::MDEntryType(FIX::MDEntryType_TRADE));
-	msg.addGroup(marketDataEntryGroup);
-
-	// Repeating group for the instrument to which we are subscribing:
-	FIX42::MarketDataRequest::NoRelatedSym symbolGroup;
-	symbolGroup.set(FIX::Symbol(symbol));
-	symbolGroup.set(FIX::MaturityMonthYear(maturityMonthYear));
-	symbolGroup.set(FIX::SecurityExchange("CME"));
-	symbolGroup.set(FIX::SecurityType("FUT"));
-	msg.addGroup(symbolGroup);
-	
-	
-	FIX::Session::sendToTarget(msg, mdSessionId_);
+		checkpoint_->Restore(orders_, risk_);
+
+		// MsgSeqNums start again every day, so an older number means nothing:
+		const int64_t nsPerDay = 86400LL * 1000000000LL;
+		const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		if(checkpoint_->Header().updated / nsPerDay == now / nsPerDay)
+			recoveredExecSeqNum_ = checkpoint_->Header().lastExecSeqNum;
+
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "[init] Recovered " << checkpoint_->Instruments() << " instruments and " << orders_.LiveOrders()
+			<< " working orders from " << path << " in " << ms << " ms" << std::endl;
+	}
+	orders_.TrackChanges(true);
 }
 
-void Simple::SendMarketOrder(const std::string & symbol, const std::string & maturityMonthYear, const std::string & account, SimpleSide side, int qty)
+// Write what the last OrderManager call changed, and the risk that goes
+// with it, to the checkpoint.  `execSeqNum` is the ExecutionReport's, if one
+// caused it.
+void Simple::SaveState(int execSeqNum)
 {
-	FIX42::NewOrderSingle msg;
-	
-	if(SimpleSide::BUY == side) msg.set(FIX::Side(FIX::Side_BUY));
-	else msg.set(FIX::Side(FIX::Side_SELL));
-
-	msg.set(FIX::Symbol(symbol));
-	msg.set(FIX::MaturityMonthYear(maturityMonthYear));
-	msg.set(FIX::Account(account));
-	msg.set(FIX::OrderQty(qty));	
-	msg.set(FIX::ClOrdID(idHelper_.GetNextOrderId()));
-	
-	msg.set(FIX::OrdType(FIX::OrdType_MARKET));
-	msg.set(FIX::TimeInForce(FIX::TimeInForce_DAY));
-	msg.set(FIX::SecurityExchange("CME"));
-	msg.set(FIX::SecurityType("FUT"));
-	msg.set(FIX::CustomerOrFirm(0));
-	msg.set(FIX::Rule80A('A'));
+	if(checkpoint_) checkpoint_->Commit(orders_, risk_, execSeqNum);
+}
+
+// Ask the venue about every recovered order that may still be working; the
+// answers come back as status ExecutionReports, see ReconcileOrder().  A
+// replace in flight is left to the reports for the order it replaces.
+void Simple::RequestOrderStatus()
+{
+	int requested = 0;
+	for(uint32_t slot = 0; slot < orders_.Capacity(); ++slot)
+	{
+		const Order& order = orders_.Slot(slot);
+		if(0 == order.clOrdIdSize || order.IsTerminal() || ORDER_PENDING_REPLACE == order.state)
+			continue;
+
+		const Instrument& details = instruments_.Get(order.instrument);
+		FIX42::OrderStatusRequest request(FIX::ClOrdID(std::string(order.clOrdId, order.clOrdIdSize)), FIX::Symbol(details.symbol), FIX::Side(order.side));
+		request.set(FIX::MaturityMonthYear(details.maturityMonthYear));
+		request.set(FIX::SecurityExchange(details.exchange));
+		FIX::Session::sendToTarget(request, orderSessionId_);
+		++requested;
+	}
+	std::cout << "[init] Asked for the status of " << requested << " recovered orders" << std::endl;
+}
+
+/// Run without FIX sessions: market data comes in through ApplyMarketData(),
+/// e.g. from ReplayEngine, and orders are filled by `fills` instead of being sent.
+void Simple::InitSimulation(FillSimulator & fills)
+{
+	fillSimulator_ = &fills;
+	batchSubscriptions_ = true;
+	strategy_.OnInit(*this);
+	batchSubscriptions_ = false;
+	subscriptions_.Flush(nullptr);
+	DeliverSimulatedFills();
+}
+
+InstrumentId Simple::SendMarketDataSubscription(const std::string & symbol, const std::string & maturityMonthYear, int depth)
+{
+	InstrumentId instrument = RegisterInstrument(symbol, maturityMonthYear);
+	OrderBook& book = books_[instrument];
+	book.SetDepth(depth);
+
+	if (!shards_.empty())
+	{
+		// Only its shard's session carries the instrument:
+		MarketDataShard& shard = ShardOf(instrument);
+		shard.SetDepth(instrument, depth);
+		shard.Subscriptions().Add(instrument, book.Depth());
+		if (!batchSubscriptions_)
+			shard.Subscriptions().Flush(&shard.Session());
+		return instrument;
+	}
+
+	subscriptions_.Add(instrument, book.Depth());
+	if (!batchSubscriptions_)
+		subscriptions_.Flush(fillSimulator_ ? nullptr : &mdSessionId_);
+	return instrument;
+}
+
+// Give the instrument its dense id and per-instrument state up front, so the
+// message handlers only ever index arrays.
+InstrumentId Simple::RegisterInstrument(const std::string & symbol, const std::string & maturityMonthYear)
+{
+	// Once the strategy thread runs, only instruments from OnInit are known:
+	if (registrationClosed_)
+	{
+		const InstrumentId known = instruments_.Find(symbol, maturityMonthYear, DEFAULT_EXCHANGE);
+		if (INVALID_INSTRUMENT == known)
+			throw std::runtime_error("[Simple] " + symbol + " " + maturityMonthYear + " was not subscribed to in OnInit; with MyStrategyThread=Y no instrument can be added later");
+		return known;
+	}
+
+	InstrumentId instrument = instruments_.Register(symbol, maturityMonthYear, DEFAULT_EXCHANGE);
+	if (static_cast<size_t>(instrument) >= books_.size())
+	{
+		books_.resize(instrument + 1);
+		bookDirty_.resize(instrument + 1, BOOK_CLEAN);
+		changedBooks_.reserve(instrument + 1);
+		tradeCount_.resize(instrument + 1, 0);
+		tradeQty_.resize(instrument + 1, 0);
+		tradePx_.resize(instrument + 1, 0);
+		tradedInstruments_.reserve(instrument + 1);
+		orders_.AddInstrument(instrument);
+		if (feedMonitor_) feedMonitor_->AddInstrument(instrument, instruments_.Get(instrument));
+		if (checkpoint_) checkpoint_->AddInstrument(instrument, instruments_.Get(instrument));
+	}
+	return instrument;
+}
+
+// Size the per-instrument state for `instruments` up front, so subscribing
+// later does not move the books while references to them are held.
+void Simple::Reserve(size_t instruments)
+{
+	books_.reserve(instruments);
+	bookDirty_.reserve(instruments);
+	changedBooks_.reserve(instruments);
+	tradeCount_.reserve(instruments);
+	tradeQty_.reserve(instruments);
+	tradePx_.reserve(instruments);
+	tradedInstruments_.reserve(instruments);
+}
+
+IdString Simple::SendMarketOrder(const std::string & symbol, const std::string & maturityMonthYear, const std::string & account, SimpleSide side, int qty)
+{
+	return SendMarketOrder(RegisterInstrument(symbol, maturityMonthYear), account, side, qty);
+}
+
+// The order-entry messages below are patched in place from a template
+// prepared on the first order for each instrument and account.
+IdString Simple::SendMarketOrder(InstrumentId instrument, const std::string & account, SimpleSide side, int qty)
+{
+	PROBE_SEND_ORDER();
+	const int riskAccount = risk_.Account(instrument, account);
+	if (!PassesRisk(instrument, riskAccount, side, qty))
+		return ToIdString(nullptr, 0);
+
+	IdString clOrdId = ids_.NextOrderId();
+	orders_.OnNewOrder(clOrdId.c_str(), instrument, side, FIX::OrdType_MARKET, qty, 0, riskAccount);
+	SaveState();
+
+	if (fillSimulator_)
+	{
+		fillSimulator_->SubmitMarketOrder(clOrdId, instrument, books_[instrument], side, qty);
+		return clOrdId;
+	}
+
+	SendOrderCommand(MakeOrderCommand(COMMAND_NEW_ORDER, instrument, account, clOrdId, side, FIX::OrdType_MARKET, qty, 0));
+	return clOrdId;
+}
+
+IdString Simple::SendLimitOrder(InstrumentId instrument, const std::string & account, SimpleSide side, int qty, double px)
+{
+	PROBE_SEND_ORDER();
+	const int riskAccount = risk_.Account(instrument, account);
+	if (!PassesRisk(instrument, riskAccount, side, qty))
+		return ToIdString(nullptr, 0);
 
-	FIX::Session::sendToTarget(msg, orderSessionId_);
+	IdString clOrdId = ids_.NextOrderId();
+	orders_.OnNewOrder(clOrdId.c_str(), instrument, side, FIX::OrdType_LIMIT, qty, px, riskAccount);
+	SaveState();
+
+	if (fillSimulator_)
+	{
+		fillSimulator_->SubmitLimitOrder(clOrdId, instrument, books_[instrument], side, qty, px);
+		return clOrdId;
+	}
+
+	SendOrderCommand(MakeOrderCommand(COMMAND_NEW_ORDER, instrument, account, clOrdId, side, FIX::OrdType_LIMIT, qty, px));
+	return clOrdId;
+}
+
+IdString Simple::SendCancelOrder(InstrumentId instrument, const std::string & account, const std::string & origClOrdId, SimpleSide side, int qty)
+{
+	IdString clOrdId = ids_.NextOrderId();
+
+	// Nothing rests in the FillSimulator, so there is nothing to cancel:
+	if (fillSimulator_)
+		return clOrdId;
+
+	orders_.OnCancelRequested(origClOrdId);
+	SaveState();
+
+	OrderCommand command = MakeOrderCommand(COMMAND_CANCEL, instrument, account, clOrdId, side, 0, qty, 0);
+	command.origClOrdId = ToIdString(origClOrdId);
+	SendOrderCommand(command);
+	return clOrdId;
 }
 
+IdString Simple::SendCancelReplaceOrder(InstrumentId instrument, const std::string & account, const std::string & origClOrdId, SimpleSide side, int qty, double px)
+{
+	PROBE_SEND_ORDER();
+	// The new quantity counts in full until the replace is confirmed:
+	const int riskAccount = risk_.Account(instrument, account);
+	if (!PassesRisk(instrument, riskAccount, side, qty))
+		return ToIdString(nullptr, 0);
+
+	IdString clOrdId = ids_.NextOrderId();
+
+	// The replaced order is a new limit order as far as the FillSimulator goes:
+	if (fillSimulator_)
+	{
+		orders_.OnNewOrder(clOrdId.c_str(), instrument, side, FIX::OrdType_LIMIT, qty, px, riskAccount);
+		fillSimulator_->SubmitLimitOrder(clOrdId, instrument, books_[instrument], side, qty, px);
+		return clOrdId;
+	}
+
+	orders_.OnReplaceRequested(clOrdId.c_str(), origClOrdId, qty, px);
+	SaveState();
+
+	OrderCommand command = MakeOrderCommand(COMMAND_CANCEL_REPLACE, instrument, account, clOrdId, side, FIX::OrdType_LIMIT, qty, px);
+	command.origClOrdId = ToIdString(origClOrdId);
+	SendOrderCommand(command);
+	return clOrdId;
+}
+
+// Ask the RiskGate about a new order or replace, and log it if refused.
+bool Simple::PassesRisk(InstrumentId instrument, int riskAccount, SimpleSide side, int qty)
+{
+	const RiskResult result = risk_.Check(instrument, riskAccount, side, qty);
+	if (RISK_OK == result) return true;
+
+	LOG_WARN("Risk gate refused {} {} {}: {}", side, qty, instruments_.Get(instrument).symbol, RiskResultName(result));
+	return false;
+}
+
+OrderCommand Simple::MakeOrderCommand(int type, InstrumentId instrument, const std::string & account, const IdString& clOrdId, SimpleSide side, char ordType, int qty, double px)
+{
+	OrderCommand command;
+	command.tsc = 0;
+	PROBE_HANDOFF_ORDER(command.sendTsc, command.tickTsc);
+	command.type = type;
+	command.messages = &Template(instrument, account);
+	command.clOrdId = clOrdId;
+	command.origClOrdId.data[0] = '\0';
+	command.origClOrdId.size = 0;
+	command.side = side;
+	command.ordType = ordType;
+	command.qty = qty;
+	command.px = px;
+	return command;
+}
+
+void Simple::SendOrderCommand(const OrderCommand& command)
+{
+	if (pipeline_)
+		pipeline_->PublishOrder(command);
+	else
+		ExecuteOrderCommand(command);
+}
+
+// Patch the command's template and send it.  Runs on the pipeline's sender
+// thread, the only thread that touches the templates once it is running.
+void Simple::ExecuteOrderCommand(const OrderCommand& command)
+{
+	// toApp, where the order's spans end, runs inside sendToTarget below:
+	PROBE_RESUME_ORDER(command.sendTsc, command.tickTsc);
+	OrderTemplate& messages = *command.messages;
+	switch (command.type)
+	{
+	case COMMAND_NEW_ORDER:
+		FIX::Session::sendToTarget(messages.NewOrder(command.clOrdId.c_str(), command.side, command.qty, command.ordType, command.px), orderSessionId_);
+		break;
+	case COMMAND_CANCEL:
+		FIX::Session::sendToTarget(messages.Cancel(command.clOrdId.c_str(), command.origClOrdId.str(), command.side, command.qty), orderSessionId_);
+		break;
+	case COMMAND_CANCEL_REPLACE:
+		FIX::Session::sendToTarget(messages.Replace(command.clOrdId.c_str(), command.origClOrdId.str(), command.side, command.qty, command.px), orderSessionId_);
+		break;
+	}
+}
+
+const FIX42::NewOrderSingle & Simple::BuildMarketOrder(InstrumentId instrument, const std::string & account, SimpleSide side, int qty)
+{
+	return Template(instrument, account).NewOrder(ids_.NextOrderId().c_str(), side, qty, FIX::OrdType_MARKET, 0);
+}
+
+OrderTemplate & Simple::Template(InstrumentId instrument, const std::string & account)
+{
+	return templates_.Get(instrument, instruments_.Get(instrument), account);
+}
+
+// Decode the report here, on QuickFIX's thread, and act on it in ProcessExecution().
 void Simple::onMessage(const FIX42::ExecutionReport& msg, const FIX::SessionID&)
 {
 	FIX::ExecType execType;
-	FIX::Symbol symbol;
-	FIX::MaturityMonthYear maturityMonthYear;
 	FIX::Side side;
 
 	// See what kind of execution report this is:
 	msg.get(execType);
-	if (FIX::ExecType_FILL == execType.getValue() || FIX::ExecType_PARTIAL_FILL == execType.getValue())
+	msg.get(side);
+
+	// A report resent after a restart may already be in the checkpoint:
+	FIX::MsgSeqNum msgSeqNum;
+	msg.getHeader().getField(msgSeqNum);
+	if (msgSeqNum.getValue() <= recoveredExecSeqNum_ && msg.getHeader().isSetField(FIX::FIELD::PossDupFlag))
+	{
+		FIX::PossDupFlag possDup;
+		msg.getHeader().getField(possDup);
+		if (possDup.getValue())
+		{
+			LOG_INFO("Skipping ExecutionReport {} resent from before the restart", msgSeqNum.getValue());
+			return;
+		}
+	}
+
+	ExecutionEvent execution;
+	execution.clOrdId = ToIdString(msg.isSetField(FIX::FIELD::ClOrdID) ? msg.getField(FIX::FIELD::ClOrdID) : std::string());
+	execution.origClOrdId = ToIdString(msg.isSetField(FIX::FIELD::OrigClOrdID) ? msg.getField(FIX::FIELD::OrigClOrdID) : std::string());
+	execution.instrument = INVALID_INSTRUMENT;
+	execution.side = side.getValue();
+	execution.execType = execType.getValue();
+	execution.orderQty = 0;
+	execution.lastQty = 0;
+	execution.lastPx = 0;
+	execution.cumQty = 0;
+	execution.avgPx = 0;
+	execution.msgSeqNum = msgSeqNum.getValue();
+	execution.status = msg.isSetField(FIX::FIELD::ExecTransType) && FIX::ExecTransType_STATUS == msg.getField(FIX::FIELD::ExecTransType)[0];
+
+	if (execution.status)
+	{
+		// An answer to RequestOrderStatus(), see ReconcileOrder():
+		FIX::OrdStatus ordStatus;
+		FIX::CumQty cumQty;
+		FIX::AvgPx avgPx;
+		msg.get(ordStatus);
+		msg.get(cumQty);
+		msg.get(avgPx);
+		execution.instrument = ResolveInstrument(msg);
+		execution.execType = ordStatus.getValue();
+		execution.cumQty = cumQty.getValue();
+		execution.avgPx = avgPx.getValue();
+	}
+	else if (FIX::ExecType_FILL == execType.getValue() || FIX::ExecType_PARTIAL_FILL == execType.getValue())
 	{
 		FIX::LastShares lastQty;
 		FIX::LastPx lastPx;
-		msg.get(symbol);
-		msg.get(maturityMonthYear);
-		msg.get(side);
 		msg.get(lastQty);
 		msg.get(lastPx);
-
-		// Let our Strategy know about the fill:
-		if (FIX::Side_BUY == side)
-		{
-			strategy_.OnOrderFill(*this, SimpleSide::BUY, lastQty.getValue(), lastPx.getValue());
-		}
-		else if (FIX::Side_SELL == side)
-		{
-			strategy_.OnOrderFill(*this, SimpleSide::SELL, lastQty.getValue(), lastPx.getValue());
-		}
+		execution.instrument = ResolveInstrument(msg);
+		execution.lastQty = lastQty.getValue();
+		execution.lastPx = lastPx.getValue();
 	}
 	else if (FIX::ExecType_REJECTED == execType.getValue())
 	{
 		FIX::OrderQty orderQty;
-		msg.get(symbol);
-		msg.get(maturityMonthYear);
-		msg.get(side);
 		msg.get(orderQty);
+		execution.instrument = ResolveInstrument(msg);
+		execution.orderQty = orderQty.getValue();
+
+		LOG_WARN("RECEIVED REJECT: {}", msg.toString());
+	}
+	else if (FIX::ExecType_NEW != execType.getValue() && FIX::ExecType_CANCELED != execType.getValue() && FIX::ExecType_REPLACE != execType.getValue())
+	{
+		LOG_WARN("Not sure what to do with ExecutionReport with ExecType={}: {}", execType.getValue(), msg.toString());
+		return;
+	}
+
+	DispatchExecution(EVENT_EXECUTION, execution);
+}
+
+// Update order state and position first, so the Strategy sees them updated,
+// then tell the Strategy about fills and rejects.  A NEW means our order was
+// accepted; a CANCELED or REPLACE means a cancel or cancel/replace we sent
+// took effect, and the replaced order now goes by the ClOrdID
+// SendCancelReplaceOrder returned.
+void Simple::ProcessExecution(const ExecutionEvent& execution)
+{
+	if (execution.status)
+	{
+		ReconcileOrder(execution);
+		return;
+	}
+
+	UpdateRisk(execution);
+	orders_.OnExecutionReport(execution.clOrdId.str(), execution.origClOrdId.str(), execution.instrument,
+		execution.side, execution.execType, execution.lastQty, execution.lastPx);
+	SaveState(execution.msgSeqNum);
+
+	if (FIX::Side_BUY != execution.side && FIX::Side_SELL != execution.side)
+		return;
+	const SimpleSide side = static_cast<SimpleSide>(execution.side);
+
+	PROBE_STRATEGY_ENTER();
+	if (FIX::ExecType_FILL == execution.execType || FIX::ExecType_PARTIAL_FILL == execution.execType)
+		strategy_.OnOrderFill(*this, execution.instrument, side, execution.lastQty, execution.lastPx);
+	else if (FIX::ExecType_REJECTED == execution.execType)
+		strategy_.OnOrderReject(*this, execution.instrument, side, execution.orderQty);
+	PROBE_STRATEGY_EXIT();
+}
+
+// Release what the RiskGate counted as working for quantity that will no
+// longer fill.  Runs before the OrderManager applies the report, so the
+// orders involved are still as they were when the report was sent.
+void Simple::UpdateRisk(const ExecutionEvent& execution)
+{
+	const Order* order = orders_.Find(execution.clOrdId.c_str(), execution.clOrdId.size);
+	switch (execution.execType)
+	{
+	case FIX::ExecType_PARTIAL_FILL:
+	case FIX::ExecType_FILL:
+		if (order && !order->IsTerminal())
+			risk_.OnFill(order->instrument, order->account, order->side, execution.lastQty);
+		break;
+	case FIX::ExecType_CANCELED:
+	{
+		// ClOrdID is the cancel request's; the order is OrigClOrdID.
+		const Order* canceled = orders_.Find(execution.origClOrdId.c_str(), execution.origClOrdId.size);
+		if (!canceled) canceled = order;
+		if (canceled && !canceled->IsTerminal())
+			risk_.Release(canceled->instrument, canceled->account, canceled->side, canceled->orderQty - canceled->cumQty);
+		break;
+	}
+	case FIX::ExecType_REJECTED:
+		if (order && !order->IsTerminal())
+			risk_.Release(order->instrument, order->account, order->side, order->orderQty - order->cumQty);
+		break;
+	case FIX::ExecType_REPLACE:
+	{
+		// The replacement was counted in full; it takes over the original's
+		// fills, and the original stops working.
+		const Order* orig = orders_.Find(execution.origClOrdId.c_str(), execution.origClOrdId.size);
+		if (order && orig && !orig->IsTerminal())
+			risk_.Release(orig->instrument, orig->account, orig->side, orig->orderQty);
+		break;
+	}
+	}
+}
+
+// Bring a recovered order in line with the venue's answer to
+// RequestOrderStatus(), by replaying what we missed as ordinary execution
+// reports: fills we never saw as one at the price that explains the venue's
+// average, then the order's end if it has ended.
+void Simple::ReconcileOrder(const ExecutionEvent& status)
+{
+	const Order* order = orders_.Find(status.clOrdId.c_str(), status.clOrdId.size);
+	if (!order || order->IsTerminal()) return;
+
+	ExecutionEvent missed = status;
+	missed.origClOrdId = ToIdString(nullptr, 0);
+	missed.instrument = order->instrument;
+	missed.side = order->side;
+	missed.orderQty = order->orderQty;
+	missed.msgSeqNum = 0;
+	missed.status = false;
+
+	const double missedQty = status.cumQty - order->cumQty;
+	if (missedQty > 0)
+	{
+		missed.execType = status.cumQty >= order->orderQty ? FIX::ExecType_FILL : FIX::ExecType_PARTIAL_FILL;
+		missed.lastQty = missedQty;
+		missed.lastPx = (status.avgPx * status.cumQty - order->avgPx * order->cumQty) / missedQty;
+		LOG_WARN("Order {} filled {} @ {} while we were down", status.clOrdId.c_str(), missed.lastQty, missed.lastPx);
+		ProcessExecution(missed);
+		if (order->IsTerminal()) return;
+	}
 
-		// Let our Strategy know about the reject
-		if (FIX::Side_BUY == side)
+	missed.lastQty = 0;
+	missed.lastPx = 0;
+	switch (status.execType)
+	{
+	case FIX::OrdStatus_NEW:
+	case FIX::OrdStatus_PARTIALLY_FILLED:
+		// Still working; acknowledges an order that was pending:
+		missed.execType = FIX::ExecType_NEW;
+		break;
+	case FIX::OrdStatus_CANCELED:
+	case FIX::OrdStatus_DONE_FOR_DAY:
+	case FIX::OrdStatus_EXPIRED:
+		missed.execType = FIX::ExecType_CANCELED;
+		break;
+	case FIX::OrdStatus_REJECTED:
+		// Unknown to the venue.  One that never got there was rejected; one
+		// it had accepted is gone, and whatever filled is lost with it.
+		if (ORDER_PENDING_NEW == order->state)
 		{
-			strategy_.OnOrderReject(*this, SimpleSide::BUY, orderQty.getValue());
+			missed.execType = FIX::ExecType_REJECTED;
 		}
-		else if (FIX::Side_SELL == side)
+		else
 		{
-			strategy_.OnOrderReject(*this, SimpleSide::SELL, orderQty.getValue());
+			LOG_WARN("Order {} is unknown to the venue; treating it as canceled", status.clOrdId.c_str());
+			missed.execType = FIX::ExecType_CANCELED;
 		}
+		break;
+	default:
+		return;
+	}
+	ProcessExecution(missed);
+}
+
+void Simple::ProcessCancelReject(const ExecutionEvent& reject)
+{
+	// A refused cancel/replace: its replacement will never work.
+	const Order* replacement = orders_.Find(reject.clOrdId.c_str(), reject.clOrdId.size);
+	if (replacement && ORDER_PENDING_REPLACE == replacement->state)
+		risk_.Release(replacement->instrument, replacement->account, replacement->side, replacement->orderQty);
+
+	orders_.OnCancelReject(reject.clOrdId.str(), reject.origClOrdId.str());
+	SaveState();
+}
+
+void Simple::DispatchExecution(int type, const ExecutionEvent& execution)
+{
+	if (pipeline_)
+	{
+		InboundEvent& event = pipeline_->ClaimInbound();
+		event.type = type;
+		event.instrument = execution.instrument;
+		event.execution = execution;
+		pipeline_->PublishInbound(event);
+	}
+	else if (EVENT_EXECUTION == type)
+	{
+		ProcessExecution(execution);
+	}
+	else
+	{
+		ProcessCancelReject(execution);
+	}
+}
+
+void Simple::DispatchMdEntry(InstrumentId instrument, const MdEntry& entry)
+{
+	if (currentShard)
+	{
+		currentShard->Apply(instrument, entry);
+		return;
+	}
+
+	if (pipeline_)
+	{
+		InboundEvent& event = pipeline_->ClaimInbound();
+		event.type = EVENT_MD_ENTRY;
+		event.instrument = instrument;
+		event.timeNs = currentMdTimeNs;
+		event.md = entry;
+		pipeline_->PublishInbound(event);
+	}
+	else
+	{
+		eventTimeNs_ = currentMdTimeNs;
+		ApplyMdEntry(instrument, entry);
+	}
+}
+
+void Simple::DispatchBookClear(InstrumentId instrument)
+{
+	if (currentShard)
+	{
+		currentShard->ClearBook(instrument);
+		return;
+	}
+
+	if (pipeline_)
+	{
+		InboundEvent& event = pipeline_->ClaimInbound();
+		event.type = EVENT_BOOK_CLEAR;
+		event.instrument = instrument;
+		event.timeNs = currentMdTimeNs;
+		pipeline_->PublishInbound(event);
+	}
+	else
+	{
+		eventTimeNs_ = currentMdTimeNs;
+		ClearBook(instrument);
+	}
+}
+
+void Simple::DispatchEndOfMarketData()
+{
+	if (currentShard)
+	{
+		currentShard->EndOfMessage(currentMdTimeNs);
+		return;
+	}
 
-		std::cout << std::endl << "RECEIVED REJECT: " << msg << std::endl;
+	if (pipeline_)
+	{
+		InboundEvent& event = pipeline_->ClaimInbound();
+		event.type = EVENT_MD_END;
+		event.instrument = INVALID_INSTRUMENT;
+		event.timeNs = currentMdTimeNs;
+		pipeline_->PublishInbound(event);
 	}
-	else if (FIX::ExecType_NEW == execType.getValue())
+	else
 	{
-		// Our order was accepted (but has not yet been filled)
-		// You may want to change your book keeping to indicate the order is ack'd by the exchange
+		eventTimeNs_ = currentMdTimeNs;
+		PublishBookChanges();
+	}
+}
+
+// The strategy thread's half of the Dispatch* methods above.
+void Simple::HandleEvent(const InboundEvent& event, bool backlog)
+{
+	PROBE_RESUME_FROMAPP(event.fromAppTsc);
+	switch (event.type)
+	{
+	case EVENT_MD_ENTRY:
+		eventTimeNs_ = event.timeNs;
+		ApplyMdEntry(event.instrument, event.md);
+		break;
+	case EVENT_BOOK_CLEAR:
+		eventTimeNs_ = event.timeNs;
+		ClearBook(event.instrument);
+		break;
+	case EVENT_MD_END:
+		eventTimeNs_ = event.timeNs;
+		// More queued behind this message means whatever we tell the
+		// Strategy now is already stale:
+		if (conflateBooks_ && backlog)
+			DeferBookChanges();
+		else
+			PublishBookChanges();
+		break;
+	case EVENT_EXECUTION:
+		// Deferred market data arrived first, so the Strategy hears about it first:
+		if (!changedBooks_.empty() || !tradedInstruments_.empty())
+			PublishBookChanges();
+		ProcessExecution(event.execution);
+		break;
+	case EVENT_CANCEL_REJECT:
+		ProcessCancelReject(event.execution);
+		break;
+	}
+	PROBE_RESUME_FROMAPP(0);
+}
+
+// The strategy thread's half of a MarketDataShard: books arrive already
+// built, as of the end of a message.
+void Simple::HandleShardUpdate(const ShardUpdate& update, bool backlog)
+{
+	PROBE_RESUME_FROMAPP(update.fromAppTsc);
+	eventTimeNs_ = update.timeNs;
+	switch (update.type)
+	{
+	case SHARD_ENTRY:
+		ApplyMdEntry(update.instrument, update.entry);
+		break;
+	case SHARD_BOOK:
+		books_[update.instrument] = update.book;
+		MarkBookChanged(update.instrument);
+		break;
+	case SHARD_END:
+		if (conflateBooks_ && backlog)
+			DeferBookChanges();
+		else
+			PublishBookChanges();
+		break;
+	}
+	PROBE_RESUME_FROMAPP(0);
+}
+
+MarketDataShard* Simple::FindShard(const FIX::SessionID& sessionId) const
+{
+	for (size_t i = 0; i < shards_.size(); ++i)
+	{
+		if (shards_[i]->Session() == sessionId) return shards_[i];
+	}
+	return nullptr;
+}
+
+// A snapshot replaces whatever we had, so the book is rebuilt from scratch.
+void Simple::ClearBook(InstrumentId instrument)
+{
+	books_[instrument].Clear();
+	MarkBookChanged(instrument);
+}
+
+// Queue the book for a single notification at the end of the message.
+void Simple::MarkBookChanged(InstrumentId instrument)
+{
+	switch (bookDirty_[instrument])
+	{
+	case BOOK_CLEAN:
+		bookDirty_[instrument] = BOOK_CHANGED;
+		changedBooks_.push_back(instrument);
+		break;
+	case BOOK_DEFERRED:
+		bookDirty_[instrument] = BOOK_DEFERRED_CHANGED;
+		break;
+	}
+}
+
+
+// Copy one NoMDEntries group into an MdEntry.  MDPriceLevel is not part of
+// the FIX 4.2 group definition, so it is read as a plain field if present.
+template <class TGroup>
+static MdEntry ReadMdEntry(const TGroup& group, char action)
+{
+	FIX::MDEntryType type;
+	MdEntry entry;
+
+	group.get(type);
+	entry.type = type.getValue();
+	entry.action = action;
+	entry.level = 0;
+	entry.px = 0;
+	entry.qty = 0;
+
+	if (group.isSetField(FIX::FIELD::MDPriceLevel))
+	{
+		FIX::MDPriceLevel level;
+		group.getField(level);
+		entry.level = level.getValue();
+	}
+	if (group.isSetField(FIX::FIELD::MDEntryPx))
+	{
+		FIX::MDEntryPx px;
+		group.get(px);
+		entry.px = px.getValue();
+	}
+	if (group.isSetField(FIX::FIELD::MDEntrySize))
+	{
+		FIX::MDEntrySize qty;
+		group.get(qty);
+		entry.qty = qty.getValue();
+	}
+	return entry;
+}
+
+// The first MDEntryTime of a message, copied out of its group for the FeedMonitor.
+struct MdEntryTime
+{
+	char data[32];
+	int size;
+
+	MdEntryTime() : size(0) {}
+
+	void Capture(const FIX::FieldMap& group)
+	{
+		if (size || !group.isSetField(FIX::FIELD::MDEntryTime)) return;
+		const std::string& time = group.getField(FIX::FIELD::MDEntryTime);
+		size = static_cast<int>(time.size() < sizeof(data) ? time.size() : sizeof(data));
+		std::memcpy(data, time.data(), size);
+	}
+
+	FieldView View() const
+	{
+		FieldView view = { data, size };
+		return view;
+	}
+};
+
+// Same as ResolveInstrument, for fields that point into a raw message buffer.
+InstrumentId Simple::ResolveInstrument(const FieldView& symbol, const FieldView& maturityMonthYear, const FieldView& exchange) const
+{
+	if (symbol.empty())
+		return 1 == instruments_.Size() ? 0 : INVALID_INSTRUMENT;
+
+	if (exchange.empty())
+		return instruments_.Find(symbol.data, symbol.size, maturityMonthYear.data, maturityMonthYear.size, DEFAULT_EXCHANGE.data(), DEFAULT_EXCHANGE.size());
+	return instruments_.Find(symbol.data, symbol.size, maturityMonthYear.data, maturityMonthYear.size, exchange.data, exchange.size);
+}
+
+// Look up the instrument named by the Symbol/MaturityMonthYear/SecurityExchange
+// fields of a message or repeating group.  The strings are hashed in place.
+InstrumentId Simple::ResolveInstrument(const FIX::FieldMap& fields) const
+{
+	static const std::string none;
+
+	if (!fields.isSetField(FIX::FIELD::Symbol))
+	{
+		// Venues that only quote what we asked for may leave the symbol out:
+		return 1 == instruments_.Size() ? 0 : INVALID_INSTRUMENT;
+	}
+
+	const std::string& symbol = fields.getField(FIX::FIELD::Symbol);
+	const std::string& maturityMonthYear = fields.isSetField(FIX::FIELD::MaturityMonthYear) ? fields.getField(FIX::FIELD::MaturityMonthYear) : none;
+	const std::string& exchange = fields.isSetField(FIX::FIELD::SecurityExchange) ? fields.getField(FIX::FIELD::SecurityExchange) : DEFAULT_EXCHANGE;
+	return instruments_.Find(symbol, maturityMonthYear, exchange);
+}
+
+// The instrument a market data message refers to as a whole: its own
+// instrument fields if it has them, otherwise the MDReqID we subscribed with.
+InstrumentId Simple::ResolveMdMessage(const FIX::Message& msg) const
+{
+	if (!msg.isSetField(FIX::FIELD::Symbol) && msg.isSetField(FIX::FIELD::MDReqID))
+	{
+		InstrumentId instrument = instruments_.FindByRequest(msg.getField(FIX::FIELD::MDReqID));
+		if (INVALID_INSTRUMENT != instrument) return instrument;
+	}
+	return ResolveInstrument(msg);
+}
+
+// Apply one entry to the instrument's book, or pass it straight on if it is a
+// trade.  Books that change are queued for a single notification per message.
+void Simple::ApplyMdEntry(InstrumentId instrument, const MdEntry& entry)
+{
+	if (FIX::MDEntryType_BID == entry.type || FIX::MDEntryType_OFFER == entry.type)
+	{
+		if (books_[instrument].Apply(entry))
+			MarkBookChanged(instrument);
+	}
+	else if (FIX::MDEntryType_TRADE == entry.type)
+	{
+		if (FIX::MDUpdateAction_DELETE != entry.action)
+		{
+			orders_.Mark(instrument, entry.px);
+			if (conflateTrades_)
+			{
+				// Delivered as one print with the books, see PublishBookChanges():
+				if (0 == tradeCount_[instrument]++)
+					tradedInstruments_.push_back(instrument);
+				tradeQty_[instrument] += entry.qty;
+				tradePx_[instrument] = entry.px;
+				return;
+			}
+			PROBE_STRATEGY_ENTER();
+			strategy_.OnLastTradeUpdate(*this, instrument, entry.qty, entry.px);
+			PROBE_STRATEGY_EXIT();
+		}
 	}
 	else
 	{
-		std::cout << "Not sure what to do with ExecutionReport with ExecType=" << execType << ": " << msg << std::endl;
+		LOG_WARN("Unknown MDEntryType: {}", entry.type);
+	}
+}
+
+// Tell the Strategy about every book that changed in the current message,
+// and in any messages deferred before it.  Aggregated trades go first: the
+// total volume at the last price.
+void Simple::PublishBookChanges()
+{
+	for (size_t i = 0; i < tradedInstruments_.size(); ++i)
+	{
+		InstrumentId instrument = tradedInstruments_[i];
+		conflatedTrades_ += tradeCount_[instrument] - 1;
+		PROBE_STRATEGY_ENTER();
+		strategy_.OnLastTradeUpdate(*this, instrument, tradeQty_[instrument], tradePx_[instrument]);
+		PROBE_STRATEGY_EXIT();
+		tradeCount_[instrument] = 0;
+		tradeQty_[instrument] = 0;
 	}
+	tradedInstruments_.clear();
+
+	for (size_t i = 0; i < changedBooks_.size(); ++i)
+	{
+		InstrumentId instrument = changedBooks_[i];
+		if (BOOK_DEFERRED_CHANGED == bookDirty_[instrument]) ++conflatedBookUpdates_;
+		bookDirty_[instrument] = BOOK_CLEAN;
+		if (checkpoint_) checkpoint_->SaveBook(instrument, books_[instrument]);
+		PROBE_STRATEGY_ENTER();
+		strategy_.OnBookUpdate(*this, instrument, books_[instrument]);
+		PROBE_STRATEGY_EXIT();
+	}
+	changedBooks_.clear();
 }
 
+// Hold back the notifications for the current message; the books keep
+// changing in place and the Strategy hears about the latest of them.
+void Simple::DeferBookChanges()
+{
+	for (size_t i = 0; i < changedBooks_.size(); ++i)
+	{
+		InstrumentId instrument = changedBooks_[i];
+		if (BOOK_DEFERRED_CHANGED == bookDirty_[instrument]) ++conflatedBookUpdates_;
+		bookDirty_[instrument] = BOOK_DEFERRED;
+	}
+}
 
 void Simple::onMessage(const FIX42::MarketDataSnapshotFullRefresh& msg, const FIX::SessionID&)
 {
+	const int64_t receiptNs = StampMarketData();
+
+	InstrumentId instrument = ResolveMdMessage(msg);
+	if (INVALID_INSTRUMENT == instrument)
+	{
+		LOG_WARN("MarketDataSnapshotFullRefresh for an instrument we did not subscribe to");
+		if (feedMonitor_) MonitorMdMessage(msg, receiptNs, MdEntryTime().View());
+		return;
+	}
+
+	DispatchBookClear(instrument);
 
+	MdEntryTime entryTime;
 	FIX::NoMDEntries noMDEntries;
 	msg.get(noMDEntries);
 	for (int i = 1; i <= noMDEntries; ++i)
 	{
 		FIX42::MarketDataSnapshotFullRefresh::NoMDEntries group;
-		FIX::MDEntryType type;
-		FIX::MDEntryPx px;
-		FIX::MDEntrySize qty;
-
 		msg.getGroup(i, group);
-		group.get(type);
-		group.get(px);
-		group.get(qty);
+		if (feedMonitor_) entryTime.Capture(group);
+		DispatchMdEntry(instrument, ReadMdEntry(group, FIX::MDUpdateAction_NEW));
+	}
 
-		if (FIX::MDEntryType_BID == type.getValue())
-		{
-			strategy_.OnBestBidUpdate(*this, qty.getValue(), px.getValue());
-		}
-		else if (FIX::MDEntryType_OFFER == type.getValue())
-		{
-			strategy_.OnBestOfferUpdate(*this, qty.getValue(), px.getValue());
-		}
-		else if (FIX::MDEntryType_TRADE == type.getValue())
-		{
-			strategy_.OnLastTradeUpdate(*this, qty.getValue(), px.getValue());
-		}
-		else
-		{
-			std::cout << "Unknown MDEntryType: " << type << std::endl;
-		}
+	if (feedMonitor_)
+	{
+		MonitorMdMessage(msg, receiptNs, entryTime.View());
+		feedMonitor_->OnUpdate(instrument, receiptNs);
 	}
+
+	DispatchEndOfMarketData();
 }
 
 void Simple::onMessage(const FIX42::MarketDataIncrementalRefresh& msg, const FIX::SessionID&)
 {
+	const int64_t receiptNs = StampMarketData();
+
+	// Resolve the MDReqID once for the whole message; entries that carry
+	// their own Symbol are resolved individually.
+	InstrumentId msgInstrument = INVALID_INSTRUMENT;
+	if (msg.isSetField(FIX::FIELD::MDReqID))
+		msgInstrument = instruments_.FindByRequest(msg.getField(FIX::FIELD::MDReqID));
+
+	MdEntryTime entryTime;
+	InstrumentId monitored = INVALID_INSTRUMENT;
 	FIX::NoMDEntries noMDEntries;
 	msg.get(noMDEntries);
 	for (int i = 1; i <= noMDEntries; ++i)
 	{
 		FIX42::MarketDataIncrementalRefresh::NoMDEntries group;
-		FIX::MDEntryType type;
-		FIX::MDEntryPx px;
-		FIX::MDEntrySize qty;
 		FIX::MDUpdateAction action;
 
 		msg.getGroup(i, group);
-		group.get(type);
-		group.get(px);
-		group.get(qty);
 		group.get(action);
 
-		if (FIX::MDUpdateAction_NEW == action.getValue() || FIX::MDUpdateAction_CHANGE == action.getValue())
+		// An entry that names its instrument wins, unless the name does not
+		// resolve (e.g. no MaturityMonthYear) and the MDReqID did:
+		InstrumentId instrument = msgInstrument;
+		if (INVALID_INSTRUMENT == instrument || group.isSetField(FIX::FIELD::Symbol))
 		{
-			if (FIX::MDEntryType_BID == type.getValue())
-			{
-				strategy_.OnBestBidUpdate(*this, qty.getValue(), px.getValue());
-			}
-			else if (FIX::MDEntryType_OFFER == type.getValue())
+			const InstrumentId named = ResolveInstrument(group);
+			if (INVALID_INSTRUMENT != named) instrument = named;
+		}
+		if (INVALID_INSTRUMENT == instrument)
+			continue;
+
+		if (feedMonitor_)
+		{
+			entryTime.Capture(group);
+			// Entries for one instrument come together; count the message once for it:
+			if (instrument != monitored) feedMonitor_->OnUpdate(instrument, receiptNs);
+			monitored = instrument;
+		}
+		DispatchMdEntry(instrument, ReadMdEntry(group, action.getValue()));
+	}
+
+	if (feedMonitor_)
+		MonitorMdMessage(msg, receiptNs, entryTime.View());
+
+	// One notification per changed book, however many levels the message touched:
+	DispatchEndOfMarketData();
+}
+
+// Hand the message's MsgSeqNum and SendingTime to the FeedMonitor.
+void Simple::MonitorMdMessage(const FIX::Message& msg, int64_t receiptNs, const FieldView& entryTime)
+{
+	static const std::string none;
+
+	const FIX::FieldMap& header = msg.getHeader();
+	const std::string& msgSeqNum = header.isSetField(FIX::FIELD::MsgSeqNum) ? header.getField(FIX::FIELD::MsgSeqNum) : none;
+	const std::string& sendingTime = header.isSetField(FIX::FIELD::SendingTime) ? header.getField(FIX::FIELD::SendingTime) : none;
+	const FieldView seqView = { msgSeqNum.data(), static_cast<int>(msgSeqNum.size()) };
+	const FieldView sentView = { sendingTime.data(), static_cast<int>(sendingTime.size()) };
+	feedMonitor_->OnMessage(receiptNs, seqView, sentView, entryTime);
+}
+
+// Fast path for market data refreshes: decode the raw tag=value buffer in a
+// single pass into a stack array instead of copying every NoMDEntries group
+// out of QuickFIX's field maps.  Returns false if the message should go
+// through crack() instead.
+bool Simple::OnRawMarketData(const FIX::Message& message)
+{
+	const RawMessage& raw = CurrentRawMessage();
+	if (!raw.data) return false;
+
+	const std::string& msgType = message.getHeader().getField(FIX::FIELD::MsgType);
+	if (msgType.size() != 1 || ('X' != msgType[0] && 'W' != msgType[0])) return false;
+
+	FastMdMessage md;
+	if (!ParseFastMd(raw.data, raw.size, md)) return false;
+
+	// QuickFIX may be handing us a message it queued earlier, in which case
+	// the captured buffer belongs to a different one:
+	const std::string& msgSeqNum = message.getHeader().getField(FIX::FIELD::MsgSeqNum);
+	if (msgSeqNum.compare(0, std::string::npos, md.msgSeqNum.data, md.msgSeqNum.size) != 0) return false;
+
+	ApplyMarketData(md);
+	return true;
+}
+
+/// Apply a decoded market data refresh and notify the Strategy.
+void Simple::ApplyMarketData(const FastMdMessage& md)
+{
+	const int64_t receiptNs = StampMarketData();
+	if (feedMonitor_)
+		feedMonitor_->OnMessage(receiptNs, md.msgSeqNum, md.sendingTime, md.entryTime);
+
+	if ('W' == md.msgType)
+	{
+		InstrumentId instrument = INVALID_INSTRUMENT;
+		if (md.symbol.empty() && !md.mdReqId.empty())
+			instrument = instruments_.FindByRequest(md.mdReqId.data, md.mdReqId.size);
+		if (INVALID_INSTRUMENT == instrument)
+			instrument = ResolveInstrument(md.symbol, md.maturityMonthYear, md.exchange);
+		if (INVALID_INSTRUMENT == instrument)
+		{
+			LOG_WARN("MarketDataSnapshotFullRefresh for an instrument we did not subscribe to");
+			return;
+		}
+
+		if (feedMonitor_) feedMonitor_->OnUpdate(instrument, receiptNs);
+		DispatchBookClear(instrument);
+		for (int i = 0; i < md.count; ++i)
+			DispatchMdEntry(instrument, md.entries[i].md);
+	}
+	else
+	{
+		InstrumentId msgInstrument = INVALID_INSTRUMENT;
+		if (!md.mdReqId.empty())
+			msgInstrument = instruments_.FindByRequest(md.mdReqId.data, md.mdReqId.size);
+
+		InstrumentId monitored = INVALID_INSTRUMENT;
+		for (int i = 0; i < md.count; ++i)
+		{
+			const FastMdEntry& entry = md.entries[i];
+			InstrumentId instrument = msgInstrument;
+			if (INVALID_INSTRUMENT == instrument || !entry.symbol.empty())
 			{
-				strategy_.OnBestOfferUpdate(*this, qty.getValue(), px.getValue());
+				const InstrumentId named = ResolveInstrument(entry.symbol, entry.maturityMonthYear, entry.exchange);
+				if (INVALID_INSTRUMENT != named) instrument = named;
 			}
-			else if (FIX::MDEntryType_TRADE == type.getValue())
+			if (INVALID_INSTRUMENT == instrument)
+				continue;
+
+			if (feedMonitor_ && instrument != monitored)
+				feedMonitor_->OnUpdate(instrument, receiptNs);
+			monitored = instrument;
+			DispatchMdEntry(instrument, entry.md);
+		}
+	}
+
+	DispatchEndOfMarketData();
+	DeliverSimulatedFills();
+}
+
+/// Apply entries for one instrument, e.g. top-of-book updates read back from
+/// a Write2Txt file, and notify the Strategy.
+void Simple::ApplyMarketData(InstrumentId instrument, const MdEntry* entries, int count)
+{
+	eventTimeNs_ = StampMarketData();
+	for (int i = 0; i < count; ++i)
+		ApplyMdEntry(instrument, entries[i]);
+
+	PublishBookChanges();
+	DeliverSimulatedFills();
+}
+
+/// Stamp the market data message the calling thread is about to hand on:
+/// the recorded time in a replay, otherwise the time it arrived.
+int64_t Simple::StampMarketData()
+{
+	currentMdTimeNs = replaying_ ? replayTimeNs_ : clock_.NowNs();
+	return currentMdTimeNs;
+}
+
+// Decode synthetic market data the way the handlers do and apply it to a
+// scratch book, so the parser, the book code and the instrument lookup are
+// in cache for the first live message.  Nothing reaches the Strategy, and
+// the InstrumentRegistry is only searched, so OnInit still hands out ids from 0.
+void Simple::WarmUp(int messages)
+{
+	if (messages <= 0) return;
+
+	// A full book for an instrument nobody subscribes to:
+	FIX42::MarketDataIncrementalRefresh msg;
+	msg.getHeader().setField(FIX::MsgSeqNum(1));
+	for (int level = 1; level <= MAX_BOOK_DEPTH; ++level)
+	{
+		FIX42::MarketDataIncrementalRefresh::NoMDEntries group;
+		group.set(FIX::MDUpdateAction(FIX::MDUpdateAction_NEW));
+		group.set(FIX::MDEntryType(level % 2 ? FIX::MDEntryType_BID : FIX::MDEntryType_OFFER));
+		group.set(FIX::Symbol("WARMUP"));
+		group.set(FIX::MaturityMonthYear("000000"));
+		group.set(FIX::MDEntryPx(level % 2 ? 100.0 - level : 100.0 + level));
+		group.set(FIX::MDEntrySize(level));
+		msg.addGroup(group);
+	}
+	const std::string raw = msg.toString();
+
+	OrderBook book(MAX_BOOK_DEPTH);
+	FastMdMessage md;
+	for (int i = 0; i < messages; ++i)
+	{
+		book.Clear();
+		if (fastMarketData_)
+		{
+			if (!ParseFastMd(raw.data(), raw.size(), md)) break;
+			for (int j = 0; j < md.count; ++j)
 			{
-				strategy_.OnLastTradeUpdate(*this, qty.getValue(), px.getValue());
+				const FastMdEntry& entry = md.entries[j];
+				ResolveInstrument(entry.symbol, entry.maturityMonthYear, entry.exchange);
+				book.Apply(entry.md);
 			}
-			else
+		}
+		else
+		{
+			FIX::NoMDEntries noMDEntries;
+			msg.get(noMDEntries);
+			for (int j = 1; j <= noMDEntries; ++j)
 			{
-				std::cout << "Unknown MDEntryType: " << type << std::endl;
+				FIX42::MarketDataIncrementalRefresh::NoMDEntries group;
+				FIX::MDUpdateAction action;
+				msg.getGroup(j, group);
+				group.get(action);
+				ResolveInstrument(group);
+				book.Apply(ReadMdEntry(group, action.getValue()));
 			}
 		}
 	}
+	std::cout << "[init] Warmed up with " << messages << " market data messages" << std::endl;
+}
+
+// Hand fills queued by the FillSimulator to the Strategy.
+void Simple::DeliverSimulatedFills()
+{
+	if (!fillSimulator_) return;
+
+	SimulatedFill fill;
+	while (fillSimulator_->PopFill(fill))
+	{
+		ExecutionEvent execution;
+		execution.clOrdId = fill.clOrdId;
+		execution.origClOrdId = ToIdString(nullptr, 0);
+		execution.instrument = fill.instrument;
+		execution.side = fill.side;
+		execution.execType = fill.execType;
+		execution.orderQty = fill.qty;
+		execution.lastQty = fill.qty;
+		execution.lastPx = fill.px;
+		execution.cumQty = 0;
+		execution.avgPx = 0;
+		execution.msgSeqNum = 0;
+		execution.status = false;
+		ProcessExecution(execution);
+	}
 }
 
-void Simple::onMessage(const FIX42::MarketDataRequestReject& msg, const FIX::SessionID&)
+void Simple::onMessage(const FIX42::MarketDataRequestReject& msg, const FIX::SessionID& sessionId)
 {
 	FIX::MDReqID reqId;
 	FIX::MDReqRejReason reason;
@@ -249,7 +1414,43 @@ void Simple::onMessage(const FIX42::MarketDataRequestReject& msg, const FIX::Ses
 
 	if (msg.isSetField(FIX::FIELD::Text)) msg.get(text);
 
-	std::cout << "MarketDataRequestReject: MDReqID=" << reqId << ", reason=" << reason << ", text=" << text << std::endl;
+	LOG_WARN("MarketDataRequestReject: MDReqID={}, reason={}, text={}", reqId.getValue(), reason.getValue(), text.getValue());
+
+	// Split a rejected batch up, or retry a rejected instrument:
+	MarketDataShard* shard = FindShard(sessionId);
+	(shard ? shard->Subscriptions() : subscriptions_).OnReject(reqId.getValue(), sessionId);
+}
+
+void Simple::onMessage(const FIX42::OrderCancelReject& msg, const FIX::SessionID&)
+{
+	FIX::ClOrdID clOrdId;
+	FIX::OrigClOrdID origClOrdId;
+	FIX::CxlRejResponseTo responseTo;
+	FIX::Text text;
+
+	msg.get(clOrdId);
+	msg.get(origClOrdId);
+	msg.get(responseTo);
+	if (msg.isSetField(FIX::FIELD::Text)) msg.get(text);
+
+	LOG_WARN("OrderCancelReject: {} ClOrdID={}, OrigClOrdID={}, text={}", FIX::CxlRejResponseTo_ORDER_CANCEL_REQUEST == responseTo ? "cancel" : "cancel/replace",
+		clOrdId.getValue(), origClOrdId.getValue(), text.getValue());
+
+	// The order named by OrigClOrdID is unchanged (or already gone)
+	ExecutionEvent reject;
+	reject.clOrdId = ToIdString(clOrdId.getValue());
+	reject.origClOrdId = ToIdString(origClOrdId.getValue());
+	reject.instrument = INVALID_INSTRUMENT;
+	reject.side = 0;
+	reject.execType = responseTo.getValue();
+	reject.orderQty = 0;
+	reject.lastQty = 0;
+	reject.lastPx = 0;
+	reject.cumQty = 0;
+	reject.avgPx = 0;
+	reject.msgSeqNum = 0;
+	reject.status = false;
+	DispatchExecution(EVENT_CANCEL_REJECT, reject);
 }
 
 
@@ -268,14 +1469,40 @@ void Simple::onLogon(const FIX::SessionID& sessionId)
 	// Grab our custom "MyMarketDataSession" parameter (if it exists) from the SessionSettings
 	if(settings->has("MyMarketDataSession") && settings->getBool("MyMarketDataSession"))
 	{
-		mdSessionId_ = sessionId;
-		std::cout << "[onLogon] " << mdSessionId_ << " (MyMarketDataSession)" << std::endl;
+		// With shards, market data is up once every shard's session is:
+		MarketDataShard* shard = FindShard(sessionId);
+		{
+			std::lock_guard<std::mutex> lock(logonMutex_);
+			mdSessionId_ = sessionId;
+			if(shard)
+			{
+				shardLoggedOn_[shard->Index()] = 1;
+				mdLoggedOn_ = std::find(shardLoggedOn_.begin(), shardLoggedOn_.end(), 0) == shardLoggedOn_.end();
+			}
+			else
+			{
+				mdLoggedOn_ = true;
+			}
+		}
+		logonChanged_.notify_all();
+		std::cout << "[onLogon] " << sessionId << " (MyMarketDataSession)" << std::endl;
+
+		// After a reconnect, ask for everything we had before:
+		if(shard)
+			shard->Subscriptions().OnLogon(sessionId);
+		else
+			subscriptions_.OnLogon(sessionId);
 	}
 
 	// Grab our custom "MyOrderSession" parameter (if it exists) from the SessionSettings
 	if(settings->has("MyOrderSession") && settings->getBool("MyOrderSession"))
 	{
-		orderSessionId_ = sessionId;
+		{
+			std::lock_guard<std::mutex> lock(logonMutex_);
+			orderSessionId_ = sessionId;
+			orderLoggedOn_ = true;
+		}
+		logonChanged_.notify_all();
 		std::cout << "[onLogon] " << orderSessionId_ << " (MyOrderSession)" << std::endl;
 	}
 }
@@ -346,7 +1573,11 @@ void Simple::toApp( FIX::Message& message, const FIX::SessionID& sessionID ) thr
 	catch(FIX::FieldNotFound &)
 	{ }
 
-	std::cout << std::endl << "OUT: " << message << std::endl;
+	// Closes the tick-to-trade span if this is the order SendMarketOrder just built:
+	PROBE_TOAPP_ORDER();
+
+	// Every message is in the FileLog too, so printing them is for debug builds:
+	LOG_DEBUG("OUT: {}", message.toString());
 }
 
 //-----------------------------------------------------------------------------
@@ -359,10 +1590,32 @@ void Simple::toApp( FIX::Message& message, const FIX::SessionID& sessionID ) thr
 // However, we would probably end up with a really, really long function if we
 // did that.  Instead, we usually just call the QF crack() function here, which
 // calls the proper onMessage() callback for whatever MsgType we just received.
+//
+// With MyFastMarketData=Y in the [DEFAULT] section, market data refreshes are
+// decoded from the raw buffer instead (see OnRawMarketData()); anything the
+// fast path does not understand still goes through crack().
 void Simple::fromApp( const FIX::Message& message, const FIX::SessionID& sessionID )
 	throw( FIX::FieldNotFound, FIX::IncorrectDataFormat, FIX::IncorrectTagValue, FIX::UnsupportedMessageType )
 {
-	crack( message, sessionID );
+	PROBE_FROMAPP_BEGIN();
+
+	// Market data from a shard's session goes to the shard's books; the
+	// session a thread reads only changes when QuickFIX reuses the thread:
+	if (!shards_.empty() && &sessionID != currentSession)
+	{
+		currentShard = FindShard(sessionID);
+		currentSession = &sessionID;
+	}
+
+	bool handled = fastMarketData_ && OnRawMarketData(message);
+
+	// The captured buffer is only valid while QuickFIX processes this message:
+	CurrentRawMessage().data = nullptr;
+
+	if (!handled)
+		crack( message, sessionID );
+
+	PROBE_FROMAPP_END();
 }
 
 
@@ -375,7 +1628,9 @@ void Simple::fromApp( const FIX::Message& message, const FIX::SessionID& session
 // these types of messages for us automatically.
 void Simple::fromAdmin( const FIX::Message&, const FIX::SessionID& ) 
 throw( FIX::FieldNotFound, FIX::IncorrectDataFormat, FIX::IncorrectTagValue, FIX::RejectLogon )
-{}
+{
+	CurrentRawMessage().data = nullptr;
+}
 
 
 //-----------------------------------------------------------------------------
@@ -391,6 +1646,25 @@ void Simple::onCreate( const FIX::SessionID& sessionId)
 void Simple::onLogout( const FIX::SessionID& sessionId )
 {
 	std::cout << "[onLogout] " << sessionId << std::endl;
+
+	MarketDataShard* shard = FindShard(sessionId);
+	bool marketData;
+	{
+		std::lock_guard<std::mutex> lock(logonMutex_);
+		if(shard)
+		{
+			marketData = 0 != shardLoggedOn_[shard->Index()];
+			shardLoggedOn_[shard->Index()] = 0;
+		}
+		else
+		{
+			marketData = mdLoggedOn_ && sessionId == mdSessionId_;
+		}
+		if(marketData) mdLoggedOn_ = false;
+		if(orderLoggedOn_ && sessionId == orderSessionId_) orderLoggedOn_ = false;
+	}
+	if(marketData)
+		(shard ? shard->Subscriptions() : subscriptions_).OnLogout();
 }
 
 
@@ -8,34 +8,150 @@
 #include <quickfix/FileLog.h>
 #include <quickfix/FileStore.h>
 #include <quickfix/SocketInitiator.h>
+#include <quickfix/ThreadedSocketInitiator.h>
 #include <quickfix/fix42/MarketDataRequest.h>
 #include <quickfix/fix42/MarketDataRequestReject.h>
 #include <quickfix/fix42/MarketDataSnapshotFullRefresh.h>
 #include <quickfix/fix42/MarketDataIncrementalRefresh.h>
 #include <quickfix/fix42/NewOrderSingle.h>
 #include <quickfix/fix42/ExecutionReport.h>
+#include <quickfix/fix42/OrderCancelReject.h>
+#include <quickfix/fix42/OrderStatusRequest.h>
 #include "IdHelper.h"
+#include "IdService.h"
+#include "OrderTemplates.h"
+#include "OrderManager.h"
+#include "OrderBook.h"
+#include "InstrumentRegistry.h"
+#include "FastMdParser.h"
+#include "RawMessageLog.h"
+#include "MessageStores.h"
+#include "EventPipeline.h"
+#include "MarketDataShard.h"
+#include "SubscriptionManager.h"
+#include "RiskGate.h"
+#include "StrategyBinding.h"
+#include "FeedMonitor.h"
+#include "StateCheckpoint.h"
+#include "Platform.h"
+#include <vector>
+#include <mutex>
+#include <condition_variable>
 
-class Strategy;
+class FillSimulator;
 
 enum SimpleSide { BUY = '1', SELL = '2' };
 
 /// A simple interface that allows our Strategy to subscribe to market data and send orders.
+///
+/// With MyStrategyThread=Y in the [DEFAULT] section, the Strategy runs on its
+/// own thread fed by an EventPipeline instead of on QuickFIX's socket thread.
+/// Its callbacks are then still called one at a time, but the Send* methods
+/// must only be called from OnInit or from those callbacks, and every
+/// instrument must be subscribed to in OnInit.
+///
+/// If the strategy thread falls behind, MyConflateBooks=Y lets it skip
+/// straight to the latest book: while more messages are queued, changed books
+/// are only applied, and OnBookUpdate is called once the queue is drained.
+/// MyConflateTrades=Y likewise delivers the trades of each notification as
+/// one OnLastTradeUpdate per instrument: their total volume at the last price.
+///
+/// Market data can be spread over several sessions, each with
+/// MyMarketDataSession=Y: session i of n then carries the instruments whose
+/// id modulo n is i, and is read and book-built on a thread of its own (see
+/// MarketDataShard).  This needs MyStrategyThread=Y; MyShardRingSize (default
+/// 4096, a power of two) sizes each shard's ring.
+///
+/// The Strategy it calls is chosen at compile time, see StrategyBinding.h.
 class Simple :public FIX::Application,
               public FIX::MessageCracker
 {
 public:
-	Simple(Strategy & strategy);
+	Simple(BoundStrategy & strategy);
 	~Simple();
 
 	/// Establish FIX connections and do any other setup.
+	///
+	/// Waits up to MyLogonTimeoutSeconds (default 10) for both sessions to log
+	/// on, then warms up before calling Strategy::OnInit: MyLockMemory=Y pins
+	/// the process's memory, room is made for MyExpectedInstruments (default
+	/// 64) instruments, and MyWarmUpMessages (default 10000) synthetic market
+	/// data messages are decoded and applied to a scratch book.
+	///
+	/// MyFeedMonitor=Y watches the market data feed, see FeedMonitor:
+	/// MyStaleQuoteMs (default 5000), MyBurstWindowUs (1000) and
+	/// MyBurstMessages (50) set the alerts, MyFeedReportSeconds (10) the report.
+	///
+	/// MyCheckpointFile names a StateCheckpoint: orders, positions, risk and
+	/// books are saved to it as they change, and loaded back from it here
+	/// before the sessions start.  The venue is then asked for the status of
+	/// every order still working, and what happened to them in the meantime
+	/// reaches the Strategy as ordinary fills, cancels and rejects.
 	void Init(const std::string & configFile);
 
-	/// Subscribe to market data updates for an instrument.
-	void SendMarketDataSubscription(const std::string & symbol, const std::string & maturityMonthYear);
+	/// Set up for offline use: no FIX connections, orders go to `fills`.
+	void InitSimulation(FillSimulator & fills);
+
+	/// Feed market data in without a FIX session (replay, backtests).
+	void ApplyMarketData(const FastMdMessage& md);
+	void ApplyMarketData(InstrumentId instrument, const MdEntry* entries, int count);
+
+	/// Stamp the market data applied from now on with the time it was
+	/// recorded rather than the time it is applied.  For replays; call it
+	/// before each ApplyMarketData().
+	void SetReplayTime(int64_t timeNs) { replaying_ = true; replayTimeNs_ = timeNs; }
+
+	/// When the market data the Strategy is being told about arrived, in
+	/// nanoseconds since the epoch (UTC); in a replay, when it was recorded.
+	/// Read it from the Strategy's market data callbacks.
+	int64_t EventTimeNs() const { return eventTimeNs_; }
+
+	/// Subscribe to market data updates for an instrument, `depth` price levels per side.
+	/// Returns the instrument's id, which all later callbacks for it will carry.
+	/// Subscriptions made in OnInit go out together once OnInit returns, and
+	/// all of them are sent again whenever the market data session logs back on.
+	/// With MyStrategyThread=Y a new instrument can only be subscribed to in
+	/// OnInit; later it throws std::runtime_error.
+	InstrumentId SendMarketDataSubscription(const std::string & symbol, const std::string & maturityMonthYear, int depth = 1);
 	
-	/// Send a market order
-	void SendMarketOrder(const std::string & symbol, const std::string & maturityMonthYear, const std::string & account, SimpleSide side, int qty);
+	/// Send a market order.  Returns its ClOrdID.  With MyStrategyThread=Y,
+	/// outside OnInit the instrument must already be subscribed to.
+	///
+	/// New orders and cancel/replaces first pass the RiskGate (see Risk()).
+	/// One it refuses is logged and never sent, and the ClOrdID returned for
+	/// it is empty (size 0).
+	IdString SendMarketOrder(const std::string & symbol, const std::string & maturityMonthYear, const std::string & account, SimpleSide side, int qty);
+
+	/// Send a market order for an instrument we subscribed to.  Returns its ClOrdID.
+	IdString SendMarketOrder(InstrumentId instrument, const std::string & account, SimpleSide side, int qty);
+
+	/// Send a day limit order.  Returns its ClOrdID.
+	IdString SendLimitOrder(InstrumentId instrument, const std::string & account, SimpleSide side, int qty, double px);
+
+	/// Ask to cancel the order sent as `origClOrdId`.  Returns the request's ClOrdID.
+	IdString SendCancelOrder(InstrumentId instrument, const std::string & account, const std::string & origClOrdId, SimpleSide side, int qty);
+
+	/// Ask to change the quantity and/or price of the limit order sent as
+	/// `origClOrdId`.  Returns the ClOrdID the order carries from then on.
+	IdString SendCancelReplaceOrder(InstrumentId instrument, const std::string & account, const std::string & origClOrdId, SimpleSide side, int qty, double px);
+
+	/// Prepare the NewOrderSingle SendMarketOrder would send, without sending it.
+	/// Takes the next ClOrdID.
+	const FIX42::NewOrderSingle & BuildMarketOrder(InstrumentId instrument, const std::string & account, SimpleSide side, int qty);
+
+	const InstrumentRegistry & Instruments() const { return instruments_; }
+	/// Every order we sent, and positions per instrument.
+	const OrderManager & Orders() const { return orders_; }
+	const OrderBook & Book(InstrumentId instrument) const { return books_[instrument]; }
+
+	/// Pre-trade limits and the kill switch.  Init() sets the limits from
+	/// MyMaxOrderQty, MyMaxPosition, MyMaxOrdersPerSecond and MyOrderBurst.
+	RiskGate & Risk() { return risk_; }
+
+	/// Book notifications and trade prints merged into later ones so far
+	/// (MyConflateBooks, MyConflateTrades).  Read them on the Strategy's thread.
+	uint64_t ConflatedBookUpdates() const { return conflatedBookUpdates_; }
+	uint64_t ConflatedTrades() const { return conflatedTrades_; }
 
 private: 
 	// QF callbacks
@@ -43,6 +159,49 @@ private:
 	void onMessage(const FIX42::MarketDataSnapshotFullRefresh&, const FIX::SessionID&);
 	void onMessage(const FIX42::MarketDataIncrementalRefresh& msg, const FIX::SessionID&);
 	void onMessage(const FIX42::MarketDataRequestReject&, const FIX::SessionID&);
+	void onMessage(const FIX42::OrderCancelReject&, const FIX::SessionID&);
+
+	// Hand decoded inbound events to the Strategy: through the pipeline if
+	// there is one, otherwise right here on the calling thread.
+	friend class EventPipeline;
+	void DispatchMdEntry(InstrumentId instrument, const MdEntry& entry);
+	void DispatchBookClear(InstrumentId instrument);
+	void DispatchEndOfMarketData();
+	void DispatchExecution(int type, const ExecutionEvent& execution);
+	void HandleEvent(const InboundEvent& event, bool backlog);
+	void HandleShardUpdate(const ShardUpdate& update, bool backlog);
+	MarketDataShard* FindShard(const FIX::SessionID& sessionId) const;
+	MarketDataShard& ShardOf(InstrumentId instrument) { return *shards_[instrument % shards_.size()]; }
+	void ProcessExecution(const ExecutionEvent& execution);
+	void ProcessCancelReject(const ExecutionEvent& reject);
+	void UpdateRisk(const ExecutionEvent& execution);
+	bool PassesRisk(InstrumentId instrument, int riskAccount, SimpleSide side, int qty);
+	void ClearBook(InstrumentId instrument);
+	void OpenCheckpoint(const std::string & path);
+	void SaveState(int execSeqNum = 0);
+	void RequestOrderStatus();
+	void ReconcileOrder(const ExecutionEvent& status);
+
+	// Orders go out through the pipeline's sender thread if there is one:
+	void SendOrderCommand(const OrderCommand& command);
+	void ExecuteOrderCommand(const OrderCommand& command);
+	OrderCommand MakeOrderCommand(int type, InstrumentId instrument, const std::string & account, const IdString& clOrdId, SimpleSide side, char ordType, int qty, double px);
+
+	OrderTemplate & Template(InstrumentId instrument, const std::string & account);
+	InstrumentId RegisterInstrument(const std::string & symbol, const std::string & maturityMonthYear);
+	InstrumentId ResolveInstrument(const FIX::FieldMap& fields) const;
+	InstrumentId ResolveInstrument(const FieldView& symbol, const FieldView& maturityMonthYear, const FieldView& exchange) const;
+	InstrumentId ResolveMdMessage(const FIX::Message& msg) const;
+	void ApplyMdEntry(InstrumentId instrument, const MdEntry& entry);
+	void MarkBookChanged(InstrumentId instrument);
+	void PublishBookChanges();
+	void DeferBookChanges();
+	bool OnRawMarketData(const FIX::Message& message);
+	void DeliverSimulatedFills();
+	void Reserve(size_t instruments);
+	void MonitorMdMessage(const FIX::Message& msg, int64_t receiptNs, const FieldView& entryTime);
+	int64_t StampMarketData();
+	void WarmUp(int messages);
 
 	// More QF callbacks
 	void onCreate(const FIX::SessionID&);
@@ -53,15 +212,60 @@ private:
 	void fromAdmin(const FIX::Message&, const FIX::SessionID&) throw(FIX::FieldNotFound, FIX::IncorrectDataFormat, FIX::IncorrectTagValue, FIX::RejectLogon);
 	void fromApp(const FIX::Message& message, const FIX::SessionID& sessionID) throw(FIX::FieldNotFound, FIX::IncorrectDataFormat, FIX::IncorrectTagValue, FIX::UnsupportedMessageType);
 	
-	Strategy& strategy_;
-	IdHelper idHelper_;
+	BoundStrategy& strategy_;
+	IdService ids_;
+	InstrumentRegistry instruments_;
+	SubscriptionManager subscriptions_;
+	bool batchSubscriptions_;
+	bool registrationClosed_;       // the strategy thread is running; see RegisterInstrument()
+	OrderTemplates templates_;
+	OrderManager orders_;
+	RiskGate risk_;
+
+	// Per-instrument state, indexed by InstrumentId
+	std::vector<OrderBook, CacheLineAllocator<OrderBook> > books_;
+	std::vector<char> bookDirty_;
+	std::vector<InstrumentId> changedBooks_;
+	bool fastMarketData_;
+
+	// Market data conflation.  Trades waiting to be delivered, indexed by InstrumentId:
+	bool conflateBooks_;
+	bool conflateTrades_;
+	std::vector<int> tradeCount_;
+	std::vector<double> tradeQty_;
+	std::vector<double> tradePx_;
+	std::vector<InstrumentId> tradedInstruments_;
+	uint64_t conflatedBookUpdates_;
+	uint64_t conflatedTrades_;
+
+	// Market data time, see EventTimeNs().  eventTimeNs_ belongs to the
+	// thread that calls the Strategy; the others to the thread applying market data.
+	TscClock clock_;
+	int64_t eventTimeNs_;
+	int64_t replayTimeNs_;
+	bool replaying_;
 
 	FIX::SessionID mdSessionId_;
 	FIX::SessionID orderSessionId_;
+
+	// Signalled by onLogon()/onLogout(); Init() waits on it.
+	std::mutex logonMutex_;
+	std::condition_variable logonChanged_;
+	bool mdLoggedOn_;
+	bool orderLoggedOn_;
+	std::vector<char> shardLoggedOn_;
+
 	FIX::MessageStoreFactory* messageStoreFactory_;
 	FIX::FileLogFactory* logFactory_;
+	RawMessageLogFactory* rawLogFactory_;
+	FillSimulator* fillSimulator_;
 	FIX::SessionSettings* sessionSettings_;
-	FIX::SocketInitiator* initiator_;
+	FIX::Initiator* initiator_;
+	EventPipeline* pipeline_;
+	std::vector<MarketDataShard*> shards_;     // none with a single market data session
+	FeedMonitor* feedMonitor_;
+	StateCheckpoint* checkpoint_;
+	int recoveredExecSeqNum_;       // PossDup ExecutionReports up to this one are in the checkpoint
 };
 
 //Useful for printing.
@@ -0,0 +1,119 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+#include "Platform.h"
+
+/// A bounded, lock-free, single-producer/single-consumer queue of POD records.
+/// The capacity must be a power of two.
+template <class T>
+class SpscRing
+{
+public:
+	explicit SpscRing(size_t capacity)
+		: buffer_(capacity),
+		  mask_(capacity - 1),
+		  head_(0),
+		  cachedTail_(0),
+		  tail_(0),
+		  cachedHead_(0)
+	{
+		if(capacity == 0 || (capacity & (capacity - 1)) != 0)
+			throw std::invalid_argument("SpscRing capacity must be a power of two");
+	}
+
+	/// Producer side.  Returns false if the ring is full.
+	bool TryPush(const T & item)
+	{
+		const size_t head = head_.load(std::memory_order_relaxed);
+		if(head - cachedTail_ > mask_)
+		{
+			cachedTail_ = tail_.load(std::memory_order_acquire);
+			if(head - cachedTail_ > mask_) return false;
+		}
+		buffer_[head & mask_] = item;
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Producer side, disruptor style: the next free slot to fill in place,
+	/// or nullptr if the ring is full.  Publish() makes it visible.
+	T* TryClaim()
+	{
+		const size_t head = head_.load(std::memory_order_relaxed);
+		if(head - cachedTail_ > mask_)
+		{
+			cachedTail_ = tail_.load(std::memory_order_acquire);
+			if(head - cachedTail_ > mask_) return nullptr;
+		}
+		return &buffer_[head & mask_];
+	}
+
+	void Publish()
+	{
+		head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/// Consumer side.  Returns false if the ring is empty.
+	bool TryPop(T & item)
+	{
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+		if(tail == cachedHead_)
+		{
+			cachedHead_ = head_.load(std::memory_order_acquire);
+			if(tail == cachedHead_) return false;
+		}
+		item = buffer_[tail & mask_];
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Consumer side.  Returns a pointer to up to `max` contiguous readable
+	/// records and their count through `count`; call Release(count) when done.
+	const T* Peek(size_t max, size_t & count)
+	{
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+		cachedHead_ = head_.load(std::memory_order_acquire);
+		size_t available = cachedHead_ - tail;
+		size_t untilWrap = buffer_.size() - (tail & mask_);
+		count = available < untilWrap ? available : untilWrap;
+		if(count > max) count = max;
+		return &buffer_[tail & mask_];
+	}
+
+	void Release(size_t count)
+	{
+		tail_.store(tail_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+	}
+
+	/// Approximate number of queued records; safe to call from any thread.
+	size_t Size() const
+	{
+		return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+	}
+
+	size_t Capacity() const { return buffer_.size(); }
+
+private:
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+private:
+	std::vector<T, CacheLineAllocator<T> > buffer_;   // aligned for records that hold an OrderBook
+	const size_t mask_;
+
+	// Producer and consumer state live on separate cache lines.  Padding
+	// rather than alignas keeps the ring safe to allocate with plain new.
+	char pad0_[CACHE_LINE_SIZE];
+	std::atomic<size_t> head_;
+	size_t cachedTail_;
+	char pad1_[CACHE_LINE_SIZE];
+	std::atomic<size_t> tail_;
+	size_t cachedHead_;
+	char pad2_[CACHE_LINE_SIZE];
+};
+
+#endif
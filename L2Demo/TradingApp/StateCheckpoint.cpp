@@ -0,0 +1,262 @@
+#include "StateCheckpoint.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+static const char CHECKPOINT_MAGIC[8] = "L2CHKPT";
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+// CheckpointRedo::kind
+static const uint32_t REDO_ORDER = 1;
+static const uint32_t REDO_POSITION = 2;
+
+// Regions start on a cache line, which is also what OrderBook needs.
+static size_t AlignUp(size_t offset)
+{
+	return (offset + CACHE_LINE_SIZE - 1) & ~static_cast<size_t>(CACHE_LINE_SIZE - 1);
+}
+
+static int64_t WallClockNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Copy into a fixed field, truncating; the field always ends up terminated.
+static void CopyName(char* field, size_t size, const string & value)
+{
+	std::memset(field, 0, size);
+	std::memcpy(field, value.data(), value.size() < size - 1 ? value.size() : size - 1);
+}
+
+static string ReadName(const char* field, size_t size)
+{
+	size_t length = 0;
+	while(length < size && field[length] != '\0') ++length;
+	return string(field, length);
+}
+
+// Keeps the staged records ahead of redoCount, and redoCount ahead of the
+// copies, in the order the stores reach the mapping.
+static void Barrier()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+StateCheckpoint::StateCheckpoint(const string & path, size_t orderCapacity, size_t maxInstruments)
+	: header_(nullptr),
+	  redo_(nullptr),
+	  instruments_(nullptr),
+	  positions_(nullptr),
+	  books_(nullptr),
+	  orders_(nullptr),
+	  recovered_(false),
+	  staged_(0)
+{
+	const size_t redoOffset = AlignUp(sizeof(CheckpointHeader));
+	const size_t instrumentsOffset = AlignUp(redoOffset + MAX_CHECKPOINT_REDO * sizeof(CheckpointRedo));
+	const size_t positionsOffset = AlignUp(instrumentsOffset + maxInstruments * sizeof(CheckpointInstrument));
+	const size_t booksOffset = AlignUp(positionsOffset + maxInstruments * sizeof(CheckpointPosition));
+	const size_t ordersOffset = AlignUp(booksOffset + maxInstruments * sizeof(OrderBook));
+	const size_t size = ordersOffset + orderCapacity * sizeof(Order);
+
+	file_.Open(path, size);
+	char* data = file_.Data();
+	header_ = reinterpret_cast<CheckpointHeader*>(data);
+	redo_ = reinterpret_cast<CheckpointRedo*>(data + redoOffset);
+	instruments_ = reinterpret_cast<CheckpointInstrument*>(data + instrumentsOffset);
+	positions_ = reinterpret_cast<CheckpointPosition*>(data + positionsOffset);
+	books_ = reinterpret_cast<OrderBook*>(data + booksOffset);
+	orders_ = reinterpret_cast<Order*>(data + ordersOffset);
+
+	if(header_->version == 0)
+	{
+		std::memcpy(header_->magic, CHECKPOINT_MAGIC, sizeof(header_->magic));
+		header_->version = CHECKPOINT_VERSION;
+		header_->orderSize = sizeof(Order);
+		header_->positionSize = sizeof(CheckpointPosition);
+		header_->bookSize = sizeof(OrderBook);
+		header_->orderCapacity = static_cast<uint32_t>(orderCapacity);
+		header_->maxInstruments = static_cast<uint32_t>(maxInstruments);
+		header_->created = WallClockNs();
+		return;
+	}
+
+	if(std::memcmp(header_->magic, CHECKPOINT_MAGIC, sizeof(header_->magic)) != 0)
+		throw std::runtime_error("[StateCheckpoint] " + path + " is not a checkpoint");
+	if(header_->version != CHECKPOINT_VERSION
+		|| header_->orderSize != sizeof(Order)
+		|| header_->positionSize != sizeof(CheckpointPosition)
+		|| header_->bookSize != sizeof(OrderBook)
+		|| header_->orderCapacity != orderCapacity
+		|| header_->maxInstruments != maxInstruments)
+	{
+		throw std::runtime_error("[StateCheckpoint] " + path + " was written by a different build; delete it to start flat");
+	}
+
+	// The last process died in the middle of a commit; everything it staged is there.
+	if(header_->redoCount > 0)
+		Apply();
+
+	recovered_ = header_->instruments > 0 || header_->sequence > 0;
+}
+
+StateCheckpoint::~StateCheckpoint()
+{
+	file_.Flush();
+}
+
+Instrument StateCheckpoint::GetInstrument(InstrumentId instrument) const
+{
+	const CheckpointInstrument & saved = instruments_[instrument];
+	Instrument details;
+	details.symbol = ReadName(saved.symbol, sizeof(saved.symbol));
+	details.maturityMonthYear = ReadName(saved.maturityMonthYear, sizeof(saved.maturityMonthYear));
+	details.exchange = ReadName(saved.exchange, sizeof(saved.exchange));
+	return details;
+}
+
+void StateCheckpoint::Restore(OrderManager & orders, RiskGate & risk) const
+{
+	if(orders.Capacity() != header_->orderCapacity)
+		throw std::runtime_error("[StateCheckpoint] the OrderManager does not have as many slots as the checkpoint");
+
+	for(uint32_t slot = 0; slot < header_->orderCapacity; ++slot)
+	{
+		if(orders_[slot].clOrdIdSize != 0)
+			orders.RestoreOrder(slot, orders_[slot]);
+	}
+
+	for(uint32_t instrument = 0; instrument < header_->instruments; ++instrument)
+	{
+		const CheckpointPosition & saved = positions_[instrument];
+		orders.RestorePosition(instrument, saved.position);
+		for(uint32_t i = 0; i < saved.accounts && i < MAX_CHECKPOINT_ACCOUNTS; ++i)
+		{
+			RiskExposure exposure = { saved.account[i].position, saved.account[i].workingBuy, saved.account[i].workingSell };
+			risk.Restore(instrument, ReadName(saved.account[i].name, sizeof(saved.account[i].name)), exposure);
+		}
+	}
+
+	orders.Rebuild();
+}
+
+void StateCheckpoint::AddInstrument(InstrumentId instrument, const Instrument & details)
+{
+	if(static_cast<uint32_t>(instrument) < header_->instruments) return;
+	if(static_cast<uint32_t>(instrument) != header_->instruments)
+		throw std::runtime_error("[StateCheckpoint] instruments must be added in id order");
+	if(header_->instruments >= header_->maxInstruments)
+		throw std::runtime_error("[StateCheckpoint] no room for instrument " + details.symbol);
+
+	CheckpointInstrument & saved = instruments_[instrument];
+	CopyName(saved.symbol, sizeof(saved.symbol), details.symbol);
+	CopyName(saved.maturityMonthYear, sizeof(saved.maturityMonthYear), details.maturityMonthYear);
+	CopyName(saved.exchange, sizeof(saved.exchange), details.exchange);
+	std::memset(&positions_[instrument], 0, sizeof(CheckpointPosition));
+	books_[instrument] = OrderBook();
+
+	// Count it only once its slots are written:
+	Barrier();
+	header_->instruments = instrument + 1;
+}
+
+void StateCheckpoint::SaveBook(InstrumentId instrument, const OrderBook & book)
+{
+	books_[instrument] = book;
+}
+
+void StateCheckpoint::Commit(OrderManager & orders, const RiskGate & risk, int execSeqNum)
+{
+	staged_ = 0;
+	const std::vector<uint32_t> & changedOrders = orders.ChangedOrders();
+	for(size_t i = 0; i < changedOrders.size(); ++i)
+	{
+		// An order's risk moves with it even where its position does not,
+		// e.g. a refused replace:
+		Stage(REDO_ORDER, changedOrders[i], orders, risk);
+		Stage(REDO_POSITION, orders.Slot(changedOrders[i]).instrument, orders, risk);
+	}
+	const std::vector<InstrumentId> & changedPositions = orders.ChangedPositions();
+	for(size_t i = 0; i < changedPositions.size(); ++i)
+		Stage(REDO_POSITION, changedPositions[i], orders, risk);
+	orders.ClearChanges();
+
+	if(staged_ == 0 && execSeqNum <= 0) return;
+
+	header_->redoExecSeqNum = execSeqNum > 0 ? execSeqNum : 0;
+	Barrier();
+	header_->redoCount = staged_;
+	Barrier();
+	Apply();
+	staged_ = 0;
+}
+
+// Stage one record unless this commit already has it.  A commit too big for
+// the redo area is split, which only an event touching dozens of orders
+// would need.
+void StateCheckpoint::Stage(uint32_t kind, uint32_t index, const OrderManager & orders, const RiskGate & risk)
+{
+	for(uint32_t i = 0; i < staged_; ++i)
+	{
+		if(redo_[i].kind == kind && redo_[i].index == index) return;
+	}
+
+	if(staged_ == MAX_CHECKPOINT_REDO)
+	{
+		header_->redoExecSeqNum = 0;
+		Barrier();
+		header_->redoCount = staged_;
+		Barrier();
+		Apply();
+		staged_ = 0;
+	}
+
+	CheckpointRedo & record = redo_[staged_];
+	std::memset(&record, 0, sizeof(record));
+	record.kind = kind;
+	record.index = index;
+	if(REDO_ORDER == kind)
+	{
+		record.order = orders.Slot(index);
+	}
+	else
+	{
+		const InstrumentId instrument = static_cast<InstrumentId>(index);
+		record.position.position = orders.GetPosition(instrument);
+		const int accounts = risk.Accounts(instrument);
+		for(int i = 0; i < accounts && i < MAX_CHECKPOINT_ACCOUNTS; ++i)
+		{
+			CheckpointAccount & account = record.position.account[i];
+			const RiskExposure exposure = risk.GetExposure(instrument, i);
+			CopyName(account.name, sizeof(account.name), risk.AccountName(instrument, i));
+			account.position = exposure.position;
+			account.workingBuy = exposure.workingBuy;
+			account.workingSell = exposure.workingSell;
+			++record.position.accounts;
+		}
+	}
+	++staged_;
+}
+
+// Copy the staged records into place.  Safe to repeat: a crash in here is
+// finished by the next process's constructor.
+void StateCheckpoint::Apply()
+{
+	const uint32_t count = header_->redoCount;
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		const CheckpointRedo & record = redo_[i];
+		if(REDO_ORDER == record.kind && record.index < header_->orderCapacity)
+			orders_[record.index] = record.order;
+		else if(REDO_POSITION == record.kind && record.index < header_->maxInstruments)
+			positions_[record.index] = record.position;
+	}
+	if(header_->redoExecSeqNum > 0)
+		header_->lastExecSeqNum = header_->redoExecSeqNum;
+	++header_->sequence;
+	header_->updated = WallClockNs();
+
+	Barrier();
+	header_->redoCount = 0;
+}
@@ -0,0 +1,154 @@
+#ifndef STATE_CHECKPOINT_H
+#define STATE_CHECKPOINT_H
+
+#include <string>
+#include <cstdint>
+#include "MappedFile.h"
+#include "OrderManager.h"
+#include "OrderBook.h"
+#include "RiskGate.h"
+#include "InstrumentRegistry.h"
+
+using std::string;
+
+/// Accounts per instrument whose risk exposure a checkpoint keeps; strategies
+/// use one or two.
+enum { MAX_CHECKPOINT_ACCOUNTS = 4 };
+
+/// Records an interrupted commit may have left half written; a commit
+/// touches a few at most.
+enum { MAX_CHECKPOINT_REDO = 32 };
+
+struct CheckpointHeader
+{
+	char magic[8];          // "L2CHKPT"
+	uint32_t version;
+	uint32_t orderSize;     // sizeof(Order), sizeof(CheckpointPosition) and
+	uint32_t positionSize;  // sizeof(OrderBook) in the build that wrote the file
+	uint32_t bookSize;
+	uint32_t orderCapacity;
+	uint32_t maxInstruments;
+	uint32_t instruments;   // registered so far
+	uint32_t redoCount;     // records of a commit in progress; 0 between commits
+	uint64_t sequence;      // commits so far
+	int64_t created;        // nanoseconds since the epoch
+	int64_t updated;        // time of the last commit
+	int32_t lastExecSeqNum; // MsgSeqNum of the last ExecutionReport applied
+	int32_t redoExecSeqNum; // lastExecSeqNum once the commit in progress is applied
+	uint8_t reserved[56];
+};
+
+/// Which instrument an InstrumentId stood for.
+struct CheckpointInstrument
+{
+	char symbol[32];
+	char maturityMonthYear[16];
+	char exchange[16];
+};
+
+/// What RiskGate counted for one account.
+struct CheckpointAccount
+{
+	char name[24];
+	int64_t position;
+	int64_t workingBuy;
+	int64_t workingSell;
+};
+
+/// Position and per-account risk of one instrument, saved together.
+struct CheckpointPosition
+{
+	Position position;
+	uint32_t accounts;
+	uint32_t reserved;
+	CheckpointAccount account[MAX_CHECKPOINT_ACCOUNTS];
+};
+
+/// One record of a commit, staged before it is copied into place.
+struct CheckpointRedo
+{
+	uint32_t kind;          // order or position
+	uint32_t index;         // order slot or InstrumentId
+	union
+	{
+		Order order;
+		CheckpointPosition position;
+	};
+};
+
+static_assert(sizeof(CheckpointHeader) == 128, "CheckpointHeader layout is part of the file format");
+static_assert(sizeof(CheckpointInstrument) == 64, "CheckpointInstrument layout is part of the file format");
+
+/// Orders, positions, risk exposure and books kept in a memory-mapped file,
+/// so that a restarted process carries on where the last one stopped.
+///
+/// Orders sit in the same slots as in the OrderManager.  Each Commit()
+/// writes the records an event changed as one update: they are staged in a
+/// redo area first, and copied into place once all of them are there, so a
+/// process that dies half way through leaves either the state before the
+/// event or the staged records to finish it with on the next start.  The
+/// mapping survives the process; only a machine crash can lose the pages the
+/// OS has not written back yet.
+///
+/// Books are copied as they change without staging; a book torn by a crash
+/// is replaced by the snapshot that follows the resubscription anyway.
+///
+/// The file records the sizes of what it holds.  One written by a build with
+/// different Order, Position or OrderBook layouts, or with other capacities,
+/// is refused: delete it to start flat.
+class StateCheckpoint
+{
+public:
+	/// Open (or create) the checkpoint at `path` for `orderCapacity` order
+	/// slots and `maxInstruments` instruments, finishing any interrupted commit.
+	/// Throws std::runtime_error.
+	StateCheckpoint(const string & path, size_t orderCapacity, size_t maxInstruments);
+	~StateCheckpoint();
+
+	/// True if the file held state from an earlier run.
+	bool Recovered() const { return recovered_; }
+
+	const CheckpointHeader & Header() const { return *header_; }
+
+	int Instruments() const { return static_cast<int>(header_->instruments); }
+	Instrument GetInstrument(InstrumentId instrument) const;
+	const OrderBook & Book(InstrumentId instrument) const { return books_[instrument]; }
+
+	/// Load the saved orders and positions into `orders` and the saved
+	/// exposure into `risk`.  The instruments must already have their old ids.
+	void Restore(OrderManager & orders, RiskGate & risk) const;
+
+	/// Record a newly registered instrument.  Ids already in the file are
+	/// left alone, so registering them again after a restart is harmless.
+	void AddInstrument(InstrumentId instrument, const Instrument & details);
+
+	/// Save everything `orders` changed since its last ClearChanges(), with
+	/// the risk exposure of the instruments involved, as one update; then
+	/// clear the changes.  `execSeqNum` > 0 is the MsgSeqNum of the
+	/// ExecutionReport that caused them.
+	void Commit(OrderManager & orders, const RiskGate & risk, int execSeqNum = 0);
+
+	void SaveBook(InstrumentId instrument, const OrderBook & book);
+
+	/// Ask the OS to write dirty pages back to disk.
+	void Flush() { file_.Flush(); }
+
+private:
+	StateCheckpoint(const StateCheckpoint&) = delete;
+	StateCheckpoint& operator=(const StateCheckpoint&) = delete;
+
+	void Stage(uint32_t kind, uint32_t index, const OrderManager & orders, const RiskGate & risk);
+	void Apply();
+
+	MappedFile file_;
+	CheckpointHeader* header_;
+	CheckpointRedo* redo_;
+	CheckpointInstrument* instruments_;
+	CheckpointPosition* positions_;
+	OrderBook* books_;
+	Order* orders_;
+	bool recovered_;
+	uint32_t staged_;
+};
+
+#endif
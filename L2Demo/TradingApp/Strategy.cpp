@@ -1,74 +1,130 @@
 #include "Strategy.h"
+#include "AsyncLog.h"
+#include <chrono>
+
+// Timestamps for recorded ticks.
+static int64_t WallClockNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
 
 
 Strategy::Strategy(const string& symbol,
 	const string& maturityMonthYear,
 	const string& account,
      const shared_ptr<Write2Txt>& W1)
-	: symbol_(symbol),
-	maturityMonthYear_(maturityMonthYear),
+	: contracts_(1, Contract{ symbol, maturityMonthYear }),
+	account_(account),
+	W1_(W1)
+{ }
+
+Strategy::Strategy(const std::vector<Contract>& contracts,
+	const string& account,
+	const shared_ptr<Write2Txt>& W1)
+	: contracts_(contracts),
 	account_(account),
 	W1_(W1)
 { }
 
 void Strategy::OnInit(Simple & simple)
 {
-	// Subscribing to market data at startup
-	simple.SendMarketDataSubscription(symbol_, maturityMonthYear_);
+	// Subscribing to market data at startup; Simple hands out dense ids we
+	// can index our per-instrument state with.
+	for (size_t i = 0; i < contracts_.size(); ++i)
+	{
+		InstrumentId instrument = simple.SendMarketDataSubscription(contracts_[i].symbol, contracts_[i].maturityMonthYear);
+		State(instrument);
+	}
+}
+
+Strategy::InstrumentState & Strategy::State(InstrumentId instrument)
+{
+	if (static_cast<size_t>(instrument) >= state_.size())
+	{
+		InstrumentState empty = { 0, 0, 0, 0 };
+		state_.resize(instrument + 1, empty);
+
+		// All indicator memory is allocated here, before any market data:
+		while (signals_.size() < state_.size())
+			signals_.push_back(MicrostructureSignals());
+	}
+	return state_[instrument];
 }
 
-void Strategy::OnOrderFill(Simple & simple, SimpleSide side, double qty, double px)
+void Strategy::OnOrderFill(Simple & simple, InstrumentId instrument, SimpleSide side, double qty, double px)
 {
-	std::cout << std::endl << "RECEIVED FILL: side=" << side << ", price=" << px << ", qty=" << qty << std::endl;
+	LOG_INFO("RECEIVED FILL: side={}, price={}, qty={}", side, px, qty);
 
-	// You may want to update your position inventories
+	// Simple has already applied the fill; position and working quantities
+	// are in simple.Orders()
+	const Position& position = simple.Orders().GetPosition(instrument);
+	LOG_INFO("POSITION: net={}, avgCost={}, realizedPnl={}, unrealizedPnl={}",
+		position.netQty, position.avgCost, position.realizedPnl, position.UnrealizedPnl());
 
 }
 
-void Strategy::OnOrderReject(Simple & simple, SimpleSide side, double qty)
+void Strategy::OnOrderReject(Simple & simple, InstrumentId instrument, SimpleSide side, double qty)
 {
-	// The order was rejected -- you may want to update your working quantity
+	// The order was rejected; simple.Orders() no longer counts it as working
 	
 }
 
 
-void Strategy::OnBestBidUpdate(Simple & simple, double qty, double px)
+void Strategy::OnBookUpdate(Simple & simple, InstrumentId instrument, const OrderBook & book)
 {
-	std::cout << "MarketDataUpdate: BID " << px << " / " << qty << std::endl;
-
-	//Simple example: sell if the bid is higher than a cerain value
-	time_t timer;
+	InstrumentState & state = State(instrument);
+
+	// Only react to the top of the book for now; deeper levels are in `book`.
+	double bidPx = book.HasBid() ? book.BidPx(0) : 0;
+	double bidQty = book.HasBid() ? book.BidQty(0) : 0;
+	double offerPx = book.HasOffer() ? book.OfferPx(0) : 0;
+	double offerQty = book.HasOffer() ? book.OfferQty(0) : 0;
+
+	bool bidChanged = bidPx != state.bidPx || bidQty != state.bidQty;
+	bool offerChanged = offerPx != state.offerPx || offerQty != state.offerQty;
+	if (!bidChanged && !offerChanged)
+		return;
+
+	state.bidPx = bidPx;
+	state.bidQty = bidQty;
+	state.offerPx = offerPx;
+	state.offerQty = offerQty;
+	signals_[instrument].OnQuote(simple.EventTimeNs(), bidPx, bidQty, offerPx, offerQty);
+
+	if (bidChanged)
+		OnBestBidUpdate(simple, instrument, bidQty, bidPx);
+	if (offerChanged)
+		OnBestOfferUpdate(simple, instrument, offerQty, offerPx);
+}
 
-	time(&timer);
+void Strategy::OnBestBidUpdate(Simple & simple, InstrumentId instrument, double qty, double px)
+{
+	LOG_INFO("MarketDataUpdate: BID {} / {}", px, qty);
 
-	W1_->Write_txt_file(timer, "BID", qty, px);
+	//Simple example: sell if the bid is higher than a cerain value
+	if (W1_) W1_->Write_tick(instrument, simple.Instruments().Get(instrument), WallClockNs(), TICK_BID, qty, px);
 		
 }
 
-void Strategy::OnBestOfferUpdate(Simple & simple, double qty, double px)
+void Strategy::OnBestOfferUpdate(Simple & simple, InstrumentId instrument, double qty, double px)
 {
-	std::cout << "MarketDataUpdate: OFFER " << px << " / " << qty << std::endl;
+	LOG_INFO("MarketDataUpdate: OFFER {} / {}", px, qty);
 
-	time_t timer;
-
-	time(&timer);
-
-	W1_->Write_txt_file(timer, "OFFER", qty, px);
+	if (W1_) W1_->Write_tick(instrument, simple.Instruments().Get(instrument), WallClockNs(), TICK_OFFER, qty, px);
 	//Simple example: sell if the bid is higher than a cerain value
 		
 }
 
-void Strategy::OnLastTradeUpdate(Simple & simple, double qty, double px)
+void Strategy::OnLastTradeUpdate(Simple & simple, InstrumentId instrument, double qty, double px)
 {
-	std::cout << "MarketDataUpdate: Last Trade " << px << " / " << qty << std::endl;
+	LOG_INFO("MarketDataUpdate: Last Trade {} / {}", px, qty);
 
-	//You can have make a trading decision based on the last trade 
+	State(instrument);
+	signals_[instrument].OnTrade(simple.EventTimeNs(), qty, px);
 
-	time_t timer;
-	
-	time(&timer);
+	//You can have make a trading decision based on the last trade 
 
-	W1_->Write_txt_file(timer, "Last Trade", qty, px);
+	if (W1_) W1_->Write_tick(instrument, simple.Instruments().Get(instrument), WallClockNs(), TICK_TRADE, qty, px);
 
 
 }
\ No newline at end of file
@@ -3,11 +3,20 @@
 
 #include "Simple.h"
 #include "Write2Txt.h"
+#include "Indicators.h"
 #include <memory>
+#include <vector>
 #include <time.h> 
 
 using std::shared_ptr;
 
+/// An instrument the Strategy subscribes to and trades.
+struct Contract
+{
+	std::string symbol;
+	std::string maturityMonthYear;
+};
+
 /// A basic workspace for implementing our strategy logic, receiving market data, receiving fills, etc.
 class Strategy
 {
@@ -15,29 +24,51 @@ public:
 	/// Create a strategy that trades the given instrument for the given account.
 	Strategy(const std::string & symbol, const std::string & maturityMonthYear, const std::string & account, const shared_ptr<Write2Txt>& W1);
 
+	/// Create a strategy that trades several instruments for the given account.
+	Strategy(const std::vector<Contract> & contracts, const std::string & account, const shared_ptr<Write2Txt>& W1);
+
 	/// This callback is called once by Simple to let us know that it is done initializing itself.
 	void OnInit(Simple & simple);
 
-	/// This callback is called by Simple to let us know when the best bid changes.
-	void OnBestBidUpdate(Simple & simple, double qty, double px);
-
-	/// This callback is called by Simple to let us know when the best offer changes.
-	void OnBestOfferUpdate(Simple & simple, double qty, double px);
+	/// This callback is called by Simple once per market data message that changed the book.
+	void OnBookUpdate(Simple & simple, InstrumentId instrument, const OrderBook & book);
 
 	/// This callback is called by Simple whenever the trade ticker changes
-	void OnLastTradeUpdate(Simple & simple, double qty, double px);
+	void OnLastTradeUpdate(Simple & simple, InstrumentId instrument, double qty, double px);
 
 	/// This callback is called by Simple to let us know that an order was filled.
-	void OnOrderFill(Simple & simple, SimpleSide side, double qty, double px);
+	void OnOrderFill(Simple & simple, InstrumentId instrument, SimpleSide side, double qty, double px);
 
 	/// This callback is called by Simple to let us know that an order was rejected.
-	void OnOrderReject(Simple & simple, SimpleSide side, double qty);
+	void OnOrderReject(Simple & simple, InstrumentId instrument, SimpleSide side, double qty);
+
+	/// VWAP, microprice, volatility and flow imbalances for an instrument, as
+	/// of the last market data callback.
+	const MicrostructureSignals & Signals(InstrumentId instrument) const { return signals_[instrument]; }
 
 private:
-	const std::string symbol_;
-	const std::string maturityMonthYear_;
+	/// Called from OnBookUpdate when the best bid changes.
+	void OnBestBidUpdate(Simple & simple, InstrumentId instrument, double qty, double px);
+
+	/// Called from OnBookUpdate when the best offer changes.
+	void OnBestOfferUpdate(Simple & simple, InstrumentId instrument, double qty, double px);
+
+	/// Per-instrument state, indexed by InstrumentId.
+	struct InstrumentState
+	{
+		// Top of book as of the last OnBookUpdate
+		double bidPx, bidQty;
+		double offerPx, offerQty;
+	};
+
+	InstrumentState & State(InstrumentId instrument);
+
+	const std::vector<Contract> contracts_;
 	const std::string account_;
 	shared_ptr<Write2Txt> W1_;
+
+	std::vector<InstrumentState> state_;
+	std::vector<MicrostructureSignals> signals_;   // same index as state_
 	
 };
 
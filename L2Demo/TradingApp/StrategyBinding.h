@@ -0,0 +1,44 @@
+#ifndef STRATEGY_BINDING_H
+#define STRATEGY_BINDING_H
+
+// Which strategy Simple calls.  The type is fixed when Simple.cpp is
+// compiled, so every callback is a direct call to a known function rather
+// than a call through a vtable.
+//
+// By default Simple calls Strategy.  To plug in another, build with
+// L2_STRATEGY naming its class and L2_STRATEGY_HEADER its header, e.g.
+//
+//   -DL2_STRATEGY=PairsStrategy -DL2_STRATEGY_HEADER=\"PairsStrategy.h\"
+//
+// The class needs the same callbacks as Strategy (OnInit, OnBookUpdate,
+// OnLastTradeUpdate, OnOrderFill, OnOrderReject).  To run several
+// strategies off one feed, name a class derived from StrategyList:
+//
+//   class Strategies : public StrategyList<Strategy, PairsStrategy>
+//   {
+//   public:
+//       Strategies(Strategy & a, PairsStrategy & b) : StrategyList<Strategy, PairsStrategy>(a, b) {}
+//   };
+//
+// L2_STRATEGY must name a class, not a typedef: Simple.h only declares it,
+// and only Simple.cpp includes L2_STRATEGY_HEADER.
+//
+// Every file that includes Simple.h must see the same binding, or Simple's
+// members are declared with one type and defined with another.  Define
+// L2_STRATEGY for the whole build, not just for Simple.cpp; the CMake
+// option does.  Tools that construct Simple from a Strategy, like Replay
+// and the benchmarks, only build with the default binding.
+
+#ifndef L2_STRATEGY
+#define L2_STRATEGY Strategy
+#define L2_STRATEGY_HEADER "Strategy.h"
+#elif !defined(L2_STRATEGY_HEADER)
+#error L2_STRATEGY needs L2_STRATEGY_HEADER
+#endif
+
+class L2_STRATEGY;
+
+/// The strategy Simple calls, see above.
+typedef L2_STRATEGY BoundStrategy;
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef STRATEGY_LIST_H
+#define STRATEGY_LIST_H
+
+#include "InstrumentRegistry.h"
+
+class OrderBook;
+
+/// Several strategies sharing one feed handler.  Each callback is passed to
+/// every strategy in the order they are listed, through plain member calls
+/// the compiler can inline: there is no virtual dispatch and no loop over
+/// pointers.  The list holds references; the strategies outlive it.
+///
+/// Bind a list to Simple like any other strategy, see StrategyBinding.h.
+/// Strategies that send orders share Simple's RiskGate and OrderManager.
+template <class... Strategies>
+class StrategyList;
+
+template <>
+class StrategyList<>
+{
+public:
+	template <class TSimple>
+	void OnInit(TSimple &) {}
+
+	template <class TSimple>
+	void OnBookUpdate(TSimple &, InstrumentId, const OrderBook &) {}
+
+	template <class TSimple>
+	void OnLastTradeUpdate(TSimple &, InstrumentId, double, double) {}
+
+	template <class TSimple, class TSide>
+	void OnOrderFill(TSimple &, InstrumentId, TSide, double, double) {}
+
+	template <class TSimple, class TSide>
+	void OnOrderReject(TSimple &, InstrumentId, TSide, double) {}
+};
+
+template <class First, class... Rest>
+class StrategyList<First, Rest...> : private StrategyList<Rest...>
+{
+	typedef StrategyList<Rest...> Tail;
+
+public:
+	StrategyList(First & first, Rest &... rest)
+		: Tail(rest...),
+		  first_(first)
+	{ }
+
+	template <class TSimple>
+	void OnInit(TSimple & simple)
+	{
+		first_.OnInit(simple);
+		Tail::OnInit(simple);
+	}
+
+	template <class TSimple>
+	void OnBookUpdate(TSimple & simple, InstrumentId instrument, const OrderBook & book)
+	{
+		first_.OnBookUpdate(simple, instrument, book);
+		Tail::OnBookUpdate(simple, instrument, book);
+	}
+
+	template <class TSimple>
+	void OnLastTradeUpdate(TSimple & simple, InstrumentId instrument, double qty, double px)
+	{
+		first_.OnLastTradeUpdate(simple, instrument, qty, px);
+		Tail::OnLastTradeUpdate(simple, instrument, qty, px);
+	}
+
+	template <class TSimple, class TSide>
+	void OnOrderFill(TSimple & simple, InstrumentId instrument, TSide side, double qty, double px)
+	{
+		first_.OnOrderFill(simple, instrument, side, qty, px);
+		Tail::OnOrderFill(simple, instrument, side, qty, px);
+	}
+
+	template <class TSimple, class TSide>
+	void OnOrderReject(TSimple & simple, InstrumentId instrument, TSide side, double qty)
+	{
+		first_.OnOrderReject(simple, instrument, side, qty);
+		Tail::OnOrderReject(simple, instrument, side, qty);
+	}
+
+private:
+	First & first_;
+};
+
+#endif
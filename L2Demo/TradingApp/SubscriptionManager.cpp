@@ -0,0 +1,213 @@
+#include "SubscriptionManager.h"
+#include <algorithm>
+#include <quickfix/Session.h>
+#include "AsyncLog.h"
+
+// Instruments per MarketDataRequest and retries per instrument unless SetLimits() says otherwise.
+static const int DEFAULT_MAX_PER_REQUEST = 100;
+static const int DEFAULT_MAX_RETRIES = 3;
+
+const char* SubscriptionStateName(SubscriptionState state)
+{
+	switch(state)
+	{
+	case SUBSCRIPTION_NONE:
+		return "NONE";
+	case SUBSCRIPTION_QUEUED:
+		return "QUEUED";
+	case SUBSCRIPTION_REQUESTED:
+		return "REQUESTED";
+	case SUBSCRIPTION_REJECTED:
+		return "REJECTED";
+	default:
+		return "UNKNOWN";
+	}
+}
+
+SubscriptionManager::SubscriptionManager(InstrumentRegistry & instruments, IdService & ids)
+	: instruments_(instruments),
+	  ids_(ids),
+	  maxPerRequest_(DEFAULT_MAX_PER_REQUEST),
+	  maxRetries_(DEFAULT_MAX_RETRIES),
+	  requestsSent_(0)
+{ }
+
+void SubscriptionManager::SetLimits(int maxPerRequest, int maxRetries)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	maxPerRequest_ = maxPerRequest > 0 ? maxPerRequest : 1;
+	maxRetries_ = maxRetries >= 0 ? maxRetries : 0;
+}
+
+void SubscriptionManager::Add(InstrumentId instrument, int depth)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if(static_cast<size_t>(instrument) >= subscriptions_.size())
+	{
+		Subscription none = { 0, 0, SUBSCRIPTION_NONE };
+		subscriptions_.resize(instrument + 1, none);
+	}
+
+	Subscription & subscription = subscriptions_[instrument];
+	subscription.depth = depth;
+	subscription.retries = 0;
+	Queue(instrument);
+}
+
+void SubscriptionManager::Queue(InstrumentId instrument)
+{
+	if(SUBSCRIPTION_QUEUED == subscriptions_[instrument].state) return;
+	subscriptions_[instrument].state = SUBSCRIPTION_QUEUED;
+	queued_.push_back(instrument);
+}
+
+// Sending happens outside the lock: QuickFIX may call back into OnReject()
+// on its own thread while we wait for the session.
+void SubscriptionManager::Flush(const FIX::SessionID* session)
+{
+	std::vector<FIX42::MarketDataRequest> requests;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		BuildRequests(requests);
+		requestsSent_ += requests.size();
+	}
+
+	if(!session) return;
+	for(size_t i = 0; i < requests.size(); ++i)
+		FIX::Session::sendToTarget(requests[i], *session);
+}
+
+// Turn the queue into requests: one per depth, split at maxPerRequest_.
+void SubscriptionManager::BuildRequests(std::vector<FIX42::MarketDataRequest> & requests)
+{
+	std::stable_sort(queued_.begin(), queued_.end(), [this](InstrumentId a, InstrumentId b)
+	{
+		return subscriptions_[a].depth < subscriptions_[b].depth;
+	});
+
+	size_t i = 0;
+	while(i < queued_.size())
+	{
+		Request request;
+		request.depth = subscriptions_[queued_[i]].depth;
+		while(i < queued_.size() && subscriptions_[queued_[i]].depth == request.depth
+			&& request.instruments.size() < static_cast<size_t>(maxPerRequest_))
+		{
+			subscriptions_[queued_[i]].state = SUBSCRIPTION_REQUESTED;
+			request.instruments.push_back(queued_[i++]);
+		}
+
+		const std::string mdReqId = ids_.NextMDRequestId().str();
+		// Lets market data that only carries the MDReqID find its instrument:
+		if(request.instruments.size() == 1)
+			instruments_.MapRequest(mdReqId, request.instruments[0]);
+
+		requests.push_back(BuildRequest(mdReqId, request));
+		requests_[mdReqId] = request;
+	}
+	queued_.clear();
+}
+
+FIX42::MarketDataRequest SubscriptionManager::BuildRequest(const std::string & mdReqId, const Request & request) const
+{
+	// We want the latest snapshot, plus updates, for the requested number of levels:
+	FIX42::MarketDataRequest msg;
+	msg.set(FIX::MDReqID(mdReqId));
+	msg.set(FIX::SubscriptionRequestType(FIX::SubscriptionRequestType_SNAPSHOT_PLUS_UPDATES));
+	msg.set(FIX::MarketDepth(request.depth));
+	msg.set(FIX::MDUpdateType(FIX::MDUpdateType_INCREMENTAL_REFRESH));
+	msg.set(FIX::AggregatedBook(FIX::AggregatedBook_YES));
+
+	// We want best bid, best offer, and last trade notifications
+	FIX42::MarketDataRequest::NoMDEntryTypes marketDataEntryGroup;
+	marketDataEntryGroup.set(FIX::MDEntryType(FIX::MDEntryType_BID));
+	msg.addGroup(marketDataEntryGroup);
+	marketDataEntryGroup.set(FIX::MDEntryType(FIX::MDEntryType_OFFER));
+	msg.addGroup(marketDataEntryGroup);
+	marketDataEntryGroup.set(FIX::MDEntryType(FIX::MDEntryType_TRADE));
+	msg.addGroup(marketDataEntryGroup);
+
+	// Repeating group for the instruments to which we are subscribing:
+	for(size_t i = 0; i < request.instruments.size(); ++i)
+	{
+		const Instrument & instrument = instruments_.Get(request.instruments[i]);
+		FIX42::MarketDataRequest::NoRelatedSym symbolGroup;
+		symbolGroup.set(FIX::Symbol(instrument.symbol));
+		symbolGroup.set(FIX::MaturityMonthYear(instrument.maturityMonthYear));
+		symbolGroup.set(FIX::SecurityExchange(instrument.exchange));
+		symbolGroup.set(FIX::SecurityType("FUT"));
+		msg.addGroup(symbolGroup);
+	}
+	return msg;
+}
+
+void SubscriptionManager::OnReject(const std::string & mdReqId, const FIX::SessionID & session)
+{
+	std::vector<FIX42::MarketDataRequest> requests;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::map<std::string, Request>::iterator it = requests_.find(mdReqId);
+		if(it == requests_.end()) return;
+		const Request request = it->second;
+		requests_.erase(it);
+
+		if(request.instruments.size() > 1)
+		{
+			// Which one was it?  Ask for each on its own:
+			const int maxPerRequest = maxPerRequest_;
+			maxPerRequest_ = 1;
+			for(size_t i = 0; i < request.instruments.size(); ++i)
+				Queue(request.instruments[i]);
+			BuildRequests(requests);
+			maxPerRequest_ = maxPerRequest;
+		}
+		else
+		{
+			const InstrumentId id = request.instruments[0];
+			Subscription & subscription = subscriptions_[id];
+			if(subscription.retries >= maxRetries_)
+			{
+				subscription.state = SUBSCRIPTION_REJECTED;
+				const Instrument & instrument = instruments_.Get(id);
+				LOG_ERROR("Giving up on market data for {} {} after {} rejects",
+					instrument.symbol, instrument.maturityMonthYear, subscription.retries + 1);
+				return;
+			}
+			++subscription.retries;
+			Queue(id);
+			BuildRequests(requests);
+		}
+		requestsSent_ += requests.size();
+	}
+
+	for(size_t i = 0; i < requests.size(); ++i)
+		FIX::Session::sendToTarget(requests[i], session);
+}
+
+void SubscriptionManager::OnLogout()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	// The MDReqIDs die with the session:
+	requests_.clear();
+	for(size_t i = 0; i < subscriptions_.size(); ++i)
+	{
+		if(SUBSCRIPTION_REQUESTED == subscriptions_[i].state)
+		{
+			subscriptions_[i].retries = 0;
+			Queue(static_cast<InstrumentId>(i));
+		}
+	}
+}
+
+SubscriptionState SubscriptionManager::State(InstrumentId instrument) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return static_cast<size_t>(instrument) < subscriptions_.size() ? subscriptions_[instrument].state : SUBSCRIPTION_NONE;
+}
+
+size_t SubscriptionManager::RequestsSent() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return requestsSent_;
+}
@@ -0,0 +1,94 @@
+#ifndef SUBSCRIPTION_MANAGER_H
+#define SUBSCRIPTION_MANAGER_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <quickfix/SessionID.h>
+#include <quickfix/fix42/MarketDataRequest.h>
+#include "InstrumentRegistry.h"
+#include "IdService.h"
+
+enum SubscriptionState
+{
+	SUBSCRIPTION_NONE,
+	SUBSCRIPTION_QUEUED,        // waiting for the next Flush()
+	SUBSCRIPTION_REQUESTED,     // sent; no reject so far
+	SUBSCRIPTION_REJECTED       // rejected more often than we retry
+};
+
+const char* SubscriptionStateName(SubscriptionState state);
+
+/// Remembers what market data we asked for, so it can be asked for again.
+///
+/// Subscriptions are queued and sent in batches: one MarketDataRequest per
+/// depth with up to `maxPerRequest` NoRelatedSym entries.  A reject of a
+/// batched request resends its instruments one per request to find the bad
+/// one; a reject of a single instrument is retried up to `maxRetries` times.
+/// After a logout every subscription is queued again and goes out as soon as
+/// the market data session is back.
+///
+/// Batched requests rely on the venue naming the instrument in every market
+/// data message; venues that only echo the MDReqID need `maxPerRequest` 1.
+class SubscriptionManager
+{
+public:
+	SubscriptionManager(InstrumentRegistry & instruments, IdService & ids);
+
+	void SetLimits(int maxPerRequest, int maxRetries);
+
+	/// Queue a subscription to `depth` levels of a registered instrument.
+	void Add(InstrumentId instrument, int depth);
+
+	/// Send everything queued on `session`.  With no session (simulation)
+	/// subscriptions are marked requested without sending anything.
+	void Flush(const FIX::SessionID* session);
+
+	/// A MarketDataRequestReject for `mdReqId`; resends as described above.
+	void OnReject(const std::string & mdReqId, const FIX::SessionID & session);
+
+	/// The market data session went down: everything is to be requested again.
+	void OnLogout();
+
+	/// The market data session is up: send everything queued.
+	void OnLogon(const FIX::SessionID & session) { Flush(&session); }
+
+	SubscriptionState State(InstrumentId instrument) const;
+	size_t RequestsSent() const;
+
+private:
+	SubscriptionManager(const SubscriptionManager&) = delete;
+	SubscriptionManager& operator=(const SubscriptionManager&) = delete;
+
+	struct Subscription
+	{
+		int depth;
+		int retries;
+		SubscriptionState state;
+	};
+
+	/// What one MDReqID asked for.
+	struct Request
+	{
+		int depth;
+		std::vector<InstrumentId> instruments;
+	};
+
+	void Queue(InstrumentId instrument);
+	void BuildRequests(std::vector<FIX42::MarketDataRequest> & requests);
+	FIX42::MarketDataRequest BuildRequest(const std::string & mdReqId, const Request & request) const;
+
+	InstrumentRegistry & instruments_;
+	IdService & ids_;
+	int maxPerRequest_;
+	int maxRetries_;
+
+	mutable std::mutex mutex_;
+	std::vector<Subscription> subscriptions_;       // indexed by InstrumentId
+	std::vector<InstrumentId> queued_;
+	std::map<std::string, Request> requests_;       // outstanding, by MDReqID
+	size_t requestsSent_;
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "TickJournal.h"
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <stdexcept>
+
+static const char JOURNAL_MAGIC[8] = "L2TICKJ";
+static const uint32_t JOURNAL_VERSION = 1;
+
+const char* TickTypeLabel(TickType type)
+{
+	switch(type)
+	{
+	case TICK_BID:
+		return "BID";
+	case TICK_OFFER:
+		return "OFFER";
+	case TICK_TRADE:
+		return "Last Trade";
+	default:
+		return "UNKNOWN";
+	}
+}
+
+bool ParseTextTick(const string & line, TickRecord & record)
+{
+	const size_t pxStart = line.find_last_of(' ');
+	if(pxStart == string::npos || pxStart == 0) return false;
+	const size_t qtyStart = line.find_last_of(' ', pxStart - 1);
+	const size_t labelStart = line.find(' ');
+	if(qtyStart == string::npos || labelStart >= qtyStart) return false;
+
+	const char* p = line.c_str();
+	const char* label = p + labelStart + 1;
+	const size_t labelSize = qtyStart - labelStart - 1;
+	int type = TICK_BID;
+	for(; type <= TICK_TRADE; ++type)
+	{
+		const char* expected = TickTypeLabel(static_cast<TickType>(type));
+		if(std::strlen(expected) == labelSize && std::strncmp(label, expected, labelSize) == 0) break;
+	}
+	if(type > TICK_TRADE) return false;
+
+	record.time = std::strtoll(p, nullptr, 10);
+	record.qty = std::strtod(p + qtyStart + 1, nullptr);
+	record.px = std::strtod(p + pxStart + 1, nullptr);
+	record.type = static_cast<uint8_t>(type);
+	std::memset(record.reserved, 0, sizeof(record.reserved));
+	return true;
+}
+
+TickJournal::TickJournal(const string & path, size_t capacity, size_t ringSize)
+	: ring_(ringSize),
+	  committed_(0),
+	  running_(true)
+{
+	file_.Open(path, sizeof(TickJournalHeader) + capacity * sizeof(TickRecord));
+
+	TickJournalHeader* header = Header();
+	if(header->version == 0)
+	{
+		std::memcpy(header->magic, JOURNAL_MAGIC, sizeof(header->magic));
+		header->version = JOURNAL_VERSION;
+		header->recordSize = sizeof(TickRecord);
+		header->count = 0;
+		header->created = static_cast<int64_t>(time(nullptr));
+	}
+	else if(std::memcmp(header->magic, JOURNAL_MAGIC, sizeof(header->magic)) != 0 || header->recordSize != sizeof(TickRecord))
+	{
+		throw std::runtime_error("[TickJournal] " + path + " is not a tick journal");
+	}
+	header->capacity = (file_.Size() - sizeof(TickJournalHeader)) / sizeof(TickRecord);
+	committed_.store(header->count);
+
+	writer_ = std::thread(&TickJournal::WriterLoop, this);
+}
+
+TickJournal::~TickJournal()
+{
+	running_.store(false, std::memory_order_release);
+	writer_.join();
+	file_.Flush();
+}
+
+void TickJournal::Append(time_t time, TickType type, double qty, double px)
+{
+	TickRecord record;
+	record.time = static_cast<int64_t>(time);
+	record.qty = qty;
+	record.px = px;
+	record.type = static_cast<uint8_t>(type);
+	std::memset(record.reserved, 0, sizeof(record.reserved));
+
+	while(!ring_.TryPush(record))
+		CpuRelax();
+}
+
+uint64_t TickJournal::Count() const
+{
+	return committed_.load(std::memory_order_acquire);
+}
+
+TickJournalHeader* TickJournal::Header() const
+{
+	return reinterpret_cast<TickJournalHeader*>(file_.Data());
+}
+
+// Copy everything currently in the ring into the file and publish the new count.
+size_t TickJournal::Drain()
+{
+	size_t total = 0;
+	for(;;)
+	{
+		size_t n = 0;
+		const TickRecord* records = ring_.Peek(4096, n);
+		if(n == 0) break;
+
+		TickJournalHeader* header = Header();
+		if(header->count + n > header->capacity)
+		{
+			// Double, but never to less than the batch needs:
+			uint64_t capacity = 2 * header->capacity;
+			if(capacity < header->count + n) capacity = header->count + n;
+			file_.Resize(sizeof(TickJournalHeader) + capacity * sizeof(TickRecord));
+			header = Header();
+			header->capacity = (file_.Size() - sizeof(TickJournalHeader)) / sizeof(TickRecord);
+		}
+
+		TickRecord* out = reinterpret_cast<TickRecord*>(file_.Data() + sizeof(TickJournalHeader));
+		std::memcpy(out + header->count, records, n * sizeof(TickRecord));
+		header->count += n;
+		ring_.Release(n);
+		committed_.store(header->count, std::memory_order_release);
+		total += n;
+	}
+	return total;
+}
+
+void TickJournal::WriterLoop()
+{
+	while(running_.load(std::memory_order_acquire))
+	{
+		if(Drain() == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	Drain();
+}
+
+TickJournalReader::TickJournalReader(const string & path)
+	: records_(nullptr),
+	  count_(0)
+{
+	file_.OpenReadOnly(path);
+
+	const TickJournalHeader* header = reinterpret_cast<const TickJournalHeader*>(file_.Data());
+	if(file_.Size() < sizeof(TickJournalHeader)
+		|| std::memcmp(header->magic, JOURNAL_MAGIC, sizeof(header->magic)) != 0
+		|| header->recordSize != sizeof(TickRecord))
+	{
+		throw std::runtime_error("[TickJournalReader] " + path + " is not a tick journal");
+	}
+
+	records_ = reinterpret_cast<const TickRecord*>(file_.Data() + sizeof(TickJournalHeader));
+	count_ = header->count;
+	uint64_t fit = (file_.Size() - sizeof(TickJournalHeader)) / sizeof(TickRecord);
+	if(count_ > fit) count_ = fit;
+}
@@ -0,0 +1,104 @@
+#ifndef TICK_JOURNAL_H
+#define TICK_JOURNAL_H
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include "MappedFile.h"
+#include "SpscRing.h"
+
+using std::string;
+
+/// Kind of market data update stored in a TickRecord.
+enum TickType
+{
+	TICK_BID = 0,
+	TICK_OFFER = 1,
+	TICK_TRADE = 2
+};
+
+/// Label used for a TickType in the Write2Txt text format.
+const char* TickTypeLabel(TickType type);
+
+/// One fixed-size journal record.
+struct TickRecord
+{
+	int64_t time;       // seconds since the epoch, as in the text files
+	double qty;
+	double px;
+	uint8_t type;       // TickType
+	uint8_t reserved[7];
+};
+
+/// Parse a Write2Txt text line, "<time> <label> <qty> <px>" with the time
+/// in seconds and a TickTypeLabel() label (which may hold a space, "Last
+/// Trade").  False, leaving `record` undefined, for any other line.
+bool ParseTextTick(const string & line, TickRecord & record);
+
+/// File header; the records follow immediately after it.
+struct TickJournalHeader
+{
+	char magic[8];      // "L2TICKJ"
+	uint32_t version;
+	uint32_t recordSize;
+	uint64_t capacity;  // records that fit in the file as currently sized
+	uint64_t count;     // records committed so far
+	int64_t created;
+	uint8_t reserved[24];
+};
+
+static_assert(sizeof(TickRecord) == 32, "TickRecord layout is part of the file format");
+static_assert(sizeof(TickJournalHeader) == 64, "TickJournalHeader layout is part of the file format");
+
+/// Append-only binary tick journal.  The market data thread pushes records
+/// into a lock-free ring and a background thread copies them into a
+/// preallocated memory-mapped file.
+class TickJournal
+{
+public:
+	/// Open (or continue) the journal at `path`, preallocating room for
+	/// `capacity` records.  The file doubles in size whenever it fills up.
+	TickJournal(const string & path, size_t capacity = 1 << 20, size_t ringSize = 1 << 16);
+	~TickJournal();
+
+	/// Called from the market data thread.  Spins if the writer has fallen a
+	/// whole ring behind rather than dropping the record.
+	void Append(time_t time, TickType type, double qty, double px);
+
+	/// Records committed to the file so far.
+	uint64_t Count() const;
+
+private:
+	TickJournal(const TickJournal&) = delete;
+	TickJournal& operator=(const TickJournal&) = delete;
+
+	void WriterLoop();
+	size_t Drain();
+	TickJournalHeader* Header() const;
+
+private:
+	MappedFile file_;
+	SpscRing<TickRecord> ring_;
+	std::atomic<uint64_t> committed_;
+	std::atomic<bool> running_;
+	std::thread writer_;
+};
+
+/// Read-only view of a journal file, used by the conversion tool.
+class TickJournalReader
+{
+public:
+	explicit TickJournalReader(const string & path);
+
+	uint64_t Count() const { return count_; }
+	const TickRecord & operator[](uint64_t i) const { return records_[i]; }
+
+private:
+	MappedFile file_;
+	const TickRecord* records_;
+	uint64_t count_;
+};
+
+#endif
@@ -0,0 +1,485 @@
+#include "TickStore.h"
+#include <cmath>
+#include <cstring>
+#include <chrono>
+#include <limits>
+#include <iostream>
+#include <stdexcept>
+
+static const char STORE_MAGIC[8] = "L2TSTOR";
+static const uint32_t STORE_VERSION = 1;
+
+// Room reserved for a new file; it doubles whenever a block does not fit.
+static const size_t INITIAL_FILE_SIZE = 1 << 20;
+
+// Worst case bytes for one encoded tick: three 10-byte varints and the type.
+static const size_t MAX_TICK_BYTES = 31;
+
+// Writer polls (about a millisecond each) without new ticks before partly
+// filled blocks are written out anyway.
+static const int IDLE_POLLS_BEFORE_FLUSH = 1000;
+
+// Record::type of a record that carries a new column rather than a tick.
+static const uint8_t ADD_COLUMN = 0xff;
+
+static const int64_t NS_PER_SECOND = 1000000000LL;
+static const int64_t NS_PER_DAY = 86400 * NS_PER_SECOND;
+
+static uint64_t ZigZag(int64_t value)
+{
+	return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t UnZigZag(uint64_t value)
+{
+	return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+static uint8_t* PutVarint(uint8_t* out, uint64_t value)
+{
+	while(value >= 0x80)
+	{
+		*out++ = static_cast<uint8_t>(value) | 0x80;
+		value >>= 7;
+	}
+	*out++ = static_cast<uint8_t>(value);
+	return out;
+}
+
+// False if the varint runs past `end`.
+static bool GetVarint(const uint8_t*& in, const uint8_t* end, uint64_t & value)
+{
+	value = 0;
+	for(int shift = 0; in < end && shift < 64; shift += 7)
+	{
+		uint8_t byte = *in++;
+		value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if(!(byte & 0x80)) return true;
+	}
+	return false;
+}
+
+static size_t RoundUp8(size_t size)
+{
+	return (size + 7) & ~static_cast<size_t>(7);
+}
+
+int TickStore::DayOf(int64_t timeNs)
+{
+	// Civil date from days since 1970-01-01 (proleptic Gregorian):
+	int64_t days = timeNs / NS_PER_DAY - (timeNs % NS_PER_DAY < 0 ? 1 : 0);
+	days += 719468;
+	const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+	const int64_t dayOfEra = days - era * 146097;
+	const int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+	const int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	const int64_t mp = (5 * dayOfYear + 2) / 153;
+	const int64_t day = dayOfYear - (153 * mp + 2) / 5 + 1;
+	const int64_t month = mp < 10 ? mp + 3 : mp - 9;
+	const int64_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+	return static_cast<int>(year * 10000 + month * 100 + day);
+}
+
+// Howard Hinnant's days_from_civil.
+int64_t TickStore::DaysFromCivil(int year, int month, int day)
+{
+	year -= month <= 2;
+	const int64_t era = (year >= 0 ? year : year - 399) / 400;
+	const int64_t yearOfEra = year - era * 400;
+	const int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	const int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	return era * 146097 + dayOfEra - 719468;
+}
+
+string TickStore::FileName(const string & directory, const string & symbol, const string & maturityMonthYear, int day)
+{
+	string path = directory;
+	if(!path.empty() && path[path.size() - 1] != '/' && path[path.size() - 1] != '\\') path += '/';
+	return path + symbol + '_' + maturityMonthYear + '_' + std::to_string(day) + ".ticks";
+}
+
+TickStore::TickStore(const string & directory, double defaultTickSize, size_t ringSize)
+	: directory_(directory),
+	  defaultTickSize_(defaultTickSize),
+	  ring_(ringSize),
+	  running_(true)
+{
+	if(!(defaultTickSize > 0))
+		throw std::invalid_argument("[TickStore] tick size must be positive");
+	writer_ = std::thread(&TickStore::WriterLoop, this);
+}
+
+TickStore::~TickStore()
+{
+	running_.store(false, std::memory_order_release);
+	writer_.join();
+	for(size_t i = 0; i < columns_.size(); ++i)
+		delete columns_[i];
+}
+
+void TickStore::SetTickSize(const string & symbol, double tickSize)
+{
+	if(!(tickSize > 0))
+		throw std::invalid_argument("[TickStore] tick size must be positive");
+	std::lock_guard<std::mutex> lock(tickSizesMutex_);
+	tickSizes_.push_back(std::make_pair(symbol, tickSize));
+}
+
+void TickStore::AddInstrument(InstrumentId instrument, const Instrument & details)
+{
+	Column* column = new Column;
+	column->symbol = details.symbol;
+	column->maturityMonthYear = details.maturityMonthYear;
+	column->tickSize = defaultTickSize_;
+	column->day = 0;
+	column->time.reserve(TICK_BLOCK_SIZE);
+	column->type.reserve(TICK_BLOCK_SIZE);
+	column->px.reserve(TICK_BLOCK_SIZE);
+	column->qty.reserve(TICK_BLOCK_SIZE);
+
+	// The writer takes the column off the ring ahead of the instrument's ticks:
+	Record record;
+	record.time = 0;
+	record.column = column;
+	record.px = 0;
+	record.instrument = instrument;
+	record.type = ADD_COLUMN;
+
+	while(!ring_.TryPush(record))
+		CpuRelax();
+}
+
+// Writer thread: put a column from AddInstrument() in place.
+void TickStore::Add(InstrumentId instrument, Column* column)
+{
+	{
+		std::lock_guard<std::mutex> lock(tickSizesMutex_);
+		for(size_t i = 0; i < tickSizes_.size(); ++i)
+		{
+			if(tickSizes_[i].first == column->symbol) column->tickSize = tickSizes_[i].second;
+		}
+	}
+	if(instrument < 0)
+	{
+		delete column;
+		return;
+	}
+	if(static_cast<size_t>(instrument) >= columns_.size()) columns_.resize(instrument + 1, nullptr);
+	if(columns_[instrument])
+	{
+		FlushBlock(*columns_[instrument]);
+		delete columns_[instrument];
+	}
+	columns_[instrument] = column;
+}
+
+void TickStore::Append(InstrumentId instrument, int64_t timeNs, TickType type, double qty, double px)
+{
+	Record record;
+	record.time = timeNs;
+	record.qty = qty;
+	record.px = px;
+	record.instrument = instrument;
+	record.type = static_cast<uint8_t>(type);
+
+	while(!ring_.TryPush(record))
+		CpuRelax();
+}
+
+void TickStore::WriterLoop()
+{
+	int idle = 0;
+	while(running_.load(std::memory_order_acquire))
+	{
+		if(Drain() != 0)
+		{
+			idle = 0;
+			continue;
+		}
+		if(++idle == IDLE_POLLS_BEFORE_FLUSH) FlushAll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	Drain();
+	FlushAll();
+}
+
+size_t TickStore::Drain()
+{
+	size_t total = 0;
+	for(;;)
+	{
+		size_t n = 0;
+		const Record* records = ring_.Peek(4096, n);
+		if(n == 0) break;
+
+		for(size_t i = 0; i < n; ++i)
+		{
+			const Record & record = records[i];
+			if(record.type == ADD_COLUMN)
+			{
+				Add(record.instrument, record.column);
+				continue;
+			}
+			// Ticks for instruments nobody named are dropped:
+			if(record.instrument >= 0 && static_cast<size_t>(record.instrument) < columns_.size() && columns_[record.instrument])
+				Write(*columns_[record.instrument], record);
+		}
+		ring_.Release(n);
+		total += n;
+	}
+	return total;
+}
+
+void TickStore::Write(Column & column, const Record & record)
+{
+	const int day = DayOf(record.time);
+	if(day != column.day)
+	{
+		FlushBlock(column);
+		Open(column, day);
+	}
+	if(!column.file.IsOpen()) return;
+
+	column.time.push_back(record.time);
+	column.type.push_back(record.type);
+	column.px.push_back(std::llround(record.px / column.tickSize));
+	column.qty.push_back(std::llround(record.qty));
+	if(column.time.size() == TICK_BLOCK_SIZE)
+		FlushBlock(column);
+}
+
+// Switch the column to the file for `day`, continuing it if it exists.
+void TickStore::Open(Column & column, int day)
+{
+	column.day = day;
+	column.file.Close();
+
+	const string path = FileName(directory_, column.symbol, column.maturityMonthYear, day);
+	try
+	{
+		column.file.Open(path, INITIAL_FILE_SIZE);
+	}
+	catch(std::exception & e)
+	{
+		std::cerr << "[TickStore] " << e.what() << ", dropping ticks for " << column.symbol << std::endl;
+		return;
+	}
+
+	TickStoreHeader* header = reinterpret_cast<TickStoreHeader*>(column.file.Data());
+	if(header->version == 0)
+	{
+		std::memset(header, 0, sizeof(*header));
+		std::memcpy(header->magic, STORE_MAGIC, sizeof(header->magic));
+		header->version = STORE_VERSION;
+		header->blockSize = TICK_BLOCK_SIZE;
+		header->tickSize = column.tickSize;
+		header->day = day;
+		header->used = sizeof(TickStoreHeader);
+		header->minTime = std::numeric_limits<int64_t>::max();
+		header->maxTime = std::numeric_limits<int64_t>::min();
+		const string name = column.symbol + ' ' + column.maturityMonthYear;
+		std::strncpy(header->instrument, name.c_str(), sizeof(header->instrument) - 1);
+	}
+	else if(std::memcmp(header->magic, STORE_MAGIC, sizeof(header->magic)) != 0 || header->version != STORE_VERSION)
+	{
+		std::cerr << "[TickStore] " << path << " is not a tick store, dropping ticks for " << column.symbol << std::endl;
+		column.file.Close();
+	}
+	else
+	{
+		// Prices in an existing file stay in the units it was started with:
+		column.tickSize = header->tickSize;
+	}
+}
+
+// Encode the ticks collected for the column as one block at the end of its file.
+void TickStore::FlushBlock(Column & column)
+{
+	const size_t count = column.time.size();
+	if(count == 0 || !column.file.IsOpen()) return;
+
+	TickStoreHeader* header = reinterpret_cast<TickStoreHeader*>(column.file.Data());
+	const size_t worst = sizeof(TickBlockHeader) + count * MAX_TICK_BYTES + 8;
+	if(header->used + worst > column.file.Size())
+	{
+		size_t size = 2 * column.file.Size();
+		if(size < header->used + worst) size = header->used + worst;
+		column.file.Resize(size);
+		header = reinterpret_cast<TickStoreHeader*>(column.file.Data());
+	}
+
+	uint8_t* start = reinterpret_cast<uint8_t*>(column.file.Data()) + header->used;
+	TickBlockHeader* block = reinterpret_cast<TickBlockHeader*>(start);
+	uint8_t* out = start + sizeof(TickBlockHeader);
+
+	int64_t minTime = column.time[0];
+	int64_t maxTime = column.time[0];
+	int64_t previous = column.time[0];
+	for(size_t i = 0; i < count; ++i)
+	{
+		const int64_t t = column.time[i];
+		if(t < minTime) minTime = t;
+		if(t > maxTime) maxTime = t;
+		out = PutVarint(out, ZigZag(t - previous));
+		previous = t;
+	}
+	block->timeBytes = static_cast<uint32_t>(out - start - sizeof(TickBlockHeader));
+
+	std::memcpy(out, &column.type[0], count);
+	out += count;
+
+	uint8_t* pxStart = out;
+	previous = column.px[0];
+	for(size_t i = 0; i < count; ++i)
+	{
+		out = PutVarint(out, ZigZag(column.px[i] - previous));
+		previous = column.px[i];
+	}
+	block->pxBytes = static_cast<uint32_t>(out - pxStart);
+
+	for(size_t i = 0; i < count; ++i)
+		out = PutVarint(out, static_cast<uint64_t>(column.qty[i] > 0 ? column.qty[i] : 0));
+
+	block->minTime = minTime;
+	block->maxTime = maxTime;
+	block->firstTime = column.time[0];
+	block->firstPx = column.px[0];
+	block->count = static_cast<uint32_t>(count);
+	block->size = static_cast<uint32_t>(RoundUp8(out - start));
+
+	// Publish the block only once it is complete:
+	header->used += block->size;
+	header->blockCount += 1;
+	header->tickCount += count;
+	if(minTime < header->minTime) header->minTime = minTime;
+	if(maxTime > header->maxTime) header->maxTime = maxTime;
+
+	column.time.clear();
+	column.type.clear();
+	column.px.clear();
+	column.qty.clear();
+}
+
+void TickStore::FlushAll()
+{
+	for(size_t i = 0; i < columns_.size(); ++i)
+	{
+		if(!columns_[i]) continue;
+		FlushBlock(*columns_[i]);
+		if(columns_[i]->file.IsOpen()) columns_[i]->file.Flush();
+	}
+}
+
+TickStoreReader::TickStoreReader(const string & path)
+	: header_(nullptr)
+{
+	file_.OpenReadOnly(path);
+
+	header_ = reinterpret_cast<const TickStoreHeader*>(file_.Data());
+	if(file_.Size() < sizeof(TickStoreHeader)
+		|| std::memcmp(header_->magic, STORE_MAGIC, sizeof(header_->magic)) != 0
+		|| header_->version != STORE_VERSION)
+	{
+		throw std::runtime_error("[TickStoreReader] " + path + " is not a tick store");
+	}
+
+	// Index the blocks; stop at anything that does not look like one.
+	const char* end = file_.Data() + (header_->used < file_.Size() ? header_->used : file_.Size());
+	const char* p = file_.Data() + sizeof(TickStoreHeader);
+	while(p + sizeof(TickBlockHeader) <= end)
+	{
+		const TickBlockHeader* block = reinterpret_cast<const TickBlockHeader*>(p);
+		if(block->size < sizeof(TickBlockHeader) || block->size > static_cast<size_t>(end - p)) break;
+		blocks_.push_back(block);
+		p += block->size;
+	}
+}
+
+TickStoreReader::Cursor TickStoreReader::All() const
+{
+	return Query(std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max());
+}
+
+TickStoreReader::Cursor::Cursor(const TickStoreReader & reader, int64_t from, int64_t to)
+	: reader_(reader),
+	  from_(from),
+	  to_(to),
+	  block_(0),
+	  time_(TICK_BLOCK_SIZE),
+	  type_(TICK_BLOCK_SIZE),
+	  px_(TICK_BLOCK_SIZE),
+	  qty_(TICK_BLOCK_SIZE)
+{ }
+
+bool TickStoreReader::Cursor::Next(TickBatch & batch)
+{
+	const double tickSize = reader_.header_->tickSize;
+
+	while(block_ < reader_.blocks_.size())
+	{
+		const TickBlockHeader* block = reader_.blocks_[block_++];
+		if(block->maxTime < from_ || block->minTime >= to_ || block->count == 0) continue;
+
+		const size_t count = block->count;
+		if(count > time_.size())
+		{
+			time_.resize(count);
+			type_.resize(count);
+			px_.resize(count);
+			qty_.resize(count);
+		}
+
+		const uint8_t* in = reinterpret_cast<const uint8_t*>(block) + sizeof(TickBlockHeader);
+		const uint8_t* end = reinterpret_cast<const uint8_t*>(block) + block->size;
+		const uint8_t* types = in + block->timeBytes;
+		const uint8_t* pxIn = types + count;
+		const uint8_t* qtyIn = pxIn + block->pxBytes;
+		if(qtyIn > end) continue;
+
+		// Decode all columns, then keep the ticks inside the range:
+		int64_t t = block->firstTime;
+		int64_t px = block->firstPx;
+		size_t kept = 0;
+		bool ok = true;
+		for(size_t i = 0; i < count && ok; ++i)
+		{
+			uint64_t timeDelta, pxDelta, qty;
+			ok = GetVarint(in, types, timeDelta) && GetVarint(pxIn, qtyIn, pxDelta) && GetVarint(qtyIn, end, qty);
+			t += UnZigZag(timeDelta);
+			px += UnZigZag(pxDelta);
+			if(!ok || t < from_ || t >= to_) continue;
+
+			time_[kept] = t;
+			type_[kept] = types[i];
+			px_[kept] = px * tickSize;
+			qty_[kept] = static_cast<double>(qty);
+			++kept;
+		}
+		if(kept == 0) continue;
+
+		batch.time = &time_[0];
+		batch.type = &type_[0];
+		batch.px = &px_[0];
+		batch.qty = &qty_[0];
+		batch.count = kept;
+		return true;
+	}
+	return false;
+}
+
+uint64_t TickStoreReader::ExportText(std::ostream & out, int64_t from, int64_t to) const
+{
+	uint64_t written = 0;
+	Cursor cursor = Query(from, to);
+	TickBatch batch;
+	while(cursor.Next(batch))
+	{
+		for(size_t i = 0; i < batch.count; ++i)
+		{
+			out << batch.time[i] / NS_PER_SECOND << ' ' << TickTypeLabel(static_cast<TickType>(batch.type[i]))
+				<< ' ' << batch.qty[i] << ' ' << batch.px[i] << '\n';
+		}
+		written += batch.count;
+	}
+	return written;
+}
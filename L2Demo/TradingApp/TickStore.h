@@ -0,0 +1,208 @@
+#ifndef TICK_STORE_H
+#define TICK_STORE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <ostream>
+#include <cstdint>
+#include "MappedFile.h"
+#include "SpscRing.h"
+#include "TickJournal.h"
+#include "InstrumentRegistry.h"
+
+using std::string;
+
+// Columnar tick files, one per instrument per UTC day.
+//
+// A file is a header followed by blocks of up to TICK_BLOCK_SIZE ticks.
+// Each block stores its ticks column by column:
+//   time   nanoseconds since the epoch, zigzag varint delta from the previous tick
+//   type   one byte per tick (TickType)
+//   px     price in ticks of the file's tick size, zigzag varint delta
+//   qty    varint; sizes are whole numbers of contracts
+// Readers map the file, find the blocks that overlap a time range from
+// their headers and decode only those.
+
+/// Ticks per block; also the size of a decoded TickBatch.
+enum { TICK_BLOCK_SIZE = 4096 };
+
+struct TickStoreHeader
+{
+	char magic[8];          // "L2TSTOR"
+	uint32_t version;
+	uint32_t blockSize;     // TICK_BLOCK_SIZE when written
+	double tickSize;
+	int32_t day;            // YYYYMMDD, UTC
+	uint32_t reserved0;
+	uint64_t blockCount;
+	uint64_t used;          // bytes of header and complete blocks
+	uint64_t tickCount;
+	int64_t minTime;
+	int64_t maxTime;
+	char instrument[56];    // "SYMBOL MATURITY", for humans
+};
+
+struct TickBlockHeader
+{
+	int64_t minTime;
+	int64_t maxTime;
+	int64_t firstTime;      // time deltas start from here
+	int64_t firstPx;        // and price deltas from here, in ticks
+	uint32_t count;
+	uint32_t size;          // bytes, including this header
+	uint32_t timeBytes;
+	uint32_t pxBytes;       // the type column (count bytes) sits between time and px
+};
+
+static_assert(sizeof(TickStoreHeader) == 128, "TickStoreHeader layout is part of the file format");
+static_assert(sizeof(TickBlockHeader) == 48, "TickBlockHeader layout is part of the file format");
+
+/// Writes ticks into per-instrument, per-day tick store files under a
+/// directory.  Like TickJournal, the market data thread only pushes into a
+/// lock-free ring; a background thread encodes and appends the blocks.
+/// New instruments go through the same ring, so the market data thread
+/// never waits for the writer.
+class TickStore
+{
+public:
+	/// Prices are stored in units of `defaultTickSize` unless SetTickSize()
+	/// names another for the symbol.  Prices off that grid are rounded to it.
+	TickStore(const string & directory, double defaultTickSize = 0.01, size_t ringSize = 1 << 16);
+	~TickStore();
+
+	/// Call before the instrument's first tick.
+	void SetTickSize(const string & symbol, double tickSize);
+
+	/// Name the instrument's files.  Call once per instrument before its
+	/// first Append(), from the thread that calls Append().
+	void AddInstrument(InstrumentId instrument, const Instrument & details);
+
+	/// Called from the market data thread.  Spins if the writer has fallen a
+	/// whole ring behind rather than dropping the tick.
+	void Append(InstrumentId instrument, int64_t timeNs, TickType type, double qty, double px);
+
+	/// "<directory>/<symbol>_<maturity>_<YYYYMMDD>.ticks"
+	static string FileName(const string & directory, const string & symbol, const string & maturityMonthYear, int day);
+
+	/// UTC date of a timestamp as YYYYMMDD.
+	static int DayOf(int64_t timeNs);
+
+	/// Days since 1970-01-01 of a proleptic Gregorian date; the inverse of DayOf().
+	static int64_t DaysFromCivil(int year, int month, int day);
+
+private:
+	TickStore(const TickStore&) = delete;
+	TickStore& operator=(const TickStore&) = delete;
+
+	struct Column;
+
+	/// A tick, or with type ADD_COLUMN a new instrument's column.
+	struct Record
+	{
+		int64_t time;
+		union
+		{
+			double qty;
+			Column* column;
+		};
+		double px;
+		InstrumentId instrument;
+		uint8_t type;
+	};
+
+	/// One instrument's open file and the block being filled.  Writer thread only.
+	struct Column
+	{
+		string symbol;
+		string maturityMonthYear;
+		double tickSize;
+		int day;
+		MappedFile file;
+		std::vector<int64_t> time;
+		std::vector<uint8_t> type;
+		std::vector<int64_t> px;
+		std::vector<int64_t> qty;
+	};
+
+	void WriterLoop();
+	size_t Drain();
+	void Add(InstrumentId instrument, Column* column);
+	void Write(Column & column, const Record & record);
+	void Open(Column & column, int day);
+	void FlushBlock(Column & column);
+	void FlushAll();
+
+	string directory_;
+	double defaultTickSize_;
+	SpscRing<Record> ring_;
+
+	std::vector<Column*> columns_;                          // writer thread only
+	std::mutex tickSizesMutex_;
+	std::vector<std::pair<string, double> > tickSizes_;
+
+	std::atomic<bool> running_;
+	std::thread writer_;
+};
+
+/// A decoded run of ticks, column by column.  Valid until the next Next().
+struct TickBatch
+{
+	const int64_t* time;
+	const uint8_t* type;
+	const double* px;
+	const double* qty;
+	size_t count;
+};
+
+/// Read-only view of one tick store file.
+class TickStoreReader
+{
+public:
+	explicit TickStoreReader(const string & path);
+
+	const TickStoreHeader & Header() const { return *header_; }
+	uint64_t Count() const { return header_->tickCount; }
+	size_t BlockCount() const { return blocks_.size(); }
+
+	/// Iterates over the ticks with `from <= time < to`, a block at a time.
+	/// The columns are decoded straight out of the mapping into buffers the
+	/// cursor reuses, so a query allocates only when the cursor is created.
+	class Cursor
+	{
+	public:
+		Cursor(const TickStoreReader & reader, int64_t from, int64_t to);
+
+		/// False when the range is exhausted.
+		bool Next(TickBatch & batch);
+
+	private:
+		const TickStoreReader & reader_;
+		int64_t from_;
+		int64_t to_;
+		size_t block_;
+		std::vector<int64_t> time_;
+		std::vector<uint8_t> type_;
+		std::vector<double> px_;
+		std::vector<double> qty_;
+	};
+
+	Cursor Query(int64_t from, int64_t to) const { return Cursor(*this, from, to); }
+	Cursor All() const;
+
+	/// Write the ticks in [from, to) as Write2Txt text lines: "time type qty px",
+	/// with the time in whole seconds.  Returns the number of ticks written.
+	uint64_t ExportText(std::ostream & out, int64_t from, int64_t to) const;
+
+private:
+	TickStoreReader(const TickStoreReader&) = delete;
+	TickStoreReader& operator=(const TickStoreReader&) = delete;
+
+	MappedFile file_;
+	const TickStoreHeader* header_;
+	std::vector<const TickBlockHeader*> blocks_;
+};
+
+#endif
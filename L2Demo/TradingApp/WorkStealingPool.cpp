@@ -0,0 +1,91 @@
+#include "WorkStealingPool.h"
+#include <thread>
+
+static int DefaultThreads()
+{
+	unsigned n = std::thread::hardware_concurrency();
+	return n > 0 ? static_cast<int>(n) : 1;
+}
+
+WorkStealingPool::WorkStealingPool(int threads)
+	: threads_(threads > 0 ? threads : DefaultThreads()),
+	  steals_(0)
+{ }
+
+void WorkStealingPool::Run(size_t count, const std::function<void(size_t, int)> & task)
+{
+	steals_.store(0);
+	error_ = std::exception_ptr();
+
+	// Contiguous shares: neighbouring tasks tend to be similar in cost, and
+	// a worker only goes to someone else's deque once its own is empty.
+	queues_.clear();
+	for(int i = 0; i < threads_; ++i)
+	{
+		Queue* queue = new Queue;
+		size_t begin = count * i / threads_;
+		size_t end = count * (i + 1) / threads_;
+		for(size_t t = begin; t < end; ++t)
+			queue->tasks.push_back(t);
+		queues_.push_back(queue);
+	}
+
+	std::vector<std::thread> workers;
+	for(int i = 1; i < threads_; ++i)
+		workers.push_back(std::thread(&WorkStealingPool::Work, this, i, std::cref(task)));
+	Work(0, task);
+	for(size_t i = 0; i < workers.size(); ++i)
+		workers[i].join();
+
+	for(size_t i = 0; i < queues_.size(); ++i)
+		delete queues_[i];
+	queues_.clear();
+
+	if(error_) std::rethrow_exception(error_);
+}
+
+// Own work comes off the back, in the reverse of the order it was queued.
+bool WorkStealingPool::Pop(int worker, size_t & task)
+{
+	Queue & queue = *queues_[worker];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if(queue.tasks.empty()) return false;
+	task = queue.tasks.back();
+	queue.tasks.pop_back();
+	return true;
+}
+
+// Thieves take from the front, the end the owner will reach last.
+bool WorkStealingPool::Steal(int worker, size_t & task)
+{
+	for(int i = 1; i < threads_; ++i)
+	{
+		Queue & victim = *queues_[(worker + i) % threads_];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if(victim.tasks.empty()) continue;
+		task = victim.tasks.front();
+		victim.tasks.pop_front();
+		steals_.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+// No task is ever added once Run() has started, so a worker that finds
+// every deque empty can stop.
+void WorkStealingPool::Work(int worker, const std::function<void(size_t, int)> & task)
+{
+	size_t index;
+	while(Pop(worker, index) || Steal(worker, index))
+	{
+		try
+		{
+			task(index, worker);
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(errorMutex_);
+			if(!error_) error_ = std::current_exception();
+		}
+	}
+}
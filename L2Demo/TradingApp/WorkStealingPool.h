@@ -0,0 +1,65 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include "Platform.h"
+
+/// Runs a batch of independent tasks, numbered 0..count-1, on a fixed number
+/// of threads.  Each worker starts with a contiguous share of the tasks in its
+/// own deque and takes from the back of it; a worker that runs dry steals
+/// from the front of someone else's, so a few slow tasks cannot leave the
+/// other cores idle at the end of a batch.
+///
+/// The tasks are expected to be coarse (a whole backtest run each), so each
+/// deque is guarded by its own mutex: the lock is taken once per task and is
+/// only ever contended by a thief.
+class WorkStealingPool
+{
+public:
+	/// `threads` <= 0 uses one thread per hardware thread.
+	explicit WorkStealingPool(int threads = 0);
+
+	/// Call `task(index, worker)` once for every index in [0, count) and
+	/// return when all have finished.  The calling thread is worker 0.  If a
+	/// task throws, the remaining tasks still run and the first exception is
+	/// rethrown here.
+	void Run(size_t count, const std::function<void(size_t, int)> & task);
+
+	int Threads() const { return threads_; }
+
+	/// Tasks taken from another worker's deque during the last Run().
+	uint64_t Steals() const { return steals_.load(); }
+
+private:
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	// Padded so that two workers never write to the same cache line.
+	struct Queue
+	{
+		char pad0[CACHE_LINE_SIZE];
+		std::mutex mutex;
+		std::deque<size_t> tasks;
+		char pad1[CACHE_LINE_SIZE];
+	};
+
+	bool Pop(int worker, size_t & task);
+	bool Steal(int worker, size_t & task);
+	void Work(int worker, const std::function<void(size_t, int)> & task);
+
+	const int threads_;
+	std::vector<Queue*> queues_;
+	std::atomic<uint64_t> steals_;
+
+	std::mutex errorMutex_;
+	std::exception_ptr error_;
+};
+
+#endif
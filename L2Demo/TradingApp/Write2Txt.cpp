@@ -6,10 +6,46 @@ Write2Txt::Write2Txt(string s1) :s1_(s1)
 
 }
 
+Write2Txt::Write2Txt(string s1, TickFormat format) :s1_(s1)
+{
+	if (TICK_FORMAT_JOURNAL == format)
+		journal_.reset(new TickJournal(s1_));
+	else if (TICK_FORMAT_STORE == format)
+		store_.reset(new TickStore(s1_));
+}
+
 void Write2Txt::Write_txt_file(time_t time, string simple, double qty, double px){
 
 	outfile.open(s1_, std::ios_base::app);
 	outfile << time << ' ' << simple << ' ' << qty << ' ' << px << endl;
 	outfile.close();
 
-}
\ No newline at end of file
+}
+
+void Write2Txt::Write_tick(time_t time, TickType type, double qty, double px){
+
+	if (journal_)
+		journal_->Append(time, type, qty, px);
+	else
+		Write_txt_file(time, TickTypeLabel(type), qty, px);
+
+}
+
+void Write2Txt::Write_tick(InstrumentId instrument, const Instrument & details, int64_t timeNs, TickType type, double qty, double px){
+
+	if (!store_)
+	{
+		Write_tick(static_cast<time_t>(timeNs / 1000000000), type, qty, px);
+		return;
+	}
+
+	if (static_cast<size_t>(instrument) >= storeInstruments_.size())
+		storeInstruments_.resize(instrument + 1, 0);
+	if (!storeInstruments_[instrument])
+	{
+		store_->AddInstrument(instrument, details);
+		storeInstruments_[instrument] = 1;
+	}
+	store_->Append(instrument, timeNs, type, qty, px);
+
+}
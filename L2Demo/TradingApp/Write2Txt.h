@@ -2,9 +2,12 @@
 #define Write2Txt_H
 
 #include "Simple.h"
+#include "TickJournal.h"
+#include "TickStore.h"
 #include <iostream>
 #include <fstream>		// To read from or write to a file
 #include <ctime>
+#include <memory>
 
 using std::time_t;
 using std::string;
@@ -13,17 +16,41 @@ using std::endl;
 using std::cerr;
 using std::fstream;
 
+/// Where Write2Txt puts ticks.
+enum TickFormat
+{
+	TICK_FORMAT_TEXT,       // "time type qty px" lines appended to a file
+	TICK_FORMAT_JOURNAL,    // a TickJournal file
+	TICK_FORMAT_STORE       // a TickStore directory of per-instrument, per-day files
+};
+
 class Write2Txt
 {
 public:
 	Write2Txt(string s1);
 
+	/// s1 is the text file, the journal file or the tick store directory.
+	/// Use TickJournalDump or TickStoreExport to get text back from the
+	/// binary formats.
+	Write2Txt(string s1, TickFormat format);
+
 	void Write_txt_file(time_t time, string simple, double qty, double px);
 
+	/// Record one tick; goes to the journal in journal mode, otherwise to the text file.
+	void Write_tick(time_t time, TickType type, double qty, double px);
+
+	/// Record one tick for an instrument with a nanosecond timestamp.  Only
+	/// the tick store keeps the instrument and the nanoseconds; the other
+	/// formats get Write_tick(time, type, qty, px).
+	void Write_tick(InstrumentId instrument, const Instrument & details, int64_t timeNs, TickType type, double qty, double px);
+
 private:
 	ofstream outfile;
 	string s1_;
+	std::unique_ptr<TickJournal> journal_;
+	std::unique_ptr<TickStore> store_;
+	std::vector<char> storeInstruments_;    // instruments named to store_, by InstrumentId
 
 };
 
-#endif
\ No newline at end of file
+#endif